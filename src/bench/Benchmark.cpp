@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "benchmark.h"
+
+#include <algorithm>
+
+const int BenchmarkRunner::DEFAULT_SAMPLE_COUNT = 7;
+const int BenchmarkRunner::DEFAULT_SAMPLE_TIME = 200;
+const int BenchmarkRunner::MAX_ITERATIONS = 100000000;
+
+const double BenchmarkResult::getMin() const
+{
+	if ( m_samples.empty() ) {
+		return 0;
+	}
+
+	return *std::min_element(m_samples.begin(),m_samples.end());
+}
+
+const double BenchmarkResult::getMax() const
+{
+	if ( m_samples.empty() ) {
+		return 0;
+	}
+
+	return *std::max_element(m_samples.begin(),m_samples.end());
+}
+
+const double BenchmarkResult::getMedian() const
+{
+	if ( m_samples.empty() ) {
+		return 0;
+	}
+
+	std::vector<double> samples = m_samples;
+	std::sort(samples.begin(),samples.end());
+
+	size_t middle = samples.size()/2;
+	if ( samples.size()%2==0 ) {
+		return (samples[middle-1]+samples[middle])/2;
+	}
+
+	return samples[middle];
+}
+
+BenchmarkRunner::~BenchmarkRunner()
+{
+	while ( !m_benchmarks.empty() ) {
+		delete m_benchmarks.front();
+		m_benchmarks.pop_front();
+	}
+}
+
+bool BenchmarkRunner::run(std::vector<BenchmarkResult> &results)
+{
+	bool success = true;
+
+	std::list<Benchmark*>::iterator iter;
+	for ( iter=m_benchmarks.begin(); iter!=m_benchmarks.end(); iter++ )
+	{
+		Benchmark *benchmark = *iter;
+		if ( !m_filter.empty() && benchmark->getName().find(m_filter)==std::string::npos ) {
+			continue;
+		}
+
+		if ( !benchmark->setup() ) {
+			std::cerr << "Failed to set up " << benchmark->getName() << std::endl;
+			success = false;
+			continue;
+		}
+
+		int iterations = calibrate(benchmark);
+
+		BenchmarkResult result(benchmark->getName(),iterations);
+		for ( int i=0; i<m_sampleCount; i++ ) {
+			uint64_t elapsedTime = measure(benchmark,iterations);
+			result.addSample((double)(int64_t)elapsedTime*1000.0/iterations);
+		}
+
+		benchmark->cleanup();
+
+		std::cerr << benchmark->getName() << ": " << result.getMedian() << " ns/op" << std::endl;
+
+		results.push_back(result);
+	}
+
+	return success;
+}
+
+void BenchmarkRunner::writeResults(std::ostream &out,const std::vector<BenchmarkResult> &results)
+{
+	char buffer[32];
+
+	out << "{\n";
+	out << "\t\"version\": \"" << APP_VERSION << "\",\n";
+	out << "\t\"time\": " << (int64_t)Util::TimeUtil::getCalendarTime() << ",\n";
+	out << "\t\"unit\": \"ns/op\",\n";
+	out << "\t\"benchmarks\": [";
+
+	std::vector<BenchmarkResult>::const_iterator iter;
+	for ( iter=results.begin(); iter!=results.end(); iter++ )
+	{
+		if ( iter!=results.begin() ) {
+			out << ",";
+		}
+
+		out << "\n\t\t{ \"name\": \"" << iter->getName() << "\", "
+			<< "\"iterations\": " << iter->getIterations() << ", ";
+
+		sprintf(buffer,"%.2f",iter->getMedian());
+		out << "\"median\": " << buffer << ", ";
+
+		sprintf(buffer,"%.2f",iter->getMin());
+		out << "\"min\": " << buffer << ", ";
+
+		sprintf(buffer,"%.2f",iter->getMax());
+		out << "\"max\": " << buffer << ", ";
+
+		out << "\"samples\": [";
+		for ( size_t i=0; i<iter->getSamples().size(); i++ ) 
+		{
+			if ( i>0 ) {
+				out << ",";
+			}
+
+			sprintf(buffer,"%.2f",iter->getSamples()[i]);
+			out << buffer;
+		}
+		out << "] }";
+	}
+
+	out << "\n\t]\n";
+	out << "}\n";
+}
+
+int BenchmarkRunner::calibrate(Benchmark *benchmark)
+{
+	uint64_t sampleTime = (uint64_t)m_sampleTime*1000;
+
+	// warm up caches and any lazily allocated state
+	measure(benchmark,1);
+
+	// grow the iterations until a run takes a noticeable amount of time,
+	// then scale it to the sample time
+	int iterations = 1;
+	while ( iterations<MAX_ITERATIONS )
+	{
+		uint64_t elapsedTime = measure(benchmark,iterations);
+		if ( elapsedTime>=sampleTime/10 ) 
+		{
+			int64_t scaled = (int64_t)iterations*(int64_t)sampleTime/(int64_t)(elapsedTime==0 ? 1 : elapsedTime);
+			if ( scaled>MAX_ITERATIONS ) {
+				scaled = MAX_ITERATIONS;
+			}
+
+			return scaled<1 ? 1 : (int)scaled;
+		}
+
+		iterations *= 10;
+	}
+
+	return MAX_ITERATIONS;
+}
+
+uint64_t BenchmarkRunner::measure(Benchmark *benchmark,int iterations)
+{
+	ACE_Time_Value startTime = ACE_High_Res_Timer::gettimeofday();
+	benchmark->run(iterations);
+
+	ACE_UINT64 elapsedTime = 0;
+	(ACE_High_Res_Timer::gettimeofday()-startTime).to_usec(elapsedTime);
+
+	return elapsedTime;
+}
@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef guard_benchmark_h
+#define guard_benchmark_h
+
+/**
+* Benchmark.
+* Base class for all benchmarks. A benchmark runs a single operation 
+* on a hot path of the server for a given number of iterations.
+*/
+class Benchmark
+{
+public:
+	/**
+	* Constructor.
+	* @param name the name the benchmark is reported as
+	* @return instance
+	*/
+	Benchmark(const std::string &name) : m_sink(0) {
+		m_name = name;
+	}
+
+	/**
+	* Virtual destructor.
+	*/
+	virtual ~Benchmark() { }
+
+	/**
+	* Prepare any data used by the benchmark. 
+	* Run once before the benchmark is measured.
+	* @return true if the benchmark was prepared successfully
+	*/
+	virtual bool setup() { return true; }
+
+	/**
+	* Clean up any data used by the benchmark.
+	* Run once after the benchmark has been measured.
+	*/
+	virtual void cleanup() {}
+
+	/**
+	* Run the benchmarked operation.
+	* @param iterations the number of times to run the operation
+	*/
+	virtual void run(int iterations) = 0;
+
+	/**
+	* Get the name the benchmark is reported as.
+	* @return the name of the benchmark
+	*/
+	const std::string& getName() const {
+		return m_name;
+	}
+
+	/**
+	* Get the accumulated output of the benchmark.
+	* Benchmarks add to the sink so the measured work can't be optimized away.
+	* @return the accumulated output
+	*/
+	const size_t getSink() const {
+		return m_sink;
+	}
+
+protected:
+	size_t m_sink;
+
+private:
+	std::string m_name;
+};
+
+/**
+* BenchmarkResult.
+* Class representing the measured samples of a benchmark.
+*/
+class BenchmarkResult
+{
+public:
+	/**
+	* Constructor.
+	* @param name the name of the benchmark
+	* @param iterations the number of iterations run per sample
+	* @return instance
+	*/
+	BenchmarkResult(const std::string &name,int iterations) {
+		m_iterations = iterations;
+		m_name = name;
+	}
+
+	/**
+	* Add a sample.
+	* @param nanosPerOp the measured time per operation, in nanoseconds
+	*/
+	void addSample(double nanosPerOp) {
+		m_samples.push_back(nanosPerOp);
+	}
+
+	/**
+	* Get the number of iterations run per sample.
+	* @return the number of iterations run per sample
+	*/
+	const int getIterations() const {
+		return m_iterations;
+	}
+
+	/**
+	* Get the fastest sample, in nanoseconds per operation.
+	* @return the fastest sample
+	*/
+	const double getMin() const;
+
+	/**
+	* Get the slowest sample, in nanoseconds per operation.
+	* @return the slowest sample
+	*/
+	const double getMax() const;
+
+	/**
+	* Get the median sample, in nanoseconds per operation.
+	* @return the median sample
+	*/
+	const double getMedian() const;
+
+	/**
+	* Get the name of the benchmark.
+	* @return the name of the benchmark
+	*/
+	const std::string& getName() const {
+		return m_name;
+	}
+
+	/**
+	* Get all samples, in nanoseconds per operation.
+	* @return a collection of all samples
+	*/
+	const std::vector<double>& getSamples() const {
+		return m_samples;
+	}
+
+private:
+	std::vector<double> m_samples;
+
+	std::string m_name;
+
+	int m_iterations;
+};
+
+/**
+* BenchmarkRunner.
+* Runs a set of benchmarks and writes the results as JSON, so that 
+* results from different builds can be compared by a script. Every benchmark
+* is calibrated to run long enough for a sample to be measured reliably, 
+* after which a number of samples are taken.
+*/
+class BenchmarkRunner
+{
+public:
+	/**
+	* Default constructor.
+	* @return instance
+	*/
+	BenchmarkRunner() : m_sampleCount(DEFAULT_SAMPLE_COUNT),
+		m_sampleTime(DEFAULT_SAMPLE_TIME)
+	{
+
+	}
+
+	/**
+	* Destructor.
+	*/
+	~BenchmarkRunner();
+
+	static const int DEFAULT_SAMPLE_COUNT;
+	static const int DEFAULT_SAMPLE_TIME;
+	static const int MAX_ITERATIONS;
+
+	/**
+	* Add a benchmark to run. The runner takes ownership of the benchmark.
+	* @param benchmark the benchmark to add
+	*/
+	void add(Benchmark *benchmark) {
+		m_benchmarks.push_back(benchmark);
+	}
+
+	/**
+	* Run all benchmarks whose name contains the filter.
+	* @param results the out parameter for the results of all run benchmarks
+	* @return true if all benchmarks were run successfully
+	*/
+	bool run(std::vector<BenchmarkResult> &results);
+
+	/**
+	* Write the given results as JSON.
+	* @param out the stream to write to
+	* @param results the results to write
+	*/
+	static void writeResults(std::ostream &out,const std::vector<BenchmarkResult> &results);
+
+	/**
+	* Set the filter for which benchmarks to run.
+	* @param filter the text that the name of a benchmark must contain to be run
+	*/
+	void setFilter(const std::string &filter) {
+		m_filter = filter;
+	}
+
+	/**
+	* Set the number of samples to take for every benchmark.
+	* @param sampleCount the number of samples
+	*/
+	void setSampleCount(int sampleCount) {
+		m_sampleCount = sampleCount;
+	}
+
+	/**
+	* Set the minimum time every sample should run.
+	* @param sampleTime the minimum time in milliseconds
+	*/
+	void setSampleTime(int sampleTime) {
+		m_sampleTime = sampleTime;
+	}
+
+private:
+	/**
+	* Find the number of iterations needed for a sample to run 
+	* for at least the sample time.
+	* @param benchmark the benchmark to calibrate
+	* @return the number of iterations per sample
+	*/
+	int calibrate(Benchmark *benchmark);
+
+	/**
+	* Measure the time it takes to run the given number of iterations.
+	* @param benchmark the benchmark to measure
+	* @param iterations the number of iterations to run
+	* @return the elapsed time in microseconds
+	*/
+	static uint64_t measure(Benchmark *benchmark,int iterations);
+
+	std::list<Benchmark*> m_benchmarks;
+
+	std::string m_filter;
+
+	int m_sampleCount;
+	int m_sampleTime;
+};
+
+#endif
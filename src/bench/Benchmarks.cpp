@@ -0,0 +1,312 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "benchmarks.h"
+
+const int HttpResponseBenchmark::BODY_SIZE = 65536;
+const int HttpResponseBenchmark::BUFFER_SIZE = 8192;
+
+bool HttpWorkerBenchmark::setup()
+{
+	switch ( m_mode )
+	{
+		case MODE_COOKIES:
+			m_data = "vibe_session=7f3c9a1e5b2d4f608e1a3c5b7d9f0e2a; vibe_remember=1; "
+				"vibe_view=list; vibe_volume=80; __utma=12345678.1234567890.1234567890";
+		break;
+
+		case MODE_HEADER:
+			m_data = "GET /files/Music/Various%20Artists/Greatest%20Hits/01%20-%20Track.mp3?stream=1&bitrate=192 HTTP/1.1\r\n"
+				"Host: localhost:8085\r\n"
+				"User-Agent: Mozilla/5.0 (Windows; U; Windows NT 6.1; en-US; rv:1.9.2) Gecko/20100115 Firefox/3.6\r\n"
+				"Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+				"Accept-Language: en-us,en;q=0.5\r\n"
+				"Accept-Encoding: gzip,deflate\r\n"
+				"Accept-Charset: ISO-8859-1,utf-8;q=0.7,*;q=0.7\r\n"
+				"Keep-Alive: 115\r\n"
+				"Connection: keep-alive\r\n"
+				"Referer: http://localhost:8085/\r\n"
+				"Cookie: vibe_session=7f3c9a1e5b2d4f608e1a3c5b7d9f0e2a; vibe_view=list\r\n"
+				"\r\n";
+		break;
+
+		case MODE_QUERY_STRING:
+			m_data = "action=browse&path=%2FMusic%2FVarious%20Artists%2FGreatest%20Hits&sort=name"
+				"&order=asc&offset=0&limit=100&filter=&view=list&_=1265412345678";
+		break;
+	}
+
+	return true;
+}
+
+void HttpWorkerBenchmark::run(int iterations)
+{
+	for ( int i=0; i<iterations; i++ )
+	{
+		HttpServerRequest httpRequest(NULL);
+		HttpServerResponse httpResponse(NULL,0);
+
+		switch ( m_mode )
+		{
+			case MODE_COOKIES:
+				m_worker.parseCookies(httpRequest,httpResponse,m_data);
+			break;
+
+			case MODE_HEADER:
+				m_worker.parseHeader(httpRequest,httpResponse,m_data);
+			break;
+
+			case MODE_QUERY_STRING:
+				m_worker.parseQueryString(httpRequest,httpResponse,m_data);
+			break;
+		}
+
+		m_sink += httpRequest.getUri().length();
+	}
+}
+
+bool CryptoUtilBenchmark::setup()
+{
+	switch ( m_mode )
+	{
+		case MODE_MD5_ENCODE:
+			m_data = "7f3c9a1e5b2d4f608e1a3c5b7d9f0e2a:1265412345:127.0.0.1";
+		break;
+
+		case MODE_URL_DECODE:
+			m_data = "%2FMusic%2FVarious%20Artists%2FGreatest%20Hits%2F01%20-%20Track%20%C3%A5%C3%A4%C3%B6.mp3";
+		break;
+
+		case MODE_URL_ENCODE:
+			m_data = "/Music/Various Artists/Greatest Hits/01 - Track (Remix) & More.mp3";
+		break;
+	}
+
+	return true;
+}
+
+void CryptoUtilBenchmark::run(int iterations)
+{
+	for ( int i=0; i<iterations; i++ )
+	{
+		switch ( m_mode )
+		{
+			case MODE_MD5_ENCODE:
+				m_sink += Util::CryptoUtil::md5Encode(m_data.c_str(),m_data.length()).length();
+			break;
+
+			case MODE_URL_DECODE:
+				m_sink += Util::CryptoUtil::urlDecode(m_data).length();
+			break;
+
+			case MODE_URL_ENCODE:
+				m_sink += Util::CryptoUtil::urlEncode(m_data).length();
+			break;
+		}
+	}
+}
+
+bool PermissionBenchmark::setup()
+{
+	// a typical setup denying a few ranges and allowing the local network
+	m_permissions.push_back(Permission("","","10.0.*.*",false));
+	m_permissions.push_back(Permission("","","172.16.*.*",false));
+	m_permissions.push_back(Permission("","","192.168.0.*",true));
+	m_permissions.push_back(Permission("","","192.168.1.*",true));
+	m_permissions.push_back(Permission("","","127.0.0.1",true));
+
+	m_remoteAddresses.push_back("192.168.1.42");
+	m_remoteAddresses.push_back("127.0.0.1");
+	m_remoteAddresses.push_back("10.0.3.7");
+	m_remoteAddresses.push_back("83.226.12.190");
+
+	m_user.setGuid("b6f4a2c8-1d3e-4f5a-9b7c-0e2d4f6a8c1e");
+
+	return true;
+}
+
+void PermissionBenchmark::run(int iterations)
+{
+	for ( int i=0; i<iterations; i++ ) {
+		const std::string &remoteAddress = m_remoteAddresses[i%m_remoteAddresses.size()];
+		m_sink += Permission::checkPermission(m_permissions,m_user,remoteAddress) ? 1 : 0;
+	}
+}
+
+bool SiteManagerBenchmark::setup()
+{
+	const char *sitePaths[] = { "/","/admin","/api","/files","/mobile","/music",
+		"/music/lossless","/public","/radio","/shared","/stats","/video" };
+
+	int siteCount = sizeof(sitePaths)/sizeof(sitePaths[0]);
+	for ( int i=0; i<siteCount; i++ ) {
+		Site site;
+		site.setName(sitePaths[i]);
+		site.setPath(sitePaths[i]);
+		m_siteManager.getSites().push_back(site);
+	}
+
+	m_paths.push_back("/");
+	m_paths.push_back("/index.vibe");
+	m_paths.push_back("/music/lossless/Various Artists/01 - Track.flac");
+	m_paths.push_back("/music/browse.vibe");
+	m_paths.push_back("/admin/users.vibe");
+	m_paths.push_back("/video/player");
+
+	return true;
+}
+
+void SiteManagerBenchmark::run(int iterations)
+{
+	for ( int i=0; i<iterations; i++ ) {
+		Site *site = m_siteManager.findSiteByPath(m_paths[i%m_paths.size()]);
+		m_sink += site!=NULL ? site->getPath().length() : 0;
+	}
+}
+
+bool HttpResponseBenchmark::setup()
+{
+	m_chunk = std::string(m_chunkSize,'x');
+	return true;
+}
+
+void HttpResponseBenchmark::run(int iterations)
+{
+	for ( int i=0; i<iterations; i++ )
+	{
+		HttpServerResponse httpResponse(NULL,BUFFER_SIZE);
+		httpResponse.setStatusCode(HttpResponse::HttpStatus::HTTP_OK);
+		httpResponse.setContentType("text/html");
+		httpResponse.setHeader("Cache-Control","no-store,no-cache,must-revalidate,max-age=0");
+
+		for ( int written=0; written<BODY_SIZE; written+=m_chunkSize ) {
+			httpResponse.write(m_chunk.c_str(),m_chunk.length());
+		}
+
+		httpResponse.flush();
+		httpResponse.finish();
+
+		m_sink += httpResponse.getStatusCode();
+	}
+}
+
+bool JsDatabaseConnectionBenchmark::setup()
+{
+	try
+	{
+		m_conn = new sqlite3x::sqlite3_connection(":memory:");
+		m_conn->executenonquery("CREATE TABLE [items] ([itemId] INTEGER PRIMARY KEY,[name] TEXT,"
+			"[path] TEXT,[size] INTEGER,[modified] INTEGER,[description] TEXT)");
+
+		sqlite3x::sqlite3_transaction trans(*m_conn);
+		sqlite3x::sqlite3_command cmd(*m_conn,"INSERT INTO [items] ([name],[path],[size],[modified],[description]) "
+			"VALUES (?,?,?,?,?)");
+
+		for ( int i=0; i<m_rows; i++ ) 
+		{
+			std::string number = Util::ConvertUtil::toString(i);
+
+			cmd.bind(1,"Track " + number + ".mp3");
+			cmd.bind(2,"/Music/Various Artists/Greatest Hits/Track " + number + ".mp3");
+			cmd.bind(3,(long long)(4000000+i));
+			cmd.bind(4,(long long)1265412345);
+			cmd.bind(5,std::string("A \"quoted\" description"));
+			cmd.executenonquery();
+		}
+
+		trans.commit();
+	}
+	catch(std::exception &ex) {
+		std::cerr << "Failed to create benchmark database: " << ex.what() << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+void JsDatabaseConnectionBenchmark::cleanup()
+{
+	if ( m_conn!=NULL ) {
+		delete m_conn;
+		m_conn = NULL;
+	}
+}
+
+void JsDatabaseConnectionBenchmark::run(int iterations)
+{
+	for ( int i=0; i<iterations; i++ )
+	{
+		sqlite3x::sqlite3_command cmd(*m_conn,"SELECT * FROM [items]");
+		sqlite3x::sqlite3_reader reader = cmd.executereader();
+
+		std::stringstream result;
+		JsDatabaseConnection::formatJson(reader,result);
+
+		m_sink += (size_t)result.tellp();
+	}
+}
+
+bool EngineBenchmark::setup()
+{
+	m_file = tmpfile();
+	if ( m_file==NULL ) {
+		return false;
+	}
+
+	// a page mixing markup and script blocks, like the pages of the default site
+	std::string page = "<html>\r\n<head>\r\n<title><? print(site.getName()); ?></title>\r\n</head>\r\n<body>\r\n";
+	for ( int i=0; i<50; i++ ) 
+	{
+		std::string number = Util::ConvertUtil::toString(i);
+
+		page += "<div class=\"row\" id=\"row" + number + "\">\r\n";
+		page += "\t<span class=\"name\"><? print(items[" + number + "].name); ?></span>\r\n";
+		page += "\t<? if ( items[" + number + "].size>0 ) { ?>\r\n";
+		page += "\t<span class=\"size\"><? print(formatSize(items[" + number + "].size)); ?></span>\r\n";
+		page += "\t<? } ?>\r\n";
+		page += "</div>\r\n";
+	}
+	page += "</body>\r\n</html>\r\n";
+
+	fwrite(page.c_str(),1,page.length(),m_file);
+
+	return true;
+}
+
+void EngineBenchmark::cleanup()
+{
+	if ( m_file!=NULL ) {
+		fclose(m_file);
+		m_file = NULL;
+	}
+}
+
+void EngineBenchmark::run(int iterations)
+{
+	HttpServerRequest httpRequest(NULL);
+
+	for ( int i=0; i<iterations; i++ )
+	{
+		rewind(m_file);
+
+		std::string script;
+		m_engine.parseFile(m_file,httpRequest,script);
+
+		m_sink += script.length();
+	}
+}
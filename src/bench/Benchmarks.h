@@ -0,0 +1,298 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef guard_benchmarks_h
+#define guard_benchmarks_h
+
+#include "../jsengine/engine.h"
+#include "../jsengine/jsdatabaseconnection.h"
+#include "../server/httpworker.h"
+#include "../server/permission.h"
+#include "../server/sitemanager.h"
+#include "../server/user.h"
+
+#include "benchmark.h"
+
+/**
+* HttpWorkerBenchmark.
+* Benchmarks the request parsing of the http worker.
+*/
+class HttpWorkerBenchmark : public Benchmark
+{
+public:
+	enum Mode
+	{
+		MODE_COOKIES,
+		MODE_HEADER,
+		MODE_QUERY_STRING
+	};
+
+	/**
+	* Constructor.
+	* @param name the name the benchmark is reported as
+	* @param mode the part of the request to parse
+	* @return instance
+	*/
+	HttpWorkerBenchmark(const std::string &name,Mode mode) : Benchmark(name),
+		m_worker(NULL,NULL)
+	{
+		m_mode = mode;
+	}
+
+	/**
+	* @override
+	*/
+	virtual bool setup();
+
+	/**
+	* @override
+	*/
+	virtual void run(int iterations);
+
+private:
+	HttpWorker m_worker;
+
+	std::string m_data;
+
+	Mode m_mode;
+};
+
+/**
+* CryptoUtilBenchmark.
+* Benchmarks the url and md5 encoding used for every request.
+*/
+class CryptoUtilBenchmark : public Benchmark
+{
+public:
+	enum Mode
+	{
+		MODE_MD5_ENCODE,
+		MODE_URL_DECODE,
+		MODE_URL_ENCODE
+	};
+
+	/**
+	* Constructor.
+	* @param name the name the benchmark is reported as
+	* @param mode the encoding to benchmark
+	* @return instance
+	*/
+	CryptoUtilBenchmark(const std::string &name,Mode mode) : Benchmark(name) {
+		m_mode = mode;
+	}
+
+	/**
+	* @override
+	*/
+	virtual bool setup();
+
+	/**
+	* @override
+	*/
+	virtual void run(int iterations);
+
+private:
+	std::string m_data;
+
+	Mode m_mode;
+};
+
+/**
+* PermissionBenchmark.
+* Benchmarks permission checks against wildcard ip address rules.
+*/
+class PermissionBenchmark : public Benchmark
+{
+public:
+	/**
+	* Constructor.
+	* @param name the name the benchmark is reported as
+	* @return instance
+	*/
+	PermissionBenchmark(const std::string &name) : Benchmark(name) {
+
+	}
+
+	/**
+	* @override
+	*/
+	virtual bool setup();
+
+	/**
+	* @override
+	*/
+	virtual void run(int iterations);
+
+private:
+	std::list<Permission> m_permissions;
+
+	std::vector<std::string> m_remoteAddresses;
+
+	User m_user;
+};
+
+/**
+* SiteManagerBenchmark.
+* Benchmarks the lookup of the site that a requested path belongs to.
+*/
+class SiteManagerBenchmark : public Benchmark
+{
+public:
+	/**
+	* Constructor.
+	* @param name the name the benchmark is reported as
+	* @return instance
+	*/
+	SiteManagerBenchmark(const std::string &name) : Benchmark(name) {
+
+	}
+
+	/**
+	* @override
+	*/
+	virtual bool setup();
+
+	/**
+	* @override
+	*/
+	virtual void run(int iterations);
+
+private:
+	SiteManager m_siteManager;
+
+	std::vector<std::string> m_paths;
+};
+
+/**
+* HttpResponseBenchmark.
+* Benchmarks writing a response body through the response buffer.
+* The response is headless, so only the buffering and header 
+* formatting is measured and not the socket.
+*/
+class HttpResponseBenchmark : public Benchmark
+{
+public:
+	/**
+	* Constructor.
+	* @param name the name the benchmark is reported as
+	* @param chunkSize the size of every write
+	* @return instance
+	*/
+	HttpResponseBenchmark(const std::string &name,int chunkSize) : Benchmark(name) {
+		m_chunkSize = chunkSize;
+	}
+
+	static const int BODY_SIZE;
+	static const int BUFFER_SIZE;
+
+	/**
+	* @override
+	*/
+	virtual bool setup();
+
+	/**
+	* @override
+	*/
+	virtual void run(int iterations);
+
+private:
+	std::string m_chunk;
+
+	int m_chunkSize;
+};
+
+/**
+* JsDatabaseConnectionBenchmark.
+* Benchmarks formatting a query result as JSON for scripts,
+* reading from an in-memory database.
+*/
+class JsDatabaseConnectionBenchmark : public Benchmark
+{
+public:
+	/**
+	* Constructor.
+	* @param name the name the benchmark is reported as
+	* @param rows the number of rows in the query result
+	* @return instance
+	*/
+	JsDatabaseConnectionBenchmark(const std::string &name,int rows) : Benchmark(name),
+		m_conn(NULL)
+	{
+		m_rows = rows;
+	}
+
+	/**
+	* @override
+	*/
+	virtual bool setup();
+
+	/**
+	* @override
+	*/
+	virtual void cleanup();
+
+	/**
+	* @override
+	*/
+	virtual void run(int iterations);
+
+private:
+	sqlite3x::sqlite3_connection *m_conn;
+
+	int m_rows;
+};
+
+/**
+* EngineBenchmark.
+* Benchmarks parsing a script page into an executable script.
+*/
+class EngineBenchmark : public Benchmark
+{
+public:
+	/**
+	* Constructor.
+	* @param name the name the benchmark is reported as
+	* @return instance
+	*/
+	EngineBenchmark(const std::string &name) : Benchmark(name),
+		m_file(NULL) 
+	{
+
+	}
+
+	/**
+	* @override
+	*/
+	virtual bool setup();
+
+	/**
+	* @override
+	*/
+	virtual void cleanup();
+
+	/**
+	* @override
+	*/
+	virtual void run(int iterations);
+
+private:
+	Engine m_engine;
+
+	FILE *m_file;
+};
+
+#endif
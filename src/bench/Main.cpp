@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+
+#include "benchmarks.h"
+
+/**
+* Print the command line usage.
+*/
+void printUsage()
+{
+	std::cerr << "Usage: bench [-o file] [-s samples] [-t milliseconds] [filter]" << std::endl;
+	std::cerr << "  -o  write the results to the given file instead of the standard output" << std::endl;
+	std::cerr << "  -s  the number of samples to take for every benchmark" << std::endl;
+	std::cerr << "  -t  the minimum time in milliseconds for every sample" << std::endl;
+	std::cerr << "  filter  only run benchmarks whose name contains the filter" << std::endl;
+}
+
+int main(int argc,char *argv[])
+{
+	BenchmarkRunner runner;
+	std::string outputPath;
+
+	for ( int i=1; i<argc; i++ )
+	{
+		std::string arg = argv[i];
+		if ( (arg=="-o" || arg=="-s" || arg=="-t") && i+1<argc ) 
+		{
+			std::string value = argv[++i];
+			if ( arg=="-o" ) {
+				outputPath = value;
+			}
+			else if ( arg=="-s" ) {
+				runner.setSampleCount(Util::ConvertUtil::toInt(value));
+			}
+			else {
+				runner.setSampleTime(Util::ConvertUtil::toInt(value));
+			}
+		}
+		else if ( !arg.empty() && arg[0]!='-' ) {
+			runner.setFilter(arg);
+		}
+		else {
+			printUsage();
+			return 1;
+		}
+	}
+
+	runner.add(new HttpWorkerBenchmark("HttpWorker.parseHeader",HttpWorkerBenchmark::MODE_HEADER));
+	runner.add(new HttpWorkerBenchmark("HttpWorker.parseQueryString",HttpWorkerBenchmark::MODE_QUERY_STRING));
+	runner.add(new HttpWorkerBenchmark("HttpWorker.parseCookies",HttpWorkerBenchmark::MODE_COOKIES));
+	runner.add(new CryptoUtilBenchmark("CryptoUtil.urlDecode",CryptoUtilBenchmark::MODE_URL_DECODE));
+	runner.add(new CryptoUtilBenchmark("CryptoUtil.urlEncode",CryptoUtilBenchmark::MODE_URL_ENCODE));
+	runner.add(new CryptoUtilBenchmark("CryptoUtil.md5Encode",CryptoUtilBenchmark::MODE_MD5_ENCODE));
+	runner.add(new PermissionBenchmark("Permission.checkPermission"));
+	runner.add(new SiteManagerBenchmark("SiteManager.findSiteByPath"));
+	runner.add(new HttpResponseBenchmark("HttpServerResponse.write.256",256));
+	runner.add(new HttpResponseBenchmark("HttpServerResponse.write.4096",4096));
+	runner.add(new JsDatabaseConnectionBenchmark("JsDatabaseConnection.formatJson.100",100));
+	runner.add(new EngineBenchmark("Engine.parseFile"));
+
+	std::vector<BenchmarkResult> results;
+	bool success = runner.run(results);
+
+	if ( outputPath.empty() ) {
+		BenchmarkRunner::writeResults(std::cout,results);
+	}
+	else 
+	{
+		std::ofstream out(outputPath.c_str());
+		if ( !out.is_open() ) {
+			std::cerr << "Failed to open " << outputPath << std::endl;
+			return 1;
+		}
+
+		BenchmarkRunner::writeResults(out,results);
+	}
+
+	return success ? 0 : 1;
+}
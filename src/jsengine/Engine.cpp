@@ -20,7 +20,10 @@
 
 #define LOGGER_CLASSNAME "Engine"
 
+#include <ace/high_res_timer.h>
+
 #include "../server/logmanager.h"
+#include "../server/metricsmanager.h"
 
 #include "contextprivate.h"
 #include "jsdatabaseconnection.h"
@@ -41,6 +44,7 @@
 #include "jsshare.h"
 #include "jssharemanager.h"
 #include "jssite.h"
+#include "jstaskrunner.h"
 #include "jsuser.h"
 #include "jsusermanager.h"
 
@@ -156,8 +160,14 @@ bool Engine::executeFile(FILE *file,HttpServerRequest &httpRequest,HttpServerRes
 		}
 	}
 	
+	ACE_Time_Value gcStartTime = ACE_High_Res_Timer::gettimeofday();
+
 	JS_GC(cx); // force garbage collection
 
+	ACE_UINT64 gcTime = 0;
+	(ACE_High_Res_Timer::gettimeofday()-gcStartTime).to_usec(gcTime);
+	MetricsManager::getInstance()->addGc(gcTime);
+
 	// end request (requires js_threadsafe)
 	JS_EndRequest(cx);
 	JS_ClearContextThread(cx);
@@ -284,6 +294,10 @@ bool Engine::initCustomClasses(JSContext *cx,JSObject *obj)
 		return false;
 	}
 
+	if ( JsTaskRunner::jsInit(cx,obj)==NULL ) {
+		return false;
+	}
+
 	if ( JsUser::jsInit(cx,obj)==NULL ) {
 		return false;
 	}
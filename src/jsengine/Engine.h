@@ -92,6 +92,8 @@ public:
 	static JSBool throwUsageError(JSContext *cx,jsval *argv);
 
 private:
+	friend class EngineBenchmark;
+
 	/**
 	* Initialize all custom javascript classes.
 	* @param cx the context in which to initialize the class
@@ -23,6 +23,7 @@
 #include "../server/databasemanager.h"
 #include "../server/logmanager.h"
 
+#include "contextprivate.h"
 #include "engine.h"
 
 JSClass JsDatabaseConnection::m_jsClass = {
@@ -86,6 +87,9 @@ JSBool JsDatabaseConnection::executeJson(JSContext *cx,JSObject *obj,uintN argc,
 	DatabaseConnection *conn = (DatabaseConnection*)JS_GetPrivate(cx,obj);
 	if ( conn!=NULL ) 
 	{
+		ContextPrivate *cxPrivate = (ContextPrivate*)JS_GetContextPrivate(cx);
+		TraceScope scope(cxPrivate->getHttpRequest().getTrace(),"sql");
+
 		try
 		{
 			sqlite3x::sqlite3_command cmd(conn->getSqliteConn(),query);
@@ -114,6 +118,9 @@ JSBool JsDatabaseConnection::executeNonQuery(JSContext *cx,JSObject *obj,uintN a
 	DatabaseConnection *conn = (DatabaseConnection*)JS_GetPrivate(cx,obj);
 	if ( conn!=NULL ) 
 	{
+		ContextPrivate *cxPrivate = (ContextPrivate*)JS_GetContextPrivate(cx);
+		TraceScope scope(cxPrivate->getHttpRequest().getTrace(),"sql");
+
 		bool success = false;
 
 		try {
@@ -141,6 +148,9 @@ JSBool JsDatabaseConnection::executeString(JSContext *cx,JSObject *obj,uintN arg
 	DatabaseConnection *conn = (DatabaseConnection*)JS_GetPrivate(cx,obj);
 	if ( conn!=NULL ) 
 	{
+		ContextPrivate *cxPrivate = (ContextPrivate*)JS_GetContextPrivate(cx);
+		TraceScope scope(cxPrivate->getHttpRequest().getTrace(),"sql");
+
 		try
 		{
 			sqlite3x::sqlite3_command cmd(conn->getSqliteConn(),query);
@@ -169,6 +179,9 @@ JSBool JsDatabaseConnection::executeXml(JSContext *cx,JSObject *obj,uintN argc,j
 	DatabaseConnection *conn = (DatabaseConnection*)JS_GetPrivate(cx,obj);
 	if ( conn!=NULL ) 
 	{
+		ContextPrivate *cxPrivate = (ContextPrivate*)JS_GetContextPrivate(cx);
+		TraceScope scope(cxPrivate->getHttpRequest().getTrace(),"sql");
+
 		try
 		{
 			sqlite3x::sqlite3_command cmd(conn->getSqliteConn(),query);
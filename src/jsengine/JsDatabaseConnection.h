@@ -87,6 +87,8 @@ public:
 	static JSBool getInsertId(JSContext *cx,JSObject *obj,uintN argc,jsval *argv,jsval *rval);
 
 private:
+	friend class JsDatabaseConnectionBenchmark;
+
 	/**
 	 * Format the result from the reader as json.
 	 * @param &reader the sqlite reader
@@ -39,6 +39,7 @@ JSClass JsHttpServer::m_jsClass = {
 
 JSFunctionSpec JsHttpServer::m_jsFunctionSpec[] = {
 	{ "getSessionManager",JsHttpServer::getSessionManager,0,NULL,NULL },
+	{ "getTraces",JsHttpServer::getTraces,0,NULL,NULL },
 	{ NULL }
 };
 
@@ -63,3 +64,13 @@ JSBool JsHttpServer::getSessionManager(JSContext *cx,JSObject *obj,uintN argc,js
 
 	return JS_TRUE;
 }
+
+JSBool JsHttpServer::getTraces(JSContext *cx,JSObject *obj,uintN argc,jsval *argv,jsval *rval)
+{
+	std::string traces = HttpServer::getInstance()->getTracer().exportTraces();
+
+	JSString *str = JS_NewStringCopyN(cx,traces.c_str(),traces.length());
+	*rval = STRING_TO_JSVAL(str);
+
+	return JS_TRUE;
+}
@@ -56,6 +56,11 @@ public:
 	*/
 	static JSBool getSessionManager(JSContext *cx,JSObject *obj,uintN argc,jsval *argv,jsval *rval);
 
+	/**
+	* Get the kept request traces in the Chrome trace event format.
+	*/
+	static JSBool getTraces(JSContext *cx,JSObject *obj,uintN argc,jsval *argv,jsval *rval);
+
 private:
 	static JSClass m_jsClass;
 	static JSFunctionSpec m_jsFunctionSpec[];
@@ -39,6 +39,7 @@ JSClass JsIndexer::m_jsClass = {
 };
 
 JSFunctionSpec JsIndexer::m_jsFunctionSpec[] = {
+	{ "getActiveJobs",JsIndexer::getActiveJobs,0,NULL,NULL },
 	{ "readMetadata",JsIndexer::readMetadata,1,NULL,NULL },
 	{ "readMetadataImages",JsIndexer::readMetadataImages,1,NULL,NULL },
 	{ NULL }
@@ -59,6 +60,57 @@ JSObject* JsIndexer::jsInstance(JSContext *cx,JSObject *obj)
 	return JS_NewObject(cx,JsIndexer::getJsClass(),NULL,obj);
 }
 
+JSBool JsIndexer::getActiveJobs(JSContext *cx,JSObject *obj,uintN argc,jsval *argv,jsval *rval)
+{
+	JSObject *arr = JS_NewArrayObject(cx,0,NULL);
+	if ( arr!=NULL )
+	{
+		int count = 0;
+
+		std::list<IndexerJob> activeJobs = Indexer::getInstance()->getActiveJobs();
+		for ( std::list<IndexerJob>::iterator iter=activeJobs.begin(); iter!=activeJobs.end(); iter++ )
+		{
+			JSObject *jobObj = JS_NewObject(cx,NULL,NULL,NULL);
+			if ( jobObj==NULL ) {
+				continue;
+			}
+
+			jsval element = OBJECT_TO_JSVAL(jobObj);
+			if ( JS_SetElement(cx,arr,count,&element)==JS_FALSE ) {
+				continue;
+			}
+
+			count++;
+
+			std::string state;
+			switch ( iter->getState() )
+			{
+				case IndexerJob::State::VALIDATING: state = "validating"; break;
+				case IndexerJob::State::ANALYZING: state = "analyzing"; break;
+				case IndexerJob::State::INDEXING: state = "indexing"; break;
+				default: state = "idle"; break;
+			}
+
+			JSString *stateStr = JS_NewStringCopyN(cx,state.c_str(),state.length());
+			JSString *pathStr = JS_NewStringCopyN(cx,iter->getCurrentPath().c_str(),iter->getCurrentPath().length());
+
+			JS_DefineProperty(cx,jobObj,"shareId",INT_TO_JSVAL((int)iter->getShareId()),NULL,NULL,JSPROP_ENUMERATE);
+			JS_DefineProperty(cx,jobObj,"state",STRING_TO_JSVAL(stateStr),NULL,NULL,JSPROP_ENUMERATE);
+			JS_DefineProperty(cx,jobObj,"currentPath",STRING_TO_JSVAL(pathStr),NULL,NULL,JSPROP_ENUMERATE);
+			JS_DefineProperty(cx,jobObj,"fullIndexing",BOOLEAN_TO_JSVAL(iter->isFullIndexing()),NULL,NULL,JSPROP_ENUMERATE);
+			JS_DefineProperty(cx,jobObj,"analyzedDirectories",INT_TO_JSVAL((int)iter->getAnalyzedDirectories()),NULL,NULL,JSPROP_ENUMERATE);
+			JS_DefineProperty(cx,jobObj,"analyzedFiles",INT_TO_JSVAL((int)iter->getAnalyzedFiles()),NULL,NULL,JSPROP_ENUMERATE);
+			JS_DefineProperty(cx,jobObj,"indexedDirectories",INT_TO_JSVAL((int)iter->getIndexedDirectories()),NULL,NULL,JSPROP_ENUMERATE);
+			JS_DefineProperty(cx,jobObj,"indexedFiles",INT_TO_JSVAL((int)iter->getIndexedFiles()),NULL,NULL,JSPROP_ENUMERATE);
+			JS_DefineProperty(cx,jobObj,"duration",INT_TO_JSVAL(iter->getDuration()),NULL,NULL,JSPROP_ENUMERATE);
+		}
+
+		*rval = OBJECT_TO_JSVAL(arr);
+	}
+
+	return JS_TRUE;
+}
+
 JSBool JsIndexer::readMetadata(JSContext *cx,JSObject *obj,uintN argc,jsval *argv,jsval *rval)
 {
 	char *path = {0};
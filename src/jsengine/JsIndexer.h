@@ -51,6 +51,11 @@ public:
 		return &m_jsClass; 
 	}
 
+	/**
+	* Get all indexer jobs that are currently being processed.
+	*/
+	static JSBool getActiveJobs(JSContext *cx,JSObject *obj,uintN argc,jsval *argv,jsval *rval);
+
 	/**
 	* Read metadata from a file.
 	*/
@@ -42,6 +42,8 @@ JSFunctionSpec JsLogManager::m_jsFunctionSpec[] = {
 	{ "debug",JsLogManager::debug,1,NULL,NULL },
 	{ "info",JsLogManager::info,1,NULL,NULL },
 	{ "warning",JsLogManager::warning,1,NULL,NULL },
+	{ "getDroppedLines",JsLogManager::getDroppedLines,0,NULL,NULL },
+	{ "getQueueSize",JsLogManager::getQueueSize,0,NULL,NULL },
 	{ "isDebug",JsLogManager::isDebug,0,NULL,NULL },
 	{ NULL }
 };
@@ -100,6 +102,20 @@ JSBool JsLogManager::warning(JSContext *cx,JSObject *obj,uintN argc,jsval *argv,
 	return JS_TRUE;
 }
 
+JSBool JsLogManager::getDroppedLines(JSContext *cx,JSObject *obj,uintN argc,jsval *argv,jsval *rval)
+{
+	*rval = INT_TO_JSVAL((int)LogManager::getInstance()->getDroppedLines());
+
+	return JS_TRUE;
+}
+
+JSBool JsLogManager::getQueueSize(JSContext *cx,JSObject *obj,uintN argc,jsval *argv,jsval *rval)
+{
+	*rval = INT_TO_JSVAL((int)LogManager::getInstance()->getQueueSize());
+
+	return JS_TRUE;
+}
+
 JSBool JsLogManager::isDebug(JSContext *cx,JSObject *obj,uintN argc,jsval *argv,jsval *rval)
 {
 	*rval = BOOLEAN_TO_JSVAL(LogManager::getInstance()->isDebug());
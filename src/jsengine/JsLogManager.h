@@ -66,6 +66,16 @@ public:
 	*/
 	static JSBool warning(JSContext *cx,JSObject *obj,uintN argc,jsval *argv,jsval *rval);
 
+	/**
+	* Get the number of log lines dropped because the queue was full.
+	*/
+	static JSBool getDroppedLines(JSContext *cx,JSObject *obj,uintN argc,jsval *argv,jsval *rval);
+
+	/**
+	* Get the number of log lines waiting to be written.
+	*/
+	static JSBool getQueueSize(JSContext *cx,JSObject *obj,uintN argc,jsval *argv,jsval *rval);
+
 	/**
 	* Get whether the log manager is in debug mode.
 	*/
@@ -25,6 +25,7 @@
 #include "jsindexer.h"
 #include "jslogmanager.h"
 #include "jssharemanager.h"
+#include "jstaskrunner.h"
 #include "jsusermanager.h"
 
 JSClass JsServer::m_jsClass = {
@@ -48,6 +49,7 @@ JSFunctionSpec JsServer::m_jsFunctionSpec[] = {
 	{ "getIndexer",JsServer::getIndexer,0,NULL,NULL },
 	{ "getLogManager",JsServer::getLogManager,0,NULL,NULL },
 	{ "getShareManager",JsServer::getShareManager,0,NULL,NULL },
+	{ "getTaskRunner",JsServer::getTaskRunner,0,NULL,NULL },
 	{ "getUserManager",JsServer::getUserManager,0,NULL,NULL },
     { NULL }
 };
@@ -138,6 +140,13 @@ JSBool JsServer::getShareManager(JSContext *cx,JSObject *obj,uintN argc,jsval *a
 	return JS_TRUE;
 }
 
+JSBool JsServer::getTaskRunner(JSContext *cx,JSObject *obj,uintN argc,jsval *argv,jsval *rval)
+{
+	*rval = OBJECT_TO_JSVAL(JsTaskRunner::jsInstance(cx,obj));
+
+	return JS_TRUE;
+}
+
 JSBool JsServer::getUserManager(JSContext *cx,JSObject *obj,uintN argc,jsval *argv,jsval *rval)
 {
 	*rval = OBJECT_TO_JSVAL(JsUserManager::jsInstance(cx,obj));
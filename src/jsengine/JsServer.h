@@ -89,6 +89,11 @@ public:
 	*/
 	static JSBool getShareManager(JSContext *cx,JSObject *obj,uintN argc,jsval *argv,jsval *rval);
 
+	/**
+	* Get the task runner used for scheduling background scripts.
+	*/
+	static JSBool getTaskRunner(JSContext *cx,JSObject *obj,uintN argc,jsval *argv,jsval *rval);
+
 	/**
 	* Get the user manager singleton instance.
 	*/
@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "jstaskrunner.h"
+
+#include "../server/scriptrunner.h"
+#include "../server/taskrunner.h"
+
+#include "contextprivate.h"
+#include "engine.h"
+
+JSClass JsTaskRunner::m_jsClass = {
+	"TaskRunner",
+	NULL,
+	JS_PropertyStub,
+	JS_PropertyStub,
+	JS_PropertyStub,
+	JS_PropertyStub,
+	JS_EnumerateStub,
+	JS_ResolveStub,
+	JS_ConvertStub,
+	JS_FinalizeStub,
+	JSCLASS_NO_OPTIONAL_MEMBERS
+};
+
+JSFunctionSpec JsTaskRunner::m_jsFunctionSpec[] = {
+	{ "getAverageLatency",JsTaskRunner::getAverageLatency,0,NULL,NULL },
+	{ "getCompletedJobs",JsTaskRunner::getCompletedJobs,0,NULL,NULL },
+	{ "getFailedJobs",JsTaskRunner::getFailedJobs,0,NULL,NULL },
+	{ "getQueueSize",JsTaskRunner::getQueueSize,0,NULL,NULL },
+	{ "getTaskStatistics",JsTaskRunner::getTaskStatistics,0,NULL,NULL },
+	{ "schedule",JsTaskRunner::schedule,3,NULL,NULL },
+	{ NULL }
+};
+
+JSObject* JsTaskRunner::jsInit(JSContext *cx,JSObject *obj)
+{
+	JSObject *prototypeObj = JS_InitClass(cx,obj,NULL,&JsTaskRunner::m_jsClass,
+		NULL,NULL,
+		NULL,JsTaskRunner::m_jsFunctionSpec,
+		NULL,NULL);
+
+	return prototypeObj;
+}
+
+JSObject* JsTaskRunner::jsInstance(JSContext *cx,JSObject *obj)
+{
+	return JS_NewObject(cx,JsTaskRunner::getJsClass(),NULL,obj);
+}
+
+JSBool JsTaskRunner::getAverageLatency(JSContext *cx,JSObject *obj,uintN argc,jsval *argv,jsval *rval)
+{
+	*rval = INT_TO_JSVAL((int)ScriptRunner::getInstance()->getAverageLatency());
+
+	return JS_TRUE;
+}
+
+JSBool JsTaskRunner::getCompletedJobs(JSContext *cx,JSObject *obj,uintN argc,jsval *argv,jsval *rval)
+{
+	*rval = INT_TO_JSVAL((int)ScriptRunner::getInstance()->getCompletedJobs());
+
+	return JS_TRUE;
+}
+
+JSBool JsTaskRunner::getFailedJobs(JSContext *cx,JSObject *obj,uintN argc,jsval *argv,jsval *rval)
+{
+	*rval = INT_TO_JSVAL((int)ScriptRunner::getInstance()->getFailedJobs());
+
+	return JS_TRUE;
+}
+
+JSBool JsTaskRunner::getQueueSize(JSContext *cx,JSObject *obj,uintN argc,jsval *argv,jsval *rval)
+{
+	*rval = INT_TO_JSVAL((int)ScriptRunner::getInstance()->getQueueSize());
+
+	return JS_TRUE;
+}
+
+JSBool JsTaskRunner::getTaskStatistics(JSContext *cx,JSObject *obj,uintN argc,jsval *argv,jsval *rval)
+{
+	JSObject *arr = JS_NewArrayObject(cx,0,NULL);
+	if ( arr!=NULL )
+	{
+		int count = 0;
+
+		std::map<std::string,TaskStatistics> statistics = TaskRunner::getInstance()->getStatistics();
+		std::map<std::string,TaskStatistics>::iterator iter;
+		for ( iter=statistics.begin(); iter!=statistics.end(); iter++ )
+		{
+			JSObject *statisticsObj = JS_NewObject(cx,NULL,NULL,NULL);
+			if ( statisticsObj==NULL ) {
+				continue;
+			}
+
+			jsval element = OBJECT_TO_JSVAL(statisticsObj);
+			if ( JS_SetElement(cx,arr,count,&element)==JS_FALSE ) {
+				continue;
+			}
+
+			count++;
+
+			JSString *str = JS_NewStringCopyN(cx,iter->first.c_str(),iter->first.length());
+			JS_DefineProperty(cx,statisticsObj,"name",STRING_TO_JSVAL(str),NULL,NULL,JSPROP_ENUMERATE);
+			JS_DefineProperty(cx,statisticsObj,"executions",INT_TO_JSVAL((int)iter->second.getExecutions()),NULL,NULL,JSPROP_ENUMERATE);
+			JS_DefineProperty(cx,statisticsObj,"averageDelay",INT_TO_JSVAL(iter->second.getAverageDelay()),NULL,NULL,JSPROP_ENUMERATE);
+			JS_DefineProperty(cx,statisticsObj,"averageRunTime",INT_TO_JSVAL(iter->second.getAverageRunTime()),NULL,NULL,JSPROP_ENUMERATE);
+			JS_DefineProperty(cx,statisticsObj,"lastRunTime",INT_TO_JSVAL(iter->second.getLastRunTime()),NULL,NULL,JSPROP_ENUMERATE);
+			JS_DefineProperty(cx,statisticsObj,"maxRunTime",INT_TO_JSVAL(iter->second.getMaxRunTime()),NULL,NULL,JSPROP_ENUMERATE);
+		}
+
+		*rval = OBJECT_TO_JSVAL(arr);
+	}
+
+	return JS_TRUE;
+}
+
+JSBool JsTaskRunner::schedule(JSContext *cx,JSObject *obj,uintN argc,jsval *argv,jsval *rval)
+{
+	char *uri = {0};
+	JSObject *paramsObj = NULL;
+	uint32 delay = 0;
+
+	if ( !JS_ConvertArguments(cx,argc,argv,"s/ou",&uri,&paramsObj,&delay) ) {
+		return Engine::throwUsageError(cx,argv);
+	}
+
+	ContextPrivate *cxPrivate = (ContextPrivate*)JS_GetContextPrivate(cx);
+	HttpServerRequest &httpRequest = cxPrivate->getHttpRequest();
+
+	std::string fileUri = uri;
+	if ( httpRequest.getSite()==NULL || !Util::UriUtil::isValid(fileUri) ) {
+		*rval = JSVAL_FALSE;
+		return JS_TRUE;
+	}
+
+	if ( !Util::UriUtil::isAbsolute(fileUri) ) {
+		fileUri = Util::UriUtil::getParentSegment(httpRequest.getUri()) + "/" + fileUri;
+	}
+
+	ScriptJob job;
+	job.setUri(fileUri);
+
+	// the script is executed as the user scheduling it
+	if ( httpRequest.getUser()!=NULL ) {
+		job.setUserGuid(httpRequest.getUser()->getGuid());
+	}
+
+	// copy all properties of the params object as request parameters
+	if ( paramsObj!=NULL )
+	{
+		JSIdArray *ids = JS_Enumerate(cx,paramsObj);
+		if ( ids!=NULL )
+		{
+			for ( jsint i=0; i<ids->length; i++ )
+			{
+				jsval name;
+				jsval value;
+
+				if ( JS_IdToValue(cx,ids->vector[i],&name)==JS_FALSE ) {
+					continue;
+				}
+
+				JSString *nameStr = JS_ValueToString(cx,name);
+				if ( nameStr==NULL ) {
+					continue;
+				}
+
+				if ( JS_GetProperty(cx,paramsObj,JS_GetStringBytes(nameStr),&value)==JS_FALSE ) {
+					continue;
+				}
+
+				JSString *valueStr = JS_ValueToString(cx,value);
+				if ( valueStr!=NULL ) {
+					job.setParameter(JS_GetStringBytes(nameStr),JS_GetStringBytes(valueStr));
+				}
+			}
+
+			JS_DestroyIdArray(cx,ids);
+		}
+	}
+
+	// make sure to suspend request on any action
+	// that can cause a thread lock
+	jsrefcount saveDepth = JS_SuspendRequest(cx);
+	bool success = ScriptRunner::getInstance()->schedule(job,delay);
+	JS_ResumeRequest(cx,saveDepth);
+
+	*rval = BOOLEAN_TO_JSVAL(success);
+
+	return JS_TRUE;
+}
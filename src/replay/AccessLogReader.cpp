@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "accesslogreader.h"
+
+bool AccessLogEntry::parse(const std::string &line)
+{
+	// the line is "date time address user method uri querystring status", where the
+	// decoded uri is the only field that can contain spaces
+	std::vector<std::string> fields;
+	boost::split(fields,line,boost::is_any_of(" "));
+
+	if ( fields.size()<7 ) {
+		return false;
+	}
+
+	tm localTime;
+	memset(&localTime,0,sizeof(tm));
+
+	if ( sscanf(fields[0].c_str(),"%d-%d-%d",&localTime.tm_year,&localTime.tm_mon,&localTime.tm_mday)!=3
+		|| sscanf(fields[1].c_str(),"%d:%d:%d",&localTime.tm_hour,&localTime.tm_min,&localTime.tm_sec)!=3 ) {
+		return false;
+	}
+
+	localTime.tm_year -= 1900;
+	localTime.tm_mon -= 1;
+	localTime.tm_isdst = -1;
+
+	m_time = mktime(&localTime);
+	if ( m_time==-1 ) {
+		return false;
+	}
+
+	m_remoteAddress = fields[2];
+	m_userGuid = fields[3]=="-" ? "" : fields[3];
+	m_method = fields[4];
+
+	// older logs have no status code
+	size_t last = fields.size()-1;
+	if ( fields.size()>7 && !fields[last].empty() && isdigit(fields[last][0]) ) {
+		m_statusCode = Util::ConvertUtil::toInt(fields[last]);
+		last--;
+	}
+
+	m_queryString = fields[last]=="-" ? "" : fields[last];
+
+	m_uri = fields[5];
+	for ( size_t i=6; i<last; i++ ) {
+		m_uri += " " + fields[i];
+	}
+
+	return !m_uri.empty() && m_uri[0]=='/';
+}
+
+bool AccessLogReader::read(const std::string &path,std::vector<AccessLogEntry> &entries,size_t limit)
+{
+	std::ifstream file(path.c_str());
+	if ( !file.is_open() ) {
+		return false;
+	}
+
+	std::string line;
+	while ( std::getline(file,line) )
+	{
+		boost::trim_right(line);
+		if ( line.empty() ) {
+			continue;
+		}
+
+		AccessLogEntry entry;
+		if ( entry.parse(line) ) {
+			entries.push_back(entry);
+		}
+
+		if ( limit>0 && entries.size()>=limit ) {
+			break;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef guard_accesslogreader_h
+#define guard_accesslogreader_h
+
+/**
+* AccessLogEntry.
+* Class representing a single request read from an access log.
+*/
+class AccessLogEntry
+{
+public:
+	/**
+	* Default constructor.
+	* @return instance
+	*/
+	AccessLogEntry() : m_statusCode(0),
+		m_time(0)
+	{
+
+	}
+
+	/**
+	* Get the method of the request.
+	* @return the method of the request
+	*/
+	const std::string& getMethod() const {
+		return m_method;
+	}
+
+	/**
+	* Get the query string of the request.
+	* @return the query string, or an empty string if the request had none
+	*/
+	const std::string& getQueryString() const {
+		return m_queryString;
+	}
+
+	/**
+	* Get the address of the client that made the request.
+	* @return the remote address of the request
+	*/
+	const std::string& getRemoteAddress() const {
+		return m_remoteAddress;
+	}
+
+	/**
+	* Get the status code that the request was answered with.
+	* @return the status code, or zero if not logged
+	*/
+	const int getStatusCode() const {
+		return m_statusCode;
+	}
+
+	/**
+	* Get the time of the request.
+	* @return the time of the request
+	*/
+	const time_t getTime() const {
+		return m_time;
+	}
+
+	/**
+	* Get the decoded uri of the request.
+	* @return the uri of the request
+	*/
+	const std::string& getUri() const {
+		return m_uri;
+	}
+
+	/**
+	* Get the guid of the user that made the request.
+	* @return the guid of the user, or an empty string if there was no session
+	*/
+	const std::string& getUserGuid() const {
+		return m_userGuid;
+	}
+
+	/**
+	* Parse an access log line into the entry.
+	* The line should be in the format written by the AccessLogger.
+	* @param line the line to parse
+	* @return true if the line was parsed successfully
+	*/
+	bool parse(const std::string &line);
+
+private:
+	std::string m_method;
+	std::string m_queryString;
+	std::string m_remoteAddress;
+	std::string m_uri;
+	std::string m_userGuid;
+
+	time_t m_time;
+
+	int m_statusCode;
+};
+
+/**
+* AccessLogReader.
+* Reads the requests of an access log written by the AccessLogger.
+*/
+class AccessLogReader
+{
+public:
+	/**
+	* Read all requests of the given access log.
+	* Lines that can't be parsed are skipped.
+	* @param path the path to the access log
+	* @param entries the out parameter for the read requests, in logged order
+	* @param limit the maximum number of requests to read, or zero for no limit
+	* @return true if the access log was read successfully
+	*/
+	static bool read(const std::string &path,std::vector<AccessLogEntry> &entries,size_t limit);
+};
+
+#endif
@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+* Common includes.
+* Used as precompiled header.
+*/
+#pragma once
+
+/* server precompiled header */
+#include "../server/common.h"
+
+/* ace library */
+#include <ace/high_res_timer.h>
+#include <ace/sock_connector.h>
+#include <ace/synch.h>
+
+/* standard */
+#include <iostream>
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+
+#include <boost/filesystem/path.hpp>
+
+#include "accesslogreader.h"
+#include "replayer.h"
+#include "replayreport.h"
+#include "sharetreegenerator.h"
+
+/**
+* Print the command line usage.
+*/
+void printUsage()
+{
+	std::cerr << "Usage: replay generate <directory> [-n files] [-s bytes]" << std::endl;
+	std::cerr << "       replay run <accesslog> [options]" << std::endl;
+	std::cerr << std::endl;
+	std::cerr << "Generate options:" << std::endl;
+	std::cerr << "  -n  the number of files to generate" << std::endl;
+	std::cerr << "  -s  the size of every generated file, in bytes" << std::endl;
+	std::cerr << std::endl;
+	std::cerr << "Run options:" << std::endl;
+	std::cerr << "  -h  the host of the server" << std::endl;
+	std::cerr << "  -p  the port of the server" << std::endl;
+	std::cerr << "  -c  the number of concurrent workers" << std::endl;
+	std::cerr << "  -x  how many times faster than logged to replay, 0 for as fast as possible" << std::endl;
+	std::cerr << "  -u  the credentials to log on with, as user:password" << std::endl;
+	std::cerr << "  -a  the uri to log on through" << std::endl;
+	std::cerr << "  -d  the index database of the server, used to map requests for shared files" << std::endl;
+	std::cerr << "  -g  the share databases directory of the server, by default shares next to the index database" << std::endl;
+	std::cerr << "  -k  an additional uri class for the report, as name=regex" << std::endl;
+	std::cerr << "  -l  the maximum number of requests to replay" << std::endl;
+	std::cerr << "  -t  the request timeout, in milliseconds" << std::endl;
+	std::cerr << "  -o  write the report as json to the given file" << std::endl;
+}
+
+/**
+* Generate a share tree.
+*/
+int generate(const std::string &path,const std::map<std::string,std::string> &options)
+{
+	int fileCount = 1000;
+	int fileSize = 1048576;
+
+	std::map<std::string,std::string>::const_iterator iter;
+	if ( (iter=options.find("-n"))!=options.end() ) {
+		fileCount = Util::ConvertUtil::toInt(iter->second);
+	}
+	if ( (iter=options.find("-s"))!=options.end() ) {
+		fileSize = Util::ConvertUtil::toInt(iter->second);
+	}
+
+	if ( !ShareTreeGenerator::generate(path,fileCount,fileSize) ) {
+		return 1;
+	}
+
+	std::cout << "Generated " << fileCount << " files in " << path << std::endl;
+
+	return 0;
+}
+
+/**
+* Replay an access log.
+*/
+int run(const std::string &path,const std::map<std::string,std::string> &options,
+		const std::list<std::string> &uriClasses)
+{
+	std::string host = "127.0.0.1";
+	int port = 80;
+	int timeout = 30000;
+	size_t limit = 0;
+
+	std::map<std::string,std::string>::const_iterator iter;
+	if ( (iter=options.find("-h"))!=options.end() ) {
+		host = iter->second;
+	}
+	if ( (iter=options.find("-p"))!=options.end() ) {
+		port = Util::ConvertUtil::toInt(iter->second);
+	}
+	if ( (iter=options.find("-t"))!=options.end() ) {
+		timeout = Util::ConvertUtil::toInt(iter->second);
+	}
+	if ( (iter=options.find("-l"))!=options.end() ) {
+		limit = Util::ConvertUtil::toUnsignedInt(iter->second);
+	}
+
+	Replayer replayer(host,port,timeout);
+
+	if ( (iter=options.find("-c"))!=options.end() ) {
+		replayer.setConcurrency(Util::ConvertUtil::toInt(iter->second));
+	}
+	if ( (iter=options.find("-x"))!=options.end() ) {
+		replayer.setSpeed(atof(iter->second.c_str()));
+	}
+	if ( (iter=options.find("-a"))!=options.end() ) {
+		replayer.setAuthUri(iter->second);
+	}
+	if ( (iter=options.find("-u"))!=options.end() ) 
+	{
+		std::string::size_type pos = iter->second.find(':');
+		if ( pos==std::string::npos ) {
+			printUsage();
+			return 1;
+		}
+
+		replayer.setCredentials(iter->second.substr(0,pos),iter->second.substr(pos+1));
+	}
+	if ( (iter=options.find("-d"))!=options.end() ) 
+	{
+		std::string indexPath = iter->second;
+		std::string shareDatabasePath;
+
+		if ( (iter=options.find("-g"))!=options.end() ) {
+			shareDatabasePath = iter->second;
+		}
+		else {
+			boost::filesystem::path parentPath = boost::filesystem::path(indexPath,boost::filesystem::native).branch_path();
+			shareDatabasePath = (parentPath/"shares").string();
+		}
+
+		if ( !replayer.loadShareHashes(indexPath,shareDatabasePath) ) {
+			std::cerr << "No indexed files found in " << indexPath << std::endl;
+			return 1;
+		}
+	}
+
+	// custom classes are matched before the default ones
+	std::list<std::string>::const_iterator classIter;
+	for ( classIter=uriClasses.begin(); classIter!=uriClasses.end(); classIter++ )
+	{
+		std::string::size_type pos = classIter->find('=');
+		if ( pos==std::string::npos ) {
+			printUsage();
+			return 1;
+		}
+
+		try {
+			replayer.addUriClass(classIter->substr(0,pos),classIter->substr(pos+1));
+		}
+		catch(boost::regex_error &ex) {
+			std::cerr << "Invalid uri class " << *classIter << ": " << ex.what() << std::endl;
+			return 1;
+		}
+	}
+
+	iter = options.find("-a");
+	replayer.addUriClass("auth","^" + (iter!=options.end() ? iter->second : Replayer::DEFAULT_AUTH_URI));
+	replayer.addUriClass("share","^" + Replayer::SHARE_URI);
+	replayer.addUriClass("script","\\.vibe$");
+	replayer.addUriClass("metrics","^/metrics$");
+
+	std::vector<AccessLogEntry> entries;
+	if ( !AccessLogReader::read(path,entries,limit) ) {
+		std::cerr << "Failed to read access log " << path << std::endl;
+		return 1;
+	}
+
+	std::cout << "Replaying " << entries.size() << " requests against " << host << ":" << port << std::endl;
+
+	ReplayReport report;
+	uint64_t duration = replayer.replay(entries,report);
+
+	report.writeText(std::cout,duration);
+
+	if ( (iter=options.find("-o"))!=options.end() ) 
+	{
+		std::ofstream out(iter->second.c_str());
+		if ( !out.is_open() ) {
+			std::cerr << "Failed to open " << iter->second << std::endl;
+			return 1;
+		}
+
+		report.writeJson(out,duration);
+	}
+
+	return 0;
+}
+
+int main(int argc,char *argv[])
+{
+	if ( argc<3 ) {
+		printUsage();
+		return 1;
+	}
+
+	std::string command = argv[1];
+	std::string path = argv[2];
+
+	std::map<std::string,std::string> options;
+	std::list<std::string> uriClasses;
+
+	for ( int i=3; i<argc; i++ )
+	{
+		std::string arg = argv[i];
+		if ( arg.length()!=2 || arg[0]!='-' || i+1>=argc ) {
+			printUsage();
+			return 1;
+		}
+
+		if ( arg=="-k" ) {
+			uriClasses.push_back(argv[++i]);
+		}
+		else {
+			options[arg] = argv[++i];
+		}
+	}
+
+	ACE::init();
+
+	int result = 1;
+	if ( command=="generate" ) {
+		result = generate(path,options);
+	}
+	else if ( command=="run" ) {
+		result = run(path,options,uriClasses);
+	}
+	else {
+		printUsage();
+	}
+
+	ACE::fini();
+
+	return result;
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "replayclient.h"
+
+#include "../server/httpconnector.h"
+
+const int ReplayClient::BUFFER_SIZE = 16384;
+
+bool ReplayResponse::getCookie(const std::string &name,std::string &value) const
+{
+	std::map<std::string,std::string>::const_iterator iter = m_cookies.find(name);
+	if ( iter!=m_cookies.end() ) {
+		value = iter->second;
+		return true;
+	}
+
+	return false;
+}
+
+bool ReplayClient::execute(const std::string &method,const std::string &uri,const std::string &queryString,
+	const std::string &postData,const std::string &sessionGuid,ReplayResponse &response)
+{
+	ACE_SOCK_Connector connector;
+	ACE_SOCK_Stream peer;
+	ACE_INET_Addr addr;
+
+	ACE_Time_Value timeout(0,m_timeout*1000);
+
+	if ( addr.set(m_port,m_host.c_str())==-1 ) {
+		return false;
+	}
+
+	if ( connector.connect(peer,addr,&timeout)==-1 ) {
+		return false;
+	}
+
+	std::stringstream header;
+	header << method << " " << uri;
+
+	if ( !queryString.empty() ) {
+		header << "?" << queryString;
+	}
+
+	header << " HTTP/1.1\r\n";
+	header << "Host: " << m_host << ":" << m_port << "\r\n";
+	header << "User-Agent: " << APP_NAME << " replay\r\n";
+	header << "Connection: close\r\n";
+
+	if ( !sessionGuid.empty() ) {
+		header << "Cookie: " << HttpConnector::SESSION_COOKIE_NAME << "=" << sessionGuid << "\r\n";
+	}
+
+	if ( !postData.empty() ) {
+		header << "Content-Length: " << postData.length() << "\r\n";
+		header << "Content-Type: application/x-www-form-urlencoded\r\n";
+	}
+
+	header << "\r\n" << postData;
+
+	std::string request = header.str();
+	if ( peer.send_n(request.c_str(),request.length(),&timeout)!=(ssize_t)request.length() ) {
+		peer.close();
+		return false;
+	}
+
+	char *buffer = new char[BUFFER_SIZE];
+
+	std::string responseHeader;
+	bool parsedHeader = false;
+
+	ssize_t bytes = 0;
+	while ( (bytes=peer.recv(buffer,BUFFER_SIZE,&timeout))>0 )
+	{
+		response.m_bytesReceived += bytes;
+
+		if ( !parsedHeader )
+		{
+			responseHeader.append(buffer,bytes);
+
+			size_t pos = responseHeader.find("\r\n\r\n");
+			if ( pos!=std::string::npos ) {
+				parseHeader(responseHeader.substr(0,pos+2),response);
+				parsedHeader = true;
+			}
+		}
+	}
+
+	delete[] buffer;
+	peer.close();
+
+	return parsedHeader;
+}
+
+std::string ReplayClient::encodePath(const std::string &path)
+{
+	static const char *hex = "0123456789ABCDEF";
+
+	std::string encoded;
+	for ( size_t i=0; i<path.length(); i++ )
+	{
+		unsigned char c = (unsigned char)path[i];
+		if ( isalnum(c) || c=='/' || c=='-' || c=='.' || c=='_' || c=='~' ) {
+			encoded += c;
+		}
+		else {
+			encoded += '%';
+			encoded += hex[c>>4];
+			encoded += hex[c&15];
+		}
+	}
+
+	return encoded;
+}
+
+void ReplayClient::parseHeader(const std::string &header,ReplayResponse &response)
+{
+	// status line is "HTTP/1.1 200 OK"
+	size_t pos = header.find(' ');
+	if ( pos!=std::string::npos ) {
+		response.m_statusCode = atoi(header.c_str()+pos+1);
+	}
+
+	size_t start = header.find("\r\n");
+	while ( start!=std::string::npos )
+	{
+		start += 2;
+
+		size_t end = header.find("\r\n",start);
+		if ( end==std::string::npos ) {
+			break;
+		}
+
+		std::string line = header.substr(start,end-start);
+		size_t delimiterPos = line.find(':');
+		if ( delimiterPos!=std::string::npos )
+		{
+			std::string name = boost::trim_copy(line.substr(0,delimiterPos));
+			std::string value = boost::trim_copy(line.substr(delimiterPos+1));
+
+			if ( boost::iequals(name,"location") ) {
+				response.m_location = value;
+			}
+			else if ( boost::iequals(name,"set-cookie") ) 
+			{
+				// only the name and value is of interest, not the path
+				value = value.substr(0,value.find(';'));
+
+				size_t valuePos = value.find('=');
+				if ( valuePos!=std::string::npos ) {
+					response.m_cookies[value.substr(0,valuePos)] = value.substr(valuePos+1);
+				}
+			}
+		}
+
+		start = end;
+	}
+}
@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef guard_replayclient_h
+#define guard_replayclient_h
+
+/**
+* ReplayResponse.
+* Class representing the response to a replayed request.
+* The body is only counted and never kept.
+*/
+class ReplayResponse
+{
+public:
+	/**
+	* Default constructor.
+	* @return instance
+	*/
+	ReplayResponse() : m_bytesReceived(0),
+		m_statusCode(0)
+	{
+
+	}
+
+	/**
+	* Get the number of bytes received, including the header.
+	* @return the number of bytes received
+	*/
+	const uint64_t getBytesReceived() const {
+		return m_bytesReceived;
+	}
+
+	/**
+	* Get the value of a cookie set by the response.
+	* @param name the name of the cookie
+	* @param value the out parameter for the value of the cookie
+	* @return true if the cookie was set by the response
+	*/
+	bool getCookie(const std::string &name,std::string &value) const;
+
+	/**
+	* Get the location that the response redirects to.
+	* @return the redirect location, or an empty string if not redirected
+	*/
+	const std::string& getLocation() const {
+		return m_location;
+	}
+
+	/**
+	* Get the status code of the response.
+	* @return the status code, or zero if no response was received
+	*/
+	const int getStatusCode() const {
+		return m_statusCode;
+	}
+
+private:
+	friend class ReplayClient;
+
+	std::map<std::string,std::string> m_cookies;
+
+	std::string m_location;
+
+	uint64_t m_bytesReceived;
+
+	int m_statusCode;
+};
+
+/**
+* ReplayClient.
+* A minimal HTTP client for replaying requests. Unlike the HttpClientRequest
+* of the server it handles binary bodies of any size, since streamed files are
+* read to the end and discarded rather than kept in memory.
+*/
+class ReplayClient
+{
+public:
+	/**
+	* Constructor.
+	* @param host the host of the server
+	* @param port the port of the server
+	* @param timeout the send and receive timeout, in milliseconds
+	* @return instance
+	*/
+	ReplayClient(const std::string &host,int port,int timeout) {
+		m_host = host;
+		m_port = port;
+		m_timeout = timeout;
+	}
+
+	static const int BUFFER_SIZE;
+
+	/**
+	* Execute a request.
+	* @param method the method of the request
+	* @param uri the encoded uri of the request
+	* @param queryString the encoded query string of the request, may be empty
+	* @param postData the url encoded form data for a post request, may be empty
+	* @param sessionGuid the session cookie to send, may be empty
+	* @param response the out parameter for the response
+	* @return true if a response was received
+	*/
+	bool execute(const std::string &method,const std::string &uri,const std::string &queryString,
+		const std::string &postData,const std::string &sessionGuid,ReplayResponse &response);
+
+	/**
+	* Encode a decoded uri path, keeping the slashes.
+	* @param path the path to encode
+	* @return the encoded path
+	*/
+	static std::string encodePath(const std::string &path);
+
+private:
+	/**
+	* Parse the response header.
+	* @param header the header to parse
+	* @param response the response that will receive the parsed values
+	*/
+	static void parseHeader(const std::string &header,ReplayResponse &response);
+
+	std::string m_host;
+
+	int m_port;
+	int m_timeout;
+};
+
+#endif
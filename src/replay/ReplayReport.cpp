@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "replayreport.h"
+
+#include <algorithm>
+#include <iomanip>
+
+void ReplayStatistics::add(uint64_t latency,uint64_t bytes,bool error)
+{
+	m_latencies.push_back(latency);
+	m_bytes += bytes;
+
+	if ( error ) {
+		m_errors++;
+	}
+}
+
+void ReplayStatistics::merge(const ReplayStatistics &replayStatistics)
+{
+	m_latencies.insert(m_latencies.end(),replayStatistics.m_latencies.begin(),replayStatistics.m_latencies.end());
+	m_bytes += replayStatistics.m_bytes;
+	m_errors += replayStatistics.m_errors;
+}
+
+const uint64_t ReplayStatistics::getPercentile(double percentile) const
+{
+	if ( m_latencies.empty() ) {
+		return 0;
+	}
+
+	// nearest rank
+	size_t rank = (size_t)(percentile/100.0*m_latencies.size()+0.5);
+	if ( rank<1 ) {
+		rank = 1;
+	}
+	else if ( rank>m_latencies.size() ) {
+		rank = m_latencies.size();
+	}
+
+	return m_latencies[rank-1];
+}
+
+void ReplayStatistics::sort()
+{
+	std::sort(m_latencies.begin(),m_latencies.end());
+}
+
+void ReplayReport::add(const std::string &uriClass,uint64_t latency,uint64_t bytes,bool error)
+{
+	ACE_Guard<ACE_Mutex> guard(m_mutex);
+	m_statistics[uriClass].add(latency,bytes,error);
+}
+
+void ReplayReport::writeText(std::ostream &out,uint64_t duration)
+{
+	std::map<std::string,ReplayStatistics> statistics = getStatistics();
+
+	out << std::left << std::setw(12) << "class"
+		<< std::right << std::setw(10) << "requests"
+		<< std::setw(10) << "errors"
+		<< std::setw(10) << "req/s"
+		<< std::setw(14) << "KB/s"
+		<< std::setw(10) << "p50 ms"
+		<< std::setw(10) << "p90 ms"
+		<< std::setw(10) << "p99 ms"
+		<< std::setw(10) << "max ms" << "\n";
+
+	std::map<std::string,ReplayStatistics>::const_iterator iter;
+	for ( iter=statistics.begin(); iter!=statistics.end(); iter++ )
+	{
+		out << std::left << std::setw(12) << iter->first
+			<< std::right << std::setw(10) << Util::ConvertUtil::toString(iter->second.getCount())
+			<< std::setw(10) << Util::ConvertUtil::toString(iter->second.getErrors())
+			<< std::setw(10) << formatRate(iter->second.getCount(),duration)
+			<< std::setw(14) << formatRate(iter->second.getBytes()/1024,duration)
+			<< std::setw(10) << formatMilliseconds(iter->second.getPercentile(50))
+			<< std::setw(10) << formatMilliseconds(iter->second.getPercentile(90))
+			<< std::setw(10) << formatMilliseconds(iter->second.getPercentile(99))
+			<< std::setw(10) << formatMilliseconds(iter->second.getPercentile(100)) << "\n";
+	}
+
+	out << "duration " << formatMilliseconds(duration) << " ms\n";
+}
+
+void ReplayReport::writeJson(std::ostream &out,uint64_t duration)
+{
+	std::map<std::string,ReplayStatistics> statistics = getStatistics();
+
+	out << "{\n";
+	out << "\t\"version\": \"" << APP_VERSION << "\",\n";
+	out << "\t\"time\": " << (int64_t)Util::TimeUtil::getCalendarTime() << ",\n";
+	out << "\t\"duration\": " << formatMilliseconds(duration) << ",\n";
+	out << "\t\"classes\": [";
+
+	std::map<std::string,ReplayStatistics>::const_iterator iter;
+	for ( iter=statistics.begin(); iter!=statistics.end(); iter++ )
+	{
+		if ( iter!=statistics.begin() ) {
+			out << ",";
+		}
+
+		out << "\n\t\t{ \"class\": \"" << iter->first << "\", "
+			<< "\"requests\": " << Util::ConvertUtil::toString(iter->second.getCount()) << ", "
+			<< "\"errors\": " << Util::ConvertUtil::toString(iter->second.getErrors()) << ", "
+			<< "\"bytes\": " << Util::ConvertUtil::toString(iter->second.getBytes()) << ", "
+			<< "\"requestsPerSecond\": " << formatRate(iter->second.getCount(),duration) << ", "
+			<< "\"bytesPerSecond\": " << formatRate(iter->second.getBytes(),duration) << ", "
+			<< "\"p50\": " << formatMilliseconds(iter->second.getPercentile(50)) << ", "
+			<< "\"p90\": " << formatMilliseconds(iter->second.getPercentile(90)) << ", "
+			<< "\"p99\": " << formatMilliseconds(iter->second.getPercentile(99)) << ", "
+			<< "\"max\": " << formatMilliseconds(iter->second.getPercentile(100)) << " }";
+	}
+
+	out << "\n\t]\n";
+	out << "}\n";
+}
+
+std::map<std::string,ReplayStatistics> ReplayReport::getStatistics()
+{
+	ACE_Guard<ACE_Mutex> guard(m_mutex);
+
+	std::map<std::string,ReplayStatistics> statistics = m_statistics;
+	ReplayStatistics total;
+
+	std::map<std::string,ReplayStatistics>::iterator iter;
+	for ( iter=statistics.begin(); iter!=statistics.end(); iter++ ) {
+		iter->second.sort();
+	}
+
+	// the total is reported as a class of its own
+	for ( iter=m_statistics.begin(); iter!=m_statistics.end(); iter++ ) {
+		total.merge(iter->second);
+	}
+
+	total.sort();
+	statistics["total"] = total;
+
+	return statistics;
+}
+
+std::string ReplayReport::formatMilliseconds(uint64_t latency)
+{
+	char buffer[32];
+	sprintf(buffer,"%.2f",(double)(int64_t)latency/1000.0);
+	return buffer;
+}
+
+std::string ReplayReport::formatRate(uint64_t count,uint64_t duration)
+{
+	char buffer[32];
+	sprintf(buffer,"%.2f",duration>0 ? (double)(int64_t)count*1000000.0/(double)(int64_t)duration : 0.0);
+	return buffer;
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef guard_replayreport_h
+#define guard_replayreport_h
+
+/**
+* ReplayStatistics.
+* Class representing the latencies, errors and transferred bytes
+* recorded for a class of replayed requests.
+*/
+class ReplayStatistics
+{
+public:
+	/**
+	* Default constructor.
+	* @return instance
+	*/
+	ReplayStatistics() : m_bytes(0),
+		m_errors(0)
+	{
+
+	}
+
+	/**
+	* Add a replayed request.
+	* @param latency the time until the whole response was received, in microseconds
+	* @param bytes the number of bytes received
+	* @param error whether the request failed or was answered with an error status
+	*/
+	void add(uint64_t latency,uint64_t bytes,bool error);
+
+	/**
+	* Add the given statistics to these statistics.
+	* @param replayStatistics the statistics to add
+	*/
+	void merge(const ReplayStatistics &replayStatistics);
+
+	/**
+	* Get the latency below which the given percentage of requests completed.
+	* @param percentile the percentile, between 0 and 100
+	* @return the latency in microseconds
+	*/
+	const uint64_t getPercentile(double percentile) const;
+
+	/**
+	* Get the number of bytes received.
+	* @return the number of bytes received
+	*/
+	const uint64_t getBytes() const {
+		return m_bytes;
+	}
+
+	/**
+	* Get the number of replayed requests.
+	* @return the number of replayed requests
+	*/
+	const uint64_t getCount() const {
+		return m_latencies.size();
+	}
+
+	/**
+	* Get the number of failed requests.
+	* @return the number of failed requests
+	*/
+	const uint64_t getErrors() const {
+		return m_errors;
+	}
+
+	/**
+	* Sort the recorded latencies. Must be called before reading percentiles.
+	*/
+	void sort();
+
+private:
+	std::vector<uint64_t> m_latencies;
+
+	uint64_t m_bytes;
+	uint64_t m_errors;
+};
+
+/**
+* ReplayReport.
+* Collects the statistics of a replay, grouped by uri class.
+*/
+class ReplayReport
+{
+public:
+	/**
+	* Add a replayed request.
+	* @param uriClass the class of the requested uri
+	* @param latency the time until the whole response was received, in microseconds
+	* @param bytes the number of bytes received
+	* @param error whether the request failed or was answered with an error status
+	*/
+	void add(const std::string &uriClass,uint64_t latency,uint64_t bytes,bool error);
+
+	/**
+	* Write the report as a human readable table.
+	* @param out the stream to write to
+	* @param duration the wall clock duration of the replay, in microseconds
+	*/
+	void writeText(std::ostream &out,uint64_t duration);
+
+	/**
+	* Write the report as JSON.
+	* @param out the stream to write to
+	* @param duration the wall clock duration of the replay, in microseconds
+	*/
+	void writeJson(std::ostream &out,uint64_t duration);
+
+private:
+	/**
+	* Get the statistics of all classes, sorted and including a total.
+	* @return the statistics per uri class
+	*/
+	std::map<std::string,ReplayStatistics> getStatistics();
+
+	/**
+	* Format a latency in microseconds as milliseconds.
+	* @param latency the latency in microseconds
+	* @return the formatted latency in milliseconds
+	*/
+	static std::string formatMilliseconds(uint64_t latency);
+
+	/**
+	* Format a rate with two decimals.
+	* @param count the counted amount
+	* @param duration the duration in microseconds
+	* @return the formatted amount per second
+	*/
+	static std::string formatRate(uint64_t count,uint64_t duration);
+
+	ACE_Mutex m_mutex;
+
+	std::map<std::string,ReplayStatistics> m_statistics;
+};
+
+#endif
@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "replayer.h"
+
+#include <boost/filesystem/exception.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include "../server/httpconnector.h"
+#include "../server/httpresponse.h"
+#include "../sqlite3x/sqlite3x.hpp"
+
+const std::string Replayer::DEFAULT_AUTH_URI = "/auth/";
+const std::string Replayer::SHARE_URI = "/share/";
+
+const int Replayer::DEFAULT_CONCURRENCY = 8;
+const int Replayer::MAX_WAIT_TIME = 100;
+
+void Replayer::addUriClass(const std::string &name,const std::string &pattern)
+{
+	m_uriClasses.push_back(std::pair<std::string,boost::regex>(name,
+		boost::regex(pattern,boost::regex::perl|boost::regex::icase)));
+}
+
+bool Replayer::loadShareHashes(const std::string &path,const std::string &shareDatabasePath)
+{
+	std::list<std::string> paths;
+	paths.push_back(path);
+
+	// shares may have their index in a database of their own, named by share id
+	try
+	{
+		boost::filesystem::path directoryPath(shareDatabasePath,boost::filesystem::native);
+		if ( boost::filesystem::exists(directoryPath) ) 
+		{
+			boost::filesystem::directory_iterator endIter;
+			for ( boost::filesystem::directory_iterator iter(directoryPath); iter!=endIter; iter++ )
+			{
+				std::string fileName = iter->leaf();
+				if ( !boost::ends_with(fileName,".db") ) {
+					continue;
+				}
+
+				std::string stem = fileName.substr(0,fileName.length()-3);
+				if ( stem.empty() || !boost::all(stem,boost::is_digit()) || 
+					boost::filesystem::exists(boost::filesystem::path(iter->string() + ".removed",boost::filesystem::native)) ) {
+					continue;
+				}
+
+				paths.push_back(iter->string());
+			}
+		}
+	}
+	catch(boost::filesystem::filesystem_error &ex) {
+		std::cerr << "Failed to read share databases: " << ex.what() << std::endl;
+		return false;
+	}
+
+	// item ids are unique across all databases, so the order is the same as the server's
+	std::map<int64_t,std::string> hashes;
+
+	for ( std::list<std::string>::iterator iter=paths.begin(); iter!=paths.end(); iter++ )
+	{
+		try
+		{
+			sqlite3x::sqlite3_connection conn(iter->c_str());
+			sqlite3x::sqlite3_command cmd(conn,"SELECT [itemId],[hash] FROM [items] WHERE [directory]=0");
+			sqlite3x::sqlite3_reader reader = cmd.executereader();
+
+			while ( reader.read() ) {
+				hashes[reader.getint64(0)] = reader.getstring(1);
+			}
+		}
+		catch(std::exception &ex) {
+			std::cerr << "Failed to read index database " << *iter << ": " << ex.what() << std::endl;
+			return false;
+		}
+	}
+
+	for ( std::map<int64_t,std::string>::iterator iter=hashes.begin(); iter!=hashes.end(); iter++ ) {
+		m_shareHashes.push_back(iter->second);
+	}
+
+	return !m_shareHashes.empty();
+}
+
+uint64_t Replayer::replay(const std::vector<AccessLogEntry> &entries,ReplayReport &report)
+{
+	if ( entries.empty() ) {
+		return 0;
+	}
+
+	m_entries = &entries;
+	m_firstTime = entries.front().getTime();
+	m_next = 0;
+	m_report = &report;
+	m_startTime = ACE_High_Res_Timer::gettimeofday();
+
+	std::list<Thread*> workers;
+	for ( int i=0; i<m_concurrency; i++ )
+	{
+		Thread *worker = new Thread(this);
+		if ( !worker->start() ) {
+			delete worker;
+			break;
+		}
+
+		workers.push_back(worker);
+	}
+
+	std::list<Thread*>::iterator iter;
+	for ( iter=workers.begin(); iter!=workers.end(); iter++ ) {
+		(*iter)->join();
+		delete *iter;
+	}
+
+	ACE_UINT64 duration = 0;
+	(ACE_High_Res_Timer::gettimeofday()-m_startTime).to_usec(duration);
+
+	return duration;
+}
+
+void Replayer::run()
+{
+	Thread *thread = Thread::current();
+
+	const AccessLogEntry *entry = NULL;
+	while ( (entry=popEntry())!=NULL )
+	{
+		if ( m_speed>0 )
+		{
+			// wait until the request is due, relative to the first logged request
+			int64_t dueTime = (int64_t)((entry->getTime()-m_firstTime)*1000/m_speed);
+
+			while ( !thread->isCancelled() )
+			{
+				ACE_UINT64 elapsedTime = 0;
+				(ACE_High_Res_Timer::gettimeofday()-m_startTime).to_usec(elapsedTime);
+
+				int64_t waitTime = dueTime-(int64_t)elapsedTime/1000;
+				if ( waitTime<=0 ) {
+					break;
+				}
+
+				thread->wait(waitTime<MAX_WAIT_TIME ? (unsigned int)waitTime : MAX_WAIT_TIME);
+			}
+		}
+
+		if ( thread->isCancelled() ) {
+			break;
+		}
+
+		replayEntry(*entry);
+	}
+}
+
+const AccessLogEntry* Replayer::popEntry()
+{
+	ACE_Guard<ACE_Mutex> guard(m_mutex);
+
+	if ( m_next>=m_entries->size() ) {
+		return NULL;
+	}
+
+	return &(*m_entries)[m_next++];
+}
+
+void Replayer::replayEntry(const AccessLogEntry &entry)
+{
+	std::string uriClass = getUriClass(entry.getUri());
+
+	ACE_Time_Value startTime = ACE_High_Res_Timer::gettimeofday();
+
+	ReplayResponse response;
+	bool success = false;
+
+	// logons in the log are replayed as a new session for the user
+	if ( entry.getMethod()=="POST" && boost::iends_with(entry.getUri(),m_authUri) ) {
+		success = !getSession(entry.getUserGuid(),true).empty();
+	}
+	else
+	{
+		std::string uri = mapUri(entry.getUri());
+		std::string sessionGuid = getSession(entry.getUserGuid(),false);
+
+		success = m_client.execute(entry.getMethod(),uri,entry.getQueryString(),"",sessionGuid,response);
+
+		// an expired session is redirected to the auth form, so log on again and retry once
+		if ( success && !sessionGuid.empty() && response.getStatusCode()==HttpResponse::HttpStatus::HTTP_FOUND 
+			&& response.getLocation().find("target=")!=std::string::npos ) 
+		{
+			sessionGuid = getSession(entry.getUserGuid(),true);
+			response = ReplayResponse();
+			success = m_client.execute(entry.getMethod(),uri,entry.getQueryString(),"",sessionGuid,response);
+		}
+
+		success = success && response.getStatusCode()<HttpResponse::HttpStatus::HTTP_BAD_REQUEST;
+	}
+
+	ACE_UINT64 latency = 0;
+	(ACE_High_Res_Timer::gettimeofday()-startTime).to_usec(latency);
+
+	m_report->add(uriClass,latency,response.getBytesReceived(),!success);
+}
+
+std::string Replayer::getSession(const std::string &userGuid,bool renew)
+{
+	if ( userGuid.empty() || m_userName.empty() ) {
+		return "";
+	}
+
+	if ( !renew )
+	{
+		ACE_Guard<ACE_Mutex> guard(m_sessionMutex);
+
+		std::map<std::string,std::string>::iterator iter = m_sessions.find(userGuid);
+		if ( iter!=m_sessions.end() ) {
+			return iter->second;
+		}
+	}
+
+	// concurrent requests of a user without a session may both log on, 
+	// in which case the last session is kept
+	std::string sessionGuid;
+	if ( !logon(sessionGuid) ) {
+		return "";
+	}
+
+	ACE_Guard<ACE_Mutex> guard(m_sessionMutex);
+	m_sessions[userGuid] = sessionGuid;
+
+	return sessionGuid;
+}
+
+bool Replayer::logon(std::string &sessionGuid)
+{
+	std::string postData = "auth_username=" + Util::CryptoUtil::urlEncode(m_userName) 
+		+ "&auth_password=" + Util::CryptoUtil::urlEncode(m_password);
+
+	ReplayResponse response;
+	if ( !m_client.execute("POST",m_authUri,"",postData,"",response) ) {
+		return false;
+	}
+
+	return response.getCookie(HttpConnector::SESSION_COOKIE_NAME,sessionGuid);
+}
+
+std::string Replayer::getUriClass(const std::string &uri)
+{
+	std::list<std::pair<std::string,boost::regex> >::const_iterator iter;
+	for ( iter=m_uriClasses.begin(); iter!=m_uriClasses.end(); iter++ ) {
+		if ( boost::regex_search(uri,iter->second) ) {
+			return iter->first;
+		}
+	}
+
+	return "other";
+}
+
+std::string Replayer::mapUri(const std::string &uri)
+{
+	if ( m_shareHashes.empty() || !boost::istarts_with(uri,SHARE_URI) ) {
+		return ReplayClient::encodePath(uri);
+	}
+
+	// every logged hash is mapped to an indexed file of its own, in order of first appearance,
+	// so that the popularity of files is kept as long as there are enough indexed files
+	std::string hash = uri.substr(uri.find_last_of('/')+1);
+
+	ACE_Guard<ACE_Mutex> guard(m_mutex);
+
+	std::map<std::string,std::string>::iterator iter = m_mappedHashes.find(hash);
+	if ( iter==m_mappedHashes.end() ) {
+		std::string mappedHash = m_shareHashes[m_mappedHashes.size()%m_shareHashes.size()];
+		iter = m_mappedHashes.insert(std::pair<std::string,std::string>(hash,mappedHash)).first;
+	}
+
+	return SHARE_URI + iter->second;
+}
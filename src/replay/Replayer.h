@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef guard_replayer_h
+#define guard_replayer_h
+
+#include "../server/runnable.h"
+#include "../server/thread.h"
+
+#include "accesslogreader.h"
+#include "replayclient.h"
+#include "replayreport.h"
+
+/**
+* Replayer.
+* Replays the requests of an access log against a running server, using a 
+* number of concurrent workers. Requests are sent at the pace they were logged, 
+* optionally compressed in time. Every user seen in the log gets a session of 
+* its own, logged on with the same credentials. Since the hashes of shared files
+* differ between servers, requests for shared files are mapped onto the files 
+* indexed by the replayed server.
+*/
+class Replayer : public Runnable
+{
+public:
+	/**
+	* Constructor.
+	* @param host the host of the server
+	* @param port the port of the server
+	* @param timeout the request timeout, in milliseconds
+	* @return instance
+	*/
+	Replayer(const std::string &host,int port,int timeout) : m_authUri(DEFAULT_AUTH_URI),
+		m_client(host,port,timeout),
+		m_concurrency(DEFAULT_CONCURRENCY),
+		m_entries(NULL),
+		m_firstTime(0),
+		m_next(0),
+		m_report(NULL),
+		m_speed(1.0)
+	{
+
+	}
+
+	static const std::string DEFAULT_AUTH_URI;
+	static const std::string SHARE_URI;
+
+	static const int DEFAULT_CONCURRENCY;
+	static const int MAX_WAIT_TIME;
+
+	/**
+	* Add a class that requested uris are grouped by in the report.
+	* Classes are matched in the order they were added, and any uri
+	* not matching a class is grouped as "other".
+	* @param name the name of the class
+	* @param pattern the regular expression that uris of the class match
+	*/
+	void addUriClass(const std::string &name,const std::string &pattern);
+
+	/**
+	* Load the hashes of all files indexed by the replayed server,
+	* including those of shares that have their index in a database of their own.
+	* @param path the path to the index database of the server
+	* @param shareDatabasePath the directory of the share databases of the server
+	* @return true if any hashes were loaded
+	*/
+	bool loadShareHashes(const std::string &path,const std::string &shareDatabasePath);
+
+	/**
+	* Replay the given requests. Blocks until all requests have been replayed.
+	* @param entries the requests to replay, in logged order
+	* @param report the report that will receive the statistics
+	* @return the wall clock duration of the replay, in microseconds
+	*/
+	uint64_t replay(const std::vector<AccessLogEntry> &entries,ReplayReport &report);
+
+	/**
+	* @override
+	*/
+	virtual void run();
+
+	/**
+	* Set the uri that users are logged on through.
+	* @param authUri the auth uri
+	*/
+	void setAuthUri(const std::string &authUri) {
+		m_authUri = authUri;
+	}
+
+	/**
+	* Set the number of concurrent workers.
+	* @param concurrency the number of concurrent workers
+	*/
+	void setConcurrency(int concurrency) {
+		m_concurrency = concurrency;
+	}
+
+	/**
+	* Set the credentials that users are logged on with.
+	* Users in the log are replayed anonymously if no credentials are set.
+	* @param userName the name of the user
+	* @param password the password of the user
+	*/
+	void setCredentials(const std::string &userName,const std::string &password) {
+		m_userName = userName;
+		m_password = password;
+	}
+
+	/**
+	* Set the time compression of the replay.
+	* @param speed how many times faster than logged the requests are sent.
+	* Zero sends the requests as fast as the workers can
+	*/
+	void setSpeed(double speed) {
+		m_speed = speed;
+	}
+
+private:
+	/**
+	* Pop the next request to replay.
+	* @return the next request, or NULL if all requests have been replayed
+	*/
+	const AccessLogEntry* popEntry();
+
+	/**
+	* Replay a single request.
+	* @param entry the request to replay
+	*/
+	void replayEntry(const AccessLogEntry &entry);
+
+	/**
+	* Get the session to use for requests made by the given user.
+	* @param userGuid the guid of the logged user
+	* @param renew whether any existing session should be replaced by a new logon
+	* @return the session guid, or an empty string if the user is anonymous or the logon failed
+	*/
+	std::string getSession(const std::string &userGuid,bool renew);
+
+	/**
+	* Log on through the auth uri.
+	* @param sessionGuid the out parameter for the guid of the created session
+	* @return true if a session was created
+	*/
+	bool logon(std::string &sessionGuid);
+
+	/**
+	* Get the class of the given uri.
+	* @param uri the decoded uri
+	* @return the name of the matching class
+	*/
+	std::string getUriClass(const std::string &uri);
+
+	/**
+	* Map a logged uri onto the replayed server.
+	* @param uri the decoded uri
+	* @return the encoded uri to request
+	*/
+	std::string mapUri(const std::string &uri);
+
+	ACE_Mutex m_mutex;
+	ACE_Mutex m_sessionMutex;
+
+	ACE_Time_Value m_startTime;
+
+	std::list<std::pair<std::string,boost::regex> > m_uriClasses;
+
+	std::map<std::string,std::string> m_mappedHashes;
+	std::map<std::string,std::string> m_sessions;
+
+	std::vector<std::string> m_shareHashes;
+
+	std::string m_authUri;
+	std::string m_password;
+	std::string m_userName;
+
+	ReplayClient m_client;
+
+	ReplayReport *m_report;
+
+	const std::vector<AccessLogEntry> *m_entries;
+
+	time_t m_firstTime;
+
+	double m_speed;
+
+	size_t m_next;
+
+	int m_concurrency;
+};
+
+#endif
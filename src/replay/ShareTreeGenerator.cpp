@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "sharetreegenerator.h"
+
+#include <boost/filesystem/convenience.hpp>
+#include <boost/filesystem/exception.hpp>
+#include <boost/filesystem/path.hpp>
+
+const int ShareTreeGenerator::ALBUMS_PER_ARTIST = 5;
+const int ShareTreeGenerator::TRACKS_PER_ALBUM = 10;
+
+bool ShareTreeGenerator::generate(const std::string &path,int fileCount,int fileSize)
+{
+	for ( int i=0; i<fileCount; i++ )
+	{
+		int album = i/TRACKS_PER_ALBUM;
+		int artist = album/ALBUMS_PER_ARTIST;
+		int track = i%TRACKS_PER_ALBUM+1;
+
+		std::string artistName = Util::StringUtil::format("Artist %03d",artist+1);
+		std::string albumName = Util::StringUtil::format("Album %02d",album%ALBUMS_PER_ARTIST+1);
+		std::string title = Util::StringUtil::format("Track %04d",i+1);
+
+		boost::filesystem::path directory(path,boost::filesystem::native);
+		directory /= boost::filesystem::path(artistName,boost::filesystem::native);
+		directory /= boost::filesystem::path(albumName,boost::filesystem::native);
+
+		try {
+			boost::filesystem::create_directories(directory);
+		}
+		catch(boost::filesystem::filesystem_error &ex) {
+			std::cerr << "Failed to create directory: " << ex.what() << std::endl;
+			return false;
+		}
+
+		std::string fileName = Util::StringUtil::format("%02d - %s.mp3",track,title.c_str());
+		std::string filePath = (directory/boost::filesystem::path(fileName,boost::filesystem::native))
+			.native_file_string();
+
+		if ( !writeFile(filePath,fileSize,artistName,artistName+" - "+albumName,title,track) ) {
+			std::cerr << "Failed to write file: " << filePath << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool ShareTreeGenerator::writeFile(const std::string &path,int fileSize,const std::string &artist,
+								   const std::string &album,const std::string &title,int track)
+{
+	// ID3v1.1: "TAG", title, artist, album, year, comment, zero byte, track, genre
+	char tag[128];
+	memset(tag,0,sizeof(tag));
+	memcpy(tag,"TAG",3);
+	strncpy(tag+3,title.c_str(),30);
+	strncpy(tag+33,artist.c_str(),30);
+	strncpy(tag+63,album.c_str(),30);
+	memcpy(tag+93,"2010",4);
+	tag[126] = (char)track;
+	tag[127] = (char)255;
+
+	std::ofstream out(path.c_str(),std::ios::out|std::ios::binary|std::ios::trunc);
+	if ( !out.is_open() ) {
+		return false;
+	}
+
+	char buf[4096];
+	memset(buf,0,sizeof(buf));
+
+	int remaining = fileSize>(int)sizeof(tag) ? fileSize-(int)sizeof(tag) : 0;
+	while ( remaining>0 ) {
+		int len = remaining<(int)sizeof(buf) ? remaining : (int)sizeof(buf);
+		out.write(buf,len);
+		remaining -= len;
+	}
+
+	out.write(tag,sizeof(tag));
+
+	return out.good();
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef guard_sharetreegenerator_h
+#define guard_sharetreegenerator_h
+
+/**
+* ShareTreeGenerator.
+* Generates a tree of synthetic audio files to share from a local server,
+* so that access logs can be replayed without the original media. Files are
+* laid out as artist and album directories and carry an ID3v1 tag, so that
+* the indexer picks up metadata for them.
+*/
+class ShareTreeGenerator
+{
+public:
+	static const int ALBUMS_PER_ARTIST;
+	static const int TRACKS_PER_ALBUM;
+
+	/**
+	* Generate a share tree.
+	* @param path the root directory of the tree. Created if it doesn't exist
+	* @param fileCount the number of files to generate
+	* @param fileSize the size of every file, in bytes
+	* @return true if all files were generated
+	*/
+	static bool generate(const std::string &path,int fileCount,int fileSize);
+
+private:
+	/**
+	* Write a single file, padded to the given size and ending with an ID3v1 tag.
+	* @param path the path of the file
+	* @param fileSize the size of the file, in bytes
+	* @param artist the artist tag
+	* @param album the album tag
+	* @param title the title tag
+	* @param track the track number tag
+	* @return true if the file was written
+	*/
+	static bool writeFile(const std::string &path,int fileSize,const std::string &artist,
+		const std::string &album,const std::string &title,int track);
+};
+
+#endif
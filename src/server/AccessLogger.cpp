@@ -20,38 +20,39 @@
 
 #include "httpresponse.h"
 #include "httprequest.h"
+#include "logmanager.h"
 
 void AccessLogger::log(HttpServerRequest *httpRequest,HttpServerResponse *httpResponse)
 {
-	ACE_Write_Guard<ACE_Mutex> guard(m_mutex);
+	time_t calendarTime = Util::TimeUtil::getCalendarTime();
 
 	tm localTime;
-	Util::TimeUtil::getLocalTime(&localTime);
-	std::string formattedPath = Util::TimeUtil::format(localTime,m_path.c_str());
-
-	std::fstream file(formattedPath.c_str(),std::ios::out | std::ios::app);
-	if ( file.is_open() )
-	{
-		std::string userId = "-";
-		std::string queryString = "-";
-
-		if ( httpRequest->getSession()!=NULL ) {
-			userId = httpRequest->getSession()->getUserGuid();
-		}
-
-		if ( !httpRequest->getQueryString().empty() ) {
-			queryString = httpRequest->getQueryString();
-		}
-
-		file << Util::TimeUtil::format(localTime,"%Y-%m-%d %H:%M:%S").c_str() << " ";
-		file << httpRequest->getRemoteAddress().c_str() << " ";
-		file << userId.c_str() << " ";
-		file << httpRequest->getMethod().c_str() << " ";
-		file << httpRequest->getUri().c_str() << " ";
-		file << queryString.c_str() << " ";
-		file << httpResponse->getStatusCode();
-		file << "\r\n";
-
-		file.close();
+	Util::TimeUtil::getLocalTime(calendarTime,&localTime);
+
+	std::string userId = "-";
+	std::string queryString = "-";
+
+	if ( httpRequest->getSession()!=NULL ) {
+		userId = httpRequest->getSession()->getUserGuid();
+	}
+
+	if ( !httpRequest->getQueryString().empty() ) {
+		queryString = httpRequest->getQueryString();
+	}
+
+	std::stringstream line;
+	line << Util::TimeUtil::format(localTime,"%Y-%m-%d %H:%M:%S").c_str() << " ";
+	line << httpRequest->getRemoteAddress().c_str() << " ";
+	line << userId.c_str() << " ";
+	line << httpRequest->getMethod().c_str() << " ";
+	line << httpRequest->getUri().c_str() << " ";
+	line << queryString.c_str() << " ";
+	line << httpResponse->getStatusCode();
+
+	// access log lines are dropped rather than holding up the workers
+	if ( !LogManager::getInstance()->write(m_path,line.str(),calendarTime,true) ) {
+		m_mutex.acquire();
+		m_droppedLines++;
+		m_mutex.release();
 	}
 }
@@ -20,6 +20,8 @@
 
 #include <ace/synch.h>
 
+#include "profiledmutex.h"
+
 class HttpServerResponse; // forward declaration
 class HttpServerRequest; // forward declaration
 
@@ -36,7 +38,9 @@ public:
 	 * The path can include any format specifiers supported by strftime()
 	 * @return instance
 	 */
-	AccessLogger(std::string path) {
+	AccessLogger(std::string path) : m_droppedLines(0),
+		m_mutex("AccessLogger") 
+	{
 		m_path = path;
 	}
 
@@ -47,6 +51,15 @@ public:
 	 */
 	void log(HttpServerRequest *httpRequest,HttpServerResponse *httpResponse);
 
+	/**
+	 * Get the number of lines that has been dropped because the log writer was overloaded.
+	 * @return the number of dropped lines
+	 */
+	const uint64_t getDroppedLines() {
+		ACE_Guard<ProfiledMutex> guard(m_mutex);
+		return m_droppedLines;
+	}
+
 	/**
 	 * Get the path of the access log.
 	 * @return the path of the access log
@@ -56,9 +69,11 @@ public:
 	}
 
 private:
-	ACE_Mutex m_mutex;
+	ProfiledMutex m_mutex;
 
 	std::string m_path;
+
+	uint64_t m_droppedLines;
 };
 
 #endif
@@ -25,6 +25,11 @@
 
 const std::string ConfigManager::DATABASEMANAGER_DATABASES = "databaseManager.databases";
 
+const std::string ConfigManager::HTTPSERVER_COMPRESSION_ENABLED = "httpServer.compression.enabled";
+const std::string ConfigManager::HTTPSERVER_COMPRESSION_LEVEL = "httpServer.compression.level";
+const std::string ConfigManager::HTTPSERVER_COMPRESSION_MIMETYPES = "httpServer.compression.mimeTypes";
+const std::string ConfigManager::HTTPSERVER_COMPRESSION_MINSIZE = "httpServer.compression.minSize";
+
 const std::string ConfigManager::HTTPSERVER_CONNECTOR_BUFFERSIZE = "httpServer.connector.bufferSize";
 const std::string ConfigManager::HTTPSERVER_CONNECTOR_CLIENTTIMEOUT = "httpServer.connector.clientTimeout";
 const std::string ConfigManager::HTTPSERVER_CONNECTOR_MAXCLIENTS = "httpServer.connector.maxClients";
@@ -39,18 +44,49 @@ const std::string ConfigManager::HTTPSERVER_CONNECTOR_SSLCERTIFICATEKEYFILE = "h
 const std::string ConfigManager::HTTPSERVER_CONNECTOR_SSLCERTIFICATEKEYPASSWORD = "httpServer.connector.sslCertificateKeyPassword";
 const std::string ConfigManager::HTTPSERVER_CONNECTOR_SSLENABLED = "httpServer.connector.sslEnabled";
 
+const std::string ConfigManager::HTTPSERVER_DEFAULTHANDLER_CACHEMAXFILESIZE = "httpServer.defaultHandler.cacheMaxFileSize";
+const std::string ConfigManager::HTTPSERVER_DEFAULTHANDLER_CACHEMAXSIZE = "httpServer.defaultHandler.cacheMaxSize";
+const std::string ConfigManager::HTTPSERVER_DEFAULTHANDLER_FINGERPRINTPATTERN = "httpServer.defaultHandler.fingerprintPattern";
+
 const std::string ConfigManager::HTTPSERVER_REQUESTHANDLERS = "httpServer.requestHandlers";
+const std::string ConfigManager::HTTPSERVER_REQUESTHANDLERSVERSION = "httpServer.requestHandlersVersion";
 
 const std::string ConfigManager::HTTPSERVER_SESSIONMANAGER_MAXSESSIONS = "httpServer.sessionManager.maxSessions";
 const std::string ConfigManager::HTTPSERVER_SESSIONMANAGER_SESSIONTIMEOUT = "httpServer.sessionManager.sessionTimeout";
 
+const std::string ConfigManager::HTTPSERVER_TRACING_MAXTRACES = "httpServer.tracing.maxTraces";
+const std::string ConfigManager::HTTPSERVER_TRACING_SAMPLERATE = "httpServer.tracing.sampleRate";
+const std::string ConfigManager::HTTPSERVER_TRACING_SLOWLOGPATH = "httpServer.tracing.slowLogPath";
+const std::string ConfigManager::HTTPSERVER_TRACING_SLOWTHRESHOLD = "httpServer.tracing.slowThreshold";
+
+const std::string ConfigManager::INDEXER_BATCHSIZE = "indexer.batchSize";
+const std::string ConfigManager::INDEXER_COVERCACHEPATH = "indexer.coverCachePath";
+const std::string ConfigManager::INDEXER_COVERMAXSIZE = "indexer.coverMaxSize";
+const std::string ConfigManager::INDEXER_COVERPATTERN = "indexer.coverPattern";
+const std::string ConfigManager::INDEXER_FASTMETADATA = "indexer.fastMetadata";
 const std::string ConfigManager::INDEXER_FILEPATTERN = "indexer.filePattern";
 const std::string ConfigManager::INDEXER_INCLUDEHIDDEN = "indexer.includeHidden";
 const std::string ConfigManager::INDEXER_MAPPINGS = "indexer.mappings";
+const std::string ConfigManager::INDEXER_MAXDEVICEJOBS = "indexer.maxDeviceJobs";
+const std::string ConfigManager::INDEXER_MAXFILESPERSECOND = "indexer.maxFilesPerSecond";
+const std::string ConfigManager::INDEXER_MAXJOBS = "indexer.maxJobs";
+const std::string ConfigManager::INDEXER_MAXMEGABYTESPERSECOND = "indexer.maxMegabytesPerSecond";
+const std::string ConfigManager::INDEXER_MAXREMOTEDEVICEJOBS = "indexer.maxRemoteDeviceJobs";
+const std::string ConfigManager::INDEXER_SHAREDATABASEPATH = "indexer.shareDatabasePath";
+const std::string ConfigManager::INDEXER_SHAREDATABASES = "indexer.shareDatabases";
+const std::string ConfigManager::INDEXER_STREAMLATENCY = "indexer.streamLatency";
 
 const std::string ConfigManager::LOGMANAGER_DEBUG = "logManager.debug";
+const std::string ConfigManager::LOGMANAGER_MAXQUEUESIZE = "logManager.maxQueueSize";
 const std::string ConfigManager::LOGMANAGER_PATH = "logManager.path";
 
+const std::string ConfigManager::SCRIPTRUNNER_MAXATTEMPTS = "scriptRunner.maxAttempts";
+const std::string ConfigManager::SCRIPTRUNNER_MAXQUEUESIZE = "scriptRunner.maxQueueSize";
+const std::string ConfigManager::SCRIPTRUNNER_MAXWORKERS = "scriptRunner.maxWorkers";
+const std::string ConfigManager::SCRIPTRUNNER_RETRYDELAY = "scriptRunner.retryDelay";
+
+const std::string ConfigManager::TASKRUNNER_MAXWORKERS = "taskRunner.maxWorkers";
+
 int ConfigManager::load()
 {
 	if ( LogManager::getInstance()->isDebug() ) {
@@ -145,6 +181,11 @@ void ConfigManager::loadDefaults()
 		setElement(DATABASEMANAGER_DATABASES,element);
 	}
 
+	setDefaultBool(HTTPSERVER_COMPRESSION_ENABLED,true);
+	setDefaultInt(HTTPSERVER_COMPRESSION_LEVEL,6);
+	setDefaultString(HTTPSERVER_COMPRESSION_MIMETYPES,"text/,application/javascript,application/json,application/x-javascript,application/xml");
+	setDefaultInt(HTTPSERVER_COMPRESSION_MINSIZE,1024);
+
 	setDefaultInt(HTTPSERVER_CONNECTOR_BUFFERSIZE,2048);
 	setDefaultInt(HTTPSERVER_CONNECTOR_CLIENTTIMEOUT,45000);
 	setDefaultInt(HTTPSERVER_CONNECTOR_MAXCLIENTS,150);
@@ -159,11 +200,22 @@ void ConfigManager::loadDefaults()
 	setDefaultString(HTTPSERVER_CONNECTOR_SSLCERTIFICATEKEYPASSWORD,"");
 	setDefaultBool(HTTPSERVER_CONNECTOR_SSLENABLED,false);
 
+	setDefaultInt(HTTPSERVER_DEFAULTHANDLER_CACHEMAXFILESIZE,1048576);
+	setDefaultInt(HTTPSERVER_DEFAULTHANDLER_CACHEMAXSIZE,16777216);
+	setDefaultString(HTTPSERVER_DEFAULTHANDLER_FINGERPRINTPATTERN,"\\.[0-9a-f]{8,}\\.[a-z0-9]+$");
+
 	setDefaultInt(HTTPSERVER_SESSIONMANAGER_MAXSESSIONS,10);
 	setDefaultInt(HTTPSERVER_SESSIONMANAGER_SESSIONTIMEOUT,45000);
 
-	if ( !hasElement(HTTPSERVER_REQUESTHANDLERS) )
+	setDefaultInt(HTTPSERVER_TRACING_MAXTRACES,100);
+	setDefaultInt(HTTPSERVER_TRACING_SAMPLERATE,100);
+	setDefaultString(HTTPSERVER_TRACING_SLOWLOGPATH,"logs/slow-%y%m%d.log");
+	setDefaultInt(HTTPSERVER_TRACING_SLOWTHRESHOLD,2000);
+
 	{
+		// raised whenever a handler is added to the defaults below
+		const int requestHandlersVersion = 2;
+
 		TiXmlElement element("requestHandlers");
 		TiXmlNode *node = NULL;
 
@@ -175,11 +227,61 @@ void ConfigManager::loadDefaults()
 		node->InsertEndChild(TiXmlElement("handler"))->InsertEndChild(TiXmlText("ShareHandler"));
 		node->InsertEndChild(TiXmlElement("urlPattern"))->InsertEndChild(TiXmlText("^/share/"));
 
-		setElement(HTTPSERVER_REQUESTHANDLERS,element);
+		node = element.InsertEndChild(TiXmlElement("requestHandler"));
+		node->InsertEndChild(TiXmlElement("handler"))->InsertEndChild(TiXmlText("MetricsHandler"));
+		node->InsertEndChild(TiXmlElement("urlPattern"))->InsertEndChild(TiXmlText("^/metrics$"));
+
+		node = element.InsertEndChild(TiXmlElement("requestHandler"));
+		node->InsertEndChild(TiXmlElement("handler"))->InsertEndChild(TiXmlText("CoverHandler"));
+		node->InsertEndChild(TiXmlElement("urlPattern"))->InsertEndChild(TiXmlText("^/cover/"));
+
+		TiXmlNode *requestHandlersNode = findNode(HTTPSERVER_REQUESTHANDLERS);
+		if ( requestHandlersNode==NULL ) {
+			setElement(HTTPSERVER_REQUESTHANDLERS,element);
+			setInt(HTTPSERVER_REQUESTHANDLERSVERSION,requestHandlersVersion);
+		}
+		else if ( getInt(HTTPSERVER_REQUESTHANDLERSVERSION)<requestHandlersVersion )
+		{
+			// handlers added in later versions are appended to existing configurations once,
+			// so that a handler removed on purpose stays removed
+			for ( node=element.FirstChildElement("requestHandler"); node!=NULL; 
+				node=element.IterateChildren("requestHandler",node) )
+			{
+				std::string handler = node->FirstChild("handler")->FirstChild()->Value();
+
+				bool found = false;
+				for ( TiXmlNode *existingNode=requestHandlersNode->FirstChildElement("requestHandler"); 
+					existingNode!=NULL && !found; existingNode=requestHandlersNode->IterateChildren("requestHandler",existingNode) )
+				{
+					TiXmlNode *handlerNode = existingNode->FirstChild("handler");
+					found = handlerNode!=NULL && handlerNode->FirstChild()!=NULL && 
+						handler==handlerNode->FirstChild()->Value();
+				}
+
+				if ( !found ) {
+					requestHandlersNode->InsertEndChild(*node);
+				}
+			}
+
+			setInt(HTTPSERVER_REQUESTHANDLERSVERSION,requestHandlersVersion);
+		}
 	}
 
+	setDefaultInt(INDEXER_BATCHSIZE,1000);
+	setDefaultString(INDEXER_COVERCACHEPATH,"cache/covers");
+	setDefaultInt(INDEXER_COVERMAXSIZE,4194304);
+	setDefaultString(INDEXER_COVERPATTERN,"^(cover|folder|front)\\.(jpe?g|png)$");
+	setDefaultBool(INDEXER_FASTMETADATA,false);
 	setDefaultString(INDEXER_FILEPATTERN,".gif$|.jpeg$|.jpg$|.mp3$|.nfo$|.txt$");
 	setDefaultBool(INDEXER_INCLUDEHIDDEN,false);
+	setDefaultInt(INDEXER_MAXDEVICEJOBS,1);
+	setDefaultInt(INDEXER_MAXFILESPERSECOND,0);
+	setDefaultInt(INDEXER_MAXJOBS,4);
+	setDefaultInt(INDEXER_MAXMEGABYTESPERSECOND,0);
+	setDefaultInt(INDEXER_MAXREMOTEDEVICEJOBS,2);
+	setDefaultString(INDEXER_SHAREDATABASEPATH,"db/shares");
+	setDefaultBool(INDEXER_SHAREDATABASES,false);
+	setDefaultInt(INDEXER_STREAMLATENCY,50);
 
 	if ( !hasElement(INDEXER_MAPPINGS) ) 
 	{
@@ -193,5 +295,13 @@ void ConfigManager::loadDefaults()
 		setElement(INDEXER_MAPPINGS,element);
 	}
 
+	setDefaultInt(LOGMANAGER_MAXQUEUESIZE,10000);
 	setDefaultString(LOGMANAGER_PATH,"logs/server-%y%m%d.log");
+
+	setDefaultInt(SCRIPTRUNNER_MAXATTEMPTS,5);
+	setDefaultInt(SCRIPTRUNNER_MAXQUEUESIZE,1000);
+	setDefaultInt(SCRIPTRUNNER_MAXWORKERS,2);
+	setDefaultInt(SCRIPTRUNNER_RETRYDELAY,30000);
+
+	setDefaultInt(TASKRUNNER_MAXWORKERS,2);
 }
@@ -68,6 +68,11 @@ public:
 
 	static const std::string DATABASEMANAGER_DATABASES;
 
+	static const std::string HTTPSERVER_COMPRESSION_ENABLED;
+	static const std::string HTTPSERVER_COMPRESSION_LEVEL;
+	static const std::string HTTPSERVER_COMPRESSION_MIMETYPES;
+	static const std::string HTTPSERVER_COMPRESSION_MINSIZE;
+
 	static const std::string HTTPSERVER_CONNECTOR_BUFFERSIZE;
 	static const std::string HTTPSERVER_CONNECTOR_CLIENTTIMEOUT;
 	static const std::string HTTPSERVER_CONNECTOR_MAXCLIENTS;
@@ -82,18 +87,49 @@ public:
 	static const std::string HTTPSERVER_CONNECTOR_SSLCERTIFICATEKEYPASSWORD;
 	static const std::string HTTPSERVER_CONNECTOR_SSLENABLED;
 
+	static const std::string HTTPSERVER_DEFAULTHANDLER_CACHEMAXFILESIZE;
+	static const std::string HTTPSERVER_DEFAULTHANDLER_CACHEMAXSIZE;
+	static const std::string HTTPSERVER_DEFAULTHANDLER_FINGERPRINTPATTERN;
+
 	static const std::string HTTPSERVER_REQUESTHANDLERS;
+	static const std::string HTTPSERVER_REQUESTHANDLERSVERSION;
 
 	static const std::string HTTPSERVER_SESSIONMANAGER_MAXSESSIONS;
 	static const std::string HTTPSERVER_SESSIONMANAGER_SESSIONTIMEOUT;
 
+	static const std::string HTTPSERVER_TRACING_MAXTRACES;
+	static const std::string HTTPSERVER_TRACING_SAMPLERATE;
+	static const std::string HTTPSERVER_TRACING_SLOWLOGPATH;
+	static const std::string HTTPSERVER_TRACING_SLOWTHRESHOLD;
+
+	static const std::string INDEXER_BATCHSIZE;
+	static const std::string INDEXER_COVERCACHEPATH;
+	static const std::string INDEXER_COVERMAXSIZE;
+	static const std::string INDEXER_COVERPATTERN;
+	static const std::string INDEXER_FASTMETADATA;
 	static const std::string INDEXER_FILEPATTERN;
 	static const std::string INDEXER_INCLUDEHIDDEN;
 	static const std::string INDEXER_MAPPINGS;
+	static const std::string INDEXER_MAXDEVICEJOBS;
+	static const std::string INDEXER_MAXFILESPERSECOND;
+	static const std::string INDEXER_MAXJOBS;
+	static const std::string INDEXER_MAXMEGABYTESPERSECOND;
+	static const std::string INDEXER_MAXREMOTEDEVICEJOBS;
+	static const std::string INDEXER_SHAREDATABASEPATH;
+	static const std::string INDEXER_SHAREDATABASES;
+	static const std::string INDEXER_STREAMLATENCY;
 
 	static const std::string LOGMANAGER_DEBUG;
+	static const std::string LOGMANAGER_MAXQUEUESIZE;
 	static const std::string LOGMANAGER_PATH;
 
+	static const std::string SCRIPTRUNNER_MAXATTEMPTS;
+	static const std::string SCRIPTRUNNER_MAXQUEUESIZE;
+	static const std::string SCRIPTRUNNER_MAXWORKERS;
+	static const std::string SCRIPTRUNNER_RETRYDELAY;
+
+	static const std::string TASKRUNNER_MAXWORKERS;
+
 	/**
 	* @override
 	*/
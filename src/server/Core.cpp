@@ -25,18 +25,24 @@
 #include "httpserver.h"
 #include "indexer.h"
 #include "logmanager.h"
+#include "metricsmanager.h"
 #include "savetask.h"
+#include "scriptrunner.h"
 #include "sharemanager.h"
 #include "sitemanager.h"
 #include "statisticsmanager.h"
+#include "streammonitor.h"
 #include "taskrunner.h"
 #include "usermanager.h"
+#include "verifyindextask.h"
 #include "version.h"
 
 void Core::init()
 {
 	ACE::init(); // initialize ace framework
 
+	MetricsManager::newInstance();
+	StreamMonitor::newInstance();
 	ConfigManager::newInstance();
 	DatabaseManager::newInstance();
 	LogManager::newInstance();
@@ -47,6 +53,7 @@ void Core::init()
 	HttpServer::newInstance();
 	Indexer::newInstance();
 	TaskRunner::newInstance();
+	ScriptRunner::newInstance();
 }
 
 int Core::startup(void (*callback)(void*,const std::string&),void *arg)
@@ -56,6 +63,11 @@ int Core::startup(void (*callback)(void*,const std::string&),void *arg)
 		return 1;
 	}
 
+	if ( callback!=NULL ) { callback(arg,"Starting Log Manager"); }
+	if ( !LogManager::getInstance()->start() ) {
+		return 1;
+	}
+
 	LogManager::getInstance()->info(LOGGER_CLASSNAME,"Initializing server");
 
 	if ( callback!=NULL ) { callback(arg,"Initializing Database Manager"); }
@@ -98,12 +110,27 @@ int Core::startup(void (*callback)(void*,const std::string&),void *arg)
 		return 1;
 	}
 
+	// queued scripts are resumed on start, so the index must be ready for them
+	if ( callback!=NULL ) { callback(arg,"Starting Script Runner"); }
+	if ( !ScriptRunner::getInstance()->start() ) {
+		return 1;
+	}
+
 	// schedule tasks to save all persistent managers at a regular interval
-	TaskRunner::getInstance()->schedule(new SaveTask(ConfigManager::getInstance()),3600,3600);
-	TaskRunner::getInstance()->schedule(new SaveTask(ShareManager::getInstance()),3600,3600);
-	TaskRunner::getInstance()->schedule(new SaveTask(SiteManager::getInstance()),3600,3600);
-	TaskRunner::getInstance()->schedule(new SaveTask(StatisticsManager::getInstance()),30,30);
-	TaskRunner::getInstance()->schedule(new SaveTask(UserManager::getInstance()),3600,3600);
+	TaskRunner::getInstance()->schedule(new SaveTask(ConfigManager::getInstance(),"SaveConfigManager"),3600,3600);
+	TaskRunner::getInstance()->schedule(new SaveTask(ShareManager::getInstance(),"SaveShareManager"),3600,3600);
+	TaskRunner::getInstance()->schedule(new SaveTask(SiteManager::getInstance(),"SaveSiteManager"),3600,3600);
+	TaskRunner::getInstance()->schedule(new SaveTask(UserManager::getInstance(),"SaveUserManager"),3600,3600);
+
+	// statistics are flushed often, make sure the flush isn't held up by slower tasks
+	SaveTask *statisticsTask = new SaveTask(StatisticsManager::getInstance(),"SaveStatisticsManager");
+	statisticsTask->setPriority(Task::PRIORITY_HIGH);
+	TaskRunner::getInstance()->schedule(statisticsTask,30,30);
+
+	// the index aggregates read at startup are verified once the server has settled
+	VerifyIndexTask *verifyIndexTask = new VerifyIndexTask();
+	verifyIndexTask->setPriority(Task::PRIORITY_LOW);
+	TaskRunner::getInstance()->schedule(verifyIndexTask,300,0);
 
 	return 0;
 }
@@ -118,6 +145,9 @@ int Core::cleanup(void (*callback)(void*,const std::string&),void *arg)
 	if ( callback!=NULL ) { callback(arg,"Stopping Indexer"); }
 	Indexer::getInstance()->stop();
 
+	if ( callback!=NULL ) { callback(arg,"Stopping Script Runner"); }
+	ScriptRunner::getInstance()->stop();
+
 	if ( callback!=NULL ) { callback(arg,"Stopping Task Runner"); }
 	TaskRunner::getInstance()->stop();
 
@@ -136,6 +166,10 @@ int Core::cleanup(void (*callback)(void*,const std::string&),void *arg)
 	if ( callback!=NULL ) { callback(arg,"Saving Config Manager"); }
 	ConfigManager::getInstance()->save();
 
+	if ( callback!=NULL ) { callback(arg,"Stopping Log Manager"); }
+	LogManager::getInstance()->stop();
+
+	ScriptRunner::deleteInstance();
 	TaskRunner::deleteInstance();
 	Indexer::deleteInstance();
 	HttpServer::deleteInstance();
@@ -146,6 +180,8 @@ int Core::cleanup(void (*callback)(void*,const std::string&),void *arg)
 	LogManager::deleteInstance();
 	DatabaseManager::deleteInstance();
 	ConfigManager::deleteInstance();
+	StreamMonitor::deleteInstance();
+	MetricsManager::deleteInstance();
 
 	ACE::fini(); // finalize ace framework
 
@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "covercache.h"
+
+#define LOGGER_CLASSNAME "CoverCache"
+
+#include <ace/os.h>
+#include <boost/filesystem/convenience.hpp>
+#include <boost/filesystem/exception.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include "logmanager.h"
+
+bool CoverCache::init(const std::string &path,size_t maxImageSize)
+{
+	m_path = path;
+	m_maxImageSize = maxImageSize;
+
+	try {
+		boost::filesystem::create_directories(boost::filesystem::path(m_path,boost::filesystem::native));
+	}
+	catch(boost::filesystem::filesystem_error &ex) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not create cache directory [%s]",ex.what());
+		return false;
+	}
+
+	return true;
+}
+
+std::string CoverCache::store(const char *data,size_t size)
+{
+	if ( size==0 || size>m_maxImageSize ) {
+		return "";
+	}
+
+	if ( getMimeType(std::string(data,size<8 ? size : 8)).empty() ) {
+		return "";
+	}
+
+	std::string hash = Util::CryptoUtil::md5Encode(data,size);
+	std::string imagePath = getImagePath(hash);
+
+	ACE_Guard<ACE_Mutex> guard(m_mutex);
+
+	ACE_stat fileStat;
+	if ( ACE_OS::stat(imagePath.c_str(),&fileStat)==0 ) {
+		return hash;
+	}
+
+	try {
+		boost::filesystem::create_directories(boost::filesystem::path(imagePath,boost::filesystem::native).branch_path());
+	}
+	catch(boost::filesystem::filesystem_error &ex) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not create cache directory [%s]",ex.what());
+		return "";
+	}
+
+	// write to a temporary file first, so that a partially 
+	// written image is never served under its hash
+	std::string tempPath = imagePath + ".tmp";
+
+	FILE *file = fopen(tempPath.c_str(),"wb");
+	if ( file==NULL ) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not write image \"%s\"",tempPath.c_str());
+		return "";
+	}
+
+	size_t bytesWritten = fwrite(data,sizeof(char),size,file);
+	fclose(file);
+
+	if ( bytesWritten!=size || ACE_OS::rename(tempPath.c_str(),imagePath.c_str())!=0 ) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not write image \"%s\"",imagePath.c_str());
+		ACE_OS::unlink(tempPath.c_str());
+		return "";
+	}
+
+	return hash;
+}
+
+std::string CoverCache::storeFile(const std::wstring &path)
+{
+	FILE *file = NULL;
+
+	#ifdef WIN32
+		file = _wfopen(path.c_str(),L"rb");
+	#else
+		file = fopen(Util::ConvertUtil::toString(path).c_str(),"rb");
+	#endif
+
+	if ( file==NULL ) {
+		return "";
+	}
+
+	// covers are far below the limits of a long, so ftell is enough for the size
+	fseek(file,0,SEEK_END);
+	long fileSize = ftell(file);
+	fseek(file,0,SEEK_SET);
+
+	std::string hash;
+	if ( fileSize>0 && (uint64_t)fileSize<=m_maxImageSize )
+	{
+		std::string data;
+		data.resize((size_t)fileSize);
+
+		if ( fread(&data[0],sizeof(char),data.length(),file)==data.length() ) {
+			hash = store(data.c_str(),data.length());
+		}
+	}
+
+	fclose(file);
+
+	return hash;
+}
+
+bool CoverCache::read(const std::string &hash,std::string &data)
+{
+	if ( !isValidHash(hash) ) {
+		return false;
+	}
+
+	FILE *file = fopen(getImagePath(hash).c_str(),"rb");
+	if ( file==NULL ) {
+		return false;
+	}
+
+	char buffer[4096];
+
+	size_t bytesRead = 0;
+	while ( (bytesRead=fread(buffer,sizeof(char),sizeof(buffer),file))>0 ) {
+		data.append(buffer,bytesRead);
+	}
+
+	fclose(file);
+
+	return !data.empty();
+}
+
+int CoverCache::purge(const std::set<std::string> &hashes)
+{
+	int removedImages = 0;
+
+	ACE_Guard<ACE_Mutex> guard(m_mutex);
+
+	try
+	{
+		boost::filesystem::path cachePath(m_path,boost::filesystem::native);
+
+		boost::filesystem::directory_iterator endIter;
+		for ( boost::filesystem::directory_iterator dirIter(cachePath); dirIter!=endIter; dirIter++ )
+		{
+			if ( !boost::filesystem::is_directory(*dirIter) ) {
+				continue;
+			}
+
+			for ( boost::filesystem::directory_iterator iter(*dirIter); iter!=endIter; iter++ )
+			{
+				std::string fileName = iter->leaf();
+
+				// leftover temporary files are removed as well
+				if ( hashes.find(fileName)==hashes.end() ) 
+				{
+					try {
+						boost::filesystem::remove(*iter);
+						removedImages++;
+					}
+					catch(boost::filesystem::filesystem_error) {
+
+					}
+				}
+			}
+		}
+	}
+	catch(boost::filesystem::filesystem_error &ex) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not purge cache [%s]",ex.what());
+	}
+
+	return removedImages;
+}
+
+std::string CoverCache::getMimeType(const std::string &data)
+{
+	if ( boost::starts_with(data,"\xFF\xD8\xFF") ) {
+		return "image/jpeg";
+	}
+	else if ( boost::starts_with(data,"\x89PNG") ) {
+		return "image/png";
+	}
+	else if ( boost::starts_with(data,"GIF8") ) {
+		return "image/gif";
+	}
+	else if ( boost::starts_with(data,"BM") ) {
+		return "image/bmp";
+	}
+
+	return "";
+}
+
+bool CoverCache::isValidHash(const std::string &hash)
+{
+	if ( hash.length()!=32 ) {
+		return false;
+	}
+
+	for ( std::string::const_iterator iter=hash.begin(); iter!=hash.end(); iter++ ) {
+		if ( !isxdigit((unsigned char)*iter) ) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+std::string CoverCache::getImagePath(const std::string &hash)
+{
+	return m_path + "/" + hash.substr(0,2) + "/" + hash;
+}
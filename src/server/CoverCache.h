@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef guard_covercache_h
+#define guard_covercache_h
+
+#include <ace/synch.h>
+
+#include <set>
+
+/**
+* CoverCache.
+* An on-disk cache of cover images, keyed by the md5 hash of the image content.
+* Identical images, such as the same cover embedded in every track of an album, 
+* are only stored once. Since the content of a cached image never changes under 
+* its hash, cached images can be served with long-lived caching.
+*/
+class CoverCache
+{
+public:
+	/**
+	* Default constructor.
+	* @return instance
+	*/
+	CoverCache() : m_maxImageSize(0)
+	{
+
+	}
+
+	/**
+	* Initialize the cache.
+	* @param path the directory to store cached images in. Created if it doesn't exist
+	* @param maxImageSize the maximum size of a single image for it to be cached
+	* @return true if the cache was initialized successfully
+	*/
+	bool init(const std::string &path,size_t maxImageSize);
+
+	/**
+	* Store an image in the cache, unless an identical image is already cached.
+	* @param data the image content
+	* @param size the size of the image content
+	* @return the hash of the image, or an empty string if the image could not be stored
+	*/
+	std::string store(const char *data,size_t size);
+
+	/**
+	* Store the image file at the given path in the cache.
+	* @param path the path to the image file
+	* @return the hash of the image, or an empty string if the image could not be stored
+	*/
+	std::string storeFile(const std::wstring &path);
+
+	/**
+	* Read a cached image.
+	* @param hash the hash of the image
+	* @param data out parameter for the image content
+	* @return true if the image was found
+	*/
+	bool read(const std::string &hash,std::string &data);
+
+	/**
+	* Remove all cached images that are not in the given collection.
+	* @param hashes the hashes of all images that are still in use
+	* @return the number of removed images
+	*/
+	int purge(const std::set<std::string> &hashes);
+
+	/**
+	* Get the mime type of an image by its content.
+	* @param data the image content
+	* @return the mime type, or an empty string if the content is not a known image format
+	*/
+	static std::string getMimeType(const std::string &data);
+
+	/**
+	* Check that the given string is a well formed image hash.
+	* @param hash the string to check
+	* @return true if the string is a well formed image hash
+	*/
+	static bool isValidHash(const std::string &hash);
+
+private:
+	/**
+	* Get the path of the cached image with the given hash.
+	* Images are spread over subdirectories by the first characters of their hash.
+	* @param hash the hash of the image
+	* @return the path of the cached image
+	*/
+	std::string getImagePath(const std::string &hash);
+
+	ACE_Mutex m_mutex;
+
+	std::string m_path;
+
+	size_t m_maxImageSize;
+};
+
+#endif
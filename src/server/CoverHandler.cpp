@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "coverhandler.h"
+
+#define LOGGER_CLASSNAME "CoverHandler"
+
+#include "databasemanager.h"
+#include "indexer.h"
+#include "logmanager.h"
+#include "sharemanager.h"
+
+const std::string CoverHandler::NAME = "CoverHandler";
+
+const int CoverHandler::MAX_AGE = 31536000;
+
+bool CoverHandler::handleRequest(HttpWorker *worker,
+	HttpServerRequest &httpRequest,HttpServerResponse &httpResponse)
+{
+	if ( LogManager::getInstance()->isDebug() ) {
+		LogManager::getInstance()->debug(LOGGER_CLASSNAME,"Handling \"%s\"",httpRequest.getUri().c_str());
+	}
+
+	// make sure client is authenticated
+	if ( httpRequest.getSession()==NULL ) {
+		httpResponse.setStatusCode(HttpResponse::HttpStatus::HTTP_UNAUTHORIZED);
+		return false;
+	}
+
+	// everything from the last slash and forward is the hash
+	std::string coverHash;
+	size_t pos = httpRequest.getPath().find_last_of("/");
+	if ( pos!=std::string::npos ) {
+		coverHash = boost::to_lower_copy(httpRequest.getPath().substr(pos+1));
+	}
+
+	if ( !CoverCache::isValidHash(coverHash) ) {
+		httpResponse.setStatusCode(HttpResponse::HttpStatus::HTTP_NOT_FOUND);
+		return false;
+	}
+
+	if ( !checkPermission(httpRequest,coverHash) ) {
+		httpResponse.setStatusCode(HttpResponse::HttpStatus::HTTP_FORBIDDEN);
+		return false;
+	}
+
+	// the content of a hash never changes, so the hash itself is the entity tag
+	std::string etag = "\"" + coverHash + "\"";
+
+	httpResponse.setHeader("Cache-Control","private, max-age=" + Util::ConvertUtil::toString(MAX_AGE));
+	httpResponse.setHeader("ETag",etag);
+
+	if ( httpRequest.isMatchingEtag(etag) ) {
+		httpResponse.setStatusCode(HttpResponse::HttpStatus::HTTP_NOT_MODIFIED);
+		httpResponse.flush();
+		return true;
+	}
+
+	std::string data;
+	if ( !Indexer::getInstance()->getCoverCache().read(coverHash,data) ) {
+		httpResponse.setStatusCode(HttpResponse::HttpStatus::HTTP_NOT_FOUND);
+		return false;
+	}
+
+	TraceScope scope(httpRequest.getTrace(),"sendImage");
+
+	httpResponse.setContentType(CoverCache::getMimeType(data));
+	httpResponse.setContentLength(data.length());
+	httpResponse.write(data.c_str(),data.length(),true);
+
+	return true;
+}
+
+bool CoverHandler::checkPermission(HttpServerRequest &httpRequest,const std::string &coverHash)
+{
+	std::string shareIds;
+
+	// create a list of share id's that the user has access to
+	std::list<Share> shares = ShareManager::getInstance()->getShares();
+	for ( std::list<Share>::iterator iter=shares.begin(); iter!=shares.end(); iter++ ) {
+		if ( iter->checkPermission(*httpRequest.getUser(),httpRequest.getRemoteAddress()) ) {
+			std::string shareId = Util::ConvertUtil::toString(iter->getDbId());
+			shareIds.empty() ? shareIds += shareId : shareIds += "," + shareId;
+		}
+	}
+
+	if ( shareIds.empty() ) {
+		return false;
+	}
+
+	bool hasPermission = false;
+
+	DatabaseConnection *conn = DatabaseManager::getInstance()->getConnection(DatabaseManager::DATABASE_INDEX);
+	if ( conn!=NULL )
+	{
+		TraceScope scope(httpRequest.getTrace(),"query");
+
+		try
+		{
+			std::stringstream query;
+			query << "SELECT COUNT(*) FROM (SELECT itemId FROM [items] WHERE coverHash='" 
+				<< conn->quote(coverHash) << "' AND shareId IN (" << shareIds << ") LIMIT 1)";
+
+			hasPermission = conn->getSqliteConn().executeint(query.str())>0;
+		}
+		catch(exception &ex) 
+		{
+			if ( LogManager::getInstance()->isDebug() ) {
+				LogManager::getInstance()->debug(LOGGER_CLASSNAME,"Query for cover failed [%s]",ex.what());
+			}
+		}
+
+		DatabaseManager::getInstance()->releaseConnection(conn);
+	}
+
+	return hasPermission;
+}
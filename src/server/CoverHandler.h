@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef guard_coverhandler_h
+#define guard_coverhandler_h
+
+#include "httprequesthandler.h"
+
+/**
+* CoverHandler.
+* Handles requests for cover images extracted by the indexer. Images are 
+* requested by their content hash, so the response never changes for a uri
+* and can be cached by clients for as long as they want.
+*/
+class CoverHandler : public HttpRequestHandler
+{
+public:
+	/**
+	 * Constructor.
+	 * @param urlPatternRegex the url pattern regular expression
+	 * @return instance
+	 */
+	CoverHandler(boost::regex urlPatternRegex) {
+		m_urlPatternRegex = urlPatternRegex;
+	}
+
+	static const std::string NAME;
+
+	static const int MAX_AGE;
+
+	/**
+	* @override
+	*/
+	virtual bool init() { return true; }
+
+	/**
+	* @override
+	*/
+	virtual void cleanup() {}
+
+	/**
+	* @override
+	*/
+	virtual bool handleRequest(HttpWorker *worker,
+		HttpServerRequest &httpRequest,HttpServerResponse &httpResponse);
+
+	/**
+	* @override
+	*/
+	virtual const std::string& getName() const {
+		return NAME;
+	}
+
+private:
+	/**
+	* Check if the user has access to a share containing an item with the given cover.
+	* @param httpRequest the http request
+	* @param coverHash the hash of the cover image
+	* @return true if the user has access to the cover
+	*/
+	bool checkPermission(HttpServerRequest &httpRequest,const std::string &coverHash);
+};
+
+#endif
@@ -44,6 +44,18 @@ DatabaseConnection* Database::newConnection()
 	return conn;
 }
 
+void Database::closeIdleConnections()
+{
+	while ( !m_idleConnections.empty() ) 
+	{
+		DatabaseConnection *conn = m_idleConnections.top();
+		m_idleConnections.pop();
+
+		m_connections.remove(conn);
+		delete conn;
+	}
+}
+
 void Database::pushConnection(DatabaseConnection *conn) 
 {
 	m_idleConnections.push(conn);
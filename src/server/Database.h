@@ -35,7 +35,9 @@ public:
 	* @param database the database this connection is linked to
 	* @return instance
 	*/
-	DatabaseConnection(Database *database) {
+	DatabaseConnection(Database *database) : m_attachmentsVersion(0),
+		m_writeLocked(false) 
+	{
 		m_database = database;
 	}
 
@@ -77,10 +79,111 @@ public:
 		return boost::replace_all_copy(s,"'","''");
 	}
 
+	/**
+	* Get the schema names of the databases attached to the connection.
+	* @return the schema names of the attached databases
+	*/
+	std::list<std::string>& getAttachedSchemas() {
+		return m_attachedSchemas;
+	}
+
+	/**
+	* Get the version of the database attachments that the connection was last synchronized with.
+	* @return the version of the database attachments
+	*/
+	const int getAttachmentsVersion() const {
+		return m_attachmentsVersion;
+	}
+
+	/**
+	* Get the names of the temporary views merging the tables of the attached databases.
+	* @return the names of the merged views
+	*/
+	std::list<std::string>& getMergedViews() {
+		return m_mergedViews;
+	}
+
+	/**
+	* Set the version of the database attachments that the connection was last synchronized with.
+	* @param attachmentsVersion the version of the database attachments
+	*/
+	void setAttachmentsVersion(int attachmentsVersion) {
+		m_attachmentsVersion = attachmentsVersion;
+	}
+
+	/**
+	* Get whether the connection holds the write lock of its database.
+	* @return true if the connection holds the write lock
+	*/
+	const bool isWriteLocked() const {
+		return m_writeLocked;
+	}
+
+	/**
+	* Set whether the connection holds the write lock of its database.
+	* Write locking the databases are handled by the DatabaseManager.
+	* @param writeLocked true if the connection holds the write lock
+	*/
+	void setWriteLocked(bool writeLocked) {
+		m_writeLocked = writeLocked;
+	}
+
 private:
 	Database *m_database;
 
 	sqlite3x::sqlite3_connection m_sqliteConn;
+
+	std::list<std::string> m_attachedSchemas;
+	std::list<std::string> m_mergedViews;
+
+	int m_attachmentsVersion;
+
+	bool m_writeLocked;
+};
+
+/**
+* DatabaseAttachment.
+* Represents a database that is attached to every connection of another database.
+*/
+class DatabaseAttachment
+{
+public:
+	/**
+	* Get the path to the attached database file.
+	* @return the path to the attached database file
+	*/
+	const std::string& getPath() const {
+		return m_path;
+	}
+
+	/**
+	* Get the names of the tables that are merged with the tables of the main database.
+	* @return the names of the merged tables
+	*/
+	const std::list<std::string>& getTables() const {
+		return m_tables;
+	}
+
+	/**
+	* Set the path to the attached database file.
+	* @param path the path to the attached database file
+	*/
+	void setPath(const std::string &path) {
+		m_path = path;
+	}
+
+	/**
+	* Set the names of the tables that are merged with the tables of the main database.
+	* @param tables the names of the merged tables
+	*/
+	void setTables(const std::list<std::string> &tables) {
+		m_tables = tables;
+	}
+
+private:
+	std::list<std::string> m_tables;
+
+	std::string m_path;
 };
 
 /**
@@ -94,8 +197,8 @@ public:
 	* Constructor.
 	* @return instance
 	*/
-	Database() : m_synchronous(false),
-		m_writeLocked(false) 
+	Database() : m_attachmentsVersion(0),
+		m_synchronous(false)
 	{
 
 	}
@@ -130,6 +233,27 @@ public:
 	*/
 	DatabaseConnection* popConnection();
 
+	/**
+	* Close all idle connections to the database.
+	*/
+	void closeIdleConnections();
+
+	/**
+	* Get the databases attached to every connection, by schema name.
+	* @return the attached databases
+	*/
+	const std::map<std::string,DatabaseAttachment>& getAttachments() const {
+		return m_attachments;
+	}
+
+	/**
+	* Get the version of the attachments, which is increased whenever they change.
+	* @return the version of the attachments
+	*/
+	const int getAttachmentsVersion() const {
+		return m_attachmentsVersion;
+	}
+
 	/**
 	* Get the name of the database.
 	* @return the name of the database
@@ -146,6 +270,14 @@ public:
 		return m_path;
 	}
 
+	/**
+	* Get whether no connections to the database are in use.
+	* @return true if all connections to the database are idle
+	*/
+	const bool isIdle() const {
+		return m_connections.size()==m_idleConnections.size();
+	}
+
 	/**
 	* Get whether the database is synchrous or not.
 	* See sqlite documentation for details.
@@ -156,11 +288,23 @@ public:
 	}
 
 	/**
-	* Get whether the database write locked.
-	* @return true if the database is write locked
+	* Remove an attached database.
+	* @param schemaName the schema name of the attached database
 	*/
-	const bool isWriteLocked() const {
-		return m_writeLocked;
+	void removeAttachment(const std::string &schemaName) {
+		if ( m_attachments.erase(schemaName)>0 ) {
+			m_attachmentsVersion++;
+		}
+	}
+
+	/**
+	* Set a database that should be attached to every connection.
+	* @param schemaName the schema name that the database is attached as
+	* @param attachment the database to attach
+	*/
+	void setAttachment(const std::string &schemaName,const DatabaseAttachment &attachment) {
+		m_attachments[schemaName] = attachment;
+		m_attachmentsVersion++;
 	}
 
 	/**
@@ -188,26 +332,19 @@ public:
 		m_synchronous = synchronous;
 	}
 
-	/**
-	* Set whether the database should be write locked.
-	* A write locked database means that it is locked both for reading and writing.
-	* Write locking the databases are handled by the DatabaseManager.
-	* @param writeLocked true if the database is write locked
-	*/
-	void setWriteLocked(bool writeLocked) {
-		m_writeLocked = writeLocked;
-	}
-
 private:
 	std::list<DatabaseConnection*> m_connections;
 
 	std::stack<DatabaseConnection*> m_idleConnections;
 
+	std::map<std::string,DatabaseAttachment> m_attachments;
+
 	std::string m_name;
 	std::string m_path;
 
+	int m_attachmentsVersion;
+
 	bool m_synchronous;
-	bool m_writeLocked;
 };
 
 
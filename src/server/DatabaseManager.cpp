@@ -20,7 +20,10 @@
 
 #define LOGGER_CLASSNAME "DatabaseManager"
 
+#include <ace/high_res_timer.h>
+
 #include "logmanager.h"
+#include "metricsmanager.h"
 
 const std::string DatabaseManager::DATABASE_INDEX = "index";
 const std::string DatabaseManager::DATABASE_SERVER = "server";
@@ -28,144 +31,378 @@ const std::string DatabaseManager::DATABASE_SERVER = "server";
 bool DatabaseManager::init()
 {
 	std::list<Database>::iterator iter;
-	for ( iter=m_databases.begin(); iter!=m_databases.end(); iter++ )
-	{
-		DatabaseConnection *conn = getConnection(&*iter,true);
-		if ( conn==NULL ) {
-			LogManager::getInstance()->warning(LOGGER_CLASSNAME,
-				"Could not retrieve an initial connection to database '%s'",iter->getName().c_str());
+	for ( iter=m_databases.begin(); iter!=m_databases.end(); iter++ ) {
+		if ( !initDatabase(&*iter,iter->getPath() + ".sql") ) {
 			return false;
 		}
+	}
+
+	return true;
+}
+
+bool DatabaseManager::addDatabase(const std::string &name,const std::string &path,
+	const std::string &scriptPath,bool synchronous)
+{
+	m_mutex.acquire();
 
-		bool success = false;
+	Database *database = findDatabaseByName(name);
+	if ( database!=NULL ) {
+		m_mutex.release();
+		return true;
+	}
+
+	m_databases.push_back(Database());
+	database = &m_databases.back();
+	database->setName(name);
+	database->setPath(path);
+	database->setSynchronous(synchronous);
+
+	m_mutex.release();
+
+	if ( !initDatabase(database,scriptPath) ) {
+		removeDatabase(name);
+		return false;
+	}
+
+	return true;
+}
 
-		try
+bool DatabaseManager::removeDatabase(const std::string &name)
+{
+	ACE_Guard<ProfiledMutex> guard(m_mutex);
+
+	// detach it everywhere first, so idle connections of other databases let go of the file
+	std::list<Database>::iterator iter;
+	for ( iter=m_databases.begin(); iter!=m_databases.end(); iter++ ) 
+	{
+		if ( iter->getAttachments().find(name)!=iter->getAttachments().end() ) {
+			iter->removeAttachment(name);
+			iter->closeIdleConnections();
+		}
+	}
+
+	for ( iter=m_databases.begin(); iter!=m_databases.end(); iter++ )
+	{
+		if ( iter->getName()==name )
 		{
-			if ( iter->isSynchronous() )
-			{
-				conn->getSqliteConn().executenonquery(
-					"PRAGMA auto_vacuum=FULL;"
-					"PRAGMA count_changes=OFF;"
-					"PRAGMA synchronous=NORMAL;"
-					"PRAGMA temp_store=MEMORY");
-			}
-			else
-			{
-				conn->getSqliteConn().executenonquery(
-					"PRAGMA auto_vacuum=FULL;"
-					"PRAGMA count_changes=OFF;"
-					"PRAGMA synchronous=OFF;"
-					"PRAGMA temp_store=MEMORY");
+			iter->closeIdleConnections();
+
+			// connections still in use will be pushed back to the database
+			if ( !iter->isIdle() ) {
+				return false;
 			}
 
-			std::string scriptPath = iter->getPath() + ".sql";
-			std::fstream file(scriptPath.c_str(),std::ios::in);
-			if ( file.is_open() )
-			{
-				std::stringstream script;
-				script << file.rdbuf();
+			m_databases.erase(iter);
+			break;
+		}
+	}
+
+	return true;
+}
+
+void DatabaseManager::attachDatabase(const std::string &name,const std::string &attachedName,
+	const std::list<std::string> &tables)
+{
+	ACE_Guard<ProfiledMutex> guard(m_mutex);
 
-				try 
+	Database *database = findDatabaseByName(name);
+	Database *attachedDatabase = findDatabaseByName(attachedName);
+	if ( database!=NULL && attachedDatabase!=NULL ) 
+	{
+		DatabaseAttachment attachment;
+		attachment.setPath(attachedDatabase->getPath());
+		attachment.setTables(tables);
+
+		database->setAttachment(attachedName,attachment);
+	}
+}
+
+void DatabaseManager::detachDatabase(const std::string &name,const std::string &attachedName)
+{
+	ACE_Guard<ProfiledMutex> guard(m_mutex);
+
+	Database *database = findDatabaseByName(name);
+	if ( database!=NULL ) {
+		database->removeAttachment(attachedName);
+	}
+}
+
+bool DatabaseManager::initDatabase(Database *database,const std::string &scriptPath)
+{
+	DatabaseConnection *conn = getConnection(database,true);
+	if ( conn==NULL ) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,
+			"Could not retrieve an initial connection to database '%s'",database->getName().c_str());
+		return false;
+	}
+
+	bool success = false;
+
+	try
+	{
+		if ( database->isSynchronous() )
+		{
+			conn->getSqliteConn().executenonquery(
+				"PRAGMA auto_vacuum=FULL;"
+				"PRAGMA count_changes=OFF;"
+				"PRAGMA synchronous=NORMAL;"
+				"PRAGMA temp_store=MEMORY");
+		}
+		else
+		{
+			conn->getSqliteConn().executenonquery(
+				"PRAGMA auto_vacuum=FULL;"
+				"PRAGMA count_changes=OFF;"
+				"PRAGMA synchronous=OFF;"
+				"PRAGMA temp_store=MEMORY");
+		}
+
+		std::fstream file(scriptPath.c_str(),std::ios::in);
+		if ( file.is_open() )
+		{
+			std::stringstream script;
+			script << file.rdbuf();
+
+			try 
+			{
+				std::vector<std::string> queries = tokenizeScript(script.str());
+				std::vector<std::string>::iterator queryIter;
+				for ( queryIter=queries.begin(); queryIter!=queries.end(); queryIter++ ) 
 				{
-					std::vector<std::string> queries = tokenizeScript(script.str());
-					std::vector<std::string>::iterator queryIter;
-					for ( queryIter=queries.begin(); queryIter!=queries.end(); queryIter++ ) 
-					{
-						if ( LogManager::getInstance()->isDebug() ) {
-							LogManager::getInstance()->info(LOGGER_CLASSNAME,
-								"Executing init query: %s",queryIter->c_str());
-						}
-
-						conn->getSqliteConn().executenonquery(*queryIter);
+					if ( LogManager::getInstance()->isDebug() ) {
+						LogManager::getInstance()->info(LOGGER_CLASSNAME,
+							"Executing init query: %s",queryIter->c_str());
 					}
 
-					success = true;
-				}
-				catch(exception &ex) {
-					LogManager::getInstance()->warning(LOGGER_CLASSNAME,
-						"Could not execute script for database '%s' [%s]",iter->getName().c_str(),ex.what());
+					conn->getSqliteConn().executenonquery(*queryIter);
 				}
 
-				file.close();
-			}
-			else {
 				success = true;
 			}
-		}
-		catch(exception &ex) {
-			LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not optimize database '%s' [%s]",iter->getName().c_str(),ex.what());
-		}
-
-		releaseConnection(conn);
+			catch(exception &ex) {
+				LogManager::getInstance()->warning(LOGGER_CLASSNAME,
+					"Could not execute script for database '%s' [%s]",database->getName().c_str(),ex.what());
+			}
 
-		if ( !success ) {
-			return false;
+			file.close();
 		}
+		else {
+			success = true;
+		}
+	}
+	catch(exception &ex) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not optimize database '%s' [%s]",database->getName().c_str(),ex.what());
 	}
 
-	return true;
+	releaseConnection(conn);
+
+	return success;
 }
 
 DatabaseConnection* DatabaseManager::getConnection(const std::string name,const bool writeLock)
 {
+	DatabaseConnection *conn = NULL;
+
+	// databases added at runtime may be removed, so the lookup is done under the lock
+	m_mutex.acquire();
 	Database *database = findDatabaseByName(name);
 	if ( database!=NULL ) {
-		return getConnection(database,writeLock);
+		conn = popConnection(database);
 	}
+	m_mutex.release();
 
-	return NULL;
+	return prepareConnection(conn,writeLock);
 }
 
 DatabaseConnection* DatabaseManager::getConnection(Database *database,const bool writeLock)
 {
-	DatabaseConnection *conn = NULL;
+	m_mutex.acquire();
+	DatabaseConnection *conn = popConnection(database);
+	m_mutex.release();
+
+	return prepareConnection(conn,writeLock);
+}
+
+void DatabaseManager::releaseConnection(DatabaseConnection *conn)
+{
+	// only the connection holding the lock may release it, as other 
+	// connections to the same database may be in use by readers
+	if ( conn->isWriteLocked() ) {
+		releaseWriteLock(conn->getDatabase());
+		conn->setWriteLocked(false);
+	}
 
 	m_mutex.acquire();
-	conn = database->popConnection();
+	conn->getDatabase()->pushConnection(conn);
 	m_mutex.release();
+}
+
+std::string DatabaseManager::getDatabasePath(const std::string &name)
+{
+	ACE_Guard<ProfiledMutex> guard(m_mutex);
 
+	Database *database = findDatabaseByName(name);
+	if ( database!=NULL ) {
+		return database->getPath();
+	}
+
+	return "";
+}
+
+DatabaseConnection* DatabaseManager::popConnection(Database *database)
+{
+	DatabaseConnection *conn = database->popConnection();
 	if ( conn==NULL ) {
 		conn = database->newConnection();
+		MetricsManager::getInstance()->addDatabaseConnection();
 	}
 
+	return conn;
+}
+
+DatabaseConnection* DatabaseManager::prepareConnection(DatabaseConnection *conn,const bool writeLock)
+{
 	if ( conn!=NULL ) 
 	{
+		syncAttachments(conn);
+
 		if ( writeLock ) {
-			acquireWriteLock(database);
+			acquireWriteLock(conn->getDatabase());
+			conn->setWriteLocked(true);
 		}
 	}
 
 	return conn;
 }
 
-void DatabaseManager::releaseConnection(DatabaseConnection *conn)
+void DatabaseManager::syncAttachments(DatabaseConnection *conn)
 {
-	releaseWriteLock(conn->getDatabase());
-
 	m_mutex.acquire();
-	conn->getDatabase()->pushConnection(conn);
+	int version = conn->getDatabase()->getAttachmentsVersion();
+	std::map<std::string,DatabaseAttachment> attachments = conn->getDatabase()->getAttachments();
 	m_mutex.release();
+
+	if ( conn->getAttachmentsVersion()==version ) {
+		return;
+	}
+
+	sqlite3x::sqlite3_connection &sqliteConn = conn->getSqliteConn();
+
+	try
+	{
+		std::list<std::string>::iterator iter;
+
+		// the views reference the attached databases, so they're dropped first
+		for ( iter=conn->getMergedViews().begin(); iter!=conn->getMergedViews().end(); iter++ ) {
+			sqliteConn.executenonquery("DROP VIEW IF EXISTS temp.[" + *iter + "]");
+		}
+
+		conn->getMergedViews().clear();
+
+		for ( iter=conn->getAttachedSchemas().begin(); iter!=conn->getAttachedSchemas().end(); iter++ ) {
+			sqliteConn.executenonquery("DETACH DATABASE [" + *iter + "]");
+		}
+
+		conn->getAttachedSchemas().clear();
+
+		// the schema names of the databases to merge, by table name
+		std::map<std::string,std::list<std::string> > mergedTables;
+
+		std::map<std::string,DatabaseAttachment>::iterator attachmentIter;
+		for ( attachmentIter=attachments.begin(); attachmentIter!=attachments.end(); attachmentIter++ )
+		{
+			sqliteConn.executenonquery("ATTACH DATABASE '" + conn->quote(attachmentIter->second.getPath()) + 
+				"' AS [" + attachmentIter->first + "]");
+
+			conn->getAttachedSchemas().push_back(attachmentIter->first);
+
+			std::list<std::string>::const_iterator tableIter;
+			for ( tableIter=attachmentIter->second.getTables().begin(); 
+				tableIter!=attachmentIter->second.getTables().end(); tableIter++ ) 
+			{
+				mergedTables[*tableIter].push_back(attachmentIter->first);
+			}
+		}
+
+		std::map<std::string,std::list<std::string> >::iterator tableIter;
+		for ( tableIter=mergedTables.begin(); tableIter!=mergedTables.end(); tableIter++ )
+		{
+			// only the columns that every database has can be merged
+			std::vector<std::string> columns = getColumns(conn,"main",tableIter->first);
+			for ( iter=tableIter->second.begin(); iter!=tableIter->second.end(); iter++ )
+			{
+				std::vector<std::string> attachedColumns = getColumns(conn,*iter,tableIter->first);
+				for ( std::vector<std::string>::iterator columnIter=columns.begin(); columnIter!=columns.end(); ) 
+				{
+					if ( std::find(attachedColumns.begin(),attachedColumns.end(),*columnIter)==attachedColumns.end() ) {
+						columnIter = columns.erase(columnIter);
+					}
+					else {
+						columnIter++;
+					}
+				}
+			}
+
+			std::string columnList;
+			for ( std::vector<std::string>::iterator columnIter=columns.begin(); columnIter!=columns.end(); columnIter++ ) 
+			{
+				if ( !columnList.empty() ) {
+					columnList += ",";
+				}
+
+				columnList += "[" + *columnIter + "]";
+			}
+
+			std::string query = "CREATE TEMP VIEW [" + tableIter->first + "] AS "
+				"SELECT " + columnList + " FROM main.[" + tableIter->first + "]";
+
+			for ( iter=tableIter->second.begin(); iter!=tableIter->second.end(); iter++ ) {
+				query += " UNION ALL SELECT " + columnList + " FROM [" + *iter + "].[" + tableIter->first + "]";
+			}
+
+			sqliteConn.executenonquery(query);
+			conn->getMergedViews().push_back(tableIter->first);
+		}
+	}
+	catch(exception &ex) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not attach databases to '%s' [%s]",
+			conn->getDatabase()->getName().c_str(),ex.what());
+	}
+
+	// a failed attachment is not retried for every connection
+	conn->setAttachmentsVersion(version);
+}
+
+std::vector<std::string> DatabaseManager::getColumns(DatabaseConnection *conn,
+	const std::string &schemaName,const std::string &tableName)
+{
+	std::vector<std::string> columns;
+
+	sqlite3x::sqlite3_command cmd(conn->getSqliteConn(),
+		"PRAGMA [" + schemaName + "].table_info([" + tableName + "])");
+
+	sqlite3x::sqlite3_reader reader = cmd.executereader();
+	while ( reader.read() ) {
+		columns.push_back(reader.getstring(1));
+	}
+
+	return columns;
 }
 
 void DatabaseManager::acquireWriteLock(Database *database)
 {
+	ACE_Time_Value startTime = ACE_High_Res_Timer::gettimeofday();
+
 	m_mutexPool.lock(database);
 
-	m_mutex.acquire();
-	database->setWriteLocked(true);
-	m_mutex.release();
+	ACE_UINT64 waitTime = 0;
+	(ACE_High_Res_Timer::gettimeofday()-startTime).to_usec(waitTime);
+	MetricsManager::getInstance()->addDatabaseWait(waitTime);
 }
 
 void DatabaseManager::releaseWriteLock(Database *database) 
 {
-	m_mutex.acquire();
-
-	if ( database->isWriteLocked() ) {
-		m_mutexPool.release(database);
-		database->setWriteLocked(false);
-	}
-
-	m_mutex.release();
+	m_mutexPool.release(database);
 }
 
 Database* DatabaseManager::findDatabaseByName(const std::string name)
@@ -24,6 +24,7 @@
 #include "database.h"
 #include "databasetask.h"
 #include "mutexpool.h"
+#include "profiledmutex.h"
 #include "singleton.h"
 
 /**
@@ -37,9 +38,9 @@ public:
 	/**
 	* Default constructor.
 	*/
-	DatabaseManager() {
+	DatabaseManager() : m_mutex("DatabaseManager") {
 		ConfigManager::getInstance()->addListener(this);
-		m_mutexPool.init(5); // create mutex pool (for locking individual databases)
+		m_mutexPool.init(5,"DatabaseManager.databases"); // create mutex pool (for locking individual databases)
 	}
 
 	/**
@@ -58,6 +59,47 @@ public:
 	*/
 	bool init();
 
+	/**
+	* Add a database that isn't part of the configuration.
+	* The database is prepared the same way as the configured databases.
+	* @param name the name of the database
+	* @param path the path to the database file
+	* @param scriptPath the path to the init script to run, which is skipped if it doesn't exist
+	* @param synchronous true if the database should be synchronous
+	* @return true if the database was added and prepared successfully
+	*/
+	bool addDatabase(const std::string &name,const std::string &path,
+		const std::string &scriptPath,bool synchronous);
+
+	/**
+	* Remove a database.
+	* The database is detached from all other databases and its idle connections are closed.
+	* @param name the name of the database to remove
+	* @return false if connections to the database are still in use, 
+	* in which case the database file may still be open
+	*/
+	bool removeDatabase(const std::string &name);
+
+	/**
+	* Attach a database to every connection of another database.
+	* The given tables of all attached databases are merged with the tables of
+	* the main database into temporary views with the same names, so queries reading
+	* the tables see the rows of all databases. Since the views can't be written to,
+	* writes must name the main database as in main.[table].
+	* @param name the name of the database to attach to
+	* @param attachedName the name of the database to attach, which is also its schema name
+	* @param tables the names of the tables to merge
+	*/
+	void attachDatabase(const std::string &name,const std::string &attachedName,
+		const std::list<std::string> &tables);
+
+	/**
+	* Detach a database from every connection of another database.
+	* @param name the name of the database to detach from
+	* @param attachedName the name of the database to detach
+	*/
+	void detachDatabase(const std::string &name,const std::string &attachedName);
+
 	/**
 	* Release a database connection back to the manager.
 	* @param conn the database connection to release
@@ -89,6 +131,13 @@ public:
 	*/
 	DatabaseConnection* getConnection(Database *database,const bool writeLock = false);
 
+	/**
+	* Get the path to the file of the database with the given name.
+	* @param name the name of the database
+	* @return the path to the database file, or an empty string if no database was found
+	*/
+	std::string getDatabasePath(const std::string &name);
+
 	/**
 	* @override
 	*/
@@ -109,14 +158,55 @@ private:
 	void acquireWriteLock(Database *database);
 
 	/**
-	* Release any write lock on a database. This method
-	* is always called when releasing a collection.
-	* @param database the database to release any write lock on
+	* Release the write lock on a database.
+	* This method is called when releasing a connection that holds the write lock.
+	* @param database the database to release the write lock on
 	*/
 	void releaseWriteLock(Database *database);
 
+	/**
+	* Prepare a database by running its init script.
+	* @param database the database to prepare
+	* @param scriptPath the path to the init script to run
+	* @return true if the database was prepared successfully
+	*/
+	bool initDatabase(Database *database,const std::string &scriptPath);
+
+	/**
+	* Pop an idle connection to the database or create a new one.
+	* The calling thread must hold the lock.
+	* @param database the database to retrieve a connection to
+	* @return the connection to the database or NULL if no connection could be created
+	*/
+	DatabaseConnection* popConnection(Database *database);
+
+	/**
+	* Prepare a connection before it's handed out.
+	* @param conn the connection to prepare, or NULL
+	* @param writeLock true if the database should be write locked
+	* @return the prepared connection
+	*/
+	DatabaseConnection* prepareConnection(DatabaseConnection *conn,const bool writeLock);
+
+	/**
+	* Attach and detach databases on a connection to match the attachments of its database.
+	* @param conn the connection to synchronize
+	*/
+	void syncAttachments(DatabaseConnection *conn);
+
+	/**
+	* Get the names of the columns of a table.
+	* @param conn the connection to read the table through
+	* @param schemaName the schema name of the database holding the table
+	* @param tableName the name of the table
+	* @return the names of the columns in the order they're defined
+	*/
+	static std::vector<std::string> getColumns(DatabaseConnection *conn,
+		const std::string &schemaName,const std::string &tableName);
+
 	/**
 	* Find a database by name.
+	* The calling thread must hold the lock.
 	* @param name the name of the database to get
 	* @return the found database. NULL is returned if no database was found
 	*/
@@ -129,7 +219,7 @@ private:
 	*/
 	std::vector<std::string> DatabaseManager::tokenizeScript(const std::string &script);
 
-	ACE_Mutex m_mutex;
+	ProfiledMutex m_mutex;
 
 	MutexPool m_mutexPool;
 
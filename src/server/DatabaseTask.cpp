@@ -28,8 +28,21 @@ void DatabaseTask::run()
 	DatabaseConnection *conn = DatabaseManager::getInstance()->getConnection(m_name,m_writeLock);
 	if ( conn!=NULL )
 	{
-		try {
-			conn->getSqliteConn().executenonquery(m_query);
+		try 
+		{
+			if ( m_queries.size()==1 ) {
+				conn->getSqliteConn().executenonquery(m_queries.front());
+			}
+			else 
+			{
+				sqlite3x::sqlite3_transaction transaction(conn->getSqliteConn(),true);
+
+				for ( std::list<std::string>::iterator iter=m_queries.begin(); iter!=m_queries.end(); iter++ ) {
+					conn->getSqliteConn().executenonquery(*iter);
+				}
+
+				transaction.commit();
+			}
 		}
 		catch(exception &ex) {
 			LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Failed to execute query [%s]",ex.what());
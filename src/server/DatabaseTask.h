@@ -34,9 +34,23 @@ public:
 	* @param writeLock true if the used database connection should be write locked
 	* @return instance
 	*/
-	DatabaseTask(std::string name,std::string query,const bool writeLock = false) {
+	DatabaseTask(std::string name,std::string query,const bool writeLock = false) : Task("DatabaseTask." + name) {
 		m_name = name;
-		m_query = query;
+		m_queries.push_back(query);
+		m_writeLock = writeLock;
+	}
+
+	/**
+	* Constructor used for creating a new instance that executes several queries.
+	* The queries are executed in a single transaction, so either all or none of them are committed.
+	* @param name the name of the database to connect and query towards
+	* @param queries the database queries
+	* @param writeLock true if the used database connection should be write locked
+	* @return instance
+	*/
+	DatabaseTask(std::string name,const std::list<std::string> &queries,const bool writeLock = false) : Task("DatabaseTask." + name) {
+		m_name = name;
+		m_queries = queries;
 		m_writeLock = writeLock;
 	}
 
@@ -46,8 +60,9 @@ public:
 	virtual void run();
 
 private:
+	std::list<std::string> m_queries;
+
 	std::string m_name;
-	std::string m_query;
 
 	bool m_writeLock;
 };
@@ -20,18 +20,49 @@
 
 #define LOGGER_CLASSNAME "DefaultHandler"
 
+#include <ace/os.h>
 #include <boost/filesystem/convenience.hpp>
 #include <boost/filesystem/exception.hpp>
 #include <boost/filesystem/path.hpp>
 
 #include "configmanager.h"
 #include "httpconnector.h"
+#include "httpserver.h"
 #include "logmanager.h"
 
 const std::string DefaultHandler::DEFAULT_MIME_TYPE = "text/html;charset=iso-8859-1";
+const std::string DefaultHandler::NAME = "DefaultHandler";
 
 const int DefaultHandler::IO_BUFFER_SIZE = 8192;
 
+bool DefaultHandler::init()
+{
+	m_fileCache.init(ConfigManager::getInstance()->getInt(ConfigManager::HTTPSERVER_DEFAULTHANDLER_CACHEMAXSIZE),
+		ConfigManager::getInstance()->getInt(ConfigManager::HTTPSERVER_DEFAULTHANDLER_CACHEMAXFILESIZE),
+		&HttpServer::getInstance()->getCompression());
+
+	m_fingerprintEnabled = false;
+
+	std::string fingerprintPattern = ConfigManager::getInstance()->getString(ConfigManager::HTTPSERVER_DEFAULTHANDLER_FINGERPRINTPATTERN);
+	if ( !fingerprintPattern.empty() )
+	{
+		try {
+			m_fingerprintRegex = boost::regex(fingerprintPattern,boost::regex::icase);
+			m_fingerprintEnabled = true;
+		}
+		catch(boost::regex_error &ex) {
+			LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Invalid fingerprint pattern [%s]",ex.what());
+		}
+	}
+
+	return true;
+}
+
+void DefaultHandler::cleanup()
+{
+	m_fileCache.clear();
+}
+
 bool DefaultHandler::handleRequest(HttpWorker *worker,
 	HttpServerRequest &httpRequest,HttpServerResponse &httpResponse)
 {
@@ -61,16 +92,25 @@ bool DefaultHandler::handleFileResponse(HttpWorker *worker,
 	std::string filePath = httpRequest.getRealPath();
 	boost::filesystem::path boostPath(filePath,boost::filesystem::native);
 
+	// stat doesn't accept a trailing separator on directories
+	std::string statPath = filePath;
+	while ( statPath.length()>1 && (*(statPath.end()-1)=='\\' || *(statPath.end()-1)=='/') 
+		&& *(statPath.end()-2)!=':' ) {
+		statPath.erase(statPath.end()-1);
+	}
+
+	// a single stat tells if the file exists, if it's a directory
+	// and gives the size and last write time used for validation
+	ACE_stat fileStat;
+	if ( ACE_OS::stat(statPath.c_str(),&fileStat)!=0 ) {
+		httpResponse.setStatusCode(HttpResponse::HttpStatus::HTTP_NOT_FOUND);
+		return false;
+	}
+
 	try
 	{
-		// make sure file exists
-		if ( !boost::filesystem::exists(boostPath) ) {
-			httpResponse.setStatusCode(HttpResponse::HttpStatus::HTTP_NOT_FOUND);
-			return false;
-		}
-
 		// check if requested file is a directory
-		if ( boost::filesystem::is_directory(boostPath) )
+		if ( (fileStat.st_mode & S_IFMT)==S_IFDIR )
 		{
 			// check if client should be redirected to the same uri ending with a slash
 			if ( *(httpRequest.getUri().end()-1)!='/' ) {
@@ -113,23 +153,118 @@ bool DefaultHandler::handleFileResponse(HttpWorker *worker,
 		return false;
 	}
 
-	FILE *file = fopen(filePath.c_str(),"rb");
-	if ( file!=NULL )
+	uint64_t fileSize = fileStat.st_size;
+	time_t lastWriteTime = fileStat.st_mtime;
+
+	std::string mimeType = httpRequest.getSite()->getMimeMapping(fileExtension);
+	if ( mimeType.empty() ) {
+		mimeType = DEFAULT_MIME_TYPE;
+	}
+
+	httpResponse.setContentType(mimeType);
+	httpResponse.setHeader("Connection","close");
+
+	// the file that is sent, which is a precompressed sibling if one is available
+	std::string sendPath = filePath;
+	uint64_t sendSize = fileSize;
+	time_t sendWriteTime = lastWriteTime;
+
+	int contentEncoding = HttpCompression::ENCODING_IDENTITY;
+
+	HttpCompression &compression = HttpServer::getInstance()->getCompression();
+	if ( httpResponse.getStatusCode()==HttpResponse::HttpStatus::HTTP_OK 
+		&& compression.isCompressible(mimeType,fileSize) )
+	{
+		httpResponse.setHeader("Vary","Accept-Encoding");
+
+		int acceptedEncoding = compression.negotiateEncoding(httpRequest);
+		if ( acceptedEncoding==HttpCompression::ENCODING_GZIP )
+		{
+			// a precompressed sibling older than the file is considered stale
+			std::string gzipPath = filePath + ".gz";
+
+			ACE_stat gzipStat;
+			if ( ACE_OS::stat(gzipPath.c_str(),&gzipStat)==0 && gzipStat.st_mtime>=lastWriteTime ) {
+				sendPath = gzipPath;
+				sendSize = gzipStat.st_size;
+				sendWriteTime = gzipStat.st_mtime;
+				contentEncoding = acceptedEncoding;
+			}
+		}
+
+		// otherwise a compressed variant is built and kept in the file cache
+		if ( contentEncoding==HttpCompression::ENCODING_IDENTITY && m_fileCache.isCacheable(fileSize) ) {
+			contentEncoding = acceptedEncoding;
+		}
+	}
+
+	// only send validators for regular responses, since error
+	// pages are forwarded here with the error status code set
+	if ( httpResponse.getStatusCode()==HttpResponse::HttpStatus::HTTP_OK )
+	{
+		std::string etag = formatEtag(fileSize,lastWriteTime,contentEncoding);
+		std::string lastModified = Util::TimeUtil::formatHttpDate(lastWriteTime);
+
+		httpResponse.setHeader("ETag",etag);
+		httpResponse.setHeader("Last-Modified",lastModified);
+
+		// fingerprinted files never change content under the same name
+		if ( m_fingerprintEnabled && boost::regex_search(httpRequest.getPath(),m_fingerprintRegex) ) {
+			httpResponse.setHeader("Cache-Control","public, max-age=31536000");
+		}
+
+		if ( isNotModified(httpRequest,etag,lastModified) ) {
+			httpResponse.setStatusCode(HttpResponse::HttpStatus::HTTP_NOT_MODIFIED);
+			httpResponse.flush();
+			return true;
+		}
+	}
+
+	// a precompressed sibling is cached as is
+	int cacheEncoding = HttpCompression::ENCODING_IDENTITY;
+	if ( sendPath==filePath ) {
+		cacheEncoding = contentEncoding;
+	}
+
+	int cacheSpan = httpRequest.getTrace().beginSpan("fileCache");
+	FileCacheEntry::Ptr entryPtr = m_fileCache.get(sendPath,sendWriteTime,sendSize,cacheEncoding);
+	httpRequest.getTrace().endSpan(cacheSpan);
+
+	if ( entryPtr!=NULL ) 
+	{
+		TraceScope scope(httpRequest.getTrace(),"sendFile");
+
+		if ( contentEncoding!=HttpCompression::ENCODING_IDENTITY ) {
+			httpResponse.setHeader("Content-Encoding",HttpCompression::getEncodingName(contentEncoding));
+			compression.addStatistics(fileSize,entryPtr->getSize(),0);
+		}
+
+		httpResponse.setContentLength(entryPtr->getSize());
+		httpResponse.write(entryPtr->getData().c_str(),entryPtr->getSize(),true);
+		return true;
+	}
+
+	// fall back to the uncompressed file if the compressed variant could not be built
+	if ( cacheEncoding!=HttpCompression::ENCODING_IDENTITY )
 	{
-		fpos_t fileLength = 0;
+		contentEncoding = HttpCompression::ENCODING_IDENTITY;
+
+		if ( httpResponse.getStatusCode()==HttpResponse::HttpStatus::HTTP_OK ) {
+			httpResponse.setHeader("ETag",formatEtag(fileSize,lastWriteTime,contentEncoding));
+		}
+	}
 
-		fseek(file,0,SEEK_END);
-		fgetpos(file,&fileLength);
-		fseek(file,0,SEEK_SET);
+	FILE *file = fopen(sendPath.c_str(),"rb");
+	if ( file!=NULL )
+	{
+		TraceScope scope(httpRequest.getTrace(),"sendFile");
 
-		std::string mimeType = httpRequest.getSite()->getMimeMapping(fileExtension);
-		if ( mimeType.empty() ) {
-			mimeType = DEFAULT_MIME_TYPE;
+		if ( contentEncoding!=HttpCompression::ENCODING_IDENTITY ) {
+			httpResponse.setHeader("Content-Encoding",HttpCompression::getEncodingName(contentEncoding));
+			compression.addStatistics(fileSize,sendSize,0);
 		}
 
-		httpResponse.setContentType(mimeType);
-		httpResponse.setContentLength(fileLength);
-		httpResponse.setHeader("Connection","close");
+		httpResponse.setContentLength(sendSize);
 
 		char *buffer = new char[IO_BUFFER_SIZE];
 		memset(buffer,0,IO_BUFFER_SIZE);
@@ -238,3 +373,42 @@ bool DefaultHandler::handleErrorResponse(HttpWorker *worker,
 
 	return true;
 }
+
+bool DefaultHandler::isNotModified(HttpServerRequest &httpRequest,
+	const std::string &etag,const std::string &lastModified)
+{
+	std::string value;
+
+	// entity tags take precedence over the modification date
+	if ( httpRequest.getHeader("If-None-Match",NULL) ) {
+		return httpRequest.isMatchingEtag(etag);
+	}
+
+	if ( httpRequest.getHeader("If-Modified-Since",&value) )
+	{
+		// some clients append a length attribute to the date
+		size_t pos = value.find(";");
+		if ( pos!=std::string::npos ) {
+			value = value.substr(0,pos);
+		}
+
+		return boost::trim_copy(value)==lastModified;
+	}
+
+	return false;
+}
+
+std::string DefaultHandler::formatEtag(uint64_t size,time_t lastWriteTime,int contentEncoding)
+{
+	std::stringstream etag;
+	etag << "\"" << std::hex << size << "-" << (uint64_t)lastWriteTime;
+
+	// each encoding of the file is a separate entity
+	if ( contentEncoding!=HttpCompression::ENCODING_IDENTITY ) {
+		etag << "-" << HttpCompression::getEncodingName(contentEncoding);
+	}
+
+	etag << "\"";
+
+	return etag.str();
+}
@@ -18,6 +18,7 @@
 #ifndef guard_defaulthandler_h
 #define guard_defaulthandler_h
 
+#include "filecache.h"
 #include "httprequesthandler.h"
 
 /**
@@ -27,19 +28,28 @@
 class DefaultHandler : public HttpRequestHandler
 {
 public:
+	/**
+	* Default constructor.
+	* @return instance
+	*/
+	DefaultHandler() : m_fingerprintEnabled(false) {
+
+	}
+
 	static const std::string DEFAULT_MIME_TYPE;
+	static const std::string NAME;
 
 	static const int IO_BUFFER_SIZE;
 
 	/**
 	* @override
 	*/
-	virtual bool init() { return true; }
+	virtual bool init();
 
 	/**
 	* @override
 	*/
-	virtual void cleanup() {}
+	virtual void cleanup();
 
 	/**
 	* @override
@@ -47,6 +57,21 @@ public:
 	virtual bool handleRequest(HttpWorker *worker,
 		HttpServerRequest &httpRequest,HttpServerResponse &httpResponse);
 
+	/**
+	* @override
+	*/
+	virtual const std::string& getName() const {
+		return NAME;
+	}
+
+	/**
+	* Get the cache holding the content of small static files.
+	* @return the file cache
+	*/
+	FileCache& getFileCache() {
+		return m_fileCache;
+	}
+
 private:
 	/**
 	 * Handle a file response.
@@ -77,6 +102,32 @@ private:
 	 */
 	bool handleErrorResponse(HttpWorker *worker,
 		HttpServerRequest &httpRequest,HttpServerResponse &httpResponse);
+
+	/**
+	 * Check if the client already holds a valid copy of the requested file,
+	 * based on the If-None-Match and If-Modified-Since request headers.
+	 * @param httpRequest the request
+	 * @param etag the entity tag of the file
+	 * @param lastModified the formatted last write time of the file
+	 * @return true if the file has not been modified
+	 */
+	bool isNotModified(HttpServerRequest &httpRequest,
+		const std::string &etag,const std::string &lastModified);
+
+	/**
+	 * Format an entity tag from the size and last write time of a file.
+	 * @param size the file size
+	 * @param lastWriteTime the last write time of the file
+	 * @param contentEncoding the content encoding of the sent file
+	 * @return the formatted entity tag, including quotes
+	 */
+	static std::string formatEtag(uint64_t size,time_t lastWriteTime,int contentEncoding);
+
+	FileCache m_fileCache;
+
+	boost::regex m_fingerprintRegex;
+
+	bool m_fingerprintEnabled;
 };
 
 #endif
@@ -21,6 +21,8 @@
 #include <ace/synch.h>
 #include <algorithm>
 
+#include "profiledmutex.h"
+
 /**
 * EventBroadcaster.
 * A class can inherit from this class to become an event broadcaster.
@@ -29,13 +31,21 @@ template<typename EventListener>
 class EventBroadcaster
 {
 public:
+	/**
+	* Default constructor.
+	* @return instance
+	*/
+	EventBroadcaster() : m_mutex("EventBroadcaster") {
+
+	}
+
 	/**
 	* Add an event listener.
 	* @param listener the event listener instance
 	*/
 	void addListener(EventListener *listener) 
 	{
-		ACE_Write_Guard<ACE_Mutex> guard(m_mutex);
+		ACE_Write_Guard<ProfiledMutex> guard(m_mutex);
 
 		if ( std::find(m_listeners.begin(),m_listeners.end(),listener)==m_listeners.end() ) {
 			m_listeners.push_back(listener);
@@ -48,7 +58,7 @@ public:
 	*/
 	void removeListener(EventListener *listener) 
 	{
-		ACE_Write_Guard<ACE_Mutex> guard(m_mutex); 
+		ACE_Write_Guard<ProfiledMutex> guard(m_mutex); 
 
 		std::list<EventListener*>::iterator iter = find(m_listeners.begin(),m_listeners.end(),listener);
 		if ( iter!=m_listeners.end() ) {
@@ -64,7 +74,7 @@ protected:
 	template<typename TO>
 	void fireEvent(TO type)
 	{
-		ACE_Read_Guard<ACE_Mutex> guard(m_mutex); 
+		ACE_Read_Guard<ProfiledMutex> guard(m_mutex); 
 		
 		std::list<EventListener*>::iterator iter;
 		for ( iter=m_listeners.begin(); iter!=m_listeners.end(); iter++ ) {
@@ -80,7 +90,7 @@ protected:
 	template<typename TO,class T1>
 	void fireEvent(TO type,const T1 &p1)
 	{
-		ACE_Read_Guard<ACE_Mutex> guard(m_mutex); 	
+		ACE_Read_Guard<ProfiledMutex> guard(m_mutex); 	
 
 		std::list<EventListener*>::iterator iter;
 		for ( iter=m_listeners.begin(); iter!=m_listeners.end(); iter++ ) {
@@ -97,7 +107,7 @@ protected:
 	template<typename TO,class T1,class T2>
 	void fireEvent(TO type,const T1 &p1,const T2 &p2)
 	{
-		ACE_Read_Guard<ACE_Mutex> guard(m_mutex); 	
+		ACE_Read_Guard<ProfiledMutex> guard(m_mutex); 	
 
 		std::list<EventListener*>::iterator iter;
 		for ( iter=m_listeners.begin(); iter!=m_listeners.end(); iter++ ) {
@@ -115,7 +125,7 @@ protected:
 	template<typename TO,class T1,class T2,class T3>
 	void fireEvent(TO type,const T1 &p1,const T2 &p2,const T3 &p3)
 	{
-		ACE_Read_Guard<ACE_Mutex> guard(m_mutex); 	
+		ACE_Read_Guard<ProfiledMutex> guard(m_mutex); 	
 
 		std::list<EventListener*>::iterator iter;
 		for ( iter=m_listeners.begin(); iter!=m_listeners.end(); iter++ ) {
@@ -134,7 +144,7 @@ protected:
 	template<typename TO,class T1,class T2,class T3,class T4>
 	void fireEvent(TO type,const T1 &p1,const T2 &p2,const T3 &p3,const T4 &p4)
 	{
-		ACE_Read_Guard<ACE_Mutex> guard(m_mutex); 	
+		ACE_Read_Guard<ProfiledMutex> guard(m_mutex); 	
 
 		std::list<EventListener*>::iterator iter;
 		for ( iter=m_listeners.begin(); iter!=m_listeners.end(); iter++ ) {
@@ -143,7 +153,7 @@ protected:
 	}
 
 private:
-	ACE_Mutex m_mutex;
+	ProfiledMutex m_mutex;
 
 	std::list<EventListener*> m_listeners;
 };
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "filecache.h"
+
+#define LOGGER_CLASSNAME "FileCache"
+
+#include <ace/high_res_timer.h>
+
+#include "logmanager.h"
+
+void FileCache::init(size_t maxSize,size_t maxFileSize,HttpCompression *compression)
+{
+	m_mutex.acquire();
+	m_compression = compression;
+	m_maxSize = maxSize;
+	m_maxFileSize = maxFileSize>maxSize ? maxSize : maxFileSize;
+	m_mutex.release();
+
+	clear();
+}
+
+void FileCache::clear()
+{
+	m_mutex.acquire();
+	m_cache.clear();
+	m_lru.clear();
+	m_size = 0;
+	m_mutex.release();
+}
+
+FileCacheEntry::Ptr FileCache::get(const std::string &path,time_t lastWriteTime,uint64_t size,
+	int contentEncoding)
+{
+	m_mutex.acquire();
+
+	if ( m_maxSize==0 || size>m_maxFileSize ) {
+		m_mutex.release();
+		return FileCacheEntry::Ptr();
+	}
+
+	// compressed variants are keyed by their encoding
+	std::string key = path;
+	if ( contentEncoding!=HttpCompression::ENCODING_IDENTITY ) {
+		key += "|" + HttpCompression::getEncodingName(contentEncoding);
+	}
+
+	CacheMap::iterator iter = m_cache.find(key);
+	if ( iter!=m_cache.end() )
+	{
+		FileCacheEntry::Ptr entryPtr = iter->second.first;
+		if ( entryPtr->getLastWriteTime()==lastWriteTime && entryPtr->getFileSize()==size ) 
+		{
+			// move file to the front of the lru list
+			m_lru.splice(m_lru.begin(),m_lru,iter->second.second);
+			m_hits++;
+
+			m_mutex.release();
+			return entryPtr;
+		}
+
+		// file has been modified since it was cached
+		remove(iter);
+	}
+
+	m_misses++;
+	m_mutex.release();
+
+	// read the file without holding the lock so that
+	// other workers can be served from the cache meanwhile
+	FileCacheEntry::Ptr entryPtr = read(path,lastWriteTime,size,contentEncoding);
+	if ( entryPtr==NULL ) {
+		return entryPtr;
+	}
+
+	m_mutex.acquire();
+
+	// another worker might have cached the file while it was being read
+	iter = m_cache.find(key);
+	if ( iter!=m_cache.end() ) {
+		remove(iter);
+	}
+
+	// evict least recently used files until the new file fits
+	while ( !m_lru.empty() && m_size+entryPtr->getSize()>m_maxSize ) {
+		remove(m_cache.find(m_lru.back()));
+	}
+
+	m_lru.push_front(key);
+	m_cache[key] = CacheItem(entryPtr,m_lru.begin());
+	m_size += entryPtr->getSize();
+
+	m_mutex.release();
+
+	return entryPtr;
+}
+
+bool FileCache::isCacheable(uint64_t size)
+{
+	ACE_Guard<ACE_Mutex> guard(m_mutex);
+	return m_maxSize>0 && size<=m_maxFileSize;
+}
+
+const uint64_t FileCache::getHits()
+{
+	ACE_Guard<ACE_Mutex> guard(m_mutex);
+	return m_hits;
+}
+
+const uint64_t FileCache::getMisses()
+{
+	ACE_Guard<ACE_Mutex> guard(m_mutex);
+	return m_misses;
+}
+
+const size_t FileCache::getSize()
+{
+	ACE_Guard<ACE_Mutex> guard(m_mutex);
+	return m_size;
+}
+
+FileCacheEntry::Ptr FileCache::read(const std::string &path,time_t lastWriteTime,uint64_t size,
+	int contentEncoding)
+{
+	FILE *file = fopen(path.c_str(),"rb");
+	if ( file==NULL ) {
+		return FileCacheEntry::Ptr();
+	}
+
+	std::string data;
+	data.resize((size_t)size);
+
+	size_t bytesRead = 0;
+	if ( size>0 ) {
+		bytesRead = fread(&data[0],sizeof(char),(size_t)size,file);
+	}
+
+	fclose(file);
+
+	// the file was modified while being read
+	if ( bytesRead!=size ) {
+		if ( LogManager::getInstance()->isDebug() ) {
+			LogManager::getInstance()->debug(LOGGER_CLASSNAME,"Size of \"%s\" changed while reading",path.c_str());
+		}
+
+		return FileCacheEntry::Ptr();
+	}
+
+	if ( contentEncoding!=HttpCompression::ENCODING_IDENTITY )
+	{
+		if ( m_compression==NULL ) {
+			return FileCacheEntry::Ptr();
+		}
+
+		ACE_Time_Value startTime = ACE_High_Res_Timer::gettimeofday();
+
+		std::string compressedData;
+		if ( !m_compression->compress(data.c_str(),data.length(),contentEncoding,compressedData) ) {
+			return FileCacheEntry::Ptr();
+		}
+
+		ACE_UINT64 elapsedTime = 0;
+		(ACE_High_Res_Timer::gettimeofday()-startTime).to_usec(elapsedTime);
+
+		// the variant is sent many times but compressed only once, so
+		// only the time is accounted here and the bytes for each response
+		m_compression->addCompressionTime(elapsedTime);
+		data.swap(compressedData);
+	}
+
+	return FileCacheEntry::Ptr(new FileCacheEntry(data,lastWriteTime,size,contentEncoding));
+}
+
+void FileCache::remove(CacheMap::iterator iter)
+{
+	m_size -= iter->second.first->getSize();
+	m_lru.erase(iter->second.second);
+	m_cache.erase(iter);
+}
@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef guard_filecache_h
+#define guard_filecache_h
+
+#include <ace/synch.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include "httpcompression.h"
+
+/**
+* FileCacheEntry.
+* Represents the content of a file held in the file cache.
+*/
+class FileCacheEntry
+{
+public:
+	typedef boost::shared_ptr<FileCacheEntry> Ptr;
+
+	/**
+	* Constructor used for creating a new entry.
+	* @param data the file content
+	* @param lastWriteTime the last write time of the file when it was read
+	* @param fileSize the size of the file when it was read
+	* @param contentEncoding the content encoding the file content was compressed with
+	* @return instance
+	*/
+	FileCacheEntry(const std::string &data,time_t lastWriteTime,uint64_t fileSize,int contentEncoding) : m_data(data),
+		m_contentEncoding(contentEncoding),
+		m_fileSize(fileSize),
+		m_lastWriteTime(lastWriteTime)
+	{
+
+	}
+
+	/**
+	* Get the content encoding the file content was compressed with.
+	* @return the content encoding of the file content
+	*/
+	const int getContentEncoding() const {
+		return m_contentEncoding;
+	}
+
+	/**
+	* Get the file content.
+	* @return the file content
+	*/
+	const std::string& getData() const {
+		return m_data;
+	}
+
+	/**
+	* Get the size of the file when it was read.
+	* This differs from the size of the content if the content is compressed.
+	* @return the size of the file
+	*/
+	const uint64_t getFileSize() const {
+		return m_fileSize;
+	}
+
+	/**
+	* Get the last write time of the file when it was read.
+	* @return the last write time of the file
+	*/
+	const time_t getLastWriteTime() const {
+		return m_lastWriteTime;
+	}
+
+	/**
+	* Get the size of the file content.
+	* @return the size of the file content
+	*/
+	const size_t getSize() const {
+		return m_data.length();
+	}
+
+private:
+	std::string m_data;
+
+	time_t m_lastWriteTime;
+
+	uint64_t m_fileSize;
+
+	int m_contentEncoding;
+};
+
+/**
+* FileCache.
+* A bounded in-memory cache of small files. When the cache is full the least
+* recently used files are evicted. An entry is only returned if the last write time
+* and size that the caller got from the file system matches the cached content,
+* so modified files are read again on their next request. Compressed variants
+* of a file are cached separately from the uncompressed content.
+*/
+class FileCache
+{
+public:
+	/**
+	* Default constructor.
+	* @return instance
+	*/
+	FileCache() : m_compression(NULL),
+		m_hits(0),
+		m_maxFileSize(0),
+		m_maxSize(0),
+		m_misses(0),
+		m_size(0)
+	{
+
+	}
+
+	/**
+	* Initialize the cache. Any cached files are removed.
+	* @param maxSize the maximum number of bytes held by the cache. Zero disables the cache
+	* @param maxFileSize the maximum size of a single file for it to be cached
+	* @param compression the compression used for building compressed variants
+	*/
+	void init(size_t maxSize,size_t maxFileSize,HttpCompression *compression);
+
+	/**
+	* Remove all cached files.
+	*/
+	void clear();
+
+	/**
+	* Get the content of the file with the given path.
+	* The file is read into the cache if it's not already cached or if the cached content is stale.
+	* @param path the path of the file
+	* @param lastWriteTime the current last write time of the file
+	* @param size the current size of the file
+	* @param contentEncoding the content encoding the content should be compressed with
+	* @return the cached entry, or an empty pointer if the file is not cacheable or could not be read
+	*/
+	FileCacheEntry::Ptr get(const std::string &path,time_t lastWriteTime,uint64_t size,
+		int contentEncoding=HttpCompression::ENCODING_IDENTITY);
+
+	/**
+	* Check if a file of the given size can be held by the cache.
+	* @param size the size of the file
+	* @return true if the file can be cached
+	*/
+	bool isCacheable(uint64_t size);
+
+	/**
+	* Get the number of requests that were served from the cache.
+	* @return the number of cache hits
+	*/
+	const uint64_t getHits();
+
+	/**
+	* Get the number of requests that required the file to be read.
+	* @return the number of cache misses
+	*/
+	const uint64_t getMisses();
+
+	/**
+	* Get the number of bytes currently held by the cache.
+	* @return the number of bytes held by the cache
+	*/
+	const size_t getSize();
+
+private:
+	typedef std::list<std::string> LruList;
+	typedef std::pair<FileCacheEntry::Ptr,LruList::iterator> CacheItem;
+	typedef std::map<std::string,CacheItem> CacheMap;
+
+	/**
+	* Read a file from disk.
+	* @param path the path of the file
+	* @param lastWriteTime the last write time of the file
+	* @param size the expected size of the file
+	* @param contentEncoding the content encoding the content should be compressed with
+	* @return the read entry, or an empty pointer if the file could not be read
+	*/
+	FileCacheEntry::Ptr read(const std::string &path,time_t lastWriteTime,uint64_t size,int contentEncoding);
+
+	/**
+	* Remove the cached file with the given path.
+	* The mutex must be held when calling this method.
+	* @param iter the cache iterator pointing to the file
+	*/
+	void remove(CacheMap::iterator iter);
+
+	ACE_Mutex m_mutex;
+
+	HttpCompression *m_compression;
+
+	CacheMap m_cache;
+
+	LruList m_lru;
+
+	uint64_t m_hits;
+	uint64_t m_misses;
+
+	size_t m_maxFileSize;
+	size_t m_maxSize;
+	size_t m_size;
+};
+
+#endif
@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "httpcompression.h"
+
+#define LOGGER_CLASSNAME "HttpCompression"
+
+#include <zlib.h>
+
+#include "configmanager.h"
+#include "httprequest.h"
+#include "logmanager.h"
+
+void HttpCompression::init()
+{
+	m_enabled = ConfigManager::getInstance()->getBool(ConfigManager::HTTPSERVER_COMPRESSION_ENABLED);
+	m_level = ConfigManager::getInstance()->getInt(ConfigManager::HTTPSERVER_COMPRESSION_LEVEL);
+	m_minSize = ConfigManager::getInstance()->getInt(ConfigManager::HTTPSERVER_COMPRESSION_MINSIZE);
+
+	if ( m_level<1 || m_level>9 ) {
+		m_level = Z_DEFAULT_COMPRESSION;
+	}
+
+	std::string mimeTypes = ConfigManager::getInstance()->getString(ConfigManager::HTTPSERVER_COMPRESSION_MIMETYPES);
+
+	m_mimeTypes.clear();
+	boost::split(m_mimeTypes,mimeTypes,boost::is_any_of(","));
+
+	std::list<std::string>::iterator iter = m_mimeTypes.begin();
+	while ( iter!=m_mimeTypes.end() ) 
+	{
+		boost::trim(*iter);
+		if ( iter->empty() ) {
+			iter = m_mimeTypes.erase(iter);
+		}
+		else {
+			iter++;
+		}
+	}
+}
+
+bool HttpCompression::compress(const char *data,size_t length,int contentEncoding,std::string &output)
+{
+	if ( contentEncoding==ENCODING_IDENTITY ) {
+		return false;
+	}
+
+	z_stream stream;
+	memset(&stream,0,sizeof(stream));
+
+	if ( deflateInit2(&stream,m_level,Z_DEFLATED,getWindowBits(contentEncoding),8,Z_DEFAULT_STRATEGY)!=Z_OK ) {
+		return false;
+	}
+
+	output.resize(deflateBound(&stream,length));
+
+	stream.next_in = (Bytef*)data;
+	stream.avail_in = length;
+	stream.next_out = (Bytef*)&output[0];
+	stream.avail_out = output.length();
+
+	int result = deflate(&stream,Z_FINISH);
+	output.resize(stream.total_out);
+	deflateEnd(&stream);
+
+	return result==Z_STREAM_END;
+}
+
+int HttpCompression::negotiateEncoding(HttpServerRequest &httpRequest)
+{
+	std::string acceptEncoding;
+	if ( !m_enabled || !httpRequest.getHeader("Accept-Encoding",&acceptEncoding) ) {
+		return ENCODING_IDENTITY;
+	}
+
+	bool deflateAccepted = false;
+	bool deflateListed = false;
+	bool gzipAccepted = false;
+	bool gzipListed = false;
+	bool wildcardAccepted = false;
+
+	std::vector<std::string> codings;
+	boost::split(codings,acceptEncoding,boost::is_any_of(","));
+
+	for ( std::vector<std::string>::iterator iter=codings.begin(); iter!=codings.end(); iter++ )
+	{
+		std::string coding = *iter;
+		std::string quality;
+
+		size_t pos = coding.find(";");
+		if ( pos!=std::string::npos ) {
+			quality = coding.substr(pos+1);
+			coding = coding.substr(0,pos);
+		}
+
+		boost::trim(coding);
+		boost::trim(quality);
+
+		// a zero quality value means the coding is not acceptable
+		bool accepted = !(boost::istarts_with(quality,"q=") && atof(quality.substr(2).c_str())<=0);
+
+		if ( boost::iequals(coding,"gzip") || boost::iequals(coding,"x-gzip") ) {
+			gzipAccepted = gzipAccepted || accepted;
+			gzipListed = true;
+		}
+		else if ( boost::iequals(coding,"deflate") ) {
+			deflateAccepted = deflateAccepted || accepted;
+			deflateListed = true;
+		}
+		else if ( coding=="*" ) {
+			wildcardAccepted = wildcardAccepted || accepted;
+		}
+	}
+
+	// the wildcard only applies to codings that are not listed by name
+	if ( !gzipListed ) {
+		gzipAccepted = wildcardAccepted;
+	}
+
+	if ( !deflateListed ) {
+		deflateAccepted = wildcardAccepted;
+	}
+
+	if ( gzipAccepted ) {
+		return ENCODING_GZIP;
+	}
+	else if ( deflateAccepted ) {
+		return ENCODING_DEFLATE;
+	}
+
+	return ENCODING_IDENTITY;
+}
+
+bool HttpCompression::isCompressible(const std::string &contentType,uint64_t length)
+{
+	if ( !m_enabled || length<(uint64_t)m_minSize ) {
+		return false;
+	}
+
+	std::list<std::string>::iterator iter;
+	for ( iter=m_mimeTypes.begin(); iter!=m_mimeTypes.end(); iter++ ) {
+		if ( boost::istarts_with(contentType,*iter) ) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void HttpCompression::addStatistics(uint64_t uncompressedBytes,uint64_t compressedBytes,uint64_t compressionTime)
+{
+	m_mutex.acquire();
+	m_compressedResponses++;
+	m_uncompressedBytes += uncompressedBytes;
+	m_compressedBytes += compressedBytes;
+	m_compressionTime += compressionTime;
+	m_mutex.release();
+
+	if ( LogManager::getInstance()->isDebug() ) {
+		LogManager::getInstance()->debug(LOGGER_CLASSNAME,"Compressed %s bytes to %s bytes in %s us",
+			Util::ConvertUtil::toString(uncompressedBytes).c_str(),
+			Util::ConvertUtil::toString(compressedBytes).c_str(),
+			Util::ConvertUtil::toString(compressionTime).c_str());
+	}
+}
+
+void HttpCompression::addCompressionTime(uint64_t compressionTime)
+{
+	m_mutex.acquire();
+	m_compressionTime += compressionTime;
+	m_mutex.release();
+}
+
+const uint64_t HttpCompression::getCompressedBytes()
+{
+	ACE_Guard<ACE_Mutex> guard(m_mutex);
+	return m_compressedBytes;
+}
+
+const uint64_t HttpCompression::getCompressedResponses()
+{
+	ACE_Guard<ACE_Mutex> guard(m_mutex);
+	return m_compressedResponses;
+}
+
+const uint64_t HttpCompression::getCompressionTime()
+{
+	ACE_Guard<ACE_Mutex> guard(m_mutex);
+	return m_compressionTime;
+}
+
+const uint64_t HttpCompression::getUncompressedBytes()
+{
+	ACE_Guard<ACE_Mutex> guard(m_mutex);
+	return m_uncompressedBytes;
+}
+
+std::string HttpCompression::getEncodingName(int contentEncoding)
+{
+	switch ( contentEncoding )
+	{
+		case ENCODING_DEFLATE:
+			return "deflate";
+
+		case ENCODING_GZIP:
+			return "gzip";
+
+		default:
+			return "identity";
+	}
+}
+
+int HttpCompression::getWindowBits(int contentEncoding)
+{
+	// adding 16 to the window bits makes zlib write a gzip wrapper
+	if ( contentEncoding==ENCODING_GZIP ) {
+		return MAX_WBITS+16;
+	}
+
+	return MAX_WBITS;
+}
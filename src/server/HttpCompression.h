@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef guard_httpcompression_h
+#define guard_httpcompression_h
+
+#include <ace/synch.h>
+
+class HttpServerRequest; // forward declaration
+
+/**
+* HttpCompression.
+* Holds the settings deciding which responses are compressed and
+* keeps statistics of the bytes saved and time spent compressing.
+*/
+class HttpCompression
+{
+public:
+	enum ContentEncoding
+	{
+		ENCODING_IDENTITY = 0,
+		ENCODING_DEFLATE = 1,
+		ENCODING_GZIP = 2
+	};
+
+	/**
+	* Default constructor.
+	* @return instance
+	*/
+	HttpCompression() : m_compressedBytes(0),
+		m_compressionTime(0),
+		m_compressedResponses(0),
+		m_enabled(false),
+		m_level(0),
+		m_minSize(0),
+		m_uncompressedBytes(0)
+	{
+
+	}
+
+	/**
+	* Initialize the compression settings from the configuration.
+	*/
+	void init();
+
+	/**
+	* Compress data in a single pass.
+	* @param data the data to compress
+	* @param length the length of the data
+	* @param contentEncoding the content encoding to compress with
+	* @param output out parameter for the compressed data
+	* @return true if the data was compressed
+	*/
+	bool compress(const char *data,size_t length,int contentEncoding,std::string &output);
+
+	/**
+	* Negotiate the content encoding to use for a request
+	* based on the Accept-Encoding request header. Gzip is preferred over deflate.
+	* @param httpRequest the request
+	* @return the negotiated content encoding
+	*/
+	int negotiateEncoding(HttpServerRequest &httpRequest);
+
+	/**
+	* Check if a response should be compressed.
+	* @param contentType the content type of the response
+	* @param length the length of the response body
+	* @return true if the response should be compressed
+	*/
+	bool isCompressible(const std::string &contentType,uint64_t length);
+
+	/**
+	* Add the outcome of a compressed response to the statistics.
+	* @param uncompressedBytes the length of the body before compression
+	* @param compressedBytes the length of the body after compression
+	* @param compressionTime the time spent compressing, in microseconds
+	*/
+	void addStatistics(uint64_t uncompressedBytes,uint64_t compressedBytes,uint64_t compressionTime);
+
+	/**
+	* Add time spent compressing data that is not tied to a single response,
+	* such as compressed variants of static files that are cached.
+	* @param compressionTime the time spent compressing, in microseconds
+	*/
+	void addCompressionTime(uint64_t compressionTime);
+
+	/**
+	* Get the number of bytes sent for compressed responses.
+	* @return the number of compressed bytes
+	*/
+	const uint64_t getCompressedBytes();
+
+	/**
+	* Get the number of responses that have been compressed.
+	* @return the number of compressed responses
+	*/
+	const uint64_t getCompressedResponses();
+
+	/**
+	* Get the total time spent compressing responses, in microseconds.
+	* @return the total compression time
+	*/
+	const uint64_t getCompressionTime();
+
+	/**
+	* Get the number of bytes that compressed responses would have had uncompressed.
+	* @return the number of uncompressed bytes
+	*/
+	const uint64_t getUncompressedBytes();
+
+	/**
+	* Get the compression level.
+	* @return the compression level, between 1 and 9
+	*/
+	const int getLevel() const {
+		return m_level;
+	}
+
+	/**
+	* Get the name of a content encoding, as used in HTTP headers.
+	* @param contentEncoding the content encoding
+	* @return the name of the content encoding
+	*/
+	static std::string getEncodingName(int contentEncoding);
+
+	/**
+	* Get the zlib window bits that produces the given content encoding.
+	* @param contentEncoding the content encoding
+	* @return the window bits to pass to the deflate initialization
+	*/
+	static int getWindowBits(int contentEncoding);
+
+private:
+	ACE_Mutex m_mutex;
+
+	std::list<std::string> m_mimeTypes;
+
+	uint64_t m_compressedBytes;
+	uint64_t m_compressedResponses;
+	uint64_t m_compressionTime;
+	uint64_t m_uncompressedBytes;
+
+	int m_level;
+	int m_minSize;
+
+	bool m_enabled;
+};
+
+#endif
@@ -285,6 +285,18 @@ void HttpConnector::pushWorker(HttpWorker *worker)
 	m_idleWorkers.push(worker);
 }
 
+const size_t HttpConnector::getIdleWorkerCount()
+{
+	ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+	return m_idleWorkers.size();
+}
+
+const size_t HttpConnector::getQueuedClientCount()
+{
+	ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+	return m_clientQueue.size();
+}
+
 HttpServerClient* HttpConnector::popClient()
 {
 	ACE_Write_Guard<ACE_Mutex> guard(m_mutex);
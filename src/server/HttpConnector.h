@@ -102,6 +102,12 @@ public:
 		return m_bufferSize;
 	}
 
+	/**
+	* Get the number of workers waiting for a client.
+	* @return the number of workers waiting for a client
+	*/
+	const size_t getIdleWorkerCount();
+
 	/**
 	* Get the max header size allowed for an incoming request.
 	* @return the max header size allowed for an incoming request
@@ -118,6 +124,12 @@ public:
 		return m_maxPostSize;
 	}
 
+	/**
+	* Get the number of clients waiting for a worker.
+	* @return the number of clients waiting for a worker
+	*/
+	const size_t getQueuedClientCount();
+
 	/**
 	* Get the server address.
 	* @return the server address
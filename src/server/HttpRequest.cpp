@@ -78,6 +78,30 @@ bool HttpRequest::getParameter(const std::string &name,std::string *value)
 	return false;
 }
 
+bool HttpRequest::isMatchingEtag(const std::string &etag)
+{
+	std::string value;
+	if ( !getHeader("If-None-Match",&value) ) {
+		return false;
+	}
+
+	std::vector<std::string> tokens;
+	boost::split(tokens,value,boost::is_any_of(","));
+	for ( std::vector<std::string>::iterator iter=tokens.begin(); iter!=tokens.end(); iter++ )
+	{
+		std::string token = boost::trim_copy(*iter);
+		if ( boost::starts_with(token,"W/") ) {
+			token = token.substr(2);
+		}
+
+		if ( token=="*" || token==etag ) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
 void HttpServerRequest::removeAttribute(std::string name)
 {
 	std::map<std::string,std::string>::iterator iter = m_attributes.find(name);
@@ -125,11 +149,19 @@ std::string HttpServerRequest::getRealPath()
 
 std::string HttpServerRequest::getRemoteAddress() 
 { 
+	if ( m_client==NULL ) {
+		return "";
+	}
+
 	return m_client->getRemoteAddress().get_host_addr(); 
 }
 
 std::string HttpServerRequest::getRemoteHost() 
 { 
+	if ( m_client==NULL ) {
+		return "";
+	}
+
 	return m_client->getRemoteAddress().get_host_name();
 }
 
@@ -20,6 +20,7 @@
 
 #include "httpresponse.h"
 #include "httpsession.h"
+#include "requesttracer.h"
 #include "site.h"
 #include "user.h"
 
@@ -142,6 +143,14 @@ public:
 		return m_version; 
 	}
 
+	/**
+	* Get whether the If-None-Match header matches the given entity tag.
+	* Every listed entity tag is compared exactly, ignoring whether it's weak.
+	* @param etag the entity tag to match, including quotes
+	* @return true if the header lists the entity tag or is a wildcard
+	*/
+	bool isMatchingEtag(const std::string &etag);
+
 	/**
 	* Set the cookie with the given name.
 	* @param name the cookie name
@@ -322,6 +331,14 @@ public:
 	*/
 	std::string getRemoteHost();
 
+	/**
+	* Get the trace recording the timed phases of this request.
+	* @return the trace of this request
+	*/
+	RequestTrace& getTrace() {
+		return m_trace;
+	}
+
 	/**
 	* Get the current session associated with this request.
 	* @return the session associated with this request
@@ -413,6 +430,8 @@ private:
 
 	HttpServerClient *m_client;
 
+	RequestTrace m_trace;
+
 	Site *m_site;
 
 	User *m_user;
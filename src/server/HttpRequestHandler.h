@@ -52,6 +52,12 @@ public:
 	virtual bool handleRequest(HttpWorker *worker,
 		HttpServerRequest &httpRequest,HttpServerResponse &httpResponse) = 0;
 
+	/**
+	 * Get the name of the request handler, as used in the configuration.
+	 * @return the name of the request handler
+	 */
+	virtual const std::string& getName() const = 0;
+
 	/**
 	 * Get the url pattern regular expression.
 	 * @return the url pattern regular expression
@@ -18,6 +18,10 @@
 #include "common.h"
 #include "httpresponse.h"
 
+#include <ace/high_res_timer.h>
+#include <zlib.h>
+
+#include "httpcompression.h"
 #include "httpserverclient.h"
 
 const int HttpClientResponse::MAX_BODY_SIZE = 4096;
@@ -49,10 +53,22 @@ bool HttpResponse::getHeader(const std::string &name,std::string &value)
 	return false;
 }
 
-void HttpServerResponse::flush()
+void HttpServerResponse::finish()
+{
+	sendBuffer(FLUSH_FINISH);
+
+	if ( m_stream!=NULL ) {
+		m_compression->addStatistics(m_uncompressedLength,m_compressedLength,m_compressionTime);
+		endCompression();
+	}
+}
+
+void HttpServerResponse::sendBuffer(FlushMode flushMode)
 {
 	if ( !m_commited )
 	{
+		beginCompression(flushMode);
+
 		std::stringstream header;
 		header << "HTTP/1.1 " << Util::ConvertUtil::toString(m_statusCode) << "\r\n";
 
@@ -68,16 +84,128 @@ void HttpServerResponse::flush()
 
 		header << "\r\n";
 		m_commited = true;
-		m_client->send((char*)header.str().c_str(),header.str().length());
+
+		send(header.str().c_str(),header.str().length());
+	}
+
+	if ( m_stream!=NULL )
+	{
+		if ( m_bufferLength==0 && flushMode==FLUSH_NONE ) {
+			return;
+		}
+
+		ACE_Time_Value startTime = ACE_High_Res_Timer::gettimeofday();
+
+		int zlibFlush = Z_NO_FLUSH;
+		if ( flushMode==FLUSH_SYNC ) {
+			zlibFlush = Z_SYNC_FLUSH;
+		}
+		else if ( flushMode==FLUSH_FINISH ) {
+			zlibFlush = Z_FINISH;
+		}
+
+		m_stream->next_in = (Bytef*)m_buffer;
+		m_stream->avail_in = m_bufferLength;
+
+		char output[4096];
+		int result = Z_OK;
+
+		// run deflate until all input is consumed and the requested flush is complete
+		do
+		{
+			m_stream->next_out = (Bytef*)output;
+			m_stream->avail_out = sizeof(output);
+
+			result = deflate(m_stream,zlibFlush);
+
+			size_t outputLength = sizeof(output)-m_stream->avail_out;
+			if ( outputLength>0 ) {
+				send(output,outputLength);
+				m_compressedLength += outputLength;
+			}
+		}
+		while ( m_stream->avail_out==0 && result!=Z_STREAM_ERROR );
+
+		ACE_UINT64 elapsedTime = 0;
+		(ACE_High_Res_Timer::gettimeofday()-startTime).to_usec(elapsedTime);
+
+		m_compressionTime += elapsedTime;
+		m_uncompressedLength += m_bufferLength;
+		m_bufferLength = 0;
 	}
+	else if ( m_bufferLength>0 ) 
+	{
+		send(m_buffer,m_bufferLength);
 
-	if ( m_bufferLength>0 ) {
-		m_client->send(m_buffer,m_bufferLength);
 		memset(m_buffer,0,m_bufferSize);
 		m_bufferLength = 0;
 	}
 }
 
+void HttpServerResponse::beginCompression(FlushMode flushMode)
+{
+	if ( m_compression==NULL || m_contentEncoding==HttpCompression::ENCODING_IDENTITY 
+		|| m_statusCode!=HttpResponse::HTTP_OK ) {
+		return;
+	}
+
+	// the length is only known if it was set or if the whole body is in the buffer
+	uint64_t length = (uint64_t)-1;
+
+	std::string contentLength;
+	if ( getHeader("Content-Length",contentLength) ) {
+		length = Util::ConvertUtil::toUnsignedInt64(contentLength);
+	}
+	else if ( flushMode==FLUSH_FINISH ) {
+		length = m_bufferLength;
+	}
+
+	if ( !m_compression->isCompressible(getContentType(),length) ) {
+		return;
+	}
+
+	m_stream = new z_stream;
+	memset(m_stream,0,sizeof(z_stream));
+
+	if ( deflateInit2(m_stream,m_compression->getLevel(),Z_DEFLATED,
+		HttpCompression::getWindowBits(m_contentEncoding),8,Z_DEFAULT_STRATEGY)!=Z_OK ) 
+	{
+		delete m_stream;
+		m_stream = NULL;
+		return;
+	}
+
+	// the compressed length is unknown until the body has been sent
+	for ( std::map<std::string,std::string>::iterator iter=m_headers.begin(); 
+		iter!=m_headers.end(); iter++ ) 
+	{
+		if ( boost::iequals(iter->first,"Content-Length") ) {
+			m_headers.erase(iter);
+			break;
+		}
+	}
+
+	setHeader("Content-Encoding",HttpCompression::getEncodingName(m_contentEncoding));
+	setHeader("Vary","Accept-Encoding");
+}
+
+void HttpServerResponse::endCompression()
+{
+	if ( m_stream!=NULL ) {
+		deflateEnd(m_stream);
+		delete m_stream;
+		m_stream = NULL;
+	}
+}
+
+void HttpServerResponse::send(const char *buffer,size_t length)
+{
+	// a response without client is headless and any output is discarded
+	if ( m_client!=NULL ) {
+		m_client->send((char*)buffer,length);
+	}
+}
+
 void HttpServerResponse::write(const char *buffer,size_t length,bool autoFlush)
 {
 	if ( m_buffer==NULL ) {
@@ -90,7 +218,7 @@ void HttpServerResponse::write(const char *buffer,size_t length,bool autoFlush)
 	{
 		int available = m_bufferSize-m_bufferLength;
 		if ( available==0 ) {
-			flush();
+			sendBuffer(FLUSH_NONE);
 			available = m_bufferSize;
 		}
 
@@ -18,8 +18,11 @@
 #ifndef guard_httpresponse_h
 #define guard_httpresponse_h
 
+class HttpCompression; // forward declaration
 class HttpServerClient; // forward declaration
 
+struct z_stream_s; // forward declaration
+
 /**
 * HttpResponse.
 * The base class for all HTTP response type classes.
@@ -31,6 +34,7 @@ public:
 	{
 		HTTP_OK = 200,
 		HTTP_FOUND = 302,
+		HTTP_NOT_MODIFIED = 304,
 		HTTP_BAD_REQUEST = 400,
 		HTTP_UNAUTHORIZED = 401,
 		HTTP_FORBIDDEN = 403,
@@ -182,7 +186,13 @@ public:
 	HttpServerResponse(HttpServerClient *client,int bufferSize) : m_buffer(NULL),
 		m_bufferLength(0),
 		m_commited(false),
-		m_subStatusCode(0)
+		m_compressedLength(0),
+		m_compression(NULL),
+		m_compressionTime(0),
+		m_contentEncoding(0),
+		m_stream(NULL),
+		m_subStatusCode(0),
+		m_uncompressedLength(0)
 	{
 		m_client = client;
 		m_bufferSize = bufferSize;
@@ -192,6 +202,8 @@ public:
 	* Destructor.
 	*/
 	~HttpServerResponse() {
+		endCompression();
+
 		if ( m_buffer!=NULL ) {
 			delete[] m_buffer;
 		}
@@ -201,7 +213,16 @@ public:
 	* Flush the buffer and send it to the client.
 	* This method also commits the response header if not already done.
 	*/
-	void flush();
+	void flush() {
+		sendBuffer(FLUSH_SYNC);
+	}
+
+	/**
+	* Finish the response.
+	* This flushes the buffer and completes any compressed body.
+	* No more data should be written after the response has been finished.
+	*/
+	void finish();
 
 	/**
 	* Sends a redirect response to the client using the specified redirect location.
@@ -248,6 +269,18 @@ public:
 		return m_commited;
 	}
 
+	/**
+	* Set the compression that should be applied to the response body.
+	* Whether the body is compressed is decided when the response header is commited,
+	* based on the status code, content type and content length at that time.
+	* @param compression the compression settings
+	* @param contentEncoding the content encoding negotiated with the client
+	*/
+	void setCompression(HttpCompression *compression,int contentEncoding) {
+		m_compression = compression;
+		m_contentEncoding = contentEncoding;
+	}
+
 	/**
 	* Set the sub status code of the response.
 	* @param subStatusCode the sub status code of the response
@@ -257,6 +290,38 @@ public:
 	}
 
 private:
+	enum FlushMode
+	{
+		FLUSH_NONE,
+		FLUSH_SYNC,
+		FLUSH_FINISH
+	};
+
+	/**
+	* Commit the response header if not already done and send the buffer to the client.
+	* @param flushMode decides how much of any compressed data is sent
+	*/
+	void sendBuffer(FlushMode flushMode);
+
+	/**
+	* Start compressing the response body if compression was requested
+	* and the response is compressible. Must be called before the header is commited.
+	* @param flushMode the mode of the flush commiting the header
+	*/
+	void beginCompression(FlushMode flushMode);
+
+	/**
+	* Release the compression stream, if any.
+	*/
+	void endCompression();
+
+	/**
+	* Send data to the client, if any is attached.
+	* @param buffer the buffer to send
+	* @param length the length of the buffer
+	*/
+	void send(const char *buffer,size_t length);
+
 	/**
 	* Send the response header.
 	* This will mark the response as commited and changes
@@ -265,12 +330,21 @@ private:
 	*/
 	ssize_t sendHeader();
 
+	HttpCompression *m_compression;
+
 	HttpServerClient *m_client;
+
+	z_stream_s *m_stream;
 	
 	char *m_buffer;
 
+	uint64_t m_compressedLength;
+	uint64_t m_compressionTime;
+	uint64_t m_uncompressedLength;
+
 	int m_bufferSize;
 	int m_bufferLength;
+	int m_contentEncoding;
 	int m_subStatusCode;
 
 	bool m_commited;
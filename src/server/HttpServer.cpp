@@ -20,8 +20,10 @@
 
 #define LOGGER_CLASSNAME "HttpServer"
 
+#include "coverhandler.h"
 #include "jshandler.h"
 #include "logmanager.h"
+#include "metricshandler.h"
 #include "sharehandler.h"
 
 bool HttpServer::restart()
@@ -37,6 +39,9 @@ bool HttpServer::start()
 
 	m_started = true;
 
+	m_compression.init();
+	m_tracer.init();
+
 	std::string errorReason;
 	if ( !m_sessionManager.start() ) {
 		errorReason = "Invalid session manager";
@@ -148,12 +153,18 @@ void HttpServer::on(ConfigManagerListener::Load)
 
 		HttpRequestHandler* requestHandler = NULL;
 
-		if ( handler=="ShareHandler" ) {
+		if ( handler==ShareHandler::NAME ) {
 			requestHandler = new ShareHandler(urlPatternRegex);
 		}
-		else if ( handler=="JsHandler" ) {
+		else if ( handler==JsHandler::NAME ) {
 			requestHandler = new JsHandler(urlPatternRegex);
 		}
+		else if ( handler==MetricsHandler::NAME ) {
+			requestHandler = new MetricsHandler(urlPatternRegex);
+		}
+		else if ( handler==CoverHandler::NAME ) {
+			requestHandler = new CoverHandler(urlPatternRegex);
+		}
 
 		if ( requestHandler!=NULL ) {
 			m_requestHandlers.push_back(requestHandler);
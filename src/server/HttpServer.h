@@ -21,9 +21,11 @@
 #include "configmanager.h"
 #include "defaulthandler.h"
 #include "eventbroadcaster.h"
+#include "httpcompression.h"
 #include "httpconnector.h"
 #include "httprequesthandler.h"
 #include "httpsessionmanager.h"
+#include "requesttracer.h"
 #include "singleton.h"
 
 /**
@@ -98,6 +100,22 @@ public:
 	*/
 	bool stop();
 
+	/**
+	* Get the response compression settings.
+	* @return the response compression settings
+	*/
+	HttpCompression& getCompression() {
+		return m_compression;
+	}
+
+	/**
+	* Get the connector accepting clients.
+	* @return the connector instance
+	*/
+	HttpConnector& getConnector() {
+		return m_connector;
+	}
+
 	/**
 	* Get the default request handler.
 	* @return the default request handler instance
@@ -122,6 +140,14 @@ public:
 		return m_sessionManager;
 	}
 
+	/**
+	* Get the request tracer.
+	* @return the request tracer instance
+	*/
+	RequestTracer& getTracer() {
+		return m_tracer;
+	}
+
 	/**
 	* Get whether the http server is started.
 	* @return true if the http server is started
@@ -143,10 +169,14 @@ public:
 	}
 
 private:
+	HttpCompression m_compression;
+
 	HttpConnector m_connector;
 
 	HttpSessionManager m_sessionManager;
 
+	RequestTracer m_tracer;
+
 	DefaultHandler m_defaultHandler;
 
 	std::list<HttpRequestHandler*> m_requestHandlers;
@@ -48,12 +48,18 @@ ssize_t HttpServerClient::send(char *buffer,size_t length,bool nonBlocking)
 		timeout = &m_timeout;
 	}
 
+	ssize_t bytesSent = -1;
+
 	if ( m_sslPeer!=NULL ) {
-		return m_sslPeer->send(buffer,length,timeout);
+		bytesSent = m_sslPeer->send(buffer,length,timeout);
 	}
 	else if ( m_peer!=NULL ) {
-		return m_peer->send(buffer,length,timeout);
+		bytesSent = m_peer->send(buffer,length,timeout);
+	}
+
+	if ( bytesSent>0 ) {
+		m_bytesSent += bytesSent;
 	}
 
-	return -1;
+	return bytesSent;
 }
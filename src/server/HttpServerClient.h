@@ -41,7 +41,8 @@ public:
 	* @return instance
 	*/
 	HttpServerClient(ACE_SOCK_STREAM *peer,
-		ACE_INET_Addr remoteAddress,int bufferSize,int timeout) : m_httpResponse(this,bufferSize),
+		ACE_INET_Addr remoteAddress,int bufferSize,int timeout) : m_bytesSent(0),
+		m_httpResponse(this,bufferSize),
 		m_httpRequest(this)
 	{
 		m_peer = peer;
@@ -61,7 +62,8 @@ public:
 	* @return instance
 	*/
 	HttpServerClient(ACE_SSL_SOCK_STREAM *sslPeer,
-		ACE_INET_Addr remoteAddress,int bufferSize,int timeout) : m_httpResponse(this,bufferSize),
+		ACE_INET_Addr remoteAddress,int bufferSize,int timeout) : m_bytesSent(0),
+		m_httpResponse(this,bufferSize),
 		m_httpRequest(this)
 	{
 		m_peer = NULL;
@@ -162,6 +164,14 @@ public:
 	*/
 	const time_t& getLastAccessedTime() { return m_lastAccessedTime; }
 
+	/**
+	* Get the number of bytes sent to the client.
+	* @return the number of bytes sent to the client
+	*/
+	const uint64_t getBytesSent() const {
+		return m_bytesSent;
+	}
+
 private:
 	ACE_INET_Addr m_remoteAddress;
 	ACE_SOCK_Stream *m_peer;
@@ -172,6 +182,8 @@ private:
 	HttpServerRequest m_httpRequest;
 
 	time_t m_lastAccessedTime;
+
+	uint64_t m_bytesSent;
 };
 
 #endif
@@ -89,7 +89,7 @@ void HttpSessionManager::run()
 
 void HttpSessionManager::referenceSession(HttpSession::Ptr sessionPtr)
 {
-	ACE_Write_Guard<ACE_Mutex> guard(m_mutex);
+	ACE_Write_Guard<ProfiledMutex> guard(m_mutex);
 
 	sessionPtr->touch();
 	sessionPtr->addReference();
@@ -97,7 +97,7 @@ void HttpSessionManager::referenceSession(HttpSession::Ptr sessionPtr)
 
 void HttpSessionManager::dereferenceSession(HttpSession::Ptr sessionPtr)
 {
-	ACE_Write_Guard<ACE_Mutex> guard(m_mutex);
+	ACE_Write_Guard<ProfiledMutex> guard(m_mutex);
 
 	sessionPtr->touch();
 	sessionPtr->removeReference();
@@ -193,7 +193,7 @@ void HttpSessionManager::invalidateSession(HttpSession::Ptr sessionPtr)
 
 HttpSession::Ptr HttpSessionManager::findSessionByGuid(std::string guid)
 {
-	ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+	ACE_Read_Guard<ProfiledMutex> guard(m_mutex);
 
 	HttpSession::Ptr sessionPtr;
 
@@ -210,7 +210,7 @@ HttpSession::Ptr HttpSessionManager::findSessionByGuid(std::string guid)
 
 HttpSession::Ptr HttpSessionManager::matchSession(std::string guid,std::string remoteAddress)
 {
-	ACE_Write_Guard<ACE_Mutex> guard(m_mutex);
+	ACE_Write_Guard<ProfiledMutex> guard(m_mutex);
 
 	HttpSession::Ptr sessionPtr;
 
@@ -23,6 +23,7 @@
 #include "eventbroadcaster.h"
 #include "httpsession.h"
 #include "mutexpool.h"
+#include "profiledmutex.h"
 #include "thread.h"
 
 /**
@@ -80,11 +81,12 @@ public:
 	*/
 	HttpSessionManager() : 
 		m_maxSessions(0),
+		m_mutex("HttpSessionManager"),
 		m_sessionTimeout(0),
 		m_started(false),
 		m_thread(this)
 	{
-		m_mutexPool.init(10); // create mutex pool (for locking individual sessions)
+		m_mutexPool.init(10,"HttpSessionManager.sessions"); // create mutex pool (for locking individual sessions)
 	}
 
 	/**
@@ -176,7 +178,7 @@ public:
 	* @return the number of connected sessions
 	*/
 	const size_t getSessionCount() {
-		ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+		ACE_Read_Guard<ProfiledMutex> guard(m_mutex);
 		return m_sessions.size();
 	}
 
@@ -185,7 +187,7 @@ public:
 	* @return a collection of all connected sessions
 	*/
 	std::vector<HttpSession::Ptr> getSessions() {
-		ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+		ACE_Read_Guard<ProfiledMutex> guard(m_mutex);
 		return m_sessions;
 	}
 
@@ -208,7 +210,7 @@ private:
 	*/
 	void deleteDbEntry(const HttpSession::Ptr sessionPtr);
 
-	ACE_Mutex m_mutex;
+	ProfiledMutex m_mutex;
 
 	Thread m_thread;
 
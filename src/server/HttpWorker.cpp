@@ -20,9 +20,12 @@
 
 #define LOGGER_CLASSNAME "HttpWorker"
 
+#include <ace/high_res_timer.h>
+
 #include "base64.h"
 #include "logmanager.h"
 #include "httpserver.h"
+#include "metricsmanager.h"
 #include "sitemanager.h"
 #include "usermanager.h"
 
@@ -106,6 +109,10 @@ void HttpWorker::process(HttpServerClient *client)
 	int maxHeaderSize = m_connector->getMaxHeaderSize();
 	int maxPostSize = m_connector->getMaxPostSize();
 
+	if ( m_httpServer->getTracer().isEnabled() ) {
+		httpRequest.getTrace().start();
+	}
+
 	std::string header;
 	std::string postData;
 
@@ -562,6 +569,11 @@ void HttpWorker::parseQueryString(HttpServerRequest &httpRequest,HttpServerRespo
 
 void HttpWorker::handleRequest(HttpServerRequest &httpRequest,HttpServerResponse &httpResponse)
 {	
+	ACE_Time_Value startTime = ACE_High_Res_Timer::gettimeofday();
+
+	RequestTrace &trace = httpRequest.getTrace();
+	trace.addSpanFromStart("recv");
+
 	if ( httpResponse.getStatusCode()==HttpResponse::HttpStatus::HTTP_OK ) 
 	{
 		// match host
@@ -569,7 +581,10 @@ void HttpWorker::handleRequest(HttpServerRequest &httpRequest,HttpServerResponse
 		if ( httpResponse.getStatusCode()==HttpResponse::HttpStatus::HTTP_OK ) 
 		{
 			// match site
+			int siteSpan = trace.beginSpan("checkSite");
 			checkSite(httpRequest,httpResponse);
+			trace.endSpan(siteSpan);
+
 			if ( httpResponse.getStatusCode()==HttpResponse::HttpStatus::HTTP_OK ) 
 			{
 				// check if request is for anything in the private directory
@@ -580,6 +595,7 @@ void HttpWorker::handleRequest(HttpServerRequest &httpRequest,HttpServerResponse
 				{
 					// check if request requires authentication
 					if ( !isAuthFormRequest(httpRequest) && !isPublicRequest(httpRequest) ) {
+						TraceScope scope(trace,"checkCredentials");
 						checkCredentials(httpRequest,httpResponse);
 					}
 				}
@@ -593,12 +609,15 @@ void HttpWorker::handleRequest(HttpServerRequest &httpRequest,HttpServerResponse
 		m_httpServer->getSessionManager().referenceSession(httpRequest.getSession());
 	}
 
+	HttpRequestHandler *requestHandler = &m_httpServer->getDefaultRequestHandler();
+
 	// handle request through request handler
 	if ( httpResponse.getStatusCode()==HttpResponse::HttpStatus::HTTP_OK ) {
-		handleRequestedUri(httpRequest,httpResponse);
+		requestHandler = handleRequestedUri(httpRequest,httpResponse);
 	}
 	else {
-		m_httpServer->getDefaultRequestHandler().handleRequest(this,httpRequest,httpResponse);
+		TraceScope scope(trace,requestHandler->getName().c_str());
+		requestHandler->handleRequest(this,httpRequest,httpResponse);
 	}
 
 	// remove reference to any attached session
@@ -608,11 +627,20 @@ void HttpWorker::handleRequest(HttpServerRequest &httpRequest,HttpServerResponse
 	}
 
 	if ( httpRequest.getSite()!=NULL && httpRequest.getSite()->getAccessLogger()!=NULL ) {
+		TraceScope scope(trace,"accessLog");
 		httpRequest.getSite()->getAccessLogger()->log(&httpRequest,&httpResponse);
 	}
+
+	m_httpServer->getTracer().complete(httpRequest,httpResponse);
+
+	ACE_UINT64 duration = 0;
+	(ACE_High_Res_Timer::gettimeofday()-startTime).to_usec(duration);
+
+	MetricsManager::getInstance()->addRequest(requestHandler->getName(),
+		httpResponse.getStatusCode(),duration,m_client->getBytesSent());
 }
 
-void HttpWorker::handleRequestedUri(HttpServerRequest &httpRequest,HttpServerResponse &httpResponse)
+HttpRequestHandler* HttpWorker::handleRequestedUri(HttpServerRequest &httpRequest,HttpServerResponse &httpResponse)
 {
 	HttpRequestHandler *requestHandler = NULL;
 
@@ -626,14 +654,18 @@ void HttpWorker::handleRequestedUri(HttpServerRequest &httpRequest,HttpServerRes
 		}
 	}
 
-	if ( requestHandler!=NULL ) {
-		if ( !requestHandler->handleRequest(this,httpRequest,httpResponse) ) {
-			m_httpServer->getDefaultRequestHandler().handleRequest(this,httpRequest,httpResponse);
+	if ( requestHandler!=NULL ) 
+	{
+		TraceScope scope(httpRequest.getTrace(),requestHandler->getName().c_str());
+		if ( requestHandler->handleRequest(this,httpRequest,httpResponse) ) {
+			return requestHandler;
 		}
 	}
-	else {
-		m_httpServer->getDefaultRequestHandler().handleRequest(this,httpRequest,httpResponse);
-	}
+
+	TraceScope scope(httpRequest.getTrace(),m_httpServer->getDefaultRequestHandler().getName().c_str());
+	m_httpServer->getDefaultRequestHandler().handleRequest(this,httpRequest,httpResponse);
+
+	return &m_httpServer->getDefaultRequestHandler();
 }
 
 void HttpWorker::checkHost(HttpServerRequest &httpRequest,HttpServerResponse &httpResponse)
@@ -22,6 +22,7 @@
 #include "thread.h"
 
 class HttpConnector; // forward declaration
+class HttpRequestHandler; // forward declaration
 class HttpServer; // forward declaration
 
 /**
@@ -77,6 +78,8 @@ public:
 		const std::string& uri);
 
 private:
+	friend class HttpWorkerBenchmark;
+
 	/**
 	* Process the client.
 	* @param client the client to process
@@ -154,8 +157,9 @@ private:
 	* with a unique handler will be handled by the default request handler.
 	* @param httpRequest the request
 	* @param httpResponse the response
+	* @return the request handler that handled the request
 	*/
-	void handleRequestedUri(HttpServerRequest &httpRequest,HttpServerResponse &httpResponse);
+	HttpRequestHandler* handleRequestedUri(HttpServerRequest &httpRequest,HttpServerResponse &httpResponse);
 
 	/**
 	* Check the request and match the requested host.
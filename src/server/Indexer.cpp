@@ -20,15 +20,30 @@
 
 #define LOGGER_CLASSNAME "Indexer"
 
+#include <ace/high_res_timer.h>
 #include <ace/os.h>
 #include <boost/filesystem/exception.hpp>
 #include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/path.hpp>
 
+#ifndef WIN32
+#include <sys/stat.h>
+#endif
+
 #include "logmanager.h"
+#include "streammonitor.h"
 #include "taglibreader.h"
 #include "taskrunner.h"
 
+const int Indexer::BACKOFF_INTERVAL = 500;
+const int Indexer::FINGERPRINT_BLOCK_SIZE = 16384;
+const int Indexer::MAX_BACKOFF_DELAY = 1000;
+const int Indexer::MAX_SHARE_DATABASES = 10;
+const int Indexer::MIN_BACKOFF_DELAY = 10;
+const int Indexer::PACE_BURST = 1000;
+const int Indexer::PUBLISH_INTERVAL = 100;
+const int Indexer::SHARE_DATABASE_ID_BITS = 32;
+
 bool Indexer::init()
 {
 	if ( LogManager::getInstance()->isDebug() ) {
@@ -37,417 +52,1368 @@ bool Indexer::init()
 
 	bool success = false;
 
+	// a cache that can't be written to only means that covers are not extracted
+	m_coverCache.init(ConfigManager::getInstance()->getString(ConfigManager::INDEXER_COVERCACHEPATH),
+		ConfigManager::getInstance()->getInt(ConfigManager::INDEXER_COVERMAXSIZE));
+
+	if ( !prepareIndexTable(DatabaseManager::DATABASE_INDEX) ) {
+		return false;
+	}
+
+	// the share databases are attached before the index is read through the merged table
+	openShareDatabases();
+
+	std::list<uint64_t> missingAggregates;
+
 	DatabaseConnection *conn = DatabaseManager::getInstance()->getConnection(DatabaseManager::DATABASE_INDEX,true);
 	if ( conn!=NULL )
 	{
 		try
 		{
-			std::vector<std::string> metadataColumns;
+			std::list<Share> shares = ShareManager::getInstance()->getShares();
+			std::list<uint64_t> removedShares;
 
-			// get all existing columns
-			sqlite3x::sqlite3_command cmd(conn->getSqliteConn(),"PRAGMA table_info([items]);");
+			// the maintained aggregates are read instead of scanning the items of every share,
+			// and indexes of shares that no longer exist are found by the index verification
+			sqlite3x::sqlite3_command cmd(conn->getSqliteConn(),"SELECT shareId,directories,files,size FROM [shares]");
 			sqlite3x::sqlite3_reader reader = cmd.executereader();
-			while ( reader.read() ) {
-				metadataColumns.push_back(reader.getstring(1));
-			}
-
-			// make sure that a column exists for all metadata fields
-			for ( std::list<IndexerMapping>::iterator mappingIter=m_mappings.begin(); 
-				mappingIter!=m_mappings.end(); mappingIter++ )
-			{
-				std::list<std::string> fieldNames = mappingIter->getMetadataReader()->getFieldNames();
-				for ( std::list<std::string>::iterator iter=fieldNames.begin(); 
-					iter!=fieldNames.end(); iter++ )
-				{
-					if ( std::find(metadataColumns.begin(),metadataColumns.end(),*iter)==metadataColumns.end() ) {
-						conn->getSqliteConn().executenonquery("ALTER TABLE [items] ADD COLUMN [" + *iter + "] TEXT COLLATE NOCASE");
-					}
-				}
-			}
-
-			try
+			while ( reader.read() )
 			{
-				std::list<Share> shares = ShareManager::getInstance()->getShares();
+				uint64_t shareId = reader.getint64(0);
+				bool matchedIndex = false;
 
-				// match all indexes with existing shares
-				sqlite3x::sqlite3_command cmd(conn->getSqliteConn(),"SELECT DISTINCT shareId FROM [items]");
-				sqlite3x::sqlite3_reader reader = cmd.executereader();
-				while ( reader.read() )
+				for ( std::list<Share>::iterator iter=shares.begin(); iter!=shares.end(); iter++ ) 
 				{
-					uint64_t shareId = reader.getint64(0);
-					bool matchedIndex = false;
-
-					for ( std::list<Share>::iterator iter=shares.begin(); iter!=shares.end(); iter++ ) 
+					if ( iter->getDbId()==shareId )
 					{
-						if ( iter->getDbId()==shareId )
-						{
-							uint64_t directories = conn->getSqliteConn().executeint64("SELECT COUNT(itemId) FROM [items]"
-								" WHERE shareId=" + Util::ConvertUtil::toString(shareId) + " AND directory=1");
-
-							uint64_t files = conn->getSqliteConn().executeint64("SELECT COUNT(itemId) FROM [items]"
-								" WHERE shareId=" + Util::ConvertUtil::toString(shareId) + " AND directory=0");
-
-							uint64_t size = conn->getSqliteConn().executeint64("SELECT SUM(size) FROM [items]"
-								" WHERE shareId=" + Util::ConvertUtil::toString(shareId) + " AND directory=0");
-
-							iter->setDirectories(directories);
-							iter->setFiles(files);
-							iter->setSize(size);
-
-							ShareManager::getInstance()->updateShare(*iter);
-							matchedIndex = true;
-							break;
-						}
+						iter->setDirectories(reader.getint64(1));
+						iter->setFiles(reader.getint64(2));
+						iter->setSize(reader.getint64(3));
+
+						ShareManager::getInstance()->updateShare(*iter);
+						shares.erase(iter);
+						matchedIndex = true;
+						break;
 					}
+				}
 
-					if ( !matchedIndex ) {
-						deleteDbEntry(shareId);
-					}
+				if ( !matchedIndex ) {
+					removedShares.push_back(shareId);
 				}
+			}
 
-				success = true;
+			reader.close();
+
+			for ( std::list<uint64_t>::iterator iter=removedShares.begin(); iter!=removedShares.end(); iter++ ) {
+				deleteDbEntry(*iter);
 			}
-			catch(exception &ex) {
-				LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not load indexes [%s]",ex.what());
+
+			// indexes created before the aggregates were maintained are counted once
+			for ( std::list<Share>::iterator iter=shares.begin(); iter!=shares.end(); iter++ ) {
+				missingAggregates.push_back(iter->getDbId());
 			}
+
+			success = true;
 		}
 		catch(exception &ex) {
-			LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could prepare index table [%s]",ex.what());
+			LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not load indexes [%s]",ex.what());
 		}
 
+		loadCheckpoints(conn);
+
 		DatabaseManager::getInstance()->releaseConnection(conn);
 	}
 
+	for ( std::list<uint64_t>::iterator iter=missingAggregates.begin(); iter!=missingAggregates.end(); iter++ ) {
+		verifyAggregates(*iter);
+	}
+
+	// shares in their own databases keep their checkpoints there
+	std::list<std::string> shareDatabases;
+
+	m_mutex.acquire();
+	for ( std::map<uint64_t,std::string>::iterator iter=m_shareDatabases.begin(); iter!=m_shareDatabases.end(); iter++ ) {
+		shareDatabases.push_back(iter->second);
+	}
+	m_mutex.release();
+
+	for ( std::list<std::string>::iterator iter=shareDatabases.begin(); iter!=shareDatabases.end(); iter++ )
+	{
+		DatabaseConnection *shareConn = DatabaseManager::getInstance()->getConnection(*iter,true);
+		if ( shareConn!=NULL ) {
+			loadCheckpoints(shareConn);
+			DatabaseManager::getInstance()->releaseConnection(shareConn);
+		}
+	}
+
 	return success;
 }
 
-bool Indexer::start() 
+bool Indexer::prepareIndexTable(const std::string &databaseName)
 {
-	if ( m_started ) {
+	DatabaseConnection *conn = DatabaseManager::getInstance()->getConnection(databaseName,true);
+	if ( conn==NULL ) {
 		return false;
 	}
 
-	if ( !m_thread.start() ) {
-		return false;
-	}
+	bool success = false;
 
-	m_started = true;
+	try
+	{
+		std::vector<std::string> metadataColumns;
+		std::map<std::string,std::string> columnTypes;
+		std::list<std::string> retypedColumns;
 
-	return true;
-}
+		// get all existing columns, and not those of the merged table
+		sqlite3x::sqlite3_command cmd(conn->getSqliteConn(),"PRAGMA main.table_info([items]);");
+		sqlite3x::sqlite3_reader reader = cmd.executereader();
+		while ( reader.read() ) {
+			metadataColumns.push_back(reader.getstring(1));
+			columnTypes[reader.getstring(1)] = boost::to_upper_copy(reader.getstring(2));
+		}
 
-void Indexer::stop() 
-{
-	if ( !m_started ) {
-		return;
-	}
+		reader.close();
 
-	m_thread.cancel();
-	m_thread.join();
+		// make sure that a column of the right type exists for all metadata fields
+		for ( std::list<IndexerMapping>::iterator mappingIter=m_mappings.begin(); 
+			mappingIter!=m_mappings.end(); mappingIter++ )
+		{
+			MetadataReader *metadataReader = mappingIter->getMetadataReader();
 
-	m_started = false;
-}
+			std::list<std::string> fieldNames = metadataReader->getFieldNames();
+			for ( std::list<std::string>::iterator iter=fieldNames.begin(); 
+				iter!=fieldNames.end(); iter++ )
+			{
+				bool integer = metadataReader->getFieldType(*iter)==MetadataReader::FIELD_INTEGER;
 
-void Indexer::abort() 
-{
-	m_thread.interrupt();
-}
+				if ( std::find(metadataColumns.begin(),metadataColumns.end(),*iter)==metadataColumns.end() ) {
+					conn->getSqliteConn().executenonquery("ALTER TABLE main.[items] ADD COLUMN [" + *iter + "] " + 
+						(integer ? "INTEGER" : "TEXT COLLATE NOCASE"));
+					metadataColumns.push_back(*iter);
+				}
+				else if ( integer && columnTypes[*iter]!="INTEGER" ) {
+					retypedColumns.push_back(*iter);
+				}
+			}
+		}
 
-void Indexer::run()
-{
-	while ( true )
-	{
-		if ( m_thread.isCancelled() ) {			
-			break;
+		// columns added as text before the fields had types are converted once
+		if ( !retypedColumns.empty() ) {
+			retypeIndexColumns(conn,retypedColumns);
 		}
 
-		IndexerJob *job = popQueue();
-		if ( job!=NULL ) {
-			index(job);
-			delete job;
+		// indexes created before covers were extracted lack the cover column
+		if ( std::find(metadataColumns.begin(),metadataColumns.end(),"coverHash")==metadataColumns.end() ) {
+			conn->getSqliteConn().executenonquery("ALTER TABLE main.[items] ADD COLUMN [coverHash] TEXT");
 		}
-		else
-		{
-			// check if any shares should be auto indexed
-			std::list<Share> shares = ShareManager::getInstance()->getSharesToIndex();
-			for ( std::list<Share>::iterator iter=shares.begin(); iter!=shares.end(); iter++ ) {
-				queue(IndexerJob(iter->getDbId(),true));
-			}
+
+		// as well as the generation that replaced validating every item
+		if ( std::find(metadataColumns.begin(),metadataColumns.end(),"generation")==metadataColumns.end() ) {
+			conn->getSqliteConn().executenonquery("ALTER TABLE main.[items] ADD COLUMN [generation] INTEGER");
+		}
+
+		// and the fingerprint that moved files are recognized by
+		if ( std::find(metadataColumns.begin(),metadataColumns.end(),"fingerprint")==metadataColumns.end() ) {
+			conn->getSqliteConn().executenonquery("ALTER TABLE main.[items] ADD COLUMN [fingerprint] TEXT");
 		}
 
-		m_thread.sleep(1000);
+		conn->getSqliteConn().executenonquery("CREATE INDEX IF NOT EXISTS main.idxItemsCoverHash ON items (coverHash)");
+		conn->getSqliteConn().executenonquery("CREATE INDEX IF NOT EXISTS main.idxItemsFingerprint ON items (fingerprint)");
+
+		success = true;
 	}
+	catch(exception &ex) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could prepare index table [%s]",ex.what());
+	}
+
+	DatabaseManager::getInstance()->releaseConnection(conn);
+
+	return success;
 }
 
-void Indexer::queue(const IndexerJob &job)
+void Indexer::retypeIndexColumns(DatabaseConnection *conn,const std::list<std::string> &columns)
 {
-	m_mutex.acquire();
+	LogManager::getInstance()->info(LOGGER_CLASSNAME,"Converting %d metadata columns to integers",(int)columns.size());
 
-	// remove any already existing jobs
-	for ( std::list<IndexerJob>::iterator iter=m_queue.begin(); iter!=m_queue.end(); iter++ ) {
-		if ( iter->getShareId()==job.getShareId() ) {
-			m_queue.erase(iter);
-			break;
-		}
+	std::string tableSql = conn->getSqliteConn().executestring(
+		"SELECT sql FROM main.sqlite_master WHERE type='table' AND name='items'");
+
+	// the columns were added as text by earlier versions, so their definitions are known
+	for ( std::list<std::string>::const_iterator iter=columns.begin(); iter!=columns.end(); iter++ ) {
+		boost::replace_all(tableSql,"[" + *iter + "] TEXT COLLATE NOCASE","[" + *iter + "] INTEGER");
 	}
 
-	// abort if currently being indexed
-	if ( m_currentJob.getShareId()==job.getShareId() ) {
-		abort();
+	std::list<std::string> indexSqls;
+	std::string columnNames;
+
+	sqlite3x::sqlite3_command indexCmd(conn->getSqliteConn(),
+		"SELECT sql FROM main.sqlite_master WHERE type='index' AND tbl_name='items' AND sql IS NOT NULL");
+	sqlite3x::sqlite3_reader reader = indexCmd.executereader();
+	while ( reader.read() ) {
+		indexSqls.push_back(reader.getstring(0));
 	}
-	
-	m_queue.push_back(job);
-	m_mutex.release();
-	fireEvent(IndexerListener::JobQueued(),job);
-}
 
-void Indexer::readMetadata(const std::wstring path,
-	std::map<std::string,std::wstring> *metadata,std::list<MetadataImage::Ptr> *images)
-{
-	boost::filesystem::wpath boostPath(path,boost::filesystem::native);
+	reader.close();
 
-	for ( std::list<IndexerMapping>::iterator iter=m_mappings.begin();
-		iter!=m_mappings.end(); iter++ ) 
-	{
-		if ( boost::regex_search(boostPath.leaf(),iter->getFilePatternRegex()) ) {
-			if ( iter->getMetadataReader()!=NULL ) {
-				iter->getMetadataReader()->extract(path,metadata,images);
-			}
-		}
+	sqlite3x::sqlite3_command columnCmd(conn->getSqliteConn(),"PRAGMA main.table_info([items]);");
+	reader = columnCmd.executereader();
+	while ( reader.read() ) {
+		columnNames += (columnNames.empty() ? "[" : ",[") + reader.getstring(1) + "]";
 	}
-}
 
-void Indexer::deleteDbEntry(uint64_t shareId)
-{
-	std::stringstream query;
-	query << "DELETE FROM [items] WHERE shareId=" << shareId;
+	reader.close();
 
-	TaskRunner::getInstance()->schedule(
-		new DatabaseTask(DatabaseManager::DATABASE_INDEX,query.str(),true));
-}
+	// sqlite can't change the type of a column, so the table is rebuilt 
+	// and the integer affinity of the new columns converts the values
+	sqlite3x::sqlite3_transaction transaction(conn->getSqliteConn(),true);
 
-IndexerJob* Indexer::popQueue()
-{
-	ACE_Write_Guard<ACE_Mutex> guard(m_mutex);
+	conn->getSqliteConn().executenonquery("ALTER TABLE main.[items] RENAME TO [items_old]");
+	conn->getSqliteConn().executenonquery(tableSql);
+	conn->getSqliteConn().executenonquery("INSERT INTO main.[items] (" + columnNames + ") "
+		"SELECT " + columnNames + " FROM main.[items_old]");
+
+	// keep handing out item ids where the old table left off
+	conn->getSqliteConn().executenonquery("DELETE FROM main.sqlite_sequence WHERE name='items'");
+	conn->getSqliteConn().executenonquery("UPDATE main.sqlite_sequence SET name='items' WHERE name='items_old'");
+	conn->getSqliteConn().executenonquery("DROP TABLE main.[items_old]");
 
-	IndexerJob *job = NULL;
-	if ( !m_queue.empty() ) {
-		job = new IndexerJob(m_queue.front());
-		m_queue.pop_front();
+	for ( std::list<std::string>::iterator iter=indexSqls.begin(); iter!=indexSqls.end(); iter++ ) {
+		conn->getSqliteConn().executenonquery(*iter);
 	}
 
-	return job;
+	transaction.commit();
 }
 
-void Indexer::index(IndexerJob *job)
+void Indexer::loadCheckpoints(DatabaseConnection *conn)
 {
-	Share share;
-	if ( ShareManager::getInstance()->findShareByDbId(job->getShareId(),&share) )
+	try
 	{
-		LogManager::getInstance()->info(LOGGER_CLASSNAME,"Indexing of '%s' started",share.getName().c_str());
+		std::map<uint64_t,bool> checkpoints;
 
-		job->setStartTime(Util::TimeUtil::getCalendarTime());
-		job->setState(IndexerJob::State::VALIDATING);
-		setCurrentJob(*job);
+		sqlite3x::sqlite3_command cmd(conn->getSqliteConn(),"SELECT shareId,fullIndexing FROM main.[checkpoints]");
+		sqlite3x::sqlite3_reader reader = cmd.executereader();
+		while ( reader.read() ) {
+			checkpoints[reader.getint64(0)] = reader.getint(1)!=0;
+		}
 
-		fireEvent(IndexerListener::JobStarted());
+		reader.close();
 
-		DatabaseConnection *conn = DatabaseManager::getInstance()->getConnection(DatabaseManager::DATABASE_INDEX,true);
-		if ( conn!=NULL )
+		// resume any indexing that was interrupted by a shutdown
+		for ( std::map<uint64_t,bool>::iterator iter=checkpoints.begin(); iter!=checkpoints.end(); iter++ ) 
 		{
-			std::wstring filePattern = Util::ConvertUtil::toWideString(
-				ConfigManager::getInstance()->getString(ConfigManager::INDEXER_FILEPATTERN));
-
-			boost::wregex filePatternRegex(filePattern,boost::regex_constants::icase);
+			Share share;
+			if ( ShareManager::getInstance()->findShareByDbId(iter->first,&share) ) {
+				queue(IndexerJob(iter->first,iter->second));
+			}
+			else {
+				conn->getSqliteConn().executenonquery("DELETE FROM main.[checkpoints] WHERE shareId=" + 
+					Util::ConvertUtil::toString(iter->first));
+			}
+		}
+	}
+	catch(exception &ex) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not load index checkpoints [%s]",ex.what());
+	}
+}
 
-			bool includeHidden = ConfigManager::getInstance()->getBool(ConfigManager::INDEXER_INCLUDEHIDDEN);
-			bool interrupted = false;
+void Indexer::openShareDatabases()
+{
+	std::string shareDatabasePath = ConfigManager::getInstance()->getString(ConfigManager::INDEXER_SHAREDATABASEPATH);
 
-			sqlite3x::sqlite3_transaction transaction(conn->getSqliteConn(),true);
-			if ( validateProcess(job,conn,filePatternRegex,includeHidden) )
+	try
+	{
+		boost::filesystem::path directoryPath(shareDatabasePath,boost::filesystem::native);
+		if ( boost::filesystem::exists(directoryPath) ) 
+		{
+			boost::filesystem::directory_iterator endIter;
+			for ( boost::filesystem::directory_iterator iter(directoryPath); iter!=endIter; iter++ )
 			{
-				job->setState(IndexerJob::State::ANALYZING);
-				setCurrentJob(*job);
+				std::string fileName = iter->leaf();
+				if ( !boost::ends_with(fileName,".db") ) {
+					continue;
+				}
 
-				boost::filesystem::wpath boostPath(Util::ConvertUtil::toWideString(share.getPath()),
-					boost::filesystem::native);
+				// share databases are named by share id only, anything else isn't ours
+				std::string stem = fileName.substr(0,fileName.length()-3);
+				if ( stem.empty() || !boost::all(stem,boost::is_digit()) ) {
+					continue;
+				}
 
-				IndexerItem rootItem(boostPath,true);
-				if ( analyzeProcess(job,&rootItem,filePatternRegex,includeHidden) )
+				// databases that were still in use when their share was removed
+				boost::filesystem::path markerPath(iter->string() + ".removed",boost::filesystem::native);
+				if ( boost::filesystem::exists(markerPath) ) 
 				{
-					job->setState(IndexerJob::State::INDEXING);
-					setCurrentJob(*job);
-
-					if ( indexProcess(job,&rootItem,conn) )
-					{
-						if ( job->isFullIndexing() ) 
-						{
-							share.setDirectories(job->getNewDirectories());
-							share.setFiles(job->getNewFiles());
-							share.setSize(job->getNewSize());
-						}
-						else
-						{
-							share.setDirectories(share.getDirectories()+job->getNewDirectories());
-							share.setFiles(share.getFiles()+job->getNewFiles());
-							share.setSize(share.getSize()+job->getNewSize());
-						}
-
-						transaction.commit();
+					try {
+						boost::filesystem::remove(*iter);
+						boost::filesystem::remove(boost::filesystem::path(iter->string() + "-journal",boost::filesystem::native));
+						boost::filesystem::remove(markerPath);
 					}
-					else {
-						interrupted = true;
+					catch(boost::filesystem::filesystem_error &ex) {
+						LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not remove share database [%s]",ex.what());
 					}
+
+					continue;
 				}
-				else {
-					interrupted = true;
+
+				uint64_t shareId = Util::ConvertUtil::toUnsignedInt64(stem);
+
+				// databases of removed shares that were still open when the share was removed
+				// are left in place, since the shares may just have failed to load
+				Share share;
+				if ( shareId==0 || !ShareManager::getInstance()->findShareByDbId(shareId,&share) ) {
+					LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Skipping share database of unknown share [%s]",
+						iter->string().c_str());
+					continue;
 				}
+
+				openShareDatabase(shareId);
 			}
-			else {
-				interrupted = true;
+		}
+	}
+	catch(boost::filesystem::filesystem_error &ex) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not read share databases [%s]",ex.what());
+	}
+
+	// databases that already exist are opened either way, but no new ones are created
+	if ( !ConfigManager::getInstance()->getBool(ConfigManager::INDEXER_SHAREDATABASES) ) {
+		return;
+	}
+
+	// move the indexes of shares still kept in the main index database
+	std::list<Share> shares = ShareManager::getInstance()->getShares();
+	for ( std::list<Share>::iterator iter=shares.begin(); iter!=shares.end(); iter++ )
+	{
+		if ( getIndexDatabase(iter->getDbId())==DatabaseManager::DATABASE_INDEX ) {
+			if ( openShareDatabase(iter->getDbId()) ) {
+				moveToShareDatabase(iter->getDbId());
 			}
+		}
+	}
+}
+
+bool Indexer::openShareDatabase(uint64_t shareId)
+{
+	m_mutex.acquire();
+	bool full = m_shareDatabases.size()>=(size_t)MAX_SHARE_DATABASES;
+	m_mutex.release();
 
-			share.setLastIndexedTime(Util::TimeUtil::getCalendarTime());
+	if ( full ) {
+		return false;
+	}
 
-			ShareManager::getInstance()->updateShare(share);
+	std::string databaseName = "index_" + Util::ConvertUtil::toString(shareId);
+	std::string scriptPath = DatabaseManager::getInstance()->getDatabasePath(DatabaseManager::DATABASE_INDEX) + ".sql";
 
-			if ( interrupted ) {
-				transaction.rollback();
-			}
+	try {
+		boost::filesystem::create_directories(boost::filesystem::path(
+			ConfigManager::getInstance()->getString(ConfigManager::INDEXER_SHAREDATABASEPATH),boost::filesystem::native));
+	}
+	catch(boost::filesystem::filesystem_error &ex) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not create share database directory [%s]",ex.what());
+		return false;
+	}
 
-			DatabaseManager::getInstance()->releaseConnection(conn);
-			
-			if ( interrupted ) {
-				LogManager::getInstance()->info(LOGGER_CLASSNAME,"Indexing of '%s' was interrupted after %d seconds",
-					share.getName().c_str(),job->getDuration());
-			}
-			else {
-				LogManager::getInstance()->info(LOGGER_CLASSNAME,"Indexing of '%s' completed in %d seconds",
-					share.getName().c_str(),job->getDuration());
-			}
+	if ( !DatabaseManager::getInstance()->addDatabase(databaseName,getShareDatabasePath(shareId),scriptPath,false) ||
+		!prepareIndexTable(databaseName) ) 
+	{
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not open database for share %s",
+			Util::ConvertUtil::toString(shareId).c_str());
+		return false;
+	}
+
+	DatabaseConnection *conn = DatabaseManager::getInstance()->getConnection(databaseName,true);
+	if ( conn!=NULL )
+	{
+		// item ids start at an offset of their own, so that they're unique across all share databases
+		try
+		{
+			std::stringstream query;
+			query << "INSERT INTO main.[sqlite_sequence] (name,seq)"
+				  << " SELECT 'items'," << (shareId<<SHARE_DATABASE_ID_BITS)
+				  << " WHERE NOT EXISTS (SELECT name FROM main.[sqlite_sequence] WHERE name='items')";
+
+			conn->getSqliteConn().executenonquery(query.str());
 		}
-		else {
-			LogManager::getInstance()->info(LOGGER_CLASSNAME,
-				"Indexing failed. Could not retrieve database connection");
+		catch(exception &ex) {
+			LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not prepare share database [%s]",ex.what());
 		}
-	}
-	else {
-		LogManager::getInstance()->info(LOGGER_CLASSNAME,"Indexing failed. Share could not be found");
+
+		DatabaseManager::getInstance()->releaseConnection(conn);
 	}
 
-	setCurrentJob(IndexerJob());
+	std::list<std::string> tables;
+	tables.push_back("items");
+	tables.push_back("shares");
 
-	fireEvent(IndexerListener::JobCompleted());
+	DatabaseManager::getInstance()->attachDatabase(DatabaseManager::DATABASE_INDEX,databaseName,tables);
+
+	m_mutex.acquire();
+	m_shareDatabases[shareId] = databaseName;
+	m_mutex.release();
+
+	return true;
 }
 
-bool Indexer::validateProcess(IndexerJob *job,DatabaseConnection *conn,
-	const boost::wregex &filePatternRegex,bool includeHidden)
+void Indexer::moveToShareDatabase(uint64_t shareId)
 {
-	if ( !job->isFullIndexing() ) {
-		return true;
-	}
+	std::string databaseName = getIndexDatabase(shareId);
 
-	bool interrupted = false;
+	// the share database is attached to the connection, so the move is a single transaction
+	DatabaseConnection *conn = DatabaseManager::getInstance()->getConnection(DatabaseManager::DATABASE_INDEX,true);
+	if ( conn==NULL ) {
+		return;
+	}
 
 	try
 	{
-		std::wstringstream query;
-		query << "SELECT itemId,name,path FROM [items] WHERE shareId=" << job->getShareId();
+		std::string columnList;
 
-		sqlite3x::sqlite3_command cmd(conn->getSqliteConn(),query.str());
+		sqlite3x::sqlite3_command cmd(conn->getSqliteConn(),"PRAGMA [" + databaseName + "].table_info([items])");
 		sqlite3x::sqlite3_reader reader = cmd.executereader();
-
-		while ( reader.read() )
+		while ( reader.read() ) 
 		{
-			if ( m_thread.isInterrupted() ) {
-				interrupted = true;
-				break;
+			if ( !columnList.empty() ) {
+				columnList += ",";
 			}
-			
-			uint64_t dbId = reader.getint64(0);
 
-			std::wstring fileName = reader.getstring16(1);
-			std::wstring filePath = reader.getstring16(2);
+			columnList += "[" + reader.getstring(1) + "]";
+		}
 
-			bool validItem = false;
+		reader.close();
 
-			if ( LogManager::getInstance()->isDebug() ) {
-				LogManager::getInstance()->debug(LOGGER_CLASSNAME,"Validating '%ls'",
-					filePath.c_str());
-			}
+		std::string condition = " WHERE shareId=" + Util::ConvertUtil::toString(shareId);
 
-#ifdef WIN32
-			DWORD fileAttributes;
+		sqlite3x::sqlite3_transaction transaction(conn->getSqliteConn(),true);
 
-			// make sure path still exists
-			fileAttributes = GetFileAttributesW(filePath.c_str());
-			if ( fileAttributes!=INVALID_FILE_ATTRIBUTES ) 
-			{
-				if ( (fileAttributes & FILE_ATTRIBUTE_DIRECTORY) ||
-					boost::regex_search(fileName,filePatternRegex) )
-				{
-					validItem = true;
-				}
+		conn->getSqliteConn().executenonquery("INSERT INTO [" + databaseName + "].[items] (" + columnList + ")"
+			" SELECT " + columnList + " FROM main.[items]" + condition);
+
+		conn->getSqliteConn().executenonquery("INSERT INTO [" + databaseName + "].[checkpoints]"
+			" SELECT * FROM main.[checkpoints]" + condition);
+
+		conn->getSqliteConn().executenonquery("INSERT INTO [" + databaseName + "].[shares]"
+			" SELECT * FROM main.[shares]" + condition);
+
+		conn->getSqliteConn().executenonquery("DELETE FROM main.[items]" + condition);
+		conn->getSqliteConn().executenonquery("DELETE FROM main.[checkpoints]" + condition);
+		conn->getSqliteConn().executenonquery("DELETE FROM main.[shares]" + condition);
+
+		transaction.commit();
+	}
+	catch(exception &ex) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not move index to share database [%s]",ex.what());
+	}
+
+	DatabaseManager::getInstance()->releaseConnection(conn);
+}
+
+void Indexer::closeShareDatabase(uint64_t shareId,const std::string &databaseName)
+{
+	if ( removeShareDatabase(shareId,databaseName) ) {
+		return;
+	}
+
+	// a marker keeps the file from being opened again if it's still in use at shutdown
+	FILE *file = fopen((getShareDatabasePath(shareId) + ".removed").c_str(),"wb");
+	if ( file!=NULL ) {
+		fclose(file);
+	}
+
+	m_mutex.acquire();
+	m_removedShareDatabases[shareId] = databaseName;
+	m_mutex.release();
+
+	LogManager::getInstance()->info(LOGGER_CLASSNAME,
+		"Database of share %s is still in use and will be removed once released",
+		Util::ConvertUtil::toString(shareId).c_str());
+}
+
+bool Indexer::removeShareDatabase(uint64_t shareId,const std::string &databaseName)
+{
+	// the file can't be removed while a connection still has it open
+	if ( !DatabaseManager::getInstance()->removeDatabase(databaseName) ) {
+		return false;
+	}
+
+	try
+	{
+		std::string path = getShareDatabasePath(shareId);
+		boost::filesystem::remove(boost::filesystem::path(path,boost::filesystem::native));
+		boost::filesystem::remove(boost::filesystem::path(path + "-journal",boost::filesystem::native));
+		boost::filesystem::remove(boost::filesystem::path(path + ".removed",boost::filesystem::native));
+	}
+	catch(boost::filesystem::filesystem_error &ex) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not remove share database [%s]",ex.what());
+		return false;
+	}
+
+	return true;
+}
+
+void Indexer::removeShareDatabases()
+{
+	m_mutex.acquire();
+	std::map<uint64_t,std::string> removedShareDatabases = m_removedShareDatabases;
+	m_mutex.release();
+
+	std::map<uint64_t,std::string>::iterator iter;
+	for ( iter=removedShareDatabases.begin(); iter!=removedShareDatabases.end(); iter++ )
+	{
+		if ( removeShareDatabase(iter->first,iter->second) ) {
+			m_mutex.acquire();
+			m_removedShareDatabases.erase(iter->first);
+			m_mutex.release();
+		}
+	}
+}
+
+std::string Indexer::getIndexDatabase(uint64_t shareId)
+{
+	ACE_Guard<ACE_Mutex> guard(m_mutex);
+
+	std::map<uint64_t,std::string>::iterator iter = m_shareDatabases.find(shareId);
+	if ( iter!=m_shareDatabases.end() ) {
+		return iter->second;
+	}
+
+	return DatabaseManager::DATABASE_INDEX;
+}
+
+std::string Indexer::getShareDatabasePath(uint64_t shareId)
+{
+	return ConfigManager::getInstance()->getString(ConfigManager::INDEXER_SHAREDATABASEPATH) + 
+		"/" + Util::ConvertUtil::toString(shareId) + ".db";
+}
+
+void Indexer::verifyIndex()
+{
+	std::list<Share> shares = ShareManager::getInstance()->getShares();
+	for ( std::list<Share>::iterator iter=shares.begin(); iter!=shares.end(); iter++ ) {
+		verifyAggregates(iter->getDbId());
+	}
+
+	// indexes of shares that were removed without their aggregates
+	DatabaseConnection *conn = DatabaseManager::getInstance()->getConnection(DatabaseManager::DATABASE_INDEX);
+	if ( conn==NULL ) {
+		return;
+	}
+
+	std::list<uint64_t> removedShares;
+
+	try
+	{
+		sqlite3x::sqlite3_command cmd(conn->getSqliteConn(),"SELECT DISTINCT shareId FROM main.[items]");
+		sqlite3x::sqlite3_reader reader = cmd.executereader();
+		while ( reader.read() )
+		{
+			Share share;
+			if ( !ShareManager::getInstance()->findShareByDbId(reader.getint64(0),&share) ) {
+				removedShares.push_back(reader.getint64(0));
+			}
+		}
+	}
+	catch(exception &ex) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not verify index [%s]",ex.what());
+	}
+
+	DatabaseManager::getInstance()->releaseConnection(conn);
+
+	for ( std::list<uint64_t>::iterator iter=removedShares.begin(); iter!=removedShares.end(); iter++ ) {
+		deleteDbEntry(*iter);
+	}
+}
+
+bool Indexer::verifyAggregates(uint64_t shareId)
+{
+	// the write lock keeps any batch from being committed while the items are counted
+	DatabaseConnection *conn = DatabaseManager::getInstance()->getConnection(getIndexDatabase(shareId),true);
+	if ( conn==NULL ) {
+		return false;
+	}
+
+	uint64_t directories = 0;
+	uint64_t files = 0;
+	uint64_t size = 0;
+
+	bool success = false;
+
+	try
+	{
+		std::stringstream query;
+		query << "SELECT directory,COUNT(itemId),IFNULL(SUM(size),0) FROM main.[items]"
+			  << " WHERE shareId=" << shareId << " GROUP BY directory";
+
+		sqlite3x::sqlite3_command cmd(conn->getSqliteConn(),query.str());
+		sqlite3x::sqlite3_reader reader = cmd.executereader();
+		while ( reader.read() )
+		{
+			if ( reader.getint(0)!=0 ) {
+				directories += reader.getint64(1);
+			}
+			else {
+				files += reader.getint64(1);
+				size += reader.getint64(2);
+			}
+		}
+
+		reader.close();
+
+		bool matched = false;
+
+		query.str("");
+		query << "SELECT directories,files,size FROM main.[shares] WHERE shareId=" << shareId;
+
+		sqlite3x::sqlite3_command aggregatesCmd(conn->getSqliteConn(),query.str());
+		sqlite3x::sqlite3_reader aggregatesReader = aggregatesCmd.executereader();
+		if ( aggregatesReader.read() ) 
+		{
+			matched = (uint64_t)aggregatesReader.getint64(0)==directories && 
+				(uint64_t)aggregatesReader.getint64(1)==files && 
+				(uint64_t)aggregatesReader.getint64(2)==size;
+
+			if ( !matched ) {
+				LogManager::getInstance()->info(LOGGER_CLASSNAME,"Correcting index aggregates of share %s",
+					Util::ConvertUtil::toString(shareId).c_str());
+			}
+		}
+
+		aggregatesReader.close();
+
+		if ( !matched )
+		{
+			query.str("");
+			query << "INSERT OR REPLACE INTO main.[shares] (shareId,directories,files,size) VALUES ("
+				  << shareId << "," << directories << "," << files << "," << size << ")";
+
+			conn->getSqliteConn().executenonquery(query.str());
+		}
+
+		success = true;
+	}
+	catch(exception &ex) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not verify index aggregates [%s]",ex.what());
+	}
+
+	// the share is updated before any batch can be committed
+	if ( success )
+	{
+		Share share;
+		if ( ShareManager::getInstance()->findShareByDbId(shareId,&share) ) 
+		{
+			share.setDirectories(directories);
+			share.setFiles(files);
+			share.setSize(size);
+
+			ShareManager::getInstance()->updateShare(share);
+		}
+	}
+
+	DatabaseManager::getInstance()->releaseConnection(conn);
+
+	return success;
+}
+
+bool Indexer::start() 
+{
+	if ( m_started ) {
+		return false;
+	}
+
+	m_batchSize = ConfigManager::getInstance()->getInt(ConfigManager::INDEXER_BATCHSIZE);
+	m_maxDeviceJobs = ConfigManager::getInstance()->getInt(ConfigManager::INDEXER_MAXDEVICEJOBS);
+	m_maxJobs = ConfigManager::getInstance()->getInt(ConfigManager::INDEXER_MAXJOBS);
+	m_maxRemoteDeviceJobs = ConfigManager::getInstance()->getInt(ConfigManager::INDEXER_MAXREMOTEDEVICEJOBS);
+
+	m_throttleMutex.acquire();
+	m_backoffDelay = 0;
+	m_maxFilesPerSecond = ConfigManager::getInstance()->getInt(ConfigManager::INDEXER_MAXFILESPERSECOND);
+	m_maxMegabytesPerSecond = ConfigManager::getInstance()->getInt(ConfigManager::INDEXER_MAXMEGABYTESPERSECOND);
+	m_paceTime = 0;
+	m_streamLatency = ConfigManager::getInstance()->getInt(ConfigManager::INDEXER_STREAMLATENCY);
+	m_throttleMutex.release();
+
+	for ( int i=0; i<m_maxJobs; i++ )
+	{
+		Thread *worker = new Thread(this);
+		if ( !worker->start() ) {
+			delete worker;
+			break;
+		}
+
+		m_workers.push_back(worker);
+	}
+
+	if ( m_workers.empty() ) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not start any worker threads");
+		return false;
+	}
+
+	m_started = true;
+
+	return true;
+}
+
+void Indexer::stop() 
+{
+	if ( !m_started ) {
+		return;
+	}
+
+	std::list<Thread*>::iterator iter;
+	for ( iter=m_workers.begin(); iter!=m_workers.end(); iter++ ) {
+		(*iter)->cancel();
+	}
+
+	for ( iter=m_workers.begin(); iter!=m_workers.end(); iter++ ) {
+		(*iter)->join();
+		delete *iter;
+	}
+
+	m_workers.clear();
+
+	m_started = false;
+}
+
+void Indexer::abort() 
+{
+	ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+
+	std::map<Thread*,IndexerJob>::iterator iter;
+	for ( iter=m_activeJobs.begin(); iter!=m_activeJobs.end(); iter++ ) {
+		iter->first->interrupt();
+	}
+}
+
+void Indexer::abort(uint64_t shareId) 
+{
+	ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+	interruptJob(shareId);
+}
+
+void Indexer::run()
+{
+	Thread *thread = Thread::current();
+
+	// indexing should never be what keeps a stream waiting
+	if ( !Thread::setBackground(true) ) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not lower the priority of worker thread");
+	}
+
+	while ( true )
+	{
+		if ( thread->isCancelled() ) {			
+			break;
+		}
+
+		IndexerJob *job = popQueue(thread);
+		if ( job!=NULL ) 
+		{
+			index(job);
+			delete job;
+		}
+		else {
+			removeShareDatabases();
+			queueSharesToIndex();
+			thread->wait(1000);
+		}
+	}
+}
+
+void Indexer::queue(const IndexerJob &job)
+{
+	IndexerJob queuedJob = job;
+
+	Share share;
+	if ( ShareManager::getInstance()->findShareByDbId(job.getShareId(),&share) ) {
+		resolveDevice(share.getPath(),&queuedJob);
+	}
+
+	m_mutex.acquire();
+
+	// remove any already existing jobs
+	for ( std::list<IndexerJob>::iterator iter=m_queue.begin(); iter!=m_queue.end(); iter++ ) {
+		if ( iter->getShareId()==job.getShareId() ) {
+			m_queue.erase(iter);
+			break;
+		}
+	}
+
+	// abort if currently being indexed
+	interruptJob(job.getShareId());
+	
+	m_queue.push_back(queuedJob);
+	m_mutex.release();
+
+	notifyWorkers();
+
+	fireEvent(IndexerListener::JobQueued(),queuedJob);
+}
+
+std::list<IndexerJob> Indexer::getActiveJobs()
+{
+	ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+
+	std::list<IndexerJob> activeJobs;
+
+	std::map<Thread*,IndexerJob>::iterator iter;
+	for ( iter=m_activeJobs.begin(); iter!=m_activeJobs.end(); iter++ ) {
+		activeJobs.push_back(iter->second);
+	}
+
+	return activeJobs;
+}
+
+void Indexer::readMetadata(const std::wstring path,
+	std::map<std::string,std::wstring> *metadata,std::list<MetadataImage::Ptr> *images)
+{
+	boost::filesystem::wpath boostPath(path,boost::filesystem::native);
+
+	for ( std::list<IndexerMapping>::iterator iter=m_mappings.begin();
+		iter!=m_mappings.end(); iter++ ) 
+	{
+		if ( boost::regex_search(boostPath.leaf(),iter->getFilePatternRegex()) ) {
+			if ( iter->getMetadataReader()!=NULL ) {
+				iter->getMetadataReader()->extract(path,metadata,images);
 			}
+		}
+	}
+}
+
+void Indexer::deleteDbEntry(uint64_t shareId)
+{
+	std::string databaseName;
+
+	m_mutex.acquire();
+	std::map<uint64_t,std::string>::iterator iter = m_shareDatabases.find(shareId);
+	if ( iter!=m_shareDatabases.end() ) {
+		databaseName = iter->second;
+		m_shareDatabases.erase(iter);
+	}
+	m_mutex.release();
+
+	// a share in its own database is removed with the file instead of row by row
+	if ( !databaseName.empty() ) {
+		closeShareDatabase(shareId,databaseName);
+		return;
+	}
+
+	std::string condition = " WHERE shareId=" + Util::ConvertUtil::toString(shareId);
+
+	// the entries are deleted in a single task so that a share is never left partially deleted
+	std::list<std::string> queries;
+	queries.push_back("DELETE FROM main.[items]" + condition);
+	queries.push_back("DELETE FROM main.[checkpoints]" + condition);
+	queries.push_back("DELETE FROM main.[shares]" + condition);
+
+	TaskRunner::getInstance()->schedule(
+		new DatabaseTask(DatabaseManager::DATABASE_INDEX,queries,true));
+}
+
+IndexerJob* Indexer::popQueue(Thread *thread)
+{
+	ACE_Write_Guard<ACE_Mutex> guard(m_mutex);
+
+	// no job may store cover images while unused images are purged
+	if ( m_purging ) {
+		return NULL;
+	}
+
+	for ( std::list<IndexerJob>::iterator iter=m_queue.begin(); iter!=m_queue.end(); iter++ )
+	{
+		int deviceJobs = 0;
+		bool shareActive = false;
+
+		std::map<Thread*,IndexerJob>::iterator activeIter;
+		for ( activeIter=m_activeJobs.begin(); activeIter!=m_activeJobs.end(); activeIter++ ) 
+		{
+			if ( activeIter->second.getShareId()==iter->getShareId() ) {
+				shareActive = true;
+			}
+
+			if ( activeIter->second.getDevice()==iter->getDevice() ) {
+				deviceJobs++;
+			}
+		}
+
+		// an aborted job of the same share may still be rolling back
+		if ( shareActive ) {
+			continue;
+		}
+
+		// jobs on a busy device wait so that its disk isn't made to seek between them
+		int maxDeviceJobs = iter->isRemoteDevice() ? m_maxRemoteDeviceJobs : m_maxDeviceJobs;
+		if ( deviceJobs>=maxDeviceJobs ) {
+			continue;
+		}
+
+		// clear any interruption meant for the job this thread processed before. It's done 
+		// before the job becomes active, since any abort after that is meant for this job
+		thread->isInterrupted();
+
+		// a cancel also interrupts, so make sure that it wasn't just cleared along with it
+		if ( thread->isCancelled() ) {
+			return NULL;
+		}
+
+		IndexerJob *job = new IndexerJob(*iter);
+		m_queue.erase(iter);
+		m_activeJobs[thread] = *job;
+
+		return job;
+	}
+
+	return NULL;
+}
+
+void Indexer::queueSharesToIndex()
+{
+	std::list<IndexerJob> jobs;
+
+	std::list<Share> shares = ShareManager::getInstance()->getSharesToIndex();
+	for ( std::list<Share>::iterator iter=shares.begin(); iter!=shares.end(); iter++ ) {
+		IndexerJob job(iter->getDbId(),true);
+		resolveDevice(iter->getPath(),&job);
+		jobs.push_back(job);
+	}
+
+	std::list<IndexerJob> queuedJobs;
+
+	m_mutex.acquire();
+
+	// a share stays due until indexed, so any share already queued or active is left alone
+	for ( std::list<IndexerJob>::iterator iter=jobs.begin(); iter!=jobs.end(); iter++ )
+	{
+		bool found = false;
+
+		std::list<IndexerJob>::iterator queueIter;
+		for ( queueIter=m_queue.begin(); queueIter!=m_queue.end(); queueIter++ ) {
+			if ( queueIter->getShareId()==iter->getShareId() ) {
+				found = true;
+			}
+		}
+
+		std::map<Thread*,IndexerJob>::iterator activeIter;
+		for ( activeIter=m_activeJobs.begin(); activeIter!=m_activeJobs.end(); activeIter++ ) {
+			if ( activeIter->second.getShareId()==iter->getShareId() ) {
+				found = true;
+			}
+		}
+
+		if ( !found ) {
+			m_queue.push_back(*iter);
+			queuedJobs.push_back(*iter);
+		}
+	}
+
+	m_mutex.release();
+
+	if ( !queuedJobs.empty() ) {
+		notifyWorkers();
+	}
+
+	for ( std::list<IndexerJob>::iterator iter=queuedJobs.begin(); iter!=queuedJobs.end(); iter++ ) {
+		fireEvent(IndexerListener::JobQueued(),*iter);
+	}
+}
+
+void Indexer::resolveDevice(const std::string &path,IndexerJob *job)
+{
+#ifdef WIN32
+	std::wstring widePath = Util::ConvertUtil::toWideString(path);
+	std::wstring rootPath;
+
+	// the root is either a drive such as 'C:\' or a network share such as '\\server\share\'
+	if ( boost::starts_with(widePath,L"\\\\") ) 
+	{
+		std::wstring::size_type pos = widePath.find(L'\\',2);
+		if ( pos!=std::wstring::npos ) {
+			pos = widePath.find(L'\\',pos+1);
+		}
+
+		rootPath = (pos!=std::wstring::npos ? widePath.substr(0,pos) : widePath) + L"\\";
+	}
+	else if ( widePath.length()>=2 && widePath[1]==L':' ) {
+		rootPath = widePath.substr(0,2) + L"\\";
+	}
+
+	DWORD serialNumber = 0;
+	if ( !rootPath.empty() && GetVolumeInformationW(rootPath.c_str(),NULL,0,&serialNumber,NULL,NULL,NULL,0) ) {
+		job->setDevice(Util::ConvertUtil::toString((uint64_t)serialNumber));
+	}
+	else {
+		job->setDevice(Util::ConvertUtil::toString(boost::to_lower_copy(rootPath)));
+	}
+
+	job->setRemoteDevice(rootPath.empty() || GetDriveTypeW(rootPath.c_str())==DRIVE_REMOTE);
 #else
-			try
+	struct stat fileStat;
+	if ( stat(path.c_str(),&fileStat)==0 ) {
+		job->setDevice(Util::ConvertUtil::toString((uint64_t)fileStat.st_dev));
+	}
+
+	job->setRemoteDevice(false);
+#endif
+}
+
+void Indexer::interruptJob(uint64_t shareId)
+{
+	std::map<Thread*,IndexerJob>::iterator iter;
+	for ( iter=m_activeJobs.begin(); iter!=m_activeJobs.end(); iter++ ) {
+		if ( iter->second.getShareId()==shareId ) {
+			iter->first->interrupt();
+		}
+	}
+}
+
+void Indexer::notifyWorkers()
+{
+	std::list<Thread*>::iterator iter;
+	for ( iter=m_workers.begin(); iter!=m_workers.end(); iter++ ) {
+		(*iter)->notify();
+	}
+}
+
+void Indexer::index(IndexerJob *job)
+{
+	Share share;
+	if ( ShareManager::getInstance()->findShareByDbId(job->getShareId(),&share) )
+	{
+		LogManager::getInstance()->info(LOGGER_CLASSNAME,"Indexing of '%s' started",share.getName().c_str());
+
+		// directories are analyzed and validated as they're indexed
+		job->setStartTime(Util::TimeUtil::getCalendarTime());
+		job->setState(IndexerJob::State::INDEXING);
+		setActiveJob(*job);
+
+		fireEvent(IndexerListener::JobStarted());
+
+		// the write lock is only taken while a batch is committed
+		DatabaseConnection *conn = DatabaseManager::getInstance()->getConnection(getIndexDatabase(job->getShareId()));
+		if ( conn!=NULL )
+		{
+			std::wstring filePattern = Util::ConvertUtil::toWideString(
+				ConfigManager::getInstance()->getString(ConfigManager::INDEXER_FILEPATTERN));
+
+			boost::wregex filePatternRegex(filePattern,boost::regex_constants::icase);
+
+			std::wstring coverPattern = Util::ConvertUtil::toWideString(
+				ConfigManager::getInstance()->getString(ConfigManager::INDEXER_COVERPATTERN));
+
+			boost::wregex coverPatternRegex;
+			if ( !coverPattern.empty() ) {
+				coverPatternRegex.assign(coverPattern,boost::regex_constants::icase);
+			}
+
+			bool includeHidden = ConfigManager::getInstance()->getBool(ConfigManager::INDEXER_INCLUDEHIDDEN);
+			bool interrupted = false;
+
+			IndexerItem rootItem(Util::ConvertUtil::toWideString(share.getPath()),true);
+			IndexerBatch batch(conn);
+
+			if ( !readCheckpoint(job,rootItem.getPath().string(),conn) ) {
+				interrupted = true;
+			}
+
+			// only the batch since the last checkpoint is lost if interrupted
+			if ( !interrupted )
 			{
-				// make sure path still exists
-				boost::filesystem::wpath boostPath(filePath,boost::filesystem::native);
-				if ( boost::filesystem::exists(boostPath) )
+				if ( indexProcess(job,&rootItem,filePatternRegex,coverPatternRegex,includeHidden,&batch) )
 				{
-					if ( boost::filesystem::is_directory(boostPath) ||
-						boost::regex_search(fileName,filePatternRegex) ) 
+					if ( commitBatch(job,&batch,L"") ) 
 					{
-						validItem = true;
+						if ( job->isFullIndexing() ) 
+						{
+							// images stored by other jobs may not have been committed yet
+							m_mutex.acquire();
+							bool purge = m_activeJobs.size()==1;
+							m_purging = purge;
+							m_mutex.release();
+
+							if ( purge ) 
+							{
+								purgeCoverCache();
+
+								m_mutex.acquire();
+								m_purging = false;
+								m_mutex.release();
+
+								notifyWorkers();
+							}
+						}
+					}
+					else {
+						interrupted = true;
 					}
 				}
+				else {
+					interrupted = true;
+				}
 			}
-			catch(boost::filesystem::filesystem_error error) {
+
+			// the counters of the share were updated at every commit
+			if ( ShareManager::getInstance()->findShareByDbId(job->getShareId(),&share) ) {
+				share.setLastIndexedTime(Util::TimeUtil::getCalendarTime());
+				ShareManager::getInstance()->updateShare(share);
+			}
+
+			DatabaseManager::getInstance()->releaseConnection(conn);
 			
+			if ( interrupted ) {
+				LogManager::getInstance()->info(LOGGER_CLASSNAME,"Indexing of '%s' was interrupted after %d seconds",
+					share.getName().c_str(),job->getDuration());
+			}
+			else {
+				LogManager::getInstance()->info(LOGGER_CLASSNAME,"Indexing of '%s' completed in %d seconds",
+					share.getName().c_str(),job->getDuration());
+			}
+		}
+		else {
+			LogManager::getInstance()->info(LOGGER_CLASSNAME,
+				"Indexing failed. Could not retrieve database connection");
+		}
+	}
+	else {
+		LogManager::getInstance()->info(LOGGER_CLASSNAME,"Indexing failed. Share could not be found");
+	}
+
+	removeActiveJob();
+
+	fireEvent(IndexerListener::JobCompleted());
+}
+
+bool Indexer::readCheckpoint(IndexerJob *job,const std::wstring &rootPath,DatabaseConnection *conn)
+{
+	try
+	{
+		bool checkpointFound = false;
+		std::wstring checkpointPath;
+
+		std::stringstream query;
+		query << "SELECT generation,fullIndexing,path FROM main.[checkpoints] WHERE shareId=" << job->getShareId();
+
+		sqlite3x::sqlite3_command cmd(conn->getSqliteConn(),query.str());
+		sqlite3x::sqlite3_reader reader = cmd.executereader();
+		while ( reader.read() )
+		{
+			job->setGeneration(reader.getint64(0));
+			if ( reader.getint(1)!=0 ) {
+				job->setFullIndexing(true);
 			}
+
+			checkpointPath = reader.getstring16(2);
+			checkpointFound = true;
+		}
+
+		reader.close();
+
+		if ( !checkpointFound )
+		{
+			// items seen during this indexing are stamped with a new generation
+			std::stringstream query;
+			query << "SELECT IFNULL(MAX(generation),0)+1 FROM main.[items] WHERE shareId=" << job->getShareId();
+
+			job->setGeneration(conn->getSqliteConn().executeint64(query.str()));
+			return true;
+		}
+
+#ifdef WIN32
+		std::wstring separator = L"\\";
+#else
+		std::wstring separator = L"/";
 #endif
 
-			if ( !validItem ) 
-			{
-				std::stringstream query;
-				query << "DELETE FROM [items] WHERE shareId=" 
-					  << job->getShareId() << " AND itemId=" << dbId;
+		// a checkpoint outside of the share path means that the share has been moved,
+		// in which case all of it is walked again but with the earlier generation kept
+		std::wstring rootPrefix = rootPath + separator;
+		if ( boost::starts_with(checkpointPath,rootPrefix) ) {
+			std::wstring relativePath = checkpointPath.substr(rootPrefix.length());
+			boost::split(job->getResumePath(),relativePath,boost::is_any_of(separator));
+		}
+
+		LogManager::getInstance()->info(LOGGER_CLASSNAME,"Resuming indexing after '%ls'",checkpointPath.c_str());
+	}
+	catch(exception &ex) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not read index checkpoint [%s]",ex.what());
+		return false;
+	}
+
+	return true;
+}
+
+bool Indexer::commitBatch(IndexerJob *job,IndexerBatch *batch,const std::wstring &checkpointPath)
+{
+	// the share may have been removed while being indexed
+	Share share;
+	if ( !ShareManager::getInstance()->findShareByDbId(job->getShareId(),&share) ) {
+		return false;
+	}
+
+	// the batch is committed to the database it was read from, even if the share has been moved since
+	DatabaseConnection *conn = DatabaseManager::getInstance()->getConnection(batch->getConnection()->getDatabase(),true);
+	if ( conn==NULL ) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not commit index batch. Could not retrieve database connection");
+		return false;
+	}
+
+	bool success = false;
+	bool failedItems = false;
+
+	try
+	{
+		sqlite3x::sqlite3_transaction transaction(conn->getSqliteConn(),true);
+
+		// a single failed item should not cost the whole batch
+		const std::list<std::wstring> &queries = batch->getQueries();
+		for ( std::list<std::wstring>::const_iterator iter=queries.begin(); iter!=queries.end(); iter++ ) 
+		{
+			try {
+				conn->getSqliteConn().executenonquery(*iter);
+			}
+			catch(exception &ex) {
+				LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Failed to write index item [%s]",ex.what());
+				failedItems = true;
+			}
+		}
 
-				conn->getSqliteConn().executenonquery(query.str());
+		std::wstringstream query;
+		if ( !checkpointPath.empty() ) {
+			query << "INSERT OR REPLACE INTO main.[checkpoints] (shareId,generation,fullIndexing,path) VALUES ("
+				  << job->getShareId() << ","
+				  << job->getGeneration() << ","
+				  << job->isFullIndexing() << ","
+				  << "'" << conn->quote(checkpointPath) << "')";
+		}
+		else 
+		{
+			if ( job->isFullIndexing() ) {
+				deleteUnseenItems(job,conn);
 			}
 
-			job->setCurrentPath(Util::ConvertUtil::toString(filePath));
-			setCurrentJob(*job);
+			query << "DELETE FROM main.[checkpoints] WHERE shareId=" << job->getShareId();
+		}
+
+		conn->getSqliteConn().executenonquery(query.str());
+
+		// the aggregates are changed in the same transaction as the items they count
+		std::stringstream aggregatesQuery;
+		aggregatesQuery << "INSERT OR IGNORE INTO main.[shares] (shareId,directories,files,size) VALUES ("
+						<< job->getShareId() << ",0,0,0)";
+
+		conn->getSqliteConn().executenonquery(aggregatesQuery.str());
+
+		// the changes of the job no longer match the items if any of them failed,
+		// in which case the aggregates are counted again once the batch is committed
+		if ( !failedItems )
+		{
+			aggregatesQuery.str("");
+			aggregatesQuery << "UPDATE main.[shares] SET "
+							<< "directories=directories+(" << (int64_t)job->getNewDirectories()-(int64_t)job->getRemovedDirectories() << "),"
+							<< "files=files+(" << (int64_t)job->getNewFiles()-(int64_t)job->getRemovedFiles() << "),"
+							<< "size=size+(" << job->getNewSize()-(int64_t)job->getRemovedSize() << ")"
+							<< " WHERE shareId=" << job->getShareId();
+
+			conn->getSqliteConn().executenonquery(aggregatesQuery.str());
 		}
+
+		transaction.commit();
+		success = true;
 	}
 	catch(exception &ex) {
-		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Error validating share [%s]",ex.what());
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not commit index batch [%s]",ex.what());
 	}
 
-	return !interrupted;
+	// the share is updated while the write lock keeps the aggregates from being verified
+	if ( success && !failedItems && ShareManager::getInstance()->findShareByDbId(job->getShareId(),&share) ) 
+	{
+		share.setDirectories(share.getDirectories()+job->getNewDirectories()-job->getRemovedDirectories());
+		share.setFiles(share.getFiles()+job->getNewFiles()-job->getRemovedFiles());
+		share.setSize(share.getSize()+job->getNewSize()-job->getRemovedSize());
+
+		ShareManager::getInstance()->updateShare(share);
+	}
+
+	DatabaseManager::getInstance()->releaseConnection(conn);
+
+	batch->clearQueries();
+
+	if ( !success ) {
+		return false;
+	}
+
+	if ( failedItems ) {
+		verifyAggregates(job->getShareId());
+	}
+
+	job->resetChanges();
+
+	return true;
+}
+
+void Indexer::deleteUnseenItems(IndexerJob *job,DatabaseConnection *conn)
+{
+	std::stringstream condition;
+	condition << " WHERE shareId=" << job->getShareId()
+			  << " AND (generation IS NULL OR generation<>" << job->getGeneration() << ")";
+
+	// stale items are removed by the next full indexing if this fails
+	try 
+	{
+		uint64_t removedDirectories = 0;
+		uint64_t removedFiles = 0;
+		uint64_t removedSize = 0;
+
+		sqlite3x::sqlite3_command cmd(conn->getSqliteConn(),
+			"SELECT directory,COUNT(itemId),IFNULL(SUM(size),0) FROM main.[items]" + condition.str() + " GROUP BY directory");
+
+		sqlite3x::sqlite3_reader reader = cmd.executereader();
+		while ( reader.read() )
+		{
+			if ( reader.getint(0)!=0 ) {
+				removedDirectories += reader.getint64(1);
+			}
+			else {
+				removedFiles += reader.getint64(1);
+				removedSize += reader.getint64(2);
+			}
+		}
+
+		reader.close();
+
+		conn->getSqliteConn().executenonquery("DELETE FROM main.[items]" + condition.str());
+
+		job->increaseRemovedDirectories(removedDirectories);
+		job->increaseRemovedFiles(removedFiles);
+		job->increaseRemovedSize(removedSize);
+	}
+	catch(exception &ex) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Failed to delete missing index items [%s]",ex.what());
+	}
 }
 
-bool Indexer::analyzeProcess(IndexerJob *job,IndexerItem *item,
-	const boost::wregex &filePatternRegex,bool includeHidden)
+bool Indexer::analyzeProcess(IndexerJob *job,IndexerItem *item,const boost::wregex &filePatternRegex,
+	const boost::wregex &coverPatternRegex,bool includeHidden)
 {
+	Thread *thread = Thread::current();
+
 	bool interrupted = false;
 
 #ifdef WIN32
 	WIN32_FIND_DATAW fileData;
 
-	HANDLE file = FindFirstFileW(std::wstring(item->getPath().string()+L"\\*.*").c_str(),&fileData);
+	std::wstring directoryPath = item->getPath().string();
+
+	HANDLE file = FindFirstFileW(std::wstring(directoryPath+L"\\*.*").c_str(),&fileData);
 	if ( file!=INVALID_HANDLE_VALUE )
 	{
 		while ( FindNextFileW(file,&fileData)!=0 )
 		{
-			if ( m_thread.isInterrupted() ) {
+			if ( thread->isInterrupted() ) {
 				interrupted = true;
 				break;
 			}
 			
 			std::wstring fileName = fileData.cFileName;
-			std::wstring filePath = item->getPath().string() + L"\\" + fileName;
+			std::wstring filePath = directoryPath + L"\\" + fileName;
 
 			if ( fileName==L"." || fileName==L".." ) {
 				continue;
@@ -462,30 +1428,25 @@ bool Indexer::analyzeProcess(IndexerJob *job,IndexerItem *item,
 					filePath.c_str());
 			}
 
-			if ( fileData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY )
-			{
-				boost::filesystem::wpath boostPath(filePath,boost::filesystem::native);
-
+			if ( fileData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ) {
 				job->increaseAnalyzedDirectories();
-				IndexerItem *directoryItem =item->addItem(IndexerItem(boostPath,true));
-				if ( !analyzeProcess(job,directoryItem,filePatternRegex,includeHidden) ) {
-					interrupted = true;
-					break;
-				}
+				item->addItem(IndexerItem(fileName,true));
 			}
 			else
 			{
-				if ( boost::regex_search(fileName,filePatternRegex) ) 
+				if ( item->getCoverPath().empty() && !coverPatternRegex.empty() && 
+					boost::regex_search(fileName,coverPatternRegex) ) 
 				{
-					boost::filesystem::wpath boostPath(filePath,boost::filesystem::native);
+					item->setCoverPath(filePath);
+				}
 
+				if ( boost::regex_search(fileName,filePatternRegex) ) {
 					job->increaseAnalyzedFiles();
-					item->addItem(IndexerItem(boostPath,false));
+					item->addItem(IndexerItem(fileName,false));
 				}
 			}
 
-			job->setCurrentPath(Util::ConvertUtil::toString(filePath));
-			setCurrentJob(*job);
+			publishProgress(job,filePath);
 		}
 	}
 	else
@@ -495,7 +1456,7 @@ bool Indexer::analyzeProcess(IndexerJob *job,IndexerItem *item,
 		{
 			if ( LogManager::getInstance()->isDebug() ) {
 				LogManager::getInstance()->debug(LOGGER_CLASSNAME,
-					"Could not analyze path '%ls'",item->getPath().string().c_str());
+					"Could not analyze path '%ls'",directoryPath.c_str());
 			}
 		}
 	}
@@ -504,13 +1465,14 @@ bool Indexer::analyzeProcess(IndexerJob *job,IndexerItem *item,
 #else
 	try
 	{
-		if ( boost::filesystem::exists(item->getPath()) ) 
+		boost::filesystem::wpath directoryPath = item->getPath();
+		if ( boost::filesystem::exists(directoryPath) ) 
 		{
 			boost::filesystem::wdirectory_iterator endIter;
-			boost::filesystem::wdirectory_iterator iter(item->getPath());
+			boost::filesystem::wdirectory_iterator iter(directoryPath);
 			for ( iter; iter!=endIter; iter++ )
 			{
-				if ( m_thread.isInterrupted() ) {
+				if ( thread->isInterrupted() ) {
 					interrupted = true;
 					break;
 				}
@@ -529,25 +1491,25 @@ bool Indexer::analyzeProcess(IndexerJob *job,IndexerItem *item,
 
 				try
 				{
-					if ( boost::filesystem::is_directory(*iter) )
-					{
+					if ( boost::filesystem::is_directory(*iter) ) {
 						job->increaseAnalyzedDirectories();
-						IndexerItem *directoryItem = item->addItem(IndexerItem(*iter,true));
-						if ( !analyzeProcess(job,directoryItem,filePatternRegex,includeHidden) ) {
-							interrupted = true;
-							break;
-						}
+						item->addItem(IndexerItem(fileName,true));
 					}
 					else
 					{
+						if ( item->getCoverPath().empty() && !coverPatternRegex.empty() && 
+							boost::regex_search(fileName,coverPatternRegex) ) 
+						{
+							item->setCoverPath(filePath);
+						}
+
 						if ( boost::regex_search(fileName,filePatternRegex) ) {
 							job->increaseAnalyzedFiles();
-							item->addItem(IndexerItem(*iter,false));
+							item->addItem(IndexerItem(fileName,false));
 						}
 					}
 
-					job->setCurrentPath(Util::ConvertUtil::toString(filePath));
-					setCurrentJob(*job);
+					publishProgress(job,filePath);
 				}
 				catch(boost::filesystem::filesystem_error error) {
 					
@@ -555,262 +1517,687 @@ bool Indexer::analyzeProcess(IndexerJob *job,IndexerItem *item,
 			}
 		}
 	}
-	catch(boost::filesystem::filesystem_error error) 
+	catch(boost::filesystem::filesystem_error error) 
+	{
+		if ( LogManager::getInstance()->isDebug() ) {
+			LogManager::getInstance()->warning(LOGGER_CLASSNAME,
+				"Could not analyze path '%ls'",item->getPath().string().c_str());
+		}
+	}
+
+#endif
+
+	return !interrupted;
+}
+
+bool Indexer::indexProcess(IndexerJob *job,IndexerItem *item,const boost::wregex &filePatternRegex,
+	const boost::wregex &coverPatternRegex,bool includeHidden,IndexerBatch *batch)
+{
+	if ( !analyzeProcess(job,item,filePatternRegex,coverPatternRegex,includeHidden) ) {
+		return false;
+	}
+
+	// the walk must be in the same order every time for a checkpoint to be resumed
+	item->sortItems();
+
+	// the cover file of a directory is stored before any of its files need it
+	if ( !item->getCoverPath().empty() ) {
+		item->setCoverHash(m_coverCache.storeFile(item->getCoverPath()));
+	}
+
+	// the root directory of the share has no database entry
+	Thread *thread = Thread::current();
+
+	bool interrupted = false;
+
+	if ( item->getParentItem()!=NULL ) 
+	{
+		indexItem(job,item,batch);
+		job->increaseIndexedDirectories();
+
+		if ( !throttle(0) ) {
+			interrupted = true;
+		}
+	}
+
+	std::list<std::wstring> &resumePath = job->getResumePath();
+
+	std::list<IndexerItem> &items = item->getItems();
+	for ( std::list<IndexerItem>::iterator iter=items.begin(); 
+		!interrupted && iter!=items.end(); iter++ )
+	{
+		if ( thread->isInterrupted() ) {
+			interrupted = true;
+			break;
+		}
+
+		// skip everything that was committed before the checkpoint
+		if ( !resumePath.empty() )
+		{
+			if ( iter->getName()<resumePath.front() ) {
+				continue;
+			}
+			else if ( iter->getName()==resumePath.front() && iter->isDirectory() )
+			{
+				resumePath.pop_front();
+
+				// the checkpoint directory itself was completed
+				if ( resumePath.empty() ) {
+					continue;
+				}
+
+				bool completed = indexProcess(job,&*iter,filePatternRegex,coverPatternRegex,includeHidden,batch);
+
+				// nothing after the checkpoint has been indexed, even if it no longer exists
+				resumePath.clear();
+
+				if ( !completed ) {
+					interrupted = true;
+					break;
+				}
+
+				continue;
+			}
+			else {
+				resumePath.clear();
+			}
+		}
+
+		if ( iter->isDirectory() )
+		{
+			if ( !indexProcess(job,&*iter,filePatternRegex,coverPatternRegex,includeHidden,batch) ) {
+				interrupted = true;
+				break;
+			}
+		}
+		else
+		{
+			uint64_t bytes = indexItem(job,&*iter,batch);
+			job->increaseIndexedFiles();
+
+			publishProgress(job,iter->getPath().string());
+
+			if ( !throttle(bytes) ) {
+				interrupted = true;
+				break;
+			}
+		}
+	}
+
+	// the children are no longer needed once indexed
+	item->clearItems();
+
+	// commit with this directory as the checkpoint
+	if ( !interrupted && item->getParentItem()!=NULL && 
+		m_batchSize>0 && job->getUncommittedItems()>=(uint64_t)m_batchSize ) 
 	{
-		if ( LogManager::getInstance()->isDebug() ) {
-			LogManager::getInstance()->warning(LOGGER_CLASSNAME,
-				"Could not analyze path '%ls'",item->getPath().string().c_str());
+		if ( !commitBatch(job,batch,item->getPath().string()) ) {
+			return false;
 		}
 	}
 
-#endif
-
 	return !interrupted;
 }
 
-bool Indexer::indexProcess(IndexerJob *job,IndexerItem *item,DatabaseConnection *conn)
+uint64_t Indexer::indexItem(IndexerJob *job,IndexerItem *item,IndexerBatch *batch)
 {
-	bool interrupted = false;
+	DatabaseConnection *conn = batch->getConnection();
 
-	std::list<IndexerItem> &items = item->getItems();
-	for ( std::list<IndexerItem>::iterator iter=items.begin(); 
-		iter!=items.end(); iter++ )
+	uint64_t bytesRead = 0;
+
+	boost::filesystem::wpath boostPath = item->getPath();
+	std::wstring filePath = boostPath.string();
+
+	if ( LogManager::getInstance()->isDebug() ) {
+		LogManager::getInstance()->debug(LOGGER_CLASSNAME,"Indexing '%ls'",
+			filePath.c_str());
+	}
+
+	job->increaseUncommittedItems();
+
+	try
 	{
-		if ( m_thread.isInterrupted() ) {
-			interrupted = true;
-			break;
-		}
+		uint64_t existingId = 0;
+		uint64_t existingLastWriteTime = 0;
+		uint64_t existingSize = 0;
 
-		std::wstring filePath = iter->getPath().string();
-		std::wstring fileName = iter->getPath().leaf();
+		bool existingCoverMissing = false;
+		bool existingFingerprintMissing = false;
 
-		if ( LogManager::getInstance()->isDebug() ) {
-			LogManager::getInstance()->debug(LOGGER_CLASSNAME,"Indexing '%ls'",
-				filePath.c_str());
-		}
+		std::wstring existingName;
+		std::wstring existingPath;
 
-		try
-		{
-			uint64_t existingId = 0;
-			uint64_t existingLastWriteTime = 0;
+		std::wstringstream query;
+		query << "SELECT itemId,name,path,lastWriteTime,coverHash IS NULL,size,fingerprint IS NULL FROM main.[items]"
+			  << " WHERE shareId=" << job->getShareId()
+			  << " AND path='" << conn->quote(filePath) << "' LIMIT 1";
 
-			std::wstring existingName;
-			std::wstring existingPath;
+		// check if the item exists in the database
+		sqlite3x::sqlite3_command cmd(conn->getSqliteConn(),query.str());
+		sqlite3x::sqlite3_reader reader = cmd.executereader();
+		while ( reader.read() )
+		{
+			existingId = reader.getint64(0);
+			existingName = reader.getstring16(1);
+			existingPath = reader.getstring16(2);
+			existingLastWriteTime = reader.getint64(3);
+			existingCoverMissing = reader.getint(4)!=0;
+			existingSize = reader.getint64(5);
+			existingFingerprintMissing = reader.getint(6)!=0;
+		}
 
-			std::wstringstream query;
-			query << "SELECT itemId,name,path,lastWriteTime FROM [items]"
-				  << " WHERE shareId=" << job->getShareId()
-				  << " AND path='" << conn->quote(filePath) << "' LIMIT 1";
+		// a pending read would hold off the commits of other jobs
+		reader.close();
 
-			// check if the item exists in the database
-			sqlite3x::sqlite3_command cmd(conn->getSqliteConn(),query.str());
-			sqlite3x::sqlite3_reader reader = cmd.executereader();
-			while ( reader.read() )
-			{
-				existingId = reader.getint64(0);
-				existingName = reader.getstring16(1);
-				existingPath = reader.getstring16(2);
-				existingLastWriteTime = reader.getint64(3);
-			}
+		if ( existingId>0 )
+		{
+			item->setDbId(existingId);
 
-			if ( existingId>0 )
+			if ( job->isFullIndexing() )
 			{
-				iter->setDbId(existingId);
-
-				if ( job->isFullIndexing() )
+				try
 				{
-					try
+					uint64_t fileSize = 0;
+					time_t lastWriteTime = boost::filesystem::last_write_time(boostPath);
+					if ( !item->isDirectory() ) {
+						fileSize = boost::filesystem::file_size(boostPath);
+					}
+
+					// the metadata is only read again if the file has changed in size or time,
+					// but items indexed before covers were extracted are updated once
+					if ( existingLastWriteTime!=lastWriteTime || existingSize!=fileSize || existingCoverMissing ) 
 					{
-						uint64_t fileSize = 0;
-						time_t lastWriteTime = boost::filesystem::last_write_time(iter->getPath());
-						if ( !iter->isDirectory() ) {
-							fileSize = boost::filesystem::file_size(iter->getPath());
+						std::string fingerprint;
+						if ( !item->isDirectory() ) {
+							fingerprint = computeFingerprint(filePath,fileSize);
 						}
 
-						if ( existingLastWriteTime!=lastWriteTime ) {
-							updateItem(job,&*iter,lastWriteTime,fileSize,conn);
-						}
-						else if ( existingPath!=filePath ) {
-							updateItemPath(job,&*iter,conn);
+						updateItem(job,item,lastWriteTime,fileSize,fingerprint,batch);
+						if ( !item->isDirectory() ) {
+							job->increaseNewSize((int64_t)fileSize-(int64_t)existingSize);
 						}
 
-						if ( iter->isDirectory() ) {
-							job->increaseNewDirectories();
-						}
-						else {
-							job->increaseNewFiles();
-							job->increaseNewSize(fileSize);
-						}
-					}
-					catch(boost::filesystem::filesystem_error error) {
-						
+						bytesRead = fileSize;
 					}
-				}
-			}
-			else
-			{
-				try	
-				{
-					uint64_t fileSize = 0;
-					time_t lastWriteTime = boost::filesystem::last_write_time(iter->getPath());
-					if ( !iter->isDirectory() ) {
-						fileSize = boost::filesystem::file_size(iter->getPath());
+					else if ( existingPath!=filePath ) {
+						updateItemPath(job,item,batch);
 					}
-
-					if ( insertItem(job,&*iter,lastWriteTime,fileSize,conn) )
+					else 
 					{
-						if ( iter->isDirectory() ) {
-							job->increaseNewDirectories();
-						}
-						else {
-							job->increaseNewFiles();
-							job->increaseNewSize(fileSize);
+						updateItemGeneration(job,item,batch);
+
+						// items indexed before fingerprints were computed get one once
+						if ( existingFingerprintMissing && fileSize>0 ) 
+						{
+							std::string fingerprint = computeFingerprint(filePath,fileSize);
+							if ( !fingerprint.empty() ) {
+								updateItemFingerprint(item,fingerprint,batch);
+							}
 						}
 					}
 				}
 				catch(boost::filesystem::filesystem_error error) {
-						
+					
 				}
 			}
-
-			if ( iter->isDirectory() )
+		}
+		else
+		{
+			try	
 			{
-				job->increaseIndexedDirectories();
-				if ( !indexProcess(job,&*iter,conn) ) {
-					interrupted = true;
-					break;
+				uint64_t fileSize = 0;
+				time_t lastWriteTime = boost::filesystem::last_write_time(boostPath);
+				if ( !item->isDirectory() ) {
+					fileSize = boost::filesystem::file_size(boostPath);
+				}
+
+				std::string fingerprint;
+				uint64_t movedId = 0;
+
+				// a moved or renamed file is recognized by its content, without reading its metadata again
+				if ( !item->isDirectory() ) 
+				{
+					fingerprint = computeFingerprint(filePath,fileSize);
+					if ( !fingerprint.empty() ) {
+						movedId = findMovedItem(job,fingerprint,fileSize,batch);
+					}
+				}
+
+				if ( movedId>0 )
+				{
+					item->setDbId(movedId);
+					moveItem(job,item,lastWriteTime,batch);
+
+					bytesRead = fileSize<(uint64_t)FINGERPRINT_BLOCK_SIZE*2 ? fileSize : FINGERPRINT_BLOCK_SIZE*2;
+				}
+				else
+				{
+					insertItem(job,item,lastWriteTime,fileSize,fingerprint,batch);
+					if ( item->isDirectory() ) {
+						job->increaseNewDirectories();
+					}
+					else {
+						job->increaseNewFiles();
+						job->increaseNewSize(fileSize);
+					}
+
+					bytesRead = fileSize;
 				}
 			}
-			else {
-				job->increaseIndexedFiles();
+			catch(boost::filesystem::filesystem_error error) {
+					
 			}
 		}
-		catch(exception &ex) 
+	}
+	catch(exception &ex) 
+	{
+		if ( LogManager::getInstance()->isDebug() ) {
+			LogManager::getInstance()->debug(LOGGER_CLASSNAME,"Error while indexing item [%s]",ex.what());
+		}
+	}
+
+	return bytesRead;
+}
+
+bool Indexer::throttle(uint64_t bytes)
+{
+	ACE_UINT64 currentTime = 0;
+	ACE_High_Res_Timer::gettimeofday().to_usec(currentTime);
+
+	m_throttleMutex.acquire();
+
+	// the delay grows while streams wait too long for the disk and shrinks once they recover
+	if ( (int64_t)currentTime-m_backoffTime>=(int64_t)BACKOFF_INTERVAL*1000 )
+	{
+		uint64_t readLatency = StreamMonitor::getInstance()->getReadLatency();
+		if ( m_streamLatency>0 && readLatency>(uint64_t)m_streamLatency*1000 ) 
 		{
-			if ( LogManager::getInstance()->isDebug() ) {
-				LogManager::getInstance()->debug(LOGGER_CLASSNAME,"Error while indexing item [%s]",ex.what());
+			m_backoffDelay *= 2;
+			if ( m_backoffDelay<MIN_BACKOFF_DELAY ) {
+				m_backoffDelay = MIN_BACKOFF_DELAY;
 			}
+			else if ( m_backoffDelay>MAX_BACKOFF_DELAY ) {
+				m_backoffDelay = MAX_BACKOFF_DELAY;
+			}
+		}
+		else {
+			m_backoffDelay /= 2;
 		}
 
-		job->setCurrentPath(Util::ConvertUtil::toString(filePath));
-		setCurrentJob(*job);
+		m_backoffTime = currentTime;
 	}
 
-	return !interrupted;
+	// every item is given the next free slot within the pace limits
+	int64_t cost = 0;
+	if ( m_maxFilesPerSecond>0 ) {
+		cost = 1000000/m_maxFilesPerSecond;
+	}
+
+	if ( m_maxMegabytesPerSecond>0 ) 
+	{
+		int64_t byteCost = (int64_t)(bytes*1000000/((uint64_t)m_maxMegabytesPerSecond*1048576));
+		if ( byteCost>cost ) {
+			cost = byteCost;
+		}
+	}
+
+	// unused slots are only saved up for a short burst
+	int64_t slotTime = (int64_t)currentTime-(int64_t)PACE_BURST*1000;
+	if ( m_paceTime>slotTime ) {
+		slotTime = m_paceTime;
+	}
+
+	m_paceTime = slotTime+cost;
+
+	int64_t delay = (slotTime-(int64_t)currentTime)/1000+m_backoffDelay;
+
+	m_throttleMutex.release();
+
+	if ( delay<=0 ) {
+		return true;
+	}
+
+	return Thread::current()->sleep((unsigned int)delay);
 }
 
-bool Indexer::insertItem(IndexerJob *job,IndexerItem *item,time_t lastWriteTime,
-		uint64_t size,DatabaseConnection *conn)
+void Indexer::insertItem(IndexerJob *job,IndexerItem *item,time_t lastWriteTime,
+		uint64_t size,const std::string &fingerprint,IndexerBatch *batch)
 {
-	uint64_t parentItemId = 0;
-	if ( item->getParentItem()!=NULL ) {
-		parentItemId = item->getParentItem()->getDbId();
-	}
+	DatabaseConnection *conn = batch->getConnection();
+
+	std::string hashSource = Util::ConvertUtil::toString(boost::to_lower_copy(item->getPath().string()));
+	std::string hash = Util::CryptoUtil::md5Encode(hashSource.c_str(),hashSource.length());
+
+	// a moved item keeps the hash of its old path, so a new item at that path is given another one
+	for ( int salt=1; ; salt++ ) 
+	{
+		std::stringstream hashQuery;
+		hashQuery << "SELECT COUNT(*) FROM main.[items] WHERE hash='" << hash << "' AND shareId=" << job->getShareId();
+		if ( conn->getSqliteConn().executeint(hashQuery.str())==0 ) {
+			break;
+		}
 
-	std::string hash = Util::ConvertUtil::toString(boost::to_lower_copy(item->getPath().string()));
-	hash = Util::CryptoUtil::md5Encode(hash.c_str(),hash.length());
+		std::string saltedSource = hashSource + "#" + Util::ConvertUtil::toString(salt);
+		hash = Util::CryptoUtil::md5Encode(saltedSource.c_str(),saltedSource.length());
+	}
 
 	std::wstring metadataColumns;
 	std::wstring metadataValues;
 	std::map<std::string,std::wstring> metadata;
-	Indexer::getInstance()->readMetadata(item->getPath().string(),&metadata,NULL);
+	std::list<MetadataImage::Ptr> images;
+	Indexer::getInstance()->readMetadata(item->getPath().string(),&metadata,&images);
 	for ( std::map<std::string,std::wstring>::iterator iter=metadata.begin(); iter!=metadata.end(); iter++ ) {
 		metadataColumns += L"," + Util::ConvertUtil::toWideString(iter->first);
 		metadataValues += L",'" + conn->quote(iter->second) + L"'";
 	}
 
 	std::wstringstream query;
-	query << "INSERT INTO [items]"
-		  << " (shareId,parentItemId,name,hash,path,directory,directories,files,size,lastWriteTime" << metadataColumns << ")"
+	query << "INSERT INTO main.[items]"
+		  << " (shareId,parentItemId,name,hash,path,directory,directories,files,size,lastWriteTime,coverHash,generation,fingerprint" << metadataColumns << ")"
 		  << " VALUES ("
 		  << job->getShareId() << ","
-		  << parentItemId << ","
-		  << "'" << conn->quote(item->getPath().leaf()) << "',"
+		  << getParentItemId(job,item,conn) << ","
+		  << "'" << conn->quote(item->getName()) << "',"
 		  << "'" << Util::ConvertUtil::toWideString(hash) << "',"
 		  << "'" << conn->quote(item->getPath().string()) << "',"
 		  << item->isDirectory() << ","
 		  << item->getDirectories() << ","
 		  << item->getFiles() << ","
 		  << size << ","
-		  << lastWriteTime
+		  << lastWriteTime << ","
+		  << "'" << Util::ConvertUtil::toWideString(storeCover(item,images)) << "',"
+		  << job->getGeneration() << ","
+		  << (fingerprint.empty() ? L"NULL" : L"'" + Util::ConvertUtil::toWideString(fingerprint) + L"'")
 		  << metadataValues << ")";
 
-	try  {
-		conn->getSqliteConn().executenonquery(query.str());
-		item->setDbId(conn->getSqliteConn().insertid());
-	}
-	catch(exception &ex) {
-		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Failed to insert index item [%s]",ex.what());
-		return false;
-	}
-
-	return true;
+	batch->addQuery(query.str());
 }
 
-bool Indexer::updateItem(IndexerJob *job,IndexerItem *item,time_t lastWriteTime,
-		uint64_t size,DatabaseConnection *conn)
+void Indexer::updateItem(IndexerJob *job,IndexerItem *item,time_t lastWriteTime,
+		uint64_t size,const std::string &fingerprint,IndexerBatch *batch)
 {
+	DatabaseConnection *conn = batch->getConnection();
+
 	std::wstringstream query;
-	query << "UPDATE [items] SET "
-		  << "name='" << conn->quote(item->getPath().leaf()) << "',"
+	query << "UPDATE main.[items] SET "
+		  << "name='" << conn->quote(item->getName()) << "',"
 		  << "path='" << conn->quote(item->getPath().string()) << "',"
 		  << "directory=" << item->isDirectory() << ","
 		  << "directories=" << item->getDirectories() << ","
 		  << "files=" << item->getFiles() << ","
 		  << "size='" << size << "',"
-		  << "lastWriteTime='" << lastWriteTime << "'";
+		  << "lastWriteTime='" << lastWriteTime << "',"
+		  << "generation=" << job->getGeneration() << ","
+		  << "fingerprint=" << (fingerprint.empty() ? L"NULL" : L"'" + Util::ConvertUtil::toWideString(fingerprint) + L"'");
 
 	std::map<std::string,std::wstring> metadata;
-	Indexer::getInstance()->readMetadata(item->getPath().string(),&metadata,NULL);
+	std::list<MetadataImage::Ptr> images;
+	Indexer::getInstance()->readMetadata(item->getPath().string(),&metadata,&images);
+
+	query << ",coverHash='" << Util::ConvertUtil::toWideString(storeCover(item,images)) << "'";
+
 	for ( std::map<std::string,std::wstring>::iterator iter=metadata.begin(); iter!=metadata.end(); iter++ ) {
 		query << L"," << Util::ConvertUtil::toWideString(iter->first) << L"='" << conn->quote(iter->second) << L"'";
 	}
 
 	query << " WHERE shareId=" << job->getShareId() << " AND itemId=" << item->getDbId();
 
-	try {
-		conn->getSqliteConn().executenonquery(query.str());
+	batch->addQuery(query.str());
+}
+
+void Indexer::updateItemPath(IndexerJob *job,IndexerItem *item,IndexerBatch *batch)
+{
+	DatabaseConnection *conn = batch->getConnection();
+
+	std::wstringstream query;
+	query << "UPDATE main.[items] SET "
+		<< "name='" << conn->quote(item->getName()) << "',"
+		<< "path='" << conn->quote(item->getPath().string()) << "',"
+		<< "generation=" << job->getGeneration() << " "
+		<< "WHERE shareId=" << job->getShareId() << " AND itemId=" << item->getDbId();
+
+	batch->addQuery(query.str());
+}
+
+void Indexer::updateItemGeneration(IndexerJob *job,IndexerItem *item,IndexerBatch *batch)
+{
+	std::wstringstream query;
+	query << "UPDATE main.[items] SET generation=" << job->getGeneration()
+		  << " WHERE itemId=" << item->getDbId();
+
+	batch->addQuery(query.str());
+}
+
+void Indexer::updateItemFingerprint(IndexerItem *item,const std::string &fingerprint,IndexerBatch *batch)
+{
+	std::wstringstream query;
+	query << "UPDATE main.[items] SET fingerprint='" << Util::ConvertUtil::toWideString(fingerprint) << "'"
+		  << " WHERE itemId=" << item->getDbId();
+
+	batch->addQuery(query.str());
+}
+
+void Indexer::moveItem(IndexerJob *job,IndexerItem *item,time_t lastWriteTime,IndexerBatch *batch)
+{
+	DatabaseConnection *conn = batch->getConnection();
+
+	if ( LogManager::getInstance()->isDebug() ) {
+		LogManager::getInstance()->debug(LOGGER_CLASSNAME,"Moving item %s to '%ls'",
+			Util::ConvertUtil::toString(item->getDbId()).c_str(),item->getPath().string().c_str());
 	}
-	catch(exception &ex) {
-		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Failed to update index item [%s]",ex.what());
-		return false;
+
+	std::wstringstream query;
+	query << "UPDATE main.[items] SET "
+		  << "parentItemId=" << getParentItemId(job,item,conn) << ","
+		  << "name='" << conn->quote(item->getName()) << "',"
+		  << "path='" << conn->quote(item->getPath().string()) << "',"
+		  << "lastWriteTime='" << lastWriteTime << "',"
+		  << "generation=" << job->getGeneration()
+		  << " WHERE shareId=" << job->getShareId() << " AND itemId=" << item->getDbId();
+
+	batch->addQuery(query.str());
+}
+
+uint64_t Indexer::findMovedItem(IndexerJob *job,const std::string &fingerprint,
+	uint64_t size,IndexerBatch *batch)
+{
+	DatabaseConnection *conn = batch->getConnection();
+
+	std::map<uint64_t,std::wstring> candidates;
+
+	// items already seen by the job have been stamped with its generation
+	std::stringstream query;
+	query << "SELECT itemId,path FROM main.[items]"
+		  << " WHERE shareId=" << job->getShareId()
+		  << " AND fingerprint='" << fingerprint << "'"
+		  << " AND size=" << size
+		  << " AND directory=0"
+		  << " AND (generation IS NULL OR generation<>" << job->getGeneration() << ")";
+
+	sqlite3x::sqlite3_command cmd(conn->getSqliteConn(),query.str());
+	sqlite3x::sqlite3_reader reader = cmd.executereader();
+	while ( reader.read() ) {
+		candidates[reader.getint64(0)] = reader.getstring16(1);
 	}
 
-	return true;
+	reader.close();
+
+	for ( std::map<uint64_t,std::wstring>::iterator iter=candidates.begin(); iter!=candidates.end(); iter++ )
+	{
+		if ( batch->isMovedItem(iter->first) ) {
+			continue;
+		}
+
+		try 
+		{
+			if ( boost::filesystem::exists(boost::filesystem::wpath(iter->second)) ) {
+				continue;
+			}
+		}
+		catch(boost::filesystem::filesystem_error) {
+			continue;
+		}
+
+		batch->addMovedItem(iter->first);
+		return iter->first;
+	}
+
+	return 0;
 }
 
-bool Indexer::updateItemPath(IndexerJob *job,IndexerItem *item,DatabaseConnection *conn)
+std::wstring Indexer::getParentItemId(IndexerJob *job,IndexerItem *item,DatabaseConnection *conn)
 {
-	std::wstringstream query;
-	query << "UPDATE [items] SET "
-		<< "name='" << conn->quote(item->getPath().leaf()) << "',"
-		<< "path='" << conn->quote(item->getPath().string()) << "' "
-		<< "WHERE shareId=" << job->getShareId() << " AND itemId=" << item->getDbId();
+	// a parent inserted in the same batch has no database id yet, so it's looked up by path
+	std::wstringstream parentItemId;
+	const IndexerItem *parentItem = item->getParentItem();
+	if ( parentItem==NULL || parentItem->getParentItem()==NULL ) {
+		parentItemId << 0;
+	}
+	else if ( parentItem->getDbId()>0 ) {
+		parentItemId << parentItem->getDbId();
+	}
+	else {
+		parentItemId << "(SELECT itemId FROM main.[items] WHERE shareId=" << job->getShareId()
+					 << " AND path='" << conn->quote(parentItem->getPath().string()) << "' LIMIT 1)";
+	}
 
-	try {
-		conn->getSqliteConn().executenonquery(query.str());
+	return parentItemId.str();
+}
+
+std::string Indexer::computeFingerprint(const std::wstring &path,uint64_t size)
+{
+	if ( size==0 ) {
+		return "";
+	}
+
+	FILE *file = NULL;
+
+	#ifdef WIN32
+		file = _wfopen(path.c_str(),L"rb");
+	#else
+		file = fopen(Util::ConvertUtil::toString(path).c_str(),"rb");
+	#endif
+
+	if ( file==NULL ) {
+		return "";
+	}
+
+	bool success = false;
+	std::string data;
+
+	// small files are read whole, larger ones only at the head and tail
+	if ( size<=(uint64_t)FINGERPRINT_BLOCK_SIZE*2 ) 
+	{
+		data.resize((size_t)size);
+		success = fread(&data[0],sizeof(char),data.length(),file)==data.length();
+	}
+	else 
+	{
+		data.resize(FINGERPRINT_BLOCK_SIZE*2);
+		success = fread(&data[0],sizeof(char),FINGERPRINT_BLOCK_SIZE,file)==(size_t)FINGERPRINT_BLOCK_SIZE &&
+			fseek(file,-FINGERPRINT_BLOCK_SIZE,SEEK_END)==0 &&
+			fread(&data[FINGERPRINT_BLOCK_SIZE],sizeof(char),FINGERPRINT_BLOCK_SIZE,file)==(size_t)FINGERPRINT_BLOCK_SIZE;
+	}
+
+	fclose(file);
+
+	if ( !success ) {
+		return "";
+	}
+
+	return Util::CryptoUtil::md5Encode(data.c_str(),data.length());
+}
+
+std::string Indexer::storeCover(const IndexerItem *item,const std::list<MetadataImage::Ptr> &images)
+{
+	if ( item->isDirectory() ) {
+		return item->getCoverHash();
+	}
+
+	// front covers are read first, so the first image that can be stored is used
+	for ( std::list<MetadataImage::Ptr>::const_iterator iter=images.begin(); iter!=images.end(); iter++ ) 
+	{
+		std::string coverHash = m_coverCache.store((*iter)->getData(),(size_t)(*iter)->getSize());
+		if ( !coverHash.empty() ) {
+			return coverHash;
+		}
+	}
+
+	if ( item->getParentItem()!=NULL ) {
+		return item->getParentItem()->getCoverHash();
+	}
+
+	return "";
+}
+
+void Indexer::publishProgress(IndexerJob *job,const std::wstring &currentPath)
+{
+	uint64_t currentTime = ACE_High_Res_Timer::gettimeofday().msec();
+	if ( currentTime-job->getPublishTime()<(uint64_t)PUBLISH_INTERVAL ) {
+		return;
+	}
+
+	job->setCurrentPath(Util::ConvertUtil::toString(currentPath));
+	job->setPublishTime(currentTime);
+
+	setActiveJob(*job);
+}
+
+void Indexer::purgeCoverCache()
+{
+	std::set<std::string> coverHashes;
+
+	// the index database sees the items of all share databases
+	DatabaseConnection *conn = DatabaseManager::getInstance()->getConnection(DatabaseManager::DATABASE_INDEX);
+	if ( conn==NULL ) {
+		return;
+	}
+
+	bool success = false;
+
+	try
+	{
+		sqlite3x::sqlite3_command cmd(conn->getSqliteConn(),
+			"SELECT DISTINCT coverHash FROM [items] WHERE coverHash<>''");
+
+		sqlite3x::sqlite3_reader reader = cmd.executereader();
+		while ( reader.read() ) {
+			coverHashes.insert(reader.getstring(0));
+		}
+
+		success = true;
 	}
 	catch(exception &ex) {
-		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Failed to update index item path [%s]",ex.what());
-		return false;
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not read cover images [%s]",ex.what());
 	}
 
-	return true;
+	DatabaseManager::getInstance()->releaseConnection(conn);
+
+	if ( !success ) {
+		return;
+	}
+
+	int removedImages = m_coverCache.purge(coverHashes);
+	if ( removedImages>0 ) {
+		LogManager::getInstance()->info(LOGGER_CLASSNAME,"Removed %d unused cover images",removedImages);
+	}
 }
 
 void Indexer::on(ShareManagerListener::ShareAdded,const Share &share)
 {
+	if ( ConfigManager::getInstance()->getBool(ConfigManager::INDEXER_SHAREDATABASES) ) {
+		openShareDatabase(share.getDbId());
+	}
+
 	queue(IndexerJob(share.getDbId(),true));
 }
 
 void Indexer::on(ShareManagerListener::ShareRemoved,const Share &share)
 {
-	ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
-
 	// abort if currently being indexed
-	if ( m_currentJob.getShareId()==share.getDbId() ) {
-		abort();
-	}
+	m_mutex.acquire();
+	interruptJob(share.getDbId());
+	m_mutex.release();
 	
 	deleteDbEntry(share.getDbId());
 }
@@ -842,7 +2229,7 @@ void Indexer::on(ConfigManagerListener::Load)
 			boost::regex_constants::icase);
 
 		if ( metadataReaderName=="TagLibReader" ) {
-			metadataReader = new TagLibReader();
+			metadataReader = new TagLibReader(ConfigManager::getInstance()->getBool(ConfigManager::INDEXER_FASTMETADATA));
 		}
 
 		m_mappings.push_back(IndexerMapping(filePatternRegex,metadataReader));
@@ -22,6 +22,7 @@
 #include <boost/filesystem/path.hpp>
 
 #include "configmanager.h"
+#include "covercache.h"
 #include "databasemanager.h"
 #include "eventbroadcaster.h"
 #include "metadatareader.h"
@@ -44,13 +45,20 @@ public:
 	*/
 	IndexerJob() : m_analyzedDirectories(0),
 		m_analyzedFiles(0),
+		m_generation(0),
 		m_indexedDirectories(0),
 		m_indexedFiles(0),
 		m_fullIndexing(false),
 		m_newDirectories(0),
 		m_newFiles(0),
 		m_newSize(0),
-		m_startTime(0)
+		m_publishTime(0),
+		m_removedDirectories(0),
+		m_removedFiles(0),
+		m_remoteDevice(false),
+		m_removedSize(0),
+		m_startTime(0),
+		m_uncommittedItems(0)
 	{
 		m_state = IndexerJob::State::IDLE;
 	}
@@ -64,12 +72,19 @@ public:
 	*/
 	IndexerJob(uint64_t shareId,bool fullIndexing) : m_analyzedDirectories(0),
 		m_analyzedFiles(0),
+		m_generation(0),
 		m_indexedDirectories(0),
 		m_indexedFiles(0),
 		m_newDirectories(0),
 		m_newFiles(0),
 		m_newSize(0),
-		m_startTime(0)
+		m_publishTime(0),
+		m_removedDirectories(0),
+		m_removedFiles(0),
+		m_remoteDevice(false),
+		m_removedSize(0),
+		m_startTime(0),
+		m_uncommittedItems(0)
 	{
 		m_shareId = shareId;
 		m_fullIndexing = fullIndexing;
@@ -106,27 +121,72 @@ public:
 	}
 
 	/**
-	* Increase the number of new directories indexed during the process.
+	* Increase the number of new directories indexed since the last commit.
 	*/
 	void increaseNewDirectories() {
 		m_newDirectories++;
 	}
 
 	/**
-	* Increase the number of new files indexed during the process.
+	* Increase the number of new files indexed since the last commit.
 	*/
 	void increaseNewFiles() {
 		m_newFiles++;
 	}
 
 	/**
-	* Increase the total size of the new files indexed during the process.
-	* @param size the size to append
+	* Increase the total size of the files indexed since the last commit.
+	* @param size the size to append. Negative if an updated file has shrunk
 	*/
-	void increaseNewSize(uint64_t size) {
+	void increaseNewSize(int64_t size) {
 		m_newSize+=size;
 	}
 
+	/**
+	* Increase the number of directories removed from the index since the last commit.
+	* @param directories the number of removed directories
+	*/
+	void increaseRemovedDirectories(uint64_t directories) {
+		m_removedDirectories+=directories;
+	}
+
+	/**
+	* Increase the number of files removed from the index since the last commit.
+	* @param files the number of removed files
+	*/
+	void increaseRemovedFiles(uint64_t files) {
+		m_removedFiles+=files;
+	}
+
+	/**
+	* Increase the total size of the files removed from the index since the last commit.
+	* @param size the size to append
+	*/
+	void increaseRemovedSize(uint64_t size) {
+		m_removedSize+=size;
+	}
+
+	/**
+	* Increase the number of items written to the index since the last commit.
+	*/
+	void increaseUncommittedItems() {
+		m_uncommittedItems++;
+	}
+
+	/**
+	* Reset all counters of changes made to the index since the last commit.
+	* Should be called once the changes have been committed and applied to the share.
+	*/
+	void resetChanges() {
+		m_newDirectories = 0;
+		m_newFiles = 0;
+		m_newSize = 0;
+		m_removedDirectories = 0;
+		m_removedFiles = 0;
+		m_removedSize = 0;
+		m_uncommittedItems = 0;
+	}
+
 	/**
 	* Get the number of directories analyzed during the process.
 	* @return the number of directories analyzed during the process
@@ -151,6 +211,14 @@ public:
 		return m_currentPath;
 	}
 
+	/**
+	* Get the identifier of the device that the share of the process is stored on.
+	* @return the identifier of the device, or an empty string if unknown
+	*/
+	const std::string& getDevice() const {
+		return m_device;
+	}
+
 	/**
 	* Get the duration of the process up to the current time.
 	* @return the duration of the process
@@ -165,6 +233,14 @@ public:
 		}
 	}
 
+	/**
+	* Get the generation that items seen during the process are stamped with.
+	* @return the generation of the process
+	*/
+	const int64_t getGeneration() const {
+		return m_generation;
+	}
+
 	/**
 	* Get the number of directories indexed during the process.
 	* @return the number of directories indexed during the process
@@ -182,29 +258,70 @@ public:
 	}
 
 	/**
-	* Get the number of new directories indexed during the process.
-	* @return the number of new directories indexed during the process
+	* Get the number of new directories indexed since the last commit.
+	* @return the number of new directories indexed since the last commit
 	*/
 	const uint64_t getNewDirectories() const {
 		return m_newDirectories;
 	}
 
 	/**
-	* Get the number of new files indexed during the process.
-	* @return the number of new files indexed during the process
+	* Get the number of new files indexed since the last commit.
+	* @return the number of new files indexed since the last commit
 	*/
 	const uint64_t getNewFiles() const {
 		return m_newFiles;
 	}
 
 	/**
-	* Get the total size of the new files indexed during the process.
-	* @return the total size of the new files indexed during the process.
+	* Get the change in total size of the files indexed since the last commit.
+	* @return the change in total size of the files indexed since the last commit
 	*/
-	const uint64_t getNewSize() const {
+	const int64_t getNewSize() const {
 		return m_newSize;
 	}
 
+	/**
+	* Get the number of directories removed from the index since the last commit.
+	* @return the number of directories removed from the index since the last commit
+	*/
+	const uint64_t getRemovedDirectories() const {
+		return m_removedDirectories;
+	}
+
+	/**
+	* Get the number of files removed from the index since the last commit.
+	* @return the number of files removed from the index since the last commit
+	*/
+	const uint64_t getRemovedFiles() const {
+		return m_removedFiles;
+	}
+
+	/**
+	* Get the total size of the files removed from the index since the last commit.
+	* @return the total size of the files removed from the index since the last commit
+	*/
+	const uint64_t getRemovedSize() const {
+		return m_removedSize;
+	}
+
+	/**
+	* Get the time when the progress of the process was last published to readers.
+	* @return the time in milliseconds since the epoch
+	*/
+	const uint64_t getPublishTime() const {
+		return m_publishTime;
+	}
+
+	/**
+	* Get the names of the directories leading down to the checkpoint that the process resumes after.
+	* The first name is a directory in the root of the share. Empty if the process isn't resuming.
+	* @return the names of the directories leading down to the checkpoint
+	*/
+	std::list<std::wstring>& getResumePath() {
+		return m_resumePath;
+	}
+
 	/**
 	* Get the database id of the share used by the process.
 	* @return the database id of the share used by the process
@@ -213,6 +330,14 @@ public:
 		return m_shareId;
 	}
 
+	/**
+	* Get the number of items written to the index since the last commit.
+	* @return the number of items written to the index since the last commit
+	*/
+	const uint64_t getUncommittedItems() const {
+		return m_uncommittedItems;
+	}
+
 	/**
 	* Get the start time of the process.
 	* @return the start time of the process
@@ -237,6 +362,14 @@ public:
 		return m_fullIndexing;
 	}
 
+	/**
+	* Get whether the share of the process is stored on a network device.
+	* @return true if the share of the process is stored on a network device
+	*/
+	const bool isRemoteDevice() const {
+		return m_remoteDevice;
+	}
+
 	/**
 	* Set the path the process is currently working on.
 	* @param currentPath the path the process is currently working on.
@@ -245,6 +378,46 @@ public:
 		m_currentPath = currentPath;
 	}
 
+	/**
+	* Set the identifier of the device that the share of the process is stored on.
+	* @param device the identifier of the device
+	*/
+	void setDevice(const std::string &device) {
+		m_device = device;
+	}
+
+	/**
+	* Set whether the process does a full indexing.
+	* @param fullIndexing true if the process should do a full indexing
+	*/
+	void setFullIndexing(bool fullIndexing) {
+		m_fullIndexing = fullIndexing;
+	}
+
+	/**
+	* Set the generation that items seen during the process are stamped with.
+	* @param generation the generation of the process
+	*/
+	void setGeneration(int64_t generation) {
+		m_generation = generation;
+	}
+
+	/**
+	* Set the time when the progress of the process was last published to readers.
+	* @param publishTime the time in milliseconds since the epoch
+	*/
+	void setPublishTime(uint64_t publishTime) {
+		m_publishTime = publishTime;
+	}
+
+	/**
+	* Set whether the share of the process is stored on a network device.
+	* @param remoteDevice true if the share is stored on a network device
+	*/
+	void setRemoteDevice(bool remoteDevice) {
+		m_remoteDevice = remoteDevice;
+	}
+
 	/**
 	* Set the process state.
 	* @param processState the process state
@@ -264,42 +437,57 @@ public:
 private:
 	State m_state;
 
+	std::list<std::wstring> m_resumePath;
+
 	std::string m_currentPath;
+	std::string m_device;
 
 	time_t m_startTime;
 
+	int64_t m_generation;
+	int64_t m_newSize;
+
 	uint64_t m_analyzedDirectories;
 	uint64_t m_analyzedFiles;
 	uint64_t m_indexedDirectories;
 	uint64_t m_indexedFiles;
 	uint64_t m_newDirectories;
 	uint64_t m_newFiles;
-	uint64_t m_newSize;
+	uint64_t m_removedDirectories;
+	uint64_t m_removedFiles;
+	uint64_t m_publishTime;
+	uint64_t m_removedSize;
 	uint64_t m_shareId;
+	uint64_t m_uncommittedItems;
 
 	bool m_fullIndexing;
+	bool m_remoteDevice;
 };
 
 /**
 * IndexerItem.
 * Represents an item in a hierarchical structure of files and directories
-* currently being indexed by the indexing service.
+* currently being indexed by the indexing service. Only the name relative to 
+* the parent item is kept, and a directory only holds its children while they're
+* being indexed, so the memory used is bounded by the depth of the share 
+* rather than by its size.
 */
 class IndexerItem
 {
 public:
 	/**
 	* Constructor used for creating a new instance representing a file.
-	* @param path the path to the file or directory that this item represents.
+	* @param name the name of the file or directory that this item represents,
+	* or the full path if the item has no parent item
 	* @param directory whether the item is a directory or not
 	* @return instance
 	*/
-	IndexerItem(const boost::filesystem::wpath &path,bool directory) : m_dbId(0),
+	IndexerItem(const std::wstring &name,bool directory) : m_dbId(0),
 		m_directories(0),
 		m_files(0),
 		m_parentItem(NULL)
 	{
-		m_path = path;
+		m_name = name;
 		m_directory = directory;
 	}
 
@@ -322,6 +510,30 @@ public:
 		return &m_items.back();
 	}
 
+	/**
+	* Remove all children of the current item.
+	* The number of child directories and files is kept.
+	*/
+	void clearItems() {
+		m_items.clear();
+	}
+
+	/**
+	* Get the hash of the cover image of the current item in the cover cache.
+	* @return the hash of the cover image, or an empty string if the item has no cover
+	*/
+	const std::string& getCoverHash() const {
+		return m_coverHash;
+	}
+
+	/**
+	* Get the path of the cover image file found in the directory that this item represents.
+	* @return the path of the cover image file, or an empty string if none was found
+	*/
+	const std::wstring& getCoverPath() const {
+		return m_coverPath;
+	}
+
 	/**
 	* Get the database id of the current item.
 	* @return the database id of the current item
@@ -354,6 +566,14 @@ public:
 		return m_items;
 	}
 
+	/**
+	* Get the name of the file or directory that this item represents.
+	* @return the name of the file or directory that this item represents
+	*/
+	const std::wstring& getName() const {
+		return m_name;
+	}
+
 	/**
 	* Get the parent item.
 	* @return the parent item
@@ -364,10 +584,21 @@ public:
 
 	/**
 	* Get the path to the file or directory that this item represents.
+	* The path is built from the names of the item and all its parent items.
 	* @return the path of the file or directory that this item represents
 	*/
-	const boost::filesystem::wpath getPath() const {
-		return m_path;
+	const boost::filesystem::wpath getPath() const 
+	{
+		if ( m_parentItem==NULL ) {
+			return boost::filesystem::wpath(m_name,boost::filesystem::native);
+		}
+
+#ifdef WIN32
+		return boost::filesystem::wpath(m_parentItem->getPath().string()+L"\\"+m_name,
+			boost::filesystem::native);
+#else
+		return m_parentItem->getPath()/m_name;
+#endif
 	}
 
 	/**
@@ -378,6 +609,22 @@ public:
 		return m_directory;
 	}
 
+	/**
+	* Set the hash of the cover image of the current item in the cover cache.
+	* @param coverHash the hash of the cover image
+	*/
+	void setCoverHash(const std::string &coverHash) {
+		m_coverHash = coverHash;
+	}
+
+	/**
+	* Set the path of the cover image file found in the directory that this item represents.
+	* @param coverPath the path of the cover image file
+	*/
+	void setCoverPath(const std::wstring &coverPath) {
+		m_coverPath = coverPath;
+	}
+
 	/**
 	* Set the database id of the current item
 	* @param dbId the database id of the current item
@@ -386,7 +633,24 @@ public:
 		m_dbId = dbId;
 	}
 
+	/**
+	* Sort all children of the current item by name.
+	*/
+	void sortItems() {
+		m_items.sort(IndexerItem::compareName);
+	}
+
 private:
+	/**
+	* Compare two items by name.
+	* @param item1 the first item to compare
+	* @param item2 the second item to compare
+	* @return true if the name of the first item sorts before the name of the second item
+	*/
+	static bool compareName(const IndexerItem &item1,const IndexerItem &item2) {
+		return item1.getName()<item2.getName();
+	}
+
 	/**
 	* Set the parent item.
 	* @param set the parent item
@@ -399,7 +663,10 @@ private:
 
 	std::list<IndexerItem> m_items;
 
-	boost::filesystem::wpath m_path;
+	std::string m_coverHash;
+
+	std::wstring m_coverPath;
+	std::wstring m_name;
 
 	uint64_t m_dbId;
 	uint64_t m_directories;
@@ -450,6 +717,83 @@ private:
 	boost::wregex m_filePatternRegex;
 };
 
+/**
+* IndexerBatch.
+* Collects the changes that an indexer job makes to the index until they are committed.
+* The file system is walked without holding the write lock of the index database,
+* so that jobs on different devices are not held up by each other.
+*/
+class IndexerBatch
+{
+public:
+	/**
+	* Constructor used for creating a new instance.
+	* @param conn the connection used for reading the index while the batch is collected
+	* @return instance
+	*/
+	IndexerBatch(DatabaseConnection *conn) {
+		m_conn = conn;
+	}
+
+	/**
+	* Add a query to be executed when the batch is committed.
+	* @param query the query to add
+	*/
+	void addQuery(const std::wstring &query) {
+		m_queries.push_back(query);
+	}
+
+	/**
+	* Add an item that has been found at a new path.
+	* The item is not stamped with the generation of the job until the batch is 
+	* committed, so it must not be taken as moved by another item before then.
+	* @param itemId the database id of the moved item
+	*/
+	void addMovedItem(uint64_t itemId) {
+		m_movedItems.insert(itemId);
+	}
+
+	/**
+	* Check if an item has already been found at a new path by this batch.
+	* @param itemId the database id of the item
+	* @return true if the item has been moved by this batch
+	*/
+	bool isMovedItem(uint64_t itemId) const {
+		return m_movedItems.find(itemId)!=m_movedItems.end();
+	}
+
+	/**
+	* Remove all queries and moved items from the batch.
+	*/
+	void clearQueries() {
+		m_movedItems.clear();
+		m_queries.clear();
+	}
+
+	/**
+	* Get the connection used for reading the index.
+	* @return the connection used for reading the index
+	*/
+	DatabaseConnection* getConnection() {
+		return m_conn;
+	}
+
+	/**
+	* Get all queries of the batch, in the order that they were added.
+	* @return a collection of all queries
+	*/
+	const std::list<std::wstring>& getQueries() const {
+		return m_queries;
+	}
+
+private:
+	DatabaseConnection *m_conn;
+
+	std::list<std::wstring> m_queries;
+
+	std::set<uint64_t> m_movedItems;
+};
+
 /**
 * IndexerListener.
 * Abstract class containing event definitions for the Indexer class.
@@ -495,8 +839,18 @@ public:
 	* Default constructor.
 	* @return instance
 	*/
-	Indexer() : m_started(false),
-		m_thread(this)
+	Indexer() : m_backoffDelay(0),
+		m_backoffTime(0),
+		m_batchSize(0),
+		m_maxDeviceJobs(0),
+		m_maxFilesPerSecond(0),
+		m_maxJobs(0),
+		m_maxMegabytesPerSecond(0),
+		m_maxRemoteDeviceJobs(0),
+		m_paceTime(0),
+		m_purging(false),
+		m_started(false),
+		m_streamLatency(0)
 	{
 		ConfigManager::getInstance()->addListener(this);
 		ShareManager::getInstance()->addListener(this);
@@ -510,6 +864,15 @@ public:
 		ShareManager::getInstance()->removeListener(this);
 	}
 
+	static const int BACKOFF_INTERVAL;
+	static const int FINGERPRINT_BLOCK_SIZE;
+	static const int MAX_BACKOFF_DELAY;
+	static const int MAX_SHARE_DATABASES;
+	static const int MIN_BACKOFF_DELAY;
+	static const int PACE_BURST;
+	static const int PUBLISH_INTERVAL;
+	static const int SHARE_DATABASE_ID_BITS;
+
 	/**
 	* Initialize and prepare the indexer for usage.
 	* @return true if indexer was initialized successfully
@@ -529,10 +892,16 @@ public:
 	void stop();
 
 	/**
-	* Abort any ongoing indexing.
+	* Abort all ongoing indexing.
 	*/
 	void abort();
 
+	/**
+	* Abort any ongoing indexing of the given share.
+	* @param shareId the database id of the share
+	*/
+	void abort(uint64_t shareId);
+
 	/**
 	* @override
 	*/
@@ -556,12 +925,35 @@ public:
 		std::map<std::string,std::wstring> *metadata,std::list<MetadataImage::Ptr> *images);
 
 	/**
-	* Get the current job.
-	* @return the current job
+	* Verify the maintained aggregates of all shares against their indexed items
+	* and delete the indexes of shares that no longer exist.
+	* This scans the entire index and is meant to be run as a background task.
 	*/
-	const IndexerJob getCurrentJob() {
-		ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
-		return m_currentJob;
+	void verifyIndex();
+
+	/**
+	* Get the cache holding the cover images extracted during indexing.
+	* @return the cover cache
+	*/
+	CoverCache& getCoverCache() {
+		return m_coverCache;
+	}
+
+	/**
+	* Get all jobs that are currently being processed.
+	* Jobs of shares on different devices are processed concurrently.
+	* @return a collection of all active jobs
+	*/
+	std::list<IndexerJob> getActiveJobs();
+
+	/**
+	* Get the delay currently added after every indexed item
+	* since streams are waiting too long for the disk.
+	* @return the delay in milliseconds, or zero if the indexer isn't backing off
+	*/
+	const int getBackoffDelay() {
+		ACE_Guard<ACE_Mutex> guard(m_throttleMutex);
+		return m_backoffDelay;
 	}
 
 	/**
@@ -611,10 +1003,128 @@ private:
 	void deleteDbEntry(uint64_t shareId);
 
 	/**
-	* Pop the next job be processed from the queue.
-	* @return the job that should be processed or NULL if no job is queued for processing
+	* Make sure that the items table of an index database has all columns needed.
+	* @param databaseName the name of the index database
+	* @return true if the items table was prepared successfully
+	*/
+	bool prepareIndexTable(const std::string &databaseName);
+
+	/**
+	* Convert metadata columns of the items table that are stored as text to integers.
+	* The table is rebuilt with its indexes in a single transaction.
+	* @param conn the write locked connection to the index database
+	* @param columns the names of the columns to convert
+	*/
+	void retypeIndexColumns(DatabaseConnection *conn,const std::list<std::string> &columns);
+
+	/**
+	* Queue a job for every share with a checkpoint in the given index database.
+	* Checkpoints of shares that no longer exist are deleted.
+	* @param conn a write locked connection to the index database
+	*/
+	void loadCheckpoints(DatabaseConnection *conn);
+
+	/**
+	* Count the indexed directories, files and size of a share and correct its
+	* aggregates if they differ. The counts of the share are updated as well.
+	* @param shareId the database id of the share
+	* @return true if the aggregates were verified
+	*/
+	bool verifyAggregates(uint64_t shareId);
+
+	/**
+	* Open the databases of all shares that have their index in a database of their own.
+	* If share databases are enabled, the indexes of shares still in the main index database 
+	* are moved to databases of their own as well. Databases of unknown shares are logged 
+	* and left in place.
+	*/
+	void openShareDatabases();
+
+	/**
+	* Open or create the database that the index of the given share is kept in.
+	* The database is attached to the main index database, where its items are 
+	* merged with the items of all other shares. At most MAX_SHARE_DATABASES can be
+	* attached, and any shares beyond that are kept in the main index database.
+	* @param shareId the database id of the share
+	* @return true if the share database was opened
+	*/
+	bool openShareDatabase(uint64_t shareId);
+
+	/**
+	* Move the index of the given share from the main index database to its own database.
+	* @param shareId the database id of the share
+	*/
+	void moveToShareDatabase(uint64_t shareId);
+
+	/**
+	* Close the database of the given share and remove its file.
+	* A file still in use is marked and removed by the workers once it's released,
+	* or on the next startup if it's still in use at shutdown.
+	* @param shareId the database id of the share
+	* @param databaseName the name of the share database
+	*/
+	void closeShareDatabase(uint64_t shareId,const std::string &databaseName);
+
+	/**
+	* Remove the database of the given share and its file.
+	* @param shareId the database id of the share
+	* @param databaseName the name of the share database
+	* @return false if the database is still in use or its file couldn't be removed
+	*/
+	bool removeShareDatabase(uint64_t shareId,const std::string &databaseName);
+
+	/**
+	* Retry removing the share databases that were still in use when closed.
+	*/
+	void removeShareDatabases();
+
+	/**
+	* Get the name of the database that the index of the given share is kept in.
+	* @param shareId the database id of the share
+	* @return the name of the share database, or the main index database
+	*/
+	std::string getIndexDatabase(uint64_t shareId);
+
+	/**
+	* Get the path to the file of the database of the given share.
+	* @param shareId the database id of the share
+	* @return the path to the share database file
+	*/
+	static std::string getShareDatabasePath(uint64_t shareId);
+
+	/**
+	* Pop the next job be processed from the queue and make it active.
+	* Jobs are skipped while their device has as many active jobs as allowed.
+	* @param thread the worker thread that will process the job
+	* @return the job that should be processed or NULL if no job can be processed
 	*/
-	IndexerJob* popQueue();
+	IndexerJob* popQueue(Thread *thread);
+
+	/**
+	* Queue a full indexing of all shares that are due to be auto indexed
+	* and that are not already queued or being indexed.
+	*/
+	void queueSharesToIndex();
+
+	/**
+	* Find the device that the given path is stored on and set it on the job.
+	* Partitions sharing a physical disk are seen as separate devices.
+	* @param path the path of the share
+	* @param job the job to set the device on
+	*/
+	static void resolveDevice(const std::string &path,IndexerJob *job);
+
+	/**
+	* Interrupt the worker processing a job for the given share, if any.
+	* The mutex must be held by the caller.
+	* @param shareId the database id of the share
+	*/
+	void interruptJob(uint64_t shareId);
+
+	/**
+	* Notify all worker threads that the queue has changed.
+	*/
+	void notifyWorkers();
 
 	/**
 	* Index the given job.
@@ -623,88 +1133,248 @@ private:
 	void index(IndexerJob *job);
 
 	/**
-	* Validate any existing indexed items in the database
+	* Read the checkpoint left by an earlier indexing of the share that never completed.
+	* If one is found the job resumes after it, keeping the generation of the earlier
+	* indexing. Otherwise the job is given a new generation.
 	* @param job the indexer job currently being processed
+	* @param rootPath the path of the root directory of the share
 	* @param conn the connection to the index database
-	* @return false if the process was interrupted
+	* @return false if the checkpoint or generation could not be read
+	*/
+	bool readCheckpoint(IndexerJob *job,const std::wstring &rootPath,DatabaseConnection *conn);
+
+	/**
+	* Commit the current batch of the job and apply its changes to the share counters.
+	* The write lock of the index database is held only while the batch is written.
+	* When a full indexing completes, all items not seen are deleted in the same commit.
+	* @param job the indexer job currently being processed
+	* @param batch the batch to commit
+	* @param checkpointPath the path of the last completed directory that the job
+	* should resume after if interrupted, or an empty string if the job has completed
+	* @return false if the batch could not be committed
 	*/
-	bool validateProcess(IndexerJob *job,DatabaseConnection *conn,
-		const boost::wregex &filePatternRegex,bool includeHidden);
+	bool commitBatch(IndexerJob *job,IndexerBatch *batch,const std::wstring &checkpointPath);
 
 	/**
-	* Find and analyze all items.
+	* Delete all items of the share that were not seen during a full indexing.
+	* Every item that still exists has been stamped with the generation of the job,
+	* so removed files, and files no longer matching the file pattern, are left behind.
+	* @param job the indexer job currently being processed
+	* @param conn the connection to the index database
+	*/
+	void deleteUnseenItems(IndexerJob *job,DatabaseConnection *conn);
+
+	/**
+	* Find and analyze all items in the directory of the given item.
+	* Subdirectories are not descended into.
 	* @param job the indexer job currently being processed
 	* @param item the index item to analyze and append all found items to
 	* @param filePatternRegex the file pattern regular expression
+	* @param coverPatternRegex the regular expression matching cover image file names,
+	* or an empty expression if cover image files should not be looked for
 	* @param includeHidden whether hidden files should be included in the indexing
 	* @return false if the process was interrupted
 	*/
-	bool analyzeProcess(IndexerJob *job,IndexerItem *item,
-		const boost::wregex &filePatternRegex,bool includeHidden);
+	bool analyzeProcess(IndexerJob *job,IndexerItem *item,const boost::wregex &filePatternRegex,
+		const boost::wregex &coverPatternRegex,bool includeHidden);
 
 	/**
-	* Index all the found items.
+	* Analyze and index the directory of the given item, then descend into its subdirectories.
+	* Each directory is written to the database as soon as it has been analyzed, and its
+	* children are released once they have been indexed. Children are walked in name order,
+	* and a batch is committed after each directory once enough items are pending.
 	* @param job the indexer job currently being processed
-	* @param item the index item to analyze and append all found items to
-	* @param conn the connection to the index database
+	* @param item the index item of the directory to index
+	* @param filePatternRegex the file pattern regular expression
+	* @param coverPatternRegex the regular expression matching cover image file names,
+	* or an empty expression if cover image files should not be looked for
+	* @param includeHidden whether hidden files should be included in the indexing
+	* @param batch the batch collecting the changes of the job
 	* @return false if the process was interrupted
 	*/
-	bool indexProcess(IndexerJob *job,IndexerItem *item,DatabaseConnection *conn);
+	bool indexProcess(IndexerJob *job,IndexerItem *item,const boost::wregex &filePatternRegex,
+		const boost::wregex &coverPatternRegex,bool includeHidden,IndexerBatch *batch);
 
 	/**
-	* Insert the given item into the database.
-	* If successfull this method will set the items database id.
+	* Insert or update the database entry for a single item.
+	* @param job the indexer job currently being processed
+	* @param item the item to index
+	* @param batch the batch collecting the changes of the job
+	* @return the size of the file if it was opened to read its metadata, otherwise zero
+	*/
+	uint64_t indexItem(IndexerJob *job,IndexerItem *item,IndexerBatch *batch);
+
+	/**
+	* Pace the current worker thread after an item has been indexed.
+	* The pace is held within the configured files and megabytes per second of
+	* all workers together. While any stream has waited longer than the configured
+	* latency for the disk, a delay that doubles until the streams recover is added.
+	* @param bytes the number of bytes read while indexing the item
+	* @return false if the thread was interrupted while waiting
+	*/
+	bool throttle(uint64_t bytes);
+
+	/**
+	* Add the insertion of the given item to the batch.
 	* @param job the indexer job currently being processed
 	* @param item the item to insert into the database
 	* @param lastWriteTime the last time the item was modified
 	* @param size the file size of the item
-	* @param conn the connection to the index database
-	* @
-	* @return true if the item was inserted succesfully
+	* @param fingerprint the content fingerprint of the item, or an empty string
+	* @param batch the batch collecting the changes of the job
 	*/
-	bool insertItem(IndexerJob *job,IndexerItem *item,time_t lastWriteTime,
-		uint64_t size,DatabaseConnection *conn);
+	void insertItem(IndexerJob *job,IndexerItem *item,time_t lastWriteTime,
+		uint64_t size,const std::string &fingerprint,IndexerBatch *batch);
 
 	/**
-	* Update the given item in the database.
+	* Add the update of the given item to the batch.
 	* @param job the indexer job currently being processed
 	* @param item the item to update in the database
 	* @param lastWriteTime the last time the item was modified
 	* @param size the file size of the item
-	* @param conn the connection to the index database
-	* @return true if the item was updated successfully
+	* @param fingerprint the content fingerprint of the item, or an empty string
+	* @param batch the batch collecting the changes of the job
+	*/
+	void updateItem(IndexerJob *job,IndexerItem *item,time_t lastWriteTime,
+		uint64_t size,const std::string &fingerprint,IndexerBatch *batch);
+
+	/**
+	* Add the move of an existing item to the path of the given item to the batch.
+	* The metadata, cover and hash of the moved item are kept, so that links to it 
+	* such as playlist items still resolve.
+	* @param job the indexer job currently being processed
+	* @param item the item found at the new path, with the database id of the moved item
+	* @param lastWriteTime the last time the item was modified
+	* @param batch the batch collecting the changes of the job
+	*/
+	void moveItem(IndexerJob *job,IndexerItem *item,time_t lastWriteTime,IndexerBatch *batch);
+
+	/**
+	* Find an indexed file that has the same content as a file at a new path
+	* and that no longer exists at its own path, in which case it has been moved
+	* or renamed. Files still at their own path have been copied.
+	* @param job the indexer job currently being processed
+	* @param fingerprint the content fingerprint of the file at the new path
+	* @param size the size of the file at the new path
+	* @param batch the batch collecting the changes of the job
+	* @return the database id of the moved item, or zero if no moved item was found
 	*/
-	bool updateItem(IndexerJob *job,IndexerItem *item,time_t lastWriteTime,
-		uint64_t size,DatabaseConnection *conn);
+	uint64_t findMovedItem(IndexerJob *job,const std::string &fingerprint,
+		uint64_t size,IndexerBatch *batch);
 
 	/**
-	* Update the given item path and file name in the database.
+	* Add the update of the given item path and file name to the batch.
 	* @param job the indexer job currently being processed
 	* @param item the item to update in the database
-	* @param conn the connection to the index database
-	* @return true if the item was updated successfully
+	* @param batch the batch collecting the changes of the job
+	*/
+	void updateItemPath(IndexerJob *job,IndexerItem *item,IndexerBatch *batch);
+
+	/**
+	* Add the stamping of an unchanged item with the generation of the job to the batch.
+	* @param job the indexer job currently being processed
+	* @param item the item to stamp
+	* @param batch the batch collecting the changes of the job
+	*/
+	void updateItemGeneration(IndexerJob *job,IndexerItem *item,IndexerBatch *batch);
+
+	/**
+	* Add the fingerprint of an unchanged item indexed before fingerprints were computed to the batch.
+	* @param item the item to update
+	* @param fingerprint the content fingerprint of the item
+	* @param batch the batch collecting the changes of the job
+	*/
+	void updateItemFingerprint(IndexerItem *item,const std::string &fingerprint,IndexerBatch *batch);
+
+	/**
+	* Get the database id of the parent of the given item as an sql expression.
+	* A parent inserted in the same batch has no database id yet, so it's looked up by path.
+	* @param job the indexer job currently being processed
+	* @param item the item to get the parent database id for
+	* @param conn the connection used for quoting
+	* @return the parent database id, or a sub query selecting it
+	*/
+	static std::wstring getParentItemId(IndexerJob *job,IndexerItem *item,DatabaseConnection *conn);
+
+	/**
+	* Compute the content fingerprint of a file, which is a hash of its first and
+	* last FINGERPRINT_BLOCK_SIZE bytes. Together with the file size it identifies
+	* a file after it has been moved or renamed without reading all of it.
+	* @param path the path to the file
+	* @param size the size of the file
+	* @return the fingerprint, or an empty string if the file is empty or couldn't be read
+	*/
+	static std::string computeFingerprint(const std::wstring &path,uint64_t size);
+
+	/**
+	* Store the cover image of the given item in the cover cache.
+	* Embedded images take precedence over a cover image file in the same directory.
+	* @param item the item to store the cover image for
+	* @param images the images embedded in the item
+	* @return the hash of the cover image, or an empty string if the item has no cover
 	*/
-	bool updateItemPath(IndexerJob *job,IndexerItem *item,DatabaseConnection *conn);
+	std::string storeCover(const IndexerItem *item,const std::list<MetadataImage::Ptr> &images);
 
 	/**
-	* Set the current job.
-	* @param currentJob the current job
+	* Remove all images from the cover cache that are no longer referenced by any indexed item.
 	*/
-	void setCurrentJob(const IndexerJob &currentJob) {
+	void purgeCoverCache();
+
+	/**
+	* Publish the progress of the job processed by the current worker thread.
+	* Publishing copies the job under the lock that readers of the active jobs
+	* take, so it's done at most once every PUBLISH_INTERVAL milliseconds.
+	* @param job the job processed by the current worker thread
+	* @param currentPath the path the job is currently working on
+	*/
+	void publishProgress(IndexerJob *job,const std::wstring &currentPath);
+
+	/**
+	* Set the job processed by the current worker thread.
+	* @param activeJob the job processed by the current worker thread
+	*/
+	void setActiveJob(const IndexerJob &activeJob) {
 		ACE_Write_Guard<ACE_Mutex> guard(m_mutex);
-		m_currentJob = currentJob;
+		m_activeJobs[Thread::current()] = activeJob;
 	}
 
-	ACE_Mutex m_mutex;
+	/**
+	* Remove the job processed by the current worker thread.
+	*/
+	void removeActiveJob() {
+		ACE_Write_Guard<ACE_Mutex> guard(m_mutex);
+		m_activeJobs.erase(Thread::current());
+	}
 
-	Thread m_thread;
+	ACE_Mutex m_mutex;
+	ACE_Mutex m_throttleMutex;
 
-	IndexerJob m_currentJob;
+	CoverCache m_coverCache;
 
 	std::list<IndexerMapping> m_mappings;
 
 	std::list<IndexerJob> m_queue;
 
+	std::list<Thread*> m_workers;
+
+	std::map<Thread*,IndexerJob> m_activeJobs;
+
+	std::map<uint64_t,std::string> m_removedShareDatabases;
+	std::map<uint64_t,std::string> m_shareDatabases;
+
+	int64_t m_backoffTime;
+	int64_t m_paceTime;
+
+	int m_backoffDelay;
+	int m_batchSize;
+	int m_maxDeviceJobs;
+	int m_maxFilesPerSecond;
+	int m_maxJobs;
+	int m_maxMegabytesPerSecond;
+	int m_maxRemoteDeviceJobs;
+	int m_streamLatency;
+
+	bool m_purging;
 	bool m_started;
 };
 
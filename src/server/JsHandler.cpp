@@ -20,9 +20,11 @@
 
 #define LOGGER_CLASSNAME "JsHandler"
 
+#include "httpserver.h"
 #include "logmanager.h"
 
 const std::string JsHandler::DEFAULT_MIME_TYPE = "text/html;charset=utf-8";
+const std::string JsHandler::NAME = "JsHandler";
 
 bool JsHandler::init() 
 {
@@ -48,9 +50,7 @@ bool JsHandler::handleRequest(HttpWorker *worker,
 		// disable client cache
 		if ( !httpRequest.getParameter("allowcaching",NULL) )
 		{
-			tm localTime;
-			Util::TimeUtil::getLocalTime(&localTime);
-			std::string modifiedTime = Util::TimeUtil::format(localTime,"%a, %d %b %Y %H:%M:%S GMT");
+			std::string modifiedTime = Util::TimeUtil::formatHttpDate(Util::TimeUtil::getCalendarTime());
 
 			httpResponse.setHeader("Cache-Control","no-store,no-cache,must-revalidate,max-age=0");
 			httpResponse.setHeader("Pragma","no-cache");
@@ -61,12 +61,20 @@ bool JsHandler::handleRequest(HttpWorker *worker,
 		httpResponse.setContentType(DEFAULT_MIME_TYPE);
 		httpResponse.setHeader("Connection","close");
 
+		// compress the script output if the client accepts it
+		HttpCompression &compression = HttpServer::getInstance()->getCompression();
+		httpResponse.setCompression(&compression,compression.negotiateEncoding(httpRequest));
+
 		// run script file through engine
+		int scriptSpan = httpRequest.getTrace().beginSpan("executeScript");
 		if ( !m_engine.executeFile(file,httpRequest,httpResponse) ) {
 			httpResponse.setStatusCode(HttpResponse::HttpStatus::HTTP_INTERNAL_SERVER_ERROR);
 		}
+		httpRequest.getTrace().endSpan(scriptSpan);
 
-		httpResponse.flush();
+		int finishSpan = httpRequest.getTrace().beginSpan("finish");
+		httpResponse.finish();
+		httpRequest.getTrace().endSpan(finishSpan);
 		
 		fclose(file);
 
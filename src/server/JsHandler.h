@@ -40,6 +40,7 @@ public:
 	}
 
 	static const std::string DEFAULT_MIME_TYPE;
+	static const std::string NAME;
 
 	/**
 	 * @override
@@ -56,6 +57,14 @@ public:
 	 */
 	virtual bool handleRequest(HttpWorker *worker,
 		HttpServerRequest &httpRequest,HttpServerResponse &httpResponse);
+
+	/**
+	 * @override
+	 */
+	virtual const std::string& getName() const {
+		return NAME;
+	}
+
 private:
 	Engine m_engine;
 };
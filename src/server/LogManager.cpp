@@ -18,6 +18,117 @@
 #include "common.h"
 #include "logmanager.h"
 
+const int LogManager::BATCH_SIZE = 256;
+const int LogManager::FLUSH_INTERVAL = 1000;
+
+bool LogManager::start()
+{
+	if ( m_started ) {
+		return false;
+	}
+
+	m_maxQueueSize = ConfigManager::getInstance()->getInt(ConfigManager::LOGMANAGER_MAXQUEUESIZE);
+	if ( m_maxQueueSize<1 ) {
+		m_maxQueueSize = 1;
+	}
+
+	if ( !m_thread.start() ) {
+		return false;
+	}
+
+	m_queueMutex.acquire();
+	m_started = true;
+	m_queueMutex.release();
+
+	return true;
+}
+
+void LogManager::stop()
+{
+	m_queueMutex.acquire();
+
+	if ( !m_started ) {
+		m_queueMutex.release();
+		return;
+	}
+
+	// any callers waiting for room in the queue will write directly
+	m_started = false;
+	m_queueCondition.broadcast();
+	m_queueMutex.release();
+
+	m_thread.cancel();
+	m_thread.join();
+
+	// write anything queued after the writer made its last pass
+	flushQueue();
+}
+
+void LogManager::run()
+{
+	while ( !m_thread.isCancelled() )
+	{
+		m_thread.wait(FLUSH_INTERVAL);
+		flushQueue();
+	}
+}
+
+bool LogManager::write(const std::string &path,const std::string &line,time_t calendarTime,bool drop)
+{
+	QueuedLine queuedLine;
+	queuedLine.line = line;
+	queuedLine.path = path;
+	queuedLine.calendarTime = calendarTime;
+
+	m_queueMutex.acquire();
+
+	while ( m_started && m_queue.size()>=(size_t)m_maxQueueSize )
+	{
+		if ( drop ) {
+			m_droppedLines++;
+			m_queueMutex.release();
+			return false;
+		}
+
+		// wait until the writer has taken the queue
+		m_queueCondition.wait();
+	}
+
+	if ( m_started )
+	{
+		m_queue.push_back(queuedLine);
+		bool notifyWriter = m_queue.size()==(size_t)BATCH_SIZE;
+		m_queueMutex.release();
+
+		if ( notifyWriter ) {
+			m_thread.notify();
+		}
+
+		return true;
+	}
+
+	m_queueMutex.release();
+
+	// no writer is running, write the line directly
+	std::vector<QueuedLine> lines;
+	lines.push_back(queuedLine);
+	writeLines(lines);
+
+	return true;
+}
+
+const uint64_t LogManager::getDroppedLines()
+{
+	ACE_Guard<ACE_Mutex> guard(m_queueMutex);
+	return m_droppedLines;
+}
+
+const size_t LogManager::getQueueSize()
+{
+	ACE_Guard<ACE_Mutex> guard(m_queueMutex);
+	return m_queue.size();
+}
+
 void LogManager::debug(const std::string &source,const char *fmt,...)
 {
 	if ( !m_debug ) {
@@ -60,42 +171,106 @@ void LogManager::warning(const std::string &source,const char *fmt,...)
 
 void LogManager::log(const LogEntry &logEntry)
 {
-	m_mutex.acquire();
-
 	tm localTime;
 	Util::TimeUtil::getLocalTime(logEntry.getCreationTime(),&localTime);
 
 	std::string formattedLocalTime = Util::TimeUtil::format(localTime,"%Y-%m-%d %H:%M:%S");
-	std::string formattedPath = Util::TimeUtil::format(localTime,m_path.c_str());
 
-	std::fstream fs(formattedPath.c_str(),std::ios::out | std::ios::app);
-	if ( fs.is_open() )
+	std::stringstream line;
+
+	switch ( logEntry.getLevel() )
+	{
+		case LogManager::LogLevel::DEBUG: 
+			line << "DEBUG\t";
+		break;
+
+		case LogManager::LogLevel::INFO: 
+			line << "INFO\t";
+		break;
+
+		case LogManager::LogLevel::WARNING: 
+			line << "WARNING\t";
+		break;
+	}
+
+	line << "[" << formattedLocalTime << "]";
+	line << " " << logEntry.getSource() << " - " << logEntry.getMessage();
+
+	// log messages are never dropped, callers wait for room in the queue instead
+	write(m_path,line.str(),logEntry.getCreationTime(),false);
+
+	fireEvent(LogManagerListener::Log(),logEntry);
+}
+
+void LogManager::flushQueue()
+{
+	std::vector<QueuedLine> lines;
+
+	m_queueMutex.acquire();
+	lines.swap(m_queue);
+	m_queueCondition.broadcast();
+	m_queueMutex.release();
+
+	if ( !lines.empty() ) {
+		writeLines(lines);
+	}
+}
+
+void LogManager::writeLines(const std::vector<QueuedLine> &lines)
+{
+	ACE_Guard<ProfiledMutex> guard(m_mutex);
+
+	std::vector<QueuedLine>::const_iterator iter;
+	for ( iter=lines.begin(); iter!=lines.end(); iter++ )
 	{
-		switch ( logEntry.getLevel() )
+		OpenFile &openFile = m_files[iter->path];
+
+		// the path only has to be formatted again when the time has changed
+		if ( openFile.file==NULL || openFile.lastTime!=iter->calendarTime )
 		{
-			case LogManager::LogLevel::DEBUG: 
-				fs << "DEBUG\t";
-			break;
+			tm localTime;
+			Util::TimeUtil::getLocalTime(iter->calendarTime,&localTime);
+			std::string formattedPath = Util::TimeUtil::format(localTime,iter->path.c_str());
 
-			case LogManager::LogLevel::INFO: 
-				fs << "INFO\t";
-			break;
+			if ( openFile.file==NULL || openFile.formattedPath!=formattedPath ) 
+			{
+				if ( openFile.file!=NULL ) {
+					fclose(openFile.file);
+				}
 
-			case LogManager::LogLevel::WARNING: 
-				fs << "WARNING\t";
-			break;
+				openFile.file = fopen(formattedPath.c_str(),"ab");
+				openFile.formattedPath = formattedPath;
+			}
+
+			openFile.lastTime = iter->calendarTime;
 		}
 
-		fs << "[" << formattedLocalTime << "]";
-		fs << " " << logEntry.getSource() << " - " << logEntry.getMessage();
-		fs << "\r\n";
+		if ( openFile.file!=NULL ) {
+			fwrite(iter->line.c_str(),sizeof(char),iter->line.length(),openFile.file);
+			fwrite("\r\n",sizeof(char),2,openFile.file);
+		}
+	}
 
-		fs.close();
+	std::map<std::string,OpenFile>::iterator fileIter;
+	for ( fileIter=m_files.begin(); fileIter!=m_files.end(); fileIter++ ) {
+		if ( fileIter->second.file!=NULL ) {
+			fflush(fileIter->second.file);
+		}
 	}
+}
 
-	m_mutex.release();
+void LogManager::closeFiles()
+{
+	ACE_Guard<ProfiledMutex> guard(m_mutex);
 
-	fireEvent(LogManagerListener::Log(),logEntry);
+	std::map<std::string,OpenFile>::iterator iter;
+	for ( iter=m_files.begin(); iter!=m_files.end(); iter++ ) {
+		if ( iter->second.file!=NULL ) {
+			fclose(iter->second.file);
+		}
+	}
+
+	m_files.clear();
 }
 
 void LogManager::on(ConfigManagerListener::Load)
@@ -22,7 +22,10 @@
 
 #include "configmanager.h"
 #include "eventbroadcaster.h"
+#include "profiledmutex.h"
+#include "runnable.h"
 #include "singleton.h"
+#include "thread.h"
 
 class LogEntry; // forward declaration
 class LogManagerListener; // forward declaration
@@ -30,11 +33,15 @@ class LogManagerListener; // forward declaration
 /**
 * LogManager.
 * Singleton class that manages logging.
+* Lines are queued and written in batches by a background thread that keeps
+* the log files open. Until the log manager has been started, and after it has
+* been stopped, lines are written directly by the calling thread instead.
 * This class should probably replaced by log4cxx or a similar library.
 */
 class LogManager : public Singleton<LogManager>,
 				   public EventBroadcaster<LogManagerListener>,
-				   public ConfigManagerListener
+				   public ConfigManagerListener,
+				   public Runnable
 {
 public:
 	enum LogLevel 
@@ -48,7 +55,14 @@ public:
 	* Default constructor.
 	* @return instance
 	*/
-	LogManager() : m_debug(false) {
+	LogManager() : m_debug(false),
+		m_droppedLines(0),
+		m_maxQueueSize(0),
+		m_mutex("LogManager"),
+		m_queueCondition(m_queueMutex),
+		m_started(false),
+		m_thread(this)
+	{
 		ConfigManager::getInstance()->addListener(this);
 	}
 
@@ -56,8 +70,31 @@ public:
 	* Destructor.
 	*/
 	~LogManager() {
+		stop();
+		closeFiles();
+
 		ConfigManager::getInstance()->removeListener(this);
 	}
+
+	static const int BATCH_SIZE;
+	static const int FLUSH_INTERVAL;
+
+	/**
+	* Start the background writer.
+	* @return true if the background writer was successfully started
+	*/
+	bool start();
+
+	/**
+	* Stop the background writer.
+	* Any queued lines are written before this method returns.
+	*/
+	void stop();
+
+	/**
+	* @override
+	*/
+	virtual void run();
 	
 	/**
 	* Add a debug entry to the log.
@@ -80,6 +117,31 @@ public:
 	*/
 	void warning(const std::string &source,const char *fmt,...);
 
+	/**
+	* Write a line to a log file.
+	* The line is queued for the background writer if it's running.
+	* @param path the path of the log file.
+	* The path can include any format specifiers supported by strftime()
+	* @param line the line to write, without any line break
+	* @param calendarTime the time used for formatting the path
+	* @param drop true if the line should be dropped when the queue is full,
+	* false if the caller should wait until the writer has made room in the queue
+	* @return true if the line was written or queued, false if it was dropped
+	*/
+	bool write(const std::string &path,const std::string &line,time_t calendarTime,bool drop);
+
+	/**
+	* Get the number of lines that has been dropped because the queue was full.
+	* @return the number of dropped lines
+	*/
+	const uint64_t getDroppedLines();
+
+	/**
+	* Get the number of lines waiting to be written.
+	* @return the number of queued lines
+	*/
+	const size_t getQueueSize();
+
 	/**
 	* Get whether the log manager is in debug mode.
 	* @return true of the log manager is in debug mode
@@ -107,11 +169,73 @@ private:
 	*/
 	void log(const LogEntry &logEntry);
 
-	ACE_Mutex m_mutex;
+	/**
+	* A line waiting to be written.
+	*/
+	struct QueuedLine
+	{
+		std::string line;
+		std::string path;
+
+		time_t calendarTime;
+	};
+
+	/**
+	* A log file kept open by the writer.
+	*/
+	struct OpenFile
+	{
+		OpenFile() : file(NULL),
+			lastTime(0)
+		{
+
+		}
+
+		std::string formattedPath;
+
+		FILE *file;
+
+		time_t lastTime;
+	};
+
+	/**
+	* Take all queued lines and write them.
+	*/
+	void flushQueue();
+
+	/**
+	* Write lines to their log files.
+	* A log file is reopened when its formatted path changes, which rotates
+	* the file when the date is part of the path.
+	* @param lines the lines to write
+	*/
+	void writeLines(const std::vector<QueuedLine> &lines);
+
+	/**
+	* Close all open log files.
+	*/
+	void closeFiles();
+
+	ProfiledMutex m_mutex;
+
+	ACE_Mutex m_queueMutex;
+
+	ACE_Condition<ACE_Mutex> m_queueCondition;
+
+	Thread m_thread;
+
+	std::map<std::string,OpenFile> m_files;
+
+	std::vector<QueuedLine> m_queue;
 
 	std::string m_path;
 
+	uint64_t m_droppedLines;
+
+	int m_maxQueueSize;
+
 	bool m_debug;
+	bool m_started;
 };
 
 /**
@@ -27,6 +27,12 @@
 class MetadataReader
 {
 public:
+	enum FieldType
+	{
+		FIELD_INTEGER,
+		FIELD_TEXT
+	};
+
 	/**
 	* Extract metadata from the given file.
 	* Subclasses must override this method.
@@ -45,8 +51,36 @@ public:
 		return m_fieldNames;
 	}
 
+	/**
+	* Get the type of a field, which decides how the field is stored and sorted.
+	* @param name the name of the field
+	* @return the type of the field
+	*/
+	FieldType getFieldType(const std::string &name) const 
+	{
+		std::map<std::string,FieldType>::const_iterator iter = m_fieldTypes.find(name);
+		if ( iter!=m_fieldTypes.end() ) {
+			return iter->second;
+		}
+
+		return FIELD_TEXT;
+	}
+
 protected:
+	/**
+	* Add a field that this metadata reader can extract.
+	* @param name the name of the field
+	* @param type the type of the field
+	*/
+	void addField(const std::string &name,FieldType type) 
+	{
+		m_fieldNames.push_back(name);
+		m_fieldTypes[name] = type;
+	}
+
 	std::list<std::string> m_fieldNames;
+
+	std::map<std::string,FieldType> m_fieldTypes;
 };
 
 #endif
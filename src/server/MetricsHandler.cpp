@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "metricshandler.h"
+
+#define LOGGER_CLASSNAME "MetricsHandler"
+
+#include "httpserver.h"
+#include "indexer.h"
+#include "logmanager.h"
+#include "metricsmanager.h"
+#include "profiledmutex.h"
+#include "streammonitor.h"
+#include "taskrunner.h"
+
+const std::string MetricsHandler::DEFAULT_MIME_TYPE = "text/plain; version=0.0.4";
+const std::string MetricsHandler::NAME = "MetricsHandler";
+
+bool MetricsHandler::handleRequest(HttpWorker *worker,
+	HttpServerRequest &httpRequest,HttpServerResponse &httpResponse)
+{
+	if ( LogManager::getInstance()->isDebug() ) {
+		LogManager::getInstance()->debug(LOGGER_CLASSNAME,"Handling \"%s\"",httpRequest.getUri().c_str());
+	}
+
+	// make sure client is authenticated
+	if ( httpRequest.getSession()==NULL ) {
+		httpResponse.setStatusCode(HttpResponse::HttpStatus::HTTP_UNAUTHORIZED);
+		return false;
+	}
+
+	// the metrics expose server internals, so only admins may read them
+	if ( !httpRequest.getUser()->isRoleAdmin() ) {
+		httpResponse.setStatusCode(HttpResponse::HttpStatus::HTTP_FORBIDDEN);
+		return false;
+	}
+
+	Metrics metrics = MetricsManager::getInstance()->collect();
+
+	std::stringstream out;
+
+	// requests per handler and status code
+	writeHeader(out,"vibestreamer_http_requests_total","counter","Number of handled requests.");
+	std::map<std::string,RequestMetrics>::const_iterator iter;
+	for ( iter=metrics.getRequests().begin(); iter!=metrics.getRequests().end(); iter++ )
+	{
+		std::map<int,uint64_t>::const_iterator codeIter;
+		for ( codeIter=iter->second.getStatusCodes().begin(); codeIter!=iter->second.getStatusCodes().end(); codeIter++ ) {
+			out << "vibestreamer_http_requests_total{handler=\"" << iter->first << "\",code=\"" << codeIter->first << "\"} "
+				<< Util::ConvertUtil::toString(codeIter->second) << "\n";
+		}
+	}
+
+	// request latency per handler
+	writeHeader(out,"vibestreamer_http_request_duration_seconds","histogram","Time spent handling requests.");
+	for ( iter=metrics.getRequests().begin(); iter!=metrics.getRequests().end(); iter++ )
+	{
+		for ( int i=0; i<RequestMetrics::BUCKET_COUNT; i++ ) {
+			out << "vibestreamer_http_request_duration_seconds_bucket{handler=\"" << iter->first << "\","
+				<< "le=\"" << formatSeconds(RequestMetrics::BUCKET_BOUNDS[i]) << "\"} "
+				<< Util::ConvertUtil::toString(iter->second.getBucket(i)) << "\n";
+		}
+
+		out << "vibestreamer_http_request_duration_seconds_bucket{handler=\"" << iter->first << "\",le=\"+Inf\"} "
+			<< Util::ConvertUtil::toString(iter->second.getCount()) << "\n";
+		out << "vibestreamer_http_request_duration_seconds_sum{handler=\"" << iter->first << "\"} "
+			<< formatSeconds(iter->second.getDuration()) << "\n";
+		out << "vibestreamer_http_request_duration_seconds_count{handler=\"" << iter->first << "\"} "
+			<< Util::ConvertUtil::toString(iter->second.getCount()) << "\n";
+	}
+
+	writeHeader(out,"vibestreamer_http_sent_bytes_total","counter","Number of bytes sent to clients.");
+	out << "vibestreamer_http_sent_bytes_total " << Util::ConvertUtil::toString(metrics.getBytesSent()) << "\n";
+
+	// connector
+	HttpConnector &connector = HttpServer::getInstance()->getConnector();
+
+	writeHeader(out,"vibestreamer_http_idle_workers","gauge","Number of workers waiting for a client.");
+	out << "vibestreamer_http_idle_workers " << connector.getIdleWorkerCount() << "\n";
+
+	writeHeader(out,"vibestreamer_http_queued_clients","gauge","Number of clients waiting for a worker.");
+	out << "vibestreamer_http_queued_clients " << connector.getQueuedClientCount() << "\n";
+
+	writeHeader(out,"vibestreamer_http_sessions","gauge","Number of connected sessions.");
+	out << "vibestreamer_http_sessions " << HttpServer::getInstance()->getSessionManager().getSessionCount() << "\n";
+
+	// streams
+	writeHeader(out,"vibestreamer_streams","gauge","Number of streams being sent to clients.");
+	out << "vibestreamer_streams " << StreamMonitor::getInstance()->getActiveStreams() << "\n";
+
+	writeHeader(out,"vibestreamer_stream_read_seconds","gauge","Slowest disk read made by any stream during the last second.");
+	out << "vibestreamer_stream_read_seconds " << formatSeconds(StreamMonitor::getInstance()->getReadLatency()) << "\n";
+
+	// database
+	writeHeader(out,"vibestreamer_database_connections_opened_total","counter","Number of database connections opened since no pooled connection was available.");
+	out << "vibestreamer_database_connections_opened_total " << Util::ConvertUtil::toString(metrics.getDatabaseConnections()) << "\n";
+
+	writeHeader(out,"vibestreamer_database_lock_waits_total","counter","Number of database write locks acquired.");
+	out << "vibestreamer_database_lock_waits_total " << Util::ConvertUtil::toString(metrics.getDatabaseWaits()) << "\n";
+
+	writeHeader(out,"vibestreamer_database_lock_wait_seconds_total","counter","Time spent waiting for database write locks.");
+	out << "vibestreamer_database_lock_wait_seconds_total " << formatSeconds(metrics.getDatabaseWaitTime()) << "\n";
+
+	// indexer
+	std::list<IndexerJob> activeJobs = Indexer::getInstance()->getActiveJobs();
+
+	int filesPerSecond = 0;
+	for ( std::list<IndexerJob>::iterator jobIter=activeJobs.begin(); jobIter!=activeJobs.end(); jobIter++ ) {
+		if ( jobIter->getState()!=IndexerJob::State::IDLE && jobIter->getDuration()>0 ) {
+			filesPerSecond += (int)((jobIter->getAnalyzedFiles()+jobIter->getIndexedFiles())/jobIter->getDuration());
+		}
+	}
+
+	writeHeader(out,"vibestreamer_indexer_active_jobs","gauge","Number of indexer jobs currently being processed.");
+	out << "vibestreamer_indexer_active_jobs " << activeJobs.size() << "\n";
+
+	writeHeader(out,"vibestreamer_indexer_files_per_second","gauge","Number of files processed per second by all active indexer jobs.");
+	out << "vibestreamer_indexer_files_per_second " << filesPerSecond << "\n";
+
+	writeHeader(out,"vibestreamer_indexer_backoff_seconds","gauge","Delay added after every indexed item while streams wait for the disk.");
+	out << "vibestreamer_indexer_backoff_seconds " << formatSeconds((uint64_t)Indexer::getInstance()->getBackoffDelay()*1000) << "\n";
+
+	// task runner
+	writeHeader(out,"vibestreamer_taskrunner_queued_tasks","gauge","Number of tasks queued in the task runner.");
+	out << "vibestreamer_taskrunner_queued_tasks " << TaskRunner::getInstance()->getQueueSize() << "\n";
+
+	// script engine
+	writeHeader(out,"vibestreamer_js_gc_total","counter","Number of script engine garbage collections.");
+	out << "vibestreamer_js_gc_total " << Util::ConvertUtil::toString(metrics.getGcCount()) << "\n";
+
+	writeHeader(out,"vibestreamer_js_gc_seconds_total","counter","Time spent in script engine garbage collections.");
+	out << "vibestreamer_js_gc_seconds_total " << formatSeconds(metrics.getGcTime()) << "\n";
+
+	// locks
+	std::map<std::string,LockStatistics> locks = ProfiledLock::collect();
+	std::map<std::string,LockStatistics>::const_iterator lockIter;
+
+	writeHeader(out,"vibestreamer_lock_acquisitions_total","counter","Number of times a lock was acquired.");
+	for ( lockIter=locks.begin(); lockIter!=locks.end(); lockIter++ ) {
+		out << "vibestreamer_lock_acquisitions_total{lock=\"" << lockIter->first << "\"} " 
+			<< Util::ConvertUtil::toString(lockIter->second.getAcquisitions()) << "\n";
+	}
+
+	writeHeader(out,"vibestreamer_lock_contentions_total","counter","Number of lock acquisitions that had to wait for another thread.");
+	for ( lockIter=locks.begin(); lockIter!=locks.end(); lockIter++ ) {
+		out << "vibestreamer_lock_contentions_total{lock=\"" << lockIter->first << "\"} " 
+			<< Util::ConvertUtil::toString(lockIter->second.getContentions()) << "\n";
+	}
+
+	writeHeader(out,"vibestreamer_lock_wait_seconds","histogram","Time spent waiting for locks.");
+	for ( lockIter=locks.begin(); lockIter!=locks.end(); lockIter++ )
+	{
+		for ( int i=0; i<LockStatistics::BUCKET_COUNT; i++ ) {
+			out << "vibestreamer_lock_wait_seconds_bucket{lock=\"" << lockIter->first << "\","
+				<< "le=\"" << formatSeconds(LockStatistics::BUCKET_BOUNDS[i]) << "\"} "
+				<< Util::ConvertUtil::toString(lockIter->second.getBucket(i)) << "\n";
+		}
+
+		out << "vibestreamer_lock_wait_seconds_bucket{lock=\"" << lockIter->first << "\",le=\"+Inf\"} "
+			<< Util::ConvertUtil::toString(lockIter->second.getAcquisitions()) << "\n";
+		out << "vibestreamer_lock_wait_seconds_sum{lock=\"" << lockIter->first << "\"} "
+			<< formatSeconds(lockIter->second.getWaitTime()) << "\n";
+		out << "vibestreamer_lock_wait_seconds_count{lock=\"" << lockIter->first << "\"} "
+			<< Util::ConvertUtil::toString(lockIter->second.getAcquisitions()) << "\n";
+	}
+
+	writeHeader(out,"vibestreamer_lock_wait_seconds_max","gauge","Longest time spent waiting for a lock.");
+	for ( lockIter=locks.begin(); lockIter!=locks.end(); lockIter++ ) {
+		out << "vibestreamer_lock_wait_seconds_max{lock=\"" << lockIter->first << "\"} " 
+			<< formatSeconds(lockIter->second.getMaxWaitTime()) << "\n";
+	}
+
+	writeHeader(out,"vibestreamer_lock_hold_seconds_total","counter","Time locks were held exclusively.");
+	for ( lockIter=locks.begin(); lockIter!=locks.end(); lockIter++ ) {
+		out << "vibestreamer_lock_hold_seconds_total{lock=\"" << lockIter->first << "\"} " 
+			<< formatSeconds(lockIter->second.getHoldTime()) << "\n";
+	}
+
+	writeHeader(out,"vibestreamer_lock_hold_seconds_max","gauge","Longest time a lock was held exclusively.");
+	for ( lockIter=locks.begin(); lockIter!=locks.end(); lockIter++ ) {
+		out << "vibestreamer_lock_hold_seconds_max{lock=\"" << lockIter->first << "\"} " 
+			<< formatSeconds(lockIter->second.getMaxHoldTime()) << "\n";
+	}
+
+	std::string body = out.str();
+
+	httpResponse.setContentType(DEFAULT_MIME_TYPE);
+	httpResponse.setHeader("Cache-Control","no-store,no-cache,must-revalidate,max-age=0");
+	httpResponse.setHeader("Connection","close");
+
+	HttpCompression &compression = HttpServer::getInstance()->getCompression();
+	httpResponse.setCompression(&compression,compression.negotiateEncoding(httpRequest));
+
+	httpResponse.write(body.c_str(),body.length());
+	httpResponse.finish();
+
+	return true;
+}
+
+void MetricsHandler::writeHeader(std::stringstream &out,const std::string &name,
+	const std::string &type,const std::string &help)
+{
+	out << "# HELP " << name << " " << help << "\n";
+	out << "# TYPE " << name << " " << type << "\n";
+}
+
+std::string MetricsHandler::formatSeconds(uint64_t duration)
+{
+	char buffer[32];
+	sprintf(buffer,"%.6f",(double)(int64_t)duration/1000000.0);
+	return buffer;
+}
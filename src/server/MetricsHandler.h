@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef guard_metricshandler_h
+#define guard_metricshandler_h
+
+#include "httprequesthandler.h"
+
+/**
+* MetricsHandler.
+* Handles requests for the server metrics, 
+* written in the Prometheus text exposition format.
+* Only users with admin privileges may read the metrics.
+*/
+class MetricsHandler : public HttpRequestHandler
+{
+public:
+	/**
+	 * Constructor.
+	 * @param urlPatternRegex the url pattern regular expression
+	 * @return instance
+	 */
+	MetricsHandler(boost::regex urlPatternRegex) {
+		m_urlPatternRegex = urlPatternRegex;
+	}
+
+	static const std::string DEFAULT_MIME_TYPE;
+	static const std::string NAME;
+
+	/**
+	* @override
+	*/
+	virtual bool init() { return true; }
+
+	/**
+	* @override
+	*/
+	virtual void cleanup() {}
+
+	/**
+	* @override
+	*/
+	virtual bool handleRequest(HttpWorker *worker,
+		HttpServerRequest &httpRequest,HttpServerResponse &httpResponse);
+
+	/**
+	* @override
+	*/
+	virtual const std::string& getName() const {
+		return NAME;
+	}
+
+private:
+	/**
+	* Write the description and type of a metric.
+	* @param out the stream to write to
+	* @param name the name of the metric
+	* @param type the type of the metric
+	* @param help the description of the metric
+	*/
+	static void writeHeader(std::stringstream &out,const std::string &name,
+		const std::string &type,const std::string &help);
+
+	/**
+	* Format a duration in microseconds as seconds.
+	* @param duration the duration in microseconds
+	* @return the formatted duration in seconds
+	*/
+	static std::string formatSeconds(uint64_t duration);
+};
+
+#endif
@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "metricsmanager.h"
+
+const int RequestMetrics::BUCKET_COUNT = 12;
+
+const uint64_t RequestMetrics::BUCKET_BOUNDS[] = {
+	5000,
+	10000,
+	25000,
+	50000,
+	100000,
+	250000,
+	500000,
+	1000000,
+	2500000,
+	5000000,
+	10000000,
+	30000000
+};
+
+void RequestMetrics::add(int statusCode,uint64_t duration)
+{
+	m_count++;
+	m_duration += duration;
+	m_statusCodes[statusCode]++;
+
+	// requests slower than the last bound are only part of the total count
+	for ( int i=0; i<BUCKET_COUNT; i++ ) {
+		if ( duration<=BUCKET_BOUNDS[i] ) {
+			m_buckets[i]++;
+			break;
+		}
+	}
+}
+
+void RequestMetrics::merge(const RequestMetrics &requestMetrics)
+{
+	m_count += requestMetrics.m_count;
+	m_duration += requestMetrics.m_duration;
+
+	for ( int i=0; i<BUCKET_COUNT; i++ ) {
+		m_buckets[i] += requestMetrics.m_buckets[i];
+	}
+
+	std::map<int,uint64_t>::const_iterator iter;
+	for ( iter=requestMetrics.m_statusCodes.begin(); iter!=requestMetrics.m_statusCodes.end(); iter++ ) {
+		m_statusCodes[iter->first] += iter->second;
+	}
+}
+
+void Metrics::merge(const Metrics &metrics)
+{
+	m_bytesSent += metrics.m_bytesSent;
+	m_databaseConnections += metrics.m_databaseConnections;
+	m_databaseWaitTime += metrics.m_databaseWaitTime;
+	m_databaseWaits += metrics.m_databaseWaits;
+	m_gcCount += metrics.m_gcCount;
+	m_gcTime += metrics.m_gcTime;
+
+	std::map<std::string,RequestMetrics>::const_iterator iter;
+	for ( iter=metrics.m_requests.begin(); iter!=metrics.m_requests.end(); iter++ ) {
+		m_requests[iter->first].merge(iter->second);
+	}
+}
+
+MetricsManager::~MetricsManager()
+{
+	ACE_Guard<ACE_Mutex> guard(m_mutex);
+
+	while ( !m_threadMetrics.empty() ) {
+		delete m_threadMetrics.back();
+		m_threadMetrics.pop_back();
+	}
+}
+
+void MetricsManager::addRequest(const std::string &handlerName,int statusCode,uint64_t duration,uint64_t bytesSent)
+{
+	ThreadMetrics *threadMetrics = getThreadMetrics();
+
+	ACE_Guard<ACE_Mutex> guard(threadMetrics->m_mutex);
+	threadMetrics->m_metrics.m_requests[handlerName].add(statusCode,duration);
+	threadMetrics->m_metrics.m_bytesSent += bytesSent;
+}
+
+void MetricsManager::addDatabaseConnection()
+{
+	ThreadMetrics *threadMetrics = getThreadMetrics();
+
+	ACE_Guard<ACE_Mutex> guard(threadMetrics->m_mutex);
+	threadMetrics->m_metrics.m_databaseConnections++;
+}
+
+void MetricsManager::addDatabaseWait(uint64_t waitTime)
+{
+	ThreadMetrics *threadMetrics = getThreadMetrics();
+
+	ACE_Guard<ACE_Mutex> guard(threadMetrics->m_mutex);
+	threadMetrics->m_metrics.m_databaseWaits++;
+	threadMetrics->m_metrics.m_databaseWaitTime += waitTime;
+}
+
+void MetricsManager::addGc(uint64_t gcTime)
+{
+	ThreadMetrics *threadMetrics = getThreadMetrics();
+
+	ACE_Guard<ACE_Mutex> guard(threadMetrics->m_mutex);
+	threadMetrics->m_metrics.m_gcCount++;
+	threadMetrics->m_metrics.m_gcTime += gcTime;
+}
+
+Metrics MetricsManager::collect()
+{
+	Metrics metrics;
+
+	ACE_Guard<ACE_Mutex> guard(m_mutex);
+
+	std::list<ThreadMetrics*>::iterator iter;
+	for ( iter=m_threadMetrics.begin(); iter!=m_threadMetrics.end(); iter++ ) {
+		ACE_Guard<ACE_Mutex> threadGuard((*iter)->m_mutex);
+		metrics.merge((*iter)->m_metrics);
+	}
+
+	return metrics;
+}
+
+ThreadMetrics* MetricsManager::getThreadMetrics()
+{
+	ThreadMetrics *threadMetrics = m_tss->getThreadMetrics();
+	if ( threadMetrics==NULL ) 
+	{
+		// the metrics are kept when the thread exits, so that
+		// nothing recorded is lost from the collected totals
+		threadMetrics = new ThreadMetrics();
+		m_tss->setThreadMetrics(threadMetrics);
+
+		ACE_Guard<ACE_Mutex> guard(m_mutex);
+		m_threadMetrics.push_back(threadMetrics);
+	}
+
+	return threadMetrics;
+}
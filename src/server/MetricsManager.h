@@ -0,0 +1,318 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef guard_metricsmanager_h
+#define guard_metricsmanager_h
+
+#include <ace/synch.h>
+#include <ace/tss_t.h>
+
+#include "singleton.h"
+
+/**
+* RequestMetrics.
+* Class representing the request count and latency histogram of a request handler.
+*/
+class RequestMetrics
+{
+public:
+	/**
+	* Default constructor.
+	* @return instance
+	*/
+	RequestMetrics() : m_buckets(BUCKET_COUNT,0),
+		m_count(0),
+		m_duration(0)
+	{
+
+	}
+
+	static const int BUCKET_COUNT;
+
+	static const uint64_t BUCKET_BOUNDS[];
+
+	/**
+	* Add a handled request.
+	* @param statusCode the status code of the response
+	* @param duration the time it took to handle the request, in microseconds
+	*/
+	void add(int statusCode,uint64_t duration);
+
+	/**
+	* Add the given metrics to these metrics.
+	* @param requestMetrics the metrics to add
+	*/
+	void merge(const RequestMetrics &requestMetrics);
+
+	/**
+	* Get the number of requests that were handled within the bucket bound at the given index.
+	* The counts are cumulative, so every bucket includes the requests of the buckets before it.
+	* @param index the bucket index
+	* @return the number of requests handled within the bucket bound
+	*/
+	const uint64_t getBucket(int index) const {
+		uint64_t count = 0;
+		for ( int i=0; i<=index; i++ ) {
+			count += m_buckets[i];
+		}
+
+		return count;
+	}
+
+	/**
+	* Get the number of handled requests.
+	* @return the number of handled requests
+	*/
+	const uint64_t getCount() const {
+		return m_count;
+	}
+
+	/**
+	* Get the total time spent handling requests, in microseconds.
+	* @return the total time spent handling requests
+	*/
+	const uint64_t getDuration() const {
+		return m_duration;
+	}
+
+	/**
+	* Get the number of handled requests per response status code.
+	* @return the number of handled requests per response status code
+	*/
+	const std::map<int,uint64_t>& getStatusCodes() const {
+		return m_statusCodes;
+	}
+
+private:
+	std::map<int,uint64_t> m_statusCodes;
+
+	std::vector<uint64_t> m_buckets;
+
+	uint64_t m_count;
+	uint64_t m_duration;
+};
+
+/**
+* Metrics.
+* Class representing counters recorded by the server.
+*/
+class Metrics
+{
+public:
+	/**
+	* Default constructor.
+	* @return instance
+	*/
+	Metrics() : m_bytesSent(0),
+		m_databaseConnections(0),
+		m_databaseWaitTime(0),
+		m_databaseWaits(0),
+		m_gcCount(0),
+		m_gcTime(0)
+	{
+
+	}
+
+	/**
+	* Add the given metrics to these metrics.
+	* @param metrics the metrics to add
+	*/
+	void merge(const Metrics &metrics);
+
+	/**
+	* Get the number of bytes sent to clients.
+	* @return the number of bytes sent to clients
+	*/
+	const uint64_t getBytesSent() const {
+		return m_bytesSent;
+	}
+
+	/**
+	* Get the number of database connections that had to be opened
+	* since no pooled connection was available.
+	* @return the number of database connections opened
+	*/
+	const uint64_t getDatabaseConnections() const {
+		return m_databaseConnections;
+	}
+
+	/**
+	* Get the total time spent waiting for database write locks, in microseconds.
+	* @return the total time spent waiting for database write locks
+	*/
+	const uint64_t getDatabaseWaitTime() const {
+		return m_databaseWaitTime;
+	}
+
+	/**
+	* Get the number of database write locks acquired.
+	* @return the number of database write locks acquired
+	*/
+	const uint64_t getDatabaseWaits() const {
+		return m_databaseWaits;
+	}
+
+	/**
+	* Get the number of script engine garbage collections.
+	* @return the number of script engine garbage collections
+	*/
+	const uint64_t getGcCount() const {
+		return m_gcCount;
+	}
+
+	/**
+	* Get the total time spent in script engine garbage collections, in microseconds.
+	* @return the total time spent in script engine garbage collections
+	*/
+	const uint64_t getGcTime() const {
+		return m_gcTime;
+	}
+
+	/**
+	* Get the request metrics per request handler name.
+	* @return the request metrics per request handler name
+	*/
+	const std::map<std::string,RequestMetrics>& getRequests() const {
+		return m_requests;
+	}
+
+private:
+	friend class MetricsManager;
+
+	std::map<std::string,RequestMetrics> m_requests;
+
+	uint64_t m_bytesSent;
+	uint64_t m_databaseConnections;
+	uint64_t m_databaseWaitTime;
+	uint64_t m_databaseWaits;
+	uint64_t m_gcCount;
+	uint64_t m_gcTime;
+};
+
+/**
+* ThreadMetrics.
+* Metrics recorded by a single thread.
+* Only the owning thread updates the metrics, so the lock is 
+* uncontended except for while the metrics are being collected.
+*/
+class ThreadMetrics
+{
+public:
+	ACE_Mutex m_mutex;
+
+	Metrics m_metrics;
+};
+
+/**
+* MetricsStorage.
+* Thread specific storage class used for storing a pointer
+* to the metrics recorded by the current thread.
+*/
+class MetricsStorage
+{
+public:
+	/**
+	* Default construtor.
+	* @return instance
+	*/
+	MetricsStorage() : m_threadMetrics(NULL) {
+
+	}
+
+	/**
+	* Get the metrics recorded by the thread.
+	* @return the metrics recorded by the thread
+	*/
+	ThreadMetrics* getThreadMetrics() {
+		return m_threadMetrics;
+	}
+
+	/**
+	* Set the metrics recorded by the thread.
+	* @param threadMetrics the metrics recorded by the thread
+	*/
+	void setThreadMetrics(ThreadMetrics *threadMetrics) {
+		m_threadMetrics = threadMetrics;
+	}
+
+private:
+	ThreadMetrics *m_threadMetrics;
+};
+
+/**
+* MetricsManager.
+* Singleton class that keeps track of server metrics.
+* Every thread records into its own set of counters which are
+* summed up when the metrics are collected, so recording never
+* contends with other threads.
+*/
+class MetricsManager : public Singleton<MetricsManager>
+{
+public:
+	/**
+	* Destructor.
+	*/
+	~MetricsManager();
+
+	/**
+	* Add a handled request.
+	* @param handlerName the name of the request handler that handled the request
+	* @param statusCode the status code of the response
+	* @param duration the time it took to handle the request, in microseconds
+	* @param bytesSent the number of bytes sent to the client
+	*/
+	void addRequest(const std::string &handlerName,int statusCode,uint64_t duration,uint64_t bytesSent);
+
+	/**
+	* Add a database connection that had to be opened since no pooled connection was available.
+	*/
+	void addDatabaseConnection();
+
+	/**
+	* Add a database write lock acquisition.
+	* @param waitTime the time spent waiting for the lock, in microseconds
+	*/
+	void addDatabaseWait(uint64_t waitTime);
+
+	/**
+	* Add a script engine garbage collection.
+	* @param gcTime the time spent in the garbage collection, in microseconds
+	*/
+	void addGc(uint64_t gcTime);
+
+	/**
+	* Collect the metrics recorded by all threads.
+	* @return the summed up metrics of all threads
+	*/
+	Metrics collect();
+
+private:
+	/**
+	* Get the metrics recorded by the current thread.
+	* The metrics are created the first time a thread records anything.
+	* @return the metrics recorded by the current thread
+	*/
+	ThreadMetrics* getThreadMetrics();
+
+	ACE_Mutex m_mutex;
+
+	ACE_TSS<MetricsStorage> m_tss;
+
+	std::list<ThreadMetrics*> m_threadMetrics;
+};
+
+#endif
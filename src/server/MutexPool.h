@@ -18,12 +18,13 @@
 #ifndef guard_mutexpool_h
 #define guard_mutexpool_h
 
-#include <ace/mutex.h>
+#include "profiledmutex.h"
 
 /**
 * MutexPool.
 * A class representing a pool of allocated mutexes that can be reused
-* for more optimized mutex locking.
+* for more optimized mutex locking. All mutexes in the pool are
+* profiled and reported together under the name of the pool.
 */
 class MutexPool
 {
@@ -48,17 +49,18 @@ public:
 	* Any mutexes already allocated in the pool will be disposed of before
 	* the new ones are allocated.
 	* @param size the number of mutexes that should be allocated for the pool.
+	* @param name the name the mutexes of the pool are reported as
 	*/
-	void init(int size) 
+	void init(int size,const std::string &name) 
 	{
 		dispose();
 
 		m_size = size;
 
 		if ( m_size>0 ) {
-			m_mutexes = new ACE_Mutex*[m_size+1];
+			m_mutexes = new ProfiledMutex*[m_size+1];
 			for ( int i=0; i<m_size; i++ ) {
-				m_mutexes[i] = new ACE_Mutex();
+				m_mutexes[i] = new ProfiledMutex(name);
 			}
 		}
 	}
@@ -102,7 +104,7 @@ public:
 	}
 
 private:
-	ACE_Mutex** m_mutexes;
+	ProfiledMutex** m_mutexes;
 
 	int m_size;
 };
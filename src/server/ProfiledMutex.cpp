@@ -0,0 +1,293 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "profiledmutex.h"
+
+#include <algorithm>
+
+const int LockStatistics::BUCKET_COUNT = 6;
+
+const uint64_t LockStatistics::BUCKET_BOUNDS[] = {
+	10,
+	100,
+	1000,
+	10000,
+	100000,
+	1000000
+};
+
+ACE_Mutex ProfiledLock::m_registryMutex;
+
+std::list<ProfiledLock*> ProfiledLock::m_locks;
+
+void LockStatistics::add(uint64_t waitTime,bool contended,uint64_t holdTime)
+{
+	m_acquisitions++;
+	m_waitTime += waitTime;
+	m_holdTime += holdTime;
+
+	if ( contended ) {
+		m_contentions++;
+	}
+
+	if ( waitTime>m_maxWaitTime ) {
+		m_maxWaitTime = waitTime;
+	}
+
+	if ( holdTime>m_maxHoldTime ) {
+		m_maxHoldTime = holdTime;
+	}
+
+	// waits longer than the last bound are only part of the total count
+	for ( int i=0; i<BUCKET_COUNT; i++ ) {
+		if ( waitTime<=BUCKET_BOUNDS[i] ) {
+			m_buckets[i]++;
+			break;
+		}
+	}
+}
+
+void LockStatistics::merge(const LockStatistics &lockStatistics)
+{
+	m_acquisitions += lockStatistics.m_acquisitions;
+	m_contentions += lockStatistics.m_contentions;
+	m_holdTime += lockStatistics.m_holdTime;
+	m_waitTime += lockStatistics.m_waitTime;
+
+	if ( lockStatistics.m_maxHoldTime>m_maxHoldTime ) {
+		m_maxHoldTime = lockStatistics.m_maxHoldTime;
+	}
+
+	if ( lockStatistics.m_maxWaitTime>m_maxWaitTime ) {
+		m_maxWaitTime = lockStatistics.m_maxWaitTime;
+	}
+
+	for ( int i=0; i<BUCKET_COUNT; i++ ) {
+		m_buckets[i] += lockStatistics.m_buckets[i];
+	}
+}
+
+ProfiledLock::ProfiledLock(const std::string &name) : m_name(name)
+{
+	ACE_Guard<ACE_Mutex> guard(m_registryMutex);
+	m_locks.push_back(this);
+}
+
+ProfiledLock::~ProfiledLock()
+{
+	ACE_Guard<ACE_Mutex> guard(m_registryMutex);
+
+	std::list<ProfiledLock*>::iterator iter = std::find(m_locks.begin(),m_locks.end(),this);
+	if ( iter!=m_locks.end() ) {
+		m_locks.erase(iter);
+	}
+}
+
+std::map<std::string,LockStatistics> ProfiledLock::collect()
+{
+	std::map<std::string,LockStatistics> statistics;
+
+	ACE_Guard<ACE_Mutex> guard(m_registryMutex);
+
+	std::list<ProfiledLock*>::iterator iter;
+	for ( iter=m_locks.begin(); iter!=m_locks.end(); iter++ )
+	{
+		ProfiledLock *lock = *iter;
+
+		// the statistics mutex is never held while acquiring
+		// another lock, so taking it here can't deadlock
+		ACE_Guard<ACE_Mutex> statisticsGuard(lock->m_statisticsMutex);
+		statistics[lock->m_name].merge(lock->m_statistics);
+	}
+
+	return statistics;
+}
+
+void ProfiledLock::record(uint64_t waitTime,bool contended,uint64_t holdTime)
+{
+	ACE_Guard<ACE_Mutex> guard(m_statisticsMutex);
+	m_statistics.add(waitTime,contended,holdTime);
+}
+
+int ProfiledMutex::acquire()
+{
+	ACE_Time_Value startTime;
+	bool contended = false;
+
+	// only time the wait when the mutex is actually held by another thread
+	if ( m_mutex.tryacquire()==-1 ) 
+	{
+		contended = true;
+		startTime = ACE_High_Res_Timer::gettimeofday();
+
+		if ( m_mutex.acquire()==-1 ) {
+			return -1;
+		}
+	}
+
+	// only the outermost acquire of a recursive lock is recorded
+	if ( ++m_depth==1 ) 
+	{
+		m_acquireTime = ACE_High_Res_Timer::gettimeofday();
+		m_contended = contended;
+		m_waitTime = 0;
+
+		if ( contended ) {
+			(m_acquireTime-startTime).to_usec(m_waitTime);
+		}
+	}
+
+	return 0;
+}
+
+int ProfiledMutex::tryacquire()
+{
+	if ( m_mutex.tryacquire()==-1 ) {
+		return -1;
+	}
+
+	if ( ++m_depth==1 ) 
+	{
+		m_acquireTime = ACE_High_Res_Timer::gettimeofday();
+		m_contended = false;
+		m_waitTime = 0;
+	}
+
+	return 0;
+}
+
+int ProfiledMutex::release()
+{
+	bool outermost = (m_depth==1);
+	bool contended = m_contended;
+	uint64_t waitTime = m_waitTime;
+	uint64_t holdTime = 0;
+
+	if ( outermost ) {
+		(ACE_High_Res_Timer::gettimeofday()-m_acquireTime).to_usec(holdTime);
+	}
+
+	m_depth--;
+
+	int result = m_mutex.release();
+
+	// record after releasing so the statistics don't add to the hold time
+	if ( outermost ) {
+		record(waitTime,contended,holdTime);
+	}
+
+	return result;
+}
+
+int ProfiledRWMutex::acquire_read()
+{
+	ACE_Time_Value startTime;
+	bool contended = false;
+	uint64_t waitTime = 0;
+
+	if ( m_mutex.tryacquire_read()==-1 ) 
+	{
+		contended = true;
+		startTime = ACE_High_Res_Timer::gettimeofday();
+
+		if ( m_mutex.acquire_read()==-1 ) {
+			return -1;
+		}
+
+		(ACE_High_Res_Timer::gettimeofday()-startTime).to_usec(waitTime);
+	}
+
+	record(waitTime,contended,0);
+
+	return 0;
+}
+
+int ProfiledRWMutex::acquire_write()
+{
+	ACE_Time_Value startTime;
+	bool contended = false;
+
+	if ( m_mutex.tryacquire_write()==-1 ) 
+	{
+		contended = true;
+		startTime = ACE_High_Res_Timer::gettimeofday();
+
+		if ( m_mutex.acquire_write()==-1 ) {
+			return -1;
+		}
+	}
+
+	m_acquireTime = ACE_High_Res_Timer::gettimeofday();
+	m_contended = contended;
+	m_waitTime = 0;
+	m_writing = true;
+
+	if ( contended ) {
+		(m_acquireTime-startTime).to_usec(m_waitTime);
+	}
+
+	return 0;
+}
+
+int ProfiledRWMutex::tryacquire_read()
+{
+	if ( m_mutex.tryacquire_read()==-1 ) {
+		return -1;
+	}
+
+	record(0,false,0);
+
+	return 0;
+}
+
+int ProfiledRWMutex::tryacquire_write()
+{
+	if ( m_mutex.tryacquire_write()==-1 ) {
+		return -1;
+	}
+
+	m_acquireTime = ACE_High_Res_Timer::gettimeofday();
+	m_contended = false;
+	m_waitTime = 0;
+	m_writing = true;
+
+	return 0;
+}
+
+int ProfiledRWMutex::release()
+{
+	// readers can't hold the mutex while a writer does, 
+	// so the writing flag is only ever set for the writer itself
+	if ( !m_writing ) {
+		return m_mutex.release();
+	}
+
+	bool contended = m_contended;
+	uint64_t waitTime = m_waitTime;
+	uint64_t holdTime = 0;
+
+	(ACE_High_Res_Timer::gettimeofday()-m_acquireTime).to_usec(holdTime);
+
+	m_writing = false;
+
+	int result = m_mutex.release();
+
+	record(waitTime,contended,holdTime);
+
+	return result;
+}
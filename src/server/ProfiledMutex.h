@@ -0,0 +1,375 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef guard_profiledmutex_h
+#define guard_profiledmutex_h
+
+#include <ace/synch.h>
+
+/**
+* LockStatistics.
+* Class representing the acquisition counts, wait time histogram 
+* and hold times recorded for a lock.
+*/
+class LockStatistics
+{
+public:
+	/**
+	* Default constructor.
+	* @return instance
+	*/
+	LockStatistics() : m_buckets(BUCKET_COUNT,0),
+		m_acquisitions(0),
+		m_contentions(0),
+		m_holdTime(0),
+		m_maxHoldTime(0),
+		m_maxWaitTime(0),
+		m_waitTime(0)
+	{
+
+	}
+
+	static const int BUCKET_COUNT;
+
+	static const uint64_t BUCKET_BOUNDS[];
+
+	/**
+	* Add an acquisition of the lock.
+	* @param waitTime the time spent waiting for the lock, in microseconds
+	* @param contended whether the lock was held by another thread when requested
+	* @param holdTime the time the lock was held, in microseconds. 
+	* Zero if the hold time is not known
+	*/
+	void add(uint64_t waitTime,bool contended,uint64_t holdTime);
+
+	/**
+	* Add the given statistics to these statistics.
+	* @param lockStatistics the statistics to add
+	*/
+	void merge(const LockStatistics &lockStatistics);
+
+	/**
+	* Get the number of times the lock was acquired.
+	* @return the number of times the lock was acquired
+	*/
+	const uint64_t getAcquisitions() const {
+		return m_acquisitions;
+	}
+
+	/**
+	* Get the number of acquisitions that waited within the bucket bound at the given index.
+	* The counts are cumulative, so every bucket includes the acquisitions of the buckets before it.
+	* @param index the bucket index
+	* @return the number of acquisitions that waited within the bucket bound
+	*/
+	const uint64_t getBucket(int index) const {
+		uint64_t count = 0;
+		for ( int i=0; i<=index; i++ ) {
+			count += m_buckets[i];
+		}
+
+		return count;
+	}
+
+	/**
+	* Get the number of acquisitions that had to wait for another thread.
+	* @return the number of contended acquisitions
+	*/
+	const uint64_t getContentions() const {
+		return m_contentions;
+	}
+
+	/**
+	* Get the total time the lock was held exclusively, in microseconds.
+	* @return the total hold time
+	*/
+	const uint64_t getHoldTime() const {
+		return m_holdTime;
+	}
+
+	/**
+	* Get the longest time the lock was held exclusively, in microseconds.
+	* @return the longest hold time
+	*/
+	const uint64_t getMaxHoldTime() const {
+		return m_maxHoldTime;
+	}
+
+	/**
+	* Get the longest time spent waiting for the lock, in microseconds.
+	* @return the longest wait time
+	*/
+	const uint64_t getMaxWaitTime() const {
+		return m_maxWaitTime;
+	}
+
+	/**
+	* Get the total time spent waiting for the lock, in microseconds.
+	* @return the total wait time
+	*/
+	const uint64_t getWaitTime() const {
+		return m_waitTime;
+	}
+
+private:
+	std::vector<uint64_t> m_buckets;
+
+	uint64_t m_acquisitions;
+	uint64_t m_contentions;
+	uint64_t m_holdTime;
+	uint64_t m_maxHoldTime;
+	uint64_t m_maxWaitTime;
+	uint64_t m_waitTime;
+};
+
+/**
+* ProfiledLock.
+* Base class for locks recording contention statistics. All profiled locks 
+* register themselves by name so that the statistics of every live lock 
+* can be collected. Locks sharing a name, such as the mutexes of a 
+* mutex pool, are reported together.
+*/
+class ProfiledLock
+{
+public:
+	/**
+	* Constructor.
+	* @param name the name the lock is reported as
+	* @return instance
+	*/
+	ProfiledLock(const std::string &name);
+
+	/**
+	* Destructor.
+	*/
+	virtual ~ProfiledLock();
+
+	/**
+	* Collect the statistics of all live locks, merged by lock name.
+	* @return the statistics of all locks, keyed by lock name
+	*/
+	static std::map<std::string,LockStatistics> collect();
+
+	/**
+	* Get the name the lock is reported as.
+	* @return the name of the lock
+	*/
+	const std::string& getName() const {
+		return m_name;
+	}
+
+protected:
+	/**
+	* Record an acquisition of the lock.
+	* @param waitTime the time spent waiting for the lock, in microseconds
+	* @param contended whether the lock was held by another thread when requested
+	* @param holdTime the time the lock was held, in microseconds
+	*/
+	void record(uint64_t waitTime,bool contended,uint64_t holdTime);
+
+private:
+	static ACE_Mutex m_registryMutex;
+
+	static std::list<ProfiledLock*> m_locks;
+
+	ACE_Mutex m_statisticsMutex;
+
+	LockStatistics m_statistics;
+
+	std::string m_name;
+};
+
+/**
+* ProfiledMutex.
+* A drop-in replacement for ACE_Mutex that records how often it's acquired, 
+* how long threads wait for it and how long it's held. An uncontended acquire 
+* costs a try acquire and a timestamp, so the profiling can be left enabled.
+*/
+class ProfiledMutex : public ProfiledLock
+{
+public:
+	/**
+	* Constructor.
+	* @param name the name the mutex is reported as
+	* @return instance
+	*/
+	ProfiledMutex(const std::string &name) : ProfiledLock(name),
+		m_contended(false),
+		m_depth(0),
+		m_waitTime(0)
+	{
+
+	}
+
+	/**
+	* Acquire the mutex, blocking until it's available.
+	* @return 0 on success, -1 on failure
+	*/
+	int acquire();
+
+	/**
+	* Try to acquire the mutex without blocking.
+	* @return 0 on success, -1 if the mutex is held by another thread
+	*/
+	int tryacquire();
+
+	/**
+	* Release the mutex.
+	* @return 0 on success, -1 on failure
+	*/
+	int release();
+
+	/**
+	* Explicitly remove the mutex.
+	* @return 0 on success, -1 on failure
+	*/
+	int remove() {
+		return m_mutex.remove();
+	}
+
+	/**
+	* Same as acquire, for use with read guards.
+	* @return 0 on success, -1 on failure
+	*/
+	int acquire_read() {
+		return acquire();
+	}
+
+	/**
+	* Same as acquire, for use with write guards.
+	* @return 0 on success, -1 on failure
+	*/
+	int acquire_write() {
+		return acquire();
+	}
+
+	/**
+	* Same as tryacquire, for use with read guards.
+	* @return 0 on success, -1 if the mutex is held by another thread
+	*/
+	int tryacquire_read() {
+		return tryacquire();
+	}
+
+	/**
+	* Same as tryacquire, for use with write guards.
+	* @return 0 on success, -1 if the mutex is held by another thread
+	*/
+	int tryacquire_write() {
+		return tryacquire();
+	}
+
+private:
+	ACE_Mutex m_mutex;
+
+	ACE_Time_Value m_acquireTime;
+
+	uint64_t m_waitTime;
+
+	int m_depth;
+
+	bool m_contended;
+};
+
+/**
+* ProfiledRWMutex.
+* A drop-in replacement for ACE_RW_Mutex recording the same statistics
+* as the ProfiledMutex. Since readers share the lock, hold times are 
+* only recorded for writers.
+*/
+class ProfiledRWMutex : public ProfiledLock
+{
+public:
+	/**
+	* Constructor.
+	* @param name the name the mutex is reported as
+	* @return instance
+	*/
+	ProfiledRWMutex(const std::string &name) : ProfiledLock(name),
+		m_contended(false),
+		m_waitTime(0),
+		m_writing(false)
+	{
+
+	}
+
+	/**
+	* Acquire the mutex for writing, blocking until it's available.
+	* @return 0 on success, -1 on failure
+	*/
+	int acquire() {
+		return acquire_write();
+	}
+
+	/**
+	* Acquire the mutex for reading, blocking until it's available.
+	* @return 0 on success, -1 on failure
+	*/
+	int acquire_read();
+
+	/**
+	* Acquire the mutex for writing, blocking until it's available.
+	* @return 0 on success, -1 on failure
+	*/
+	int acquire_write();
+
+	/**
+	* Try to acquire the mutex for writing without blocking.
+	* @return 0 on success, -1 if the mutex is held by another thread
+	*/
+	int tryacquire() {
+		return tryacquire_write();
+	}
+
+	/**
+	* Try to acquire the mutex for reading without blocking.
+	* @return 0 on success, -1 if the mutex is held by a writer
+	*/
+	int tryacquire_read();
+
+	/**
+	* Try to acquire the mutex for writing without blocking.
+	* @return 0 on success, -1 if the mutex is held by another thread
+	*/
+	int tryacquire_write();
+
+	/**
+	* Release the mutex, held either for reading or writing.
+	* @return 0 on success, -1 on failure
+	*/
+	int release();
+
+	/**
+	* Explicitly remove the mutex.
+	* @return 0 on success, -1 on failure
+	*/
+	int remove() {
+		return m_mutex.remove();
+	}
+
+private:
+	ACE_RW_Mutex m_mutex;
+
+	ACE_Time_Value m_acquireTime;
+
+	uint64_t m_waitTime;
+
+	bool m_contended;
+	bool m_writing;
+};
+
+#endif
@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "requesttracer.h"
+
+#define LOGGER_CLASSNAME "RequestTracer"
+
+#include <ace/high_res_timer.h>
+#include <ace/os.h>
+
+#include "configmanager.h"
+#include "httprequest.h"
+#include "httpresponse.h"
+#include "logmanager.h"
+
+void RequestTrace::start()
+{
+	m_started = true;
+	m_startTime = ACE_High_Res_Timer::gettimeofday();
+	m_threadId = (uint64_t)ACE_OS::thr_self();
+	m_spans.clear();
+}
+
+int RequestTrace::beginSpan(const char *name)
+{
+	if ( !m_started ) {
+		return -1;
+	}
+
+	m_spans.push_back(TraceSpan(name,getElapsedTime()));
+
+	return (int)m_spans.size()-1;
+}
+
+void RequestTrace::endSpan(int index)
+{
+	if ( index<0 || index>=(int)m_spans.size() ) {
+		return;
+	}
+
+	TraceSpan &span = m_spans[index];
+	span.setDuration(getElapsedTime()-span.getStart());
+}
+
+void RequestTrace::addSpanFromStart(const char *name)
+{
+	if ( !m_started ) {
+		return;
+	}
+
+	TraceSpan span(name,0);
+	span.setDuration(getElapsedTime());
+	m_spans.push_back(span);
+}
+
+const uint64_t RequestTrace::getElapsedTime() const
+{
+	ACE_UINT64 elapsedTime = 0;
+	(ACE_High_Res_Timer::gettimeofday()-m_startTime).to_usec(elapsedTime);
+
+	return elapsedTime;
+}
+
+void RequestTracer::init()
+{
+	m_maxTraces = ConfigManager::getInstance()->getInt(ConfigManager::HTTPSERVER_TRACING_MAXTRACES);
+	m_sampleRate = ConfigManager::getInstance()->getInt(ConfigManager::HTTPSERVER_TRACING_SAMPLERATE);
+	m_slowLogPath = ConfigManager::getInstance()->getString(ConfigManager::HTTPSERVER_TRACING_SLOWLOGPATH);
+	m_slowThreshold = ConfigManager::getInstance()->getInt(ConfigManager::HTTPSERVER_TRACING_SLOWTHRESHOLD);
+}
+
+void RequestTracer::complete(HttpServerRequest &httpRequest,HttpServerResponse &httpResponse)
+{
+	RequestTrace &trace = httpRequest.getTrace();
+	if ( !trace.isStarted() ) {
+		return;
+	}
+
+	uint64_t duration = trace.getElapsedTime();
+
+	bool slow = m_slowThreshold>0 && duration>=(uint64_t)m_slowThreshold*1000;
+	if ( slow ) {
+		writeSlowLog(httpRequest,httpResponse,duration);
+	}
+
+	ACE_Guard<ACE_Mutex> guard(m_mutex);
+
+	m_requests++;
+
+	bool sampled = m_sampleRate>0 && (m_requests % m_sampleRate)==0;
+	if ( (slow || sampled) && m_maxTraces>0 )
+	{
+		m_traces.push_back(CompletedTrace(httpRequest.getMethod() + " " + httpRequest.getUri(),
+			httpResponse.getStatusCode(),trace,duration));
+
+		while ( m_traces.size()>(size_t)m_maxTraces ) {
+			m_traces.pop_front();
+		}
+	}
+}
+
+void RequestTracer::clear()
+{
+	ACE_Guard<ACE_Mutex> guard(m_mutex);
+	m_traces.clear();
+}
+
+std::string RequestTracer::exportTraces()
+{
+	ACE_Guard<ACE_Mutex> guard(m_mutex);
+
+	std::stringstream json;
+	json << "{\"traceEvents\":[";
+
+	bool first = true;
+
+	std::list<CompletedTrace>::iterator iter;
+	for ( iter=m_traces.begin(); iter!=m_traces.end(); iter++ )
+	{
+		const RequestTrace &trace = iter->getTrace();
+
+		ACE_UINT64 startTime = 0;
+		trace.getStartTime().to_usec(startTime);
+
+		std::string threadId = Util::ConvertUtil::toString(trace.getThreadId());
+
+		// the request itself is the outermost event, with the phases nested inside
+		if ( !first ) {
+			json << ",";
+		}
+
+		json << "{\"name\":\"" << escapeJson(iter->getName()) << "\","
+			<< "\"cat\":\"request\",\"ph\":\"X\","
+			<< "\"ts\":" << Util::ConvertUtil::toString(startTime) << ","
+			<< "\"dur\":" << Util::ConvertUtil::toString(iter->getDuration()) << ","
+			<< "\"pid\":1,\"tid\":" << threadId << ","
+			<< "\"args\":{\"status\":" << iter->getStatusCode() << "}}";
+
+		first = false;
+
+		std::vector<TraceSpan>::const_iterator spanIter;
+		for ( spanIter=trace.getSpans().begin(); spanIter!=trace.getSpans().end(); spanIter++ ) {
+			json << ",{\"name\":\"" << escapeJson(spanIter->getName()) << "\","
+				<< "\"cat\":\"phase\",\"ph\":\"X\","
+				<< "\"ts\":" << Util::ConvertUtil::toString(startTime+spanIter->getStart()) << ","
+				<< "\"dur\":" << Util::ConvertUtil::toString(spanIter->getDuration()) << ","
+				<< "\"pid\":1,\"tid\":" << threadId << "}";
+		}
+	}
+
+	json << "],\"displayTimeUnit\":\"ms\"}";
+
+	return json.str();
+}
+
+void RequestTracer::writeSlowLog(HttpServerRequest &httpRequest,HttpServerResponse &httpResponse,uint64_t duration)
+{
+	time_t calendarTime = Util::TimeUtil::getCalendarTime();
+
+	tm localTime;
+	Util::TimeUtil::getLocalTime(calendarTime,&localTime);
+
+	// sum up repeated phases, such as database queries, keeping the order they first occured in
+	std::vector<std::string> names;
+	std::map<std::string,std::pair<uint64_t,int> > phases;
+
+	const std::vector<TraceSpan> &spans = httpRequest.getTrace().getSpans();
+	std::vector<TraceSpan>::const_iterator iter;
+	for ( iter=spans.begin(); iter!=spans.end(); iter++ )
+	{
+		std::map<std::string,std::pair<uint64_t,int> >::iterator phaseIter = phases.find(iter->getName());
+		if ( phaseIter==phases.end() ) {
+			names.push_back(iter->getName());
+			phases[iter->getName()] = std::make_pair(iter->getDuration(),1);
+		}
+		else {
+			phaseIter->second.first += iter->getDuration();
+			phaseIter->second.second++;
+		}
+	}
+
+	std::stringstream line;
+	line << Util::TimeUtil::format(localTime,"%Y-%m-%d %H:%M:%S").c_str() << " ";
+	line << httpRequest.getRemoteAddress().c_str() << " ";
+	line << httpRequest.getMethod().c_str() << " ";
+	line << httpRequest.getUri().c_str() << " ";
+	line << httpResponse.getStatusCode() << " ";
+	line << formatMilliseconds(duration) << "ms";
+
+	std::vector<std::string>::iterator nameIter;
+	for ( nameIter=names.begin(); nameIter!=names.end(); nameIter++ )
+	{
+		const std::pair<uint64_t,int> &phase = phases[*nameIter];
+		line << " " << *nameIter << "=" << formatMilliseconds(phase.first) << "ms";
+		if ( phase.second>1 ) {
+			line << "(" << phase.second << ")";
+		}
+	}
+
+	LogManager::getInstance()->write(m_slowLogPath,line.str(),calendarTime,true);
+}
+
+std::string RequestTracer::escapeJson(const std::string &s)
+{
+	std::string escaped;
+	escaped.reserve(s.length());
+
+	for ( std::string::const_iterator iter=s.begin(); iter!=s.end(); iter++ )
+	{
+		switch ( *iter )
+		{
+			case '"':
+				escaped += "\\\"";
+			break;
+
+			case '\\':
+				escaped += "\\\\";
+			break;
+
+			default:
+				if ( (unsigned char)*iter<0x20 ) {
+					char buffer[8];
+					sprintf(buffer,"\\u%04x",(unsigned char)*iter);
+					escaped += buffer;
+				}
+				else {
+					escaped += *iter;
+				}
+			break;
+		}
+	}
+
+	return escaped;
+}
+
+std::string RequestTracer::formatMilliseconds(uint64_t duration)
+{
+	char buffer[32];
+	sprintf(buffer,"%.1f",(double)(int64_t)duration/1000.0);
+	return buffer;
+}
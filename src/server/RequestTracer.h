@@ -0,0 +1,358 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef guard_requesttracer_h
+#define guard_requesttracer_h
+
+#include <ace/synch.h>
+
+class HttpServerRequest; // forward declaration
+class HttpServerResponse; // forward declaration
+
+/**
+* TraceSpan.
+* Class representing a timed phase of a request.
+*/
+class TraceSpan
+{
+public:
+	/**
+	* Constructor used for creating a new instance.
+	* @param name the name of the phase
+	* @param start the start of the phase, in microseconds from the start of the trace
+	* @return instance
+	*/
+	TraceSpan(const std::string &name,uint64_t start) : m_duration(0) {
+		m_name = name;
+		m_start = start;
+	}
+
+	/**
+	* Get the duration of the phase, in microseconds.
+	* @return the duration of the phase
+	*/
+	const uint64_t getDuration() const {
+		return m_duration;
+	}
+
+	/**
+	* Get the name of the phase.
+	* @return the name of the phase
+	*/
+	const std::string& getName() const {
+		return m_name;
+	}
+
+	/**
+	* Get the start of the phase, in microseconds from the start of the trace.
+	* @return the start of the phase
+	*/
+	const uint64_t getStart() const {
+		return m_start;
+	}
+
+	/**
+	* Set the duration of the phase.
+	* @param duration the duration of the phase, in microseconds
+	*/
+	void setDuration(uint64_t duration) {
+		m_duration = duration;
+	}
+
+private:
+	std::string m_name;
+
+	uint64_t m_duration;
+	uint64_t m_start;
+};
+
+/**
+* RequestTrace.
+* Class recording the timed phases of a single request.
+* Nothing is recorded until the trace has been started, 
+* so an unstarted trace costs next to nothing.
+*/
+class RequestTrace
+{
+public:
+	/**
+	* Default constructor.
+	* @return instance
+	*/
+	RequestTrace() : m_started(false),
+		m_threadId(0)
+	{
+
+	}
+
+	/**
+	* Start the trace.
+	*/
+	void start();
+
+	/**
+	* Begin a phase.
+	* @param name the name of the phase
+	* @return the index of the phase, used to end it. -1 if the trace isn't started
+	*/
+	int beginSpan(const char *name);
+
+	/**
+	* End a phase.
+	* @param index the index of the phase returned when it was begun
+	*/
+	void endSpan(int index);
+
+	/**
+	* Record a phase lasting from the start of the trace up to the current time.
+	* @param name the name of the phase
+	*/
+	void addSpanFromStart(const char *name);
+
+	/**
+	* Get the time elapsed since the trace was started, in microseconds.
+	* @return the time elapsed since the trace was started
+	*/
+	const uint64_t getElapsedTime() const;
+
+	/**
+	* Get all recorded phases.
+	* @return a collection of all recorded phases
+	*/
+	const std::vector<TraceSpan>& getSpans() const {
+		return m_spans;
+	}
+
+	/**
+	* Get the time when the trace was started.
+	* @return the time when the trace was started
+	*/
+	const ACE_Time_Value& getStartTime() const {
+		return m_startTime;
+	}
+
+	/**
+	* Get the id of the thread that started the trace.
+	* @return the id of the thread that started the trace
+	*/
+	const uint64_t getThreadId() const {
+		return m_threadId;
+	}
+
+	/**
+	* Get whether the trace has been started.
+	* @return true if the trace has been started
+	*/
+	const bool isStarted() const {
+		return m_started;
+	}
+
+private:
+	ACE_Time_Value m_startTime;
+
+	std::vector<TraceSpan> m_spans;
+
+	uint64_t m_threadId;
+
+	bool m_started;
+};
+
+/**
+* TraceScope.
+* Records a phase lasting for the lifetime of the scope.
+*/
+class TraceScope
+{
+public:
+	/**
+	* Constructor used for creating a new instance.
+	* @param trace the trace to record the phase in
+	* @param name the name of the phase
+	* @return instance
+	*/
+	TraceScope(RequestTrace &trace,const char *name) : m_trace(trace) {
+		m_index = m_trace.beginSpan(name);
+	}
+
+	/**
+	* Destructor.
+	*/
+	~TraceScope() {
+		m_trace.endSpan(m_index);
+	}
+
+private:
+	RequestTrace &m_trace;
+
+	int m_index;
+};
+
+/**
+* CompletedTrace.
+* Class representing the trace of a completed request, kept for export.
+*/
+class CompletedTrace
+{
+public:
+	/**
+	* Constructor used for creating a new instance.
+	* @param name the name of the request
+	* @param statusCode the status code of the response
+	* @param trace the trace of the request
+	* @param duration the duration of the request, in microseconds
+	* @return instance
+	*/
+	CompletedTrace(const std::string &name,int statusCode,
+		const RequestTrace &trace,uint64_t duration) : m_trace(trace) 
+	{
+		m_duration = duration;
+		m_name = name;
+		m_statusCode = statusCode;
+	}
+
+	/**
+	* Get the duration of the request, in microseconds.
+	* @return the duration of the request
+	*/
+	const uint64_t getDuration() const {
+		return m_duration;
+	}
+
+	/**
+	* Get the name of the request.
+	* @return the name of the request
+	*/
+	const std::string& getName() const {
+		return m_name;
+	}
+
+	/**
+	* Get the status code of the response.
+	* @return the status code of the response
+	*/
+	const int getStatusCode() const {
+		return m_statusCode;
+	}
+
+	/**
+	* Get the trace of the request.
+	* @return the trace of the request
+	*/
+	const RequestTrace& getTrace() const {
+		return m_trace;
+	}
+
+private:
+	RequestTrace m_trace;
+
+	std::string m_name;
+
+	uint64_t m_duration;
+
+	int m_statusCode;
+};
+
+/**
+* RequestTracer.
+* Decides which requests are traced and collects the completed traces.
+* Requests slower than the configured threshold are written to the slow request
+* log with their phase breakdown. Slow requests and every n:th request are kept
+* for export in the Chrome trace event format.
+*/
+class RequestTracer
+{
+public:
+	/**
+	* Default constructor.
+	* @return instance
+	*/
+	RequestTracer() : m_maxTraces(0),
+		m_requests(0),
+		m_sampleRate(0),
+		m_slowThreshold(0)
+	{
+
+	}
+
+	/**
+	* Initialize the tracing settings from the configuration.
+	*/
+	void init();
+
+	/**
+	* Complete the trace of a request.
+	* @param httpRequest the traced request
+	* @param httpResponse the response for the traced request
+	*/
+	void complete(HttpServerRequest &httpRequest,HttpServerResponse &httpResponse);
+
+	/**
+	* Clear all kept traces.
+	*/
+	void clear();
+
+	/**
+	* Export all kept traces in the Chrome trace event format.
+	* @return the kept traces as json
+	*/
+	std::string exportTraces();
+
+	/**
+	* Get whether requests should be traced.
+	* @return true if requests should be traced
+	*/
+	const bool isEnabled() const {
+		return m_sampleRate>0 || m_slowThreshold>0;
+	}
+
+private:
+	/**
+	* Write a slow request to the slow request log.
+	* @param httpRequest the slow request
+	* @param httpResponse the response for the slow request
+	* @param duration the duration of the request, in microseconds
+	*/
+	void writeSlowLog(HttpServerRequest &httpRequest,HttpServerResponse &httpResponse,uint64_t duration);
+
+	/**
+	* Escape a string for use in json.
+	* @param s the string to escape
+	* @return the escaped string
+	*/
+	static std::string escapeJson(const std::string &s);
+
+	/**
+	* Format a duration in microseconds as milliseconds.
+	* @param duration the duration in microseconds
+	* @return the formatted duration in milliseconds
+	*/
+	static std::string formatMilliseconds(uint64_t duration);
+
+	ACE_Mutex m_mutex;
+
+	std::list<CompletedTrace> m_traces;
+
+	std::string m_slowLogPath;
+
+	uint64_t m_requests;
+
+	int m_maxTraces;
+	int m_sampleRate;
+	int m_slowThreshold;
+};
+
+#endif
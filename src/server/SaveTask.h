@@ -31,9 +31,10 @@ public:
 	/**
 	* Constructor used for creating a new instance.
 	* @param persistentManager the persistent manager to save
+	* @param name the name of the task
 	* @return instance
 	*/
-	SaveTask(PersistentManager *persistentManager) {
+	SaveTask(PersistentManager *persistentManager,std::string name) : Task(name) {
 		m_persistentManager = persistentManager;
 	}
 
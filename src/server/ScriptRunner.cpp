@@ -0,0 +1,509 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "scriptrunner.h"
+
+#define LOGGER_CLASSNAME "ScriptRunner"
+
+#include <ace/os.h>
+
+#include "configmanager.h"
+#include "databasemanager.h"
+#include "logmanager.h"
+#include "sitemanager.h"
+#include "usermanager.h"
+
+const int ScriptRunner::BUFFER_SIZE = 8192;
+const int ScriptRunner::MAX_RETRY_DELAY = 86400000;
+
+bool ScriptRunner::start()
+{
+	if ( m_started ) {
+		return false;
+	}
+
+	m_maxAttempts = ConfigManager::getInstance()->getInt(ConfigManager::SCRIPTRUNNER_MAXATTEMPTS);
+	m_maxQueueSize = ConfigManager::getInstance()->getInt(ConfigManager::SCRIPTRUNNER_MAXQUEUESIZE);
+	m_maxWorkers = ConfigManager::getInstance()->getInt(ConfigManager::SCRIPTRUNNER_MAXWORKERS);
+	m_retryDelay = ConfigManager::getInstance()->getInt(ConfigManager::SCRIPTRUNNER_RETRYDELAY);
+
+	if ( !m_engine.init() ) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not initialize script engine");
+		return false;
+	}
+
+	loadQueue();
+
+	for ( int i=0; i<m_maxWorkers; i++ )
+	{
+		Thread *worker = new Thread(this);
+		if ( !worker->start() ) {
+			delete worker;
+			break;
+		}
+
+		m_workers.push_back(worker);
+	}
+
+	if ( m_workers.empty() ) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not start any worker threads");
+		m_engine.cleanup();
+		return false;
+	}
+
+	m_started = true;
+
+	return true;
+}
+
+void ScriptRunner::stop()
+{
+	if ( !m_started ) {
+		return;
+	}
+
+	std::list<Thread*>::iterator iter;
+	for ( iter=m_workers.begin(); iter!=m_workers.end(); iter++ ) {
+		(*iter)->cancel();
+	}
+
+	for ( iter=m_workers.begin(); iter!=m_workers.end(); iter++ ) {
+		(*iter)->join();
+		delete *iter;
+	}
+
+	m_workers.clear();
+
+	// queued jobs are left in the database and reloaded on next start
+	m_mutex.acquire();
+	m_queue.clear();
+	m_mutex.release();
+
+	m_engine.cleanup();
+
+	m_started = false;
+}
+
+void ScriptRunner::run()
+{
+	Thread *thread = Thread::current();
+
+	while ( true )
+	{
+		if ( thread->isCancelled() ) {
+			break;
+		}
+
+		ScriptJob job;
+		unsigned long waitTime = 0;
+
+		if ( !popQueue(job,waitTime) ) {
+			thread->wait(waitTime);
+			continue;
+		}
+
+		int64_t latency = getCurrentTime()-job.getExecutionTime();
+
+		ExecutionResult result = execute(job);
+
+		m_mutex.acquire();
+		m_executions++;
+		m_totalLatency += latency>0 ? latency : 0;
+		m_mutex.release();
+
+		if ( result==EXECUTION_SUCCEEDED )
+		{
+			deleteDbEntry(job);
+
+			m_mutex.acquire();
+			m_completedJobs++;
+			m_mutex.release();
+			continue;
+		}
+
+		job.setAttempts(job.getAttempts()+1);
+
+		// a job that can never succeed is not retried
+		if ( result==EXECUTION_REJECTED )
+		{
+			LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Dropping job for \"%s\" that can not be executed",
+				job.getUri().c_str());
+
+			deleteDbEntry(job);
+
+			m_mutex.acquire();
+			m_failedJobs++;
+			m_mutex.release();
+			continue;
+		}
+
+		if ( job.getAttempts()>=m_maxAttempts )
+		{
+			LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Dropping job for \"%s\" after %d failed attempts",
+				job.getUri().c_str(),job.getAttempts());
+
+			deleteDbEntry(job);
+
+			m_mutex.acquire();
+			m_failedJobs++;
+			m_mutex.release();
+			continue;
+		}
+
+		// exponential backoff, doubling the retry delay for each failed attempt up to a day
+		int shift = job.getAttempts()-1;
+		int64_t delay = (int64_t)m_retryDelay << (shift<30 ? shift : 30);
+		if ( delay>MAX_RETRY_DELAY ) {
+			delay = MAX_RETRY_DELAY;
+		}
+		job.setExecutionTime(getCurrentTime()+delay);
+
+		if ( LogManager::getInstance()->isDebug() ) {
+			LogManager::getInstance()->debug(LOGGER_CLASSNAME,"Job for \"%s\" failed, retrying in %d ms",
+				job.getUri().c_str(),(int)delay);
+		}
+
+		updateDbEntry(job);
+
+		m_mutex.acquire();
+		putQueue(job);
+		m_mutex.release();
+
+		notifyWorkers();
+	}
+}
+
+bool ScriptRunner::schedule(ScriptJob job,unsigned long delay)
+{
+	if ( !m_started ) {
+		return false;
+	}
+
+	if ( getQueueSize()>=(size_t)m_maxQueueSize ) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Queue is full, could not schedule \"%s\"",job.getUri().c_str());
+		return false;
+	}
+
+	job.setAttempts(0);
+	job.setQueueTime(getCurrentTime());
+	job.setExecutionTime(job.getQueueTime()+delay);
+
+	if ( !insertDbEntry(job) ) {
+		return false;
+	}
+
+	m_mutex.acquire();
+	putQueue(job);
+	m_mutex.release();
+
+	notifyWorkers();
+
+	return true;
+}
+
+const int64_t ScriptRunner::getAverageLatency()
+{
+	ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+
+	if ( m_executions==0 ) {
+		return 0;
+	}
+
+	return m_totalLatency/(int64_t)m_executions;
+}
+
+const uint64_t ScriptRunner::getCompletedJobs()
+{
+	ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+
+	return m_completedJobs;
+}
+
+const uint64_t ScriptRunner::getFailedJobs()
+{
+	ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+
+	return m_failedJobs;
+}
+
+const size_t ScriptRunner::getQueueSize()
+{
+	ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+
+	return m_queue.size();
+}
+
+int64_t ScriptRunner::getCurrentTime()
+{
+	ACE_Time_Value currentTime = ACE_OS::gettimeofday();
+
+	return (int64_t)currentTime.sec()*1000+currentTime.usec()/1000;
+}
+
+ScriptRunner::ExecutionResult ScriptRunner::execute(const ScriptJob &job)
+{
+	Site *site = SiteManager::getInstance()->findSiteByPath(job.getUri());
+	if ( site==NULL ) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"No site found for \"%s\"",job.getUri().c_str());
+		return EXECUTION_REJECTED;
+	}
+
+	// the request is not attached to any client, any output is discarded
+	HttpServerRequest httpRequest(NULL);
+	HttpServerResponse httpResponse(NULL,BUFFER_SIZE);
+
+	httpRequest.setMethod("GET");
+	httpRequest.setUri(job.getUri());
+	httpRequest.setSite(site);
+
+	std::map<std::string,std::string>::const_iterator iter;
+	for ( iter=job.getParameters().begin(); iter!=job.getParameters().end(); iter++ ) {
+		httpRequest.setParameter(iter->first,iter->second);
+	}
+
+	if ( !job.getUserGuid().empty() )
+	{
+		User user;
+		if ( !UserManager::getInstance()->findUserByGuid(job.getUserGuid(),&user) ) {
+			LogManager::getInstance()->warning(LOGGER_CLASSNAME,"User for job \"%s\" no longer exists",job.getUri().c_str());
+			return EXECUTION_REJECTED;
+		}
+
+		// the user may have lost access to the site since the job was scheduled.
+		// The job runs on the server itself, so it's checked as a local request
+		if ( !site->checkPermission(user,"127.0.0.1") ) {
+			LogManager::getInstance()->warning(LOGGER_CLASSNAME,"User for job \"%s\" has no permission to the site",job.getUri().c_str());
+			return EXECUTION_REJECTED;
+		}
+
+		httpRequest.setUser(user);
+	}
+
+	std::string path = httpRequest.getRealPath();
+	FILE *file = fopen(path.c_str(),"rb");
+	if ( file==NULL ) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not open \"%s\"",job.getUri().c_str());
+		return EXECUTION_REJECTED;
+	}
+
+	if ( LogManager::getInstance()->isDebug() ) {
+		LogManager::getInstance()->debug(LOGGER_CLASSNAME,"Executing \"%s\"",job.getUri().c_str());
+	}
+
+	bool success = m_engine.executeFile(file,httpRequest,httpResponse);
+
+	fclose(file);
+
+	if ( !success || httpResponse.getStatusCode()>=HttpResponse::HTTP_INTERNAL_SERVER_ERROR ) {
+		return EXECUTION_FAILED;
+	}
+
+	return EXECUTION_SUCCEEDED;
+}
+
+void ScriptRunner::loadQueue()
+{
+	DatabaseConnection *conn = DatabaseManager::getInstance()->getConnection(DatabaseManager::DATABASE_SERVER,false);
+	if ( conn!=NULL )
+	{
+		try
+		{
+			sqlite3x::sqlite3_command cmd(conn->getSqliteConn(),
+				"SELECT jobId,uri,userGuid,parameters,attempts,queueTime,executionTime FROM [jobs]");
+			sqlite3x::sqlite3_reader reader = cmd.executereader();
+
+			ACE_Write_Guard<ACE_Mutex> guard(m_mutex);
+
+			while ( reader.read() )
+			{
+				ScriptJob job;
+				job.setDbId(reader.getint64(0));
+				job.setUri(reader.getstring(1));
+				job.setUserGuid(reader.getstring(2));
+				parseParameters(reader.getstring(3),job);
+				job.setAttempts(reader.getint(4));
+				job.setQueueTime(reader.getint64(5));
+				job.setExecutionTime(reader.getint64(6));
+
+				putQueue(job);
+			}
+
+			if ( !m_queue.empty() ) {
+				LogManager::getInstance()->info(LOGGER_CLASSNAME,"Resumed %d queued jobs",(int)m_queue.size());
+			}
+		}
+		catch(exception &ex) {
+			LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not load queued jobs [%s]",ex.what());
+		}
+
+		DatabaseManager::getInstance()->releaseConnection(conn);
+	}
+}
+
+bool ScriptRunner::popQueue(ScriptJob &job,unsigned long &waitTime)
+{
+	ACE_Write_Guard<ACE_Mutex> guard(m_mutex);
+
+	waitTime = 0;
+
+	if ( m_queue.empty() ) {
+		return false;
+	}
+
+	int64_t currentTime = getCurrentTime();
+	if ( m_queue.front().getExecutionTime()>currentTime ) {
+		waitTime = (unsigned long)(m_queue.front().getExecutionTime()-currentTime);
+		return false;
+	}
+
+	job = m_queue.front();
+	m_queue.pop_front();
+
+	return true;
+}
+
+void ScriptRunner::putQueue(const ScriptJob &job)
+{
+	std::list<ScriptJob>::iterator iter;
+	for ( iter=m_queue.begin(); iter!=m_queue.end(); iter++ )
+	{
+		if ( iter->getExecutionTime()>job.getExecutionTime() ) {
+			m_queue.insert(iter,job);
+			return;
+		}
+	}
+
+	m_queue.push_back(job);
+}
+
+void ScriptRunner::notifyWorkers()
+{
+	std::list<Thread*>::iterator iter;
+	for ( iter=m_workers.begin(); iter!=m_workers.end(); iter++ ) {
+		(*iter)->notify();
+	}
+}
+
+bool ScriptRunner::insertDbEntry(ScriptJob &job)
+{
+	bool success = false;
+
+	DatabaseConnection *conn = DatabaseManager::getInstance()->getConnection(DatabaseManager::DATABASE_SERVER,true);
+	if ( conn!=NULL )
+	{
+		try
+		{
+			std::stringstream query;
+			query << "INSERT INTO [jobs] (uri,userGuid,parameters,attempts,queueTime,executionTime) "
+				<< "VALUES ('" << conn->quote(job.getUri()) << "',"
+				<< "'" << conn->quote(job.getUserGuid()) << "',"
+				<< "'" << conn->quote(formatParameters(job)) << "',"
+				<< job.getAttempts() << ","
+				<< job.getQueueTime() << ","
+				<< job.getExecutionTime() << ")";
+
+			conn->getSqliteConn().executenonquery(query.str());
+
+			job.setDbId(conn->getSqliteConn().insertid());
+			success = true;
+		}
+		catch(exception &ex) {
+			LogManager::getInstance()->warning(LOGGER_CLASSNAME,
+				"Could not create database entry for job \"%s\" [%s]",job.getUri().c_str(),ex.what());
+		}
+
+		DatabaseManager::getInstance()->releaseConnection(conn);
+	}
+
+	return success;
+}
+
+void ScriptRunner::updateDbEntry(const ScriptJob &job)
+{
+	DatabaseConnection *conn = DatabaseManager::getInstance()->getConnection(DatabaseManager::DATABASE_SERVER,true);
+	if ( conn!=NULL )
+	{
+		try
+		{
+			std::stringstream query;
+			query << "UPDATE [jobs] "
+				<< "SET attempts=" << job.getAttempts() << ","
+				<< "executionTime=" << job.getExecutionTime() << " "
+				<< "WHERE jobId=" << job.getDbId();
+
+			conn->getSqliteConn().executenonquery(query.str());
+		}
+		catch(exception &ex) {
+			LogManager::getInstance()->warning(LOGGER_CLASSNAME,
+				"Could not update database entry for job \"%s\" [%s]",job.getUri().c_str(),ex.what());
+		}
+
+		DatabaseManager::getInstance()->releaseConnection(conn);
+	}
+}
+
+void ScriptRunner::deleteDbEntry(const ScriptJob &job)
+{
+	DatabaseConnection *conn = DatabaseManager::getInstance()->getConnection(DatabaseManager::DATABASE_SERVER,true);
+	if ( conn!=NULL )
+	{
+		try {
+			conn->getSqliteConn().executenonquery("DELETE FROM [jobs] WHERE jobId="
+				+ Util::ConvertUtil::toString(job.getDbId()));
+		}
+		catch(exception &ex) {
+			LogManager::getInstance()->warning(LOGGER_CLASSNAME,
+				"Could not delete database entry for job \"%s\" [%s]",job.getUri().c_str(),ex.what());
+		}
+
+		DatabaseManager::getInstance()->releaseConnection(conn);
+	}
+}
+
+void ScriptRunner::parseParameters(const std::string &s,ScriptJob &job)
+{
+	std::vector<std::string> pairs;
+	boost::split(pairs,s,boost::is_any_of("&"));
+
+	std::vector<std::string>::iterator iter;
+	for ( iter=pairs.begin(); iter!=pairs.end(); iter++ )
+	{
+		size_t pos = iter->find('=');
+		if ( pos!=std::string::npos ) {
+			job.setParameter(Util::CryptoUtil::urlDecode(iter->substr(0,pos)),
+				Util::CryptoUtil::urlDecode(iter->substr(pos+1)));
+		}
+	}
+}
+
+std::string ScriptRunner::formatParameters(const ScriptJob &job)
+{
+	std::string s;
+
+	std::map<std::string,std::string>::const_iterator iter;
+	for ( iter=job.getParameters().begin(); iter!=job.getParameters().end(); iter++ )
+	{
+		if ( !s.empty() ) {
+			s += "&";
+		}
+
+		s += Util::CryptoUtil::urlEncode(iter->first) + "=" + Util::CryptoUtil::urlEncode(iter->second);
+	}
+
+	return s;
+}
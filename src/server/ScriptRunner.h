@@ -0,0 +1,372 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef guard_scriptrunner_h
+#define guard_scriptrunner_h
+
+#include <ace/synch.h>
+
+#include "../jsengine/engine.h"
+
+#include "runnable.h"
+#include "singleton.h"
+#include "thread.h"
+
+/**
+* ScriptJob.
+* Represents a script scheduled for background execution by the ScriptRunner.
+*/
+class ScriptJob
+{
+public:
+	/**
+	* Default constructor.
+	* @return instance
+	*/
+	ScriptJob() : m_attempts(0),
+		m_dbId(0),
+		m_executionTime(0),
+		m_queueTime(0)
+	{
+
+	}
+
+	/**
+	* Get the number of failed execution attempts.
+	* @return the number of failed execution attempts
+	*/
+	const int getAttempts() const {
+		return m_attempts;
+	}
+
+	/**
+	* Get the database id of the job.
+	* @return the database id of the job
+	*/
+	const uint64_t getDbId() const {
+		return m_dbId;
+	}
+
+	/**
+	* Get the time when the job is due for execution,
+	* in milliseconds since the epoch.
+	* @return the time when the job is due for execution
+	*/
+	const int64_t getExecutionTime() const {
+		return m_executionTime;
+	}
+
+	/**
+	* Get all parameters that will be passed to the script.
+	* @return a collection of all parameters
+	*/
+	const std::map<std::string,std::string>& getParameters() const {
+		return m_parameters;
+	}
+
+	/**
+	* Get the time when the job was first queued,
+	* in milliseconds since the epoch.
+	* @return the time when the job was first queued
+	*/
+	const int64_t getQueueTime() const {
+		return m_queueTime;
+	}
+
+	/**
+	* Get the uri of the script to execute.
+	* @return the uri of the script to execute
+	*/
+	const std::string& getUri() const {
+		return m_uri;
+	}
+
+	/**
+	* Get the guid of the user that the script will be executed as.
+	* @return the guid of the user, or an empty string if anonymous
+	*/
+	const std::string& getUserGuid() const {
+		return m_userGuid;
+	}
+
+	/**
+	* Set the number of failed execution attempts.
+	* @param attempts the number of failed execution attempts
+	*/
+	void setAttempts(int attempts) {
+		m_attempts = attempts;
+	}
+
+	/**
+	* Set the database id of the job.
+	* @param dbId the database id of the job
+	*/
+	void setDbId(uint64_t dbId) {
+		m_dbId = dbId;
+	}
+
+	/**
+	* Set the time when the job is due for execution.
+	* @param executionTime the time in milliseconds since the epoch
+	*/
+	void setExecutionTime(int64_t executionTime) {
+		m_executionTime = executionTime;
+	}
+
+	/**
+	* Set the parameter with the given name.
+	* @param name the parameter name
+	* @param value the parameter value
+	*/
+	void setParameter(std::string name,std::string value) {
+		m_parameters[name] = value;
+	}
+
+	/**
+	* Set the time when the job was first queued.
+	* @param queueTime the time in milliseconds since the epoch
+	*/
+	void setQueueTime(int64_t queueTime) {
+		m_queueTime = queueTime;
+	}
+
+	/**
+	* Set the uri of the script to execute.
+	* @param uri the uri of the script to execute
+	*/
+	void setUri(std::string uri) {
+		m_uri = uri;
+	}
+
+	/**
+	* Set the guid of the user that the script will be executed as.
+	* @param userGuid the guid of the user
+	*/
+	void setUserGuid(std::string userGuid) {
+		m_userGuid = userGuid;
+	}
+
+private:
+	std::map<std::string,std::string> m_parameters;
+
+	std::string m_uri;
+	std::string m_userGuid;
+
+	uint64_t m_dbId;
+
+	int64_t m_executionTime;
+	int64_t m_queueTime;
+
+	int m_attempts;
+};
+
+/**
+* ScriptRunner.
+* Singleton class that executes scripts headless on a bounded pool of
+* background threads. Scripts are run with no client attached, so any output
+* is discarded. A job is considered failed if the script raises an error or sets
+* a server error status code, in which case it's retried with an exponential backoff.
+* All queued jobs are persisted in the server database so they survive a restart.
+*/
+class ScriptRunner : public Singleton<ScriptRunner>,
+					 public Runnable
+{
+public:
+	/**
+	* Default constructor.
+	* @return instance
+	*/
+	ScriptRunner() : m_completedJobs(0),
+		m_executions(0),
+		m_failedJobs(0),
+		m_maxAttempts(0),
+		m_maxQueueSize(0),
+		m_maxWorkers(0),
+		m_retryDelay(0),
+		m_started(false),
+		m_totalLatency(0)
+	{
+
+	}
+
+	/**
+	* Destructor.
+	*/
+	~ScriptRunner() {
+		stop();
+	}
+
+	static const int BUFFER_SIZE;
+	static const int MAX_RETRY_DELAY;
+
+	/**
+	* Start the script runner.
+	* Any jobs persisted in the database will be queued for execution.
+	* @return true if the script runner was successfully started
+	*/
+	bool start();
+
+	/**
+	* Stop the script runner.
+	* Jobs still queued are kept in the database and
+	* will be picked up again the next time the script runner is started.
+	*/
+	void stop();
+
+	/**
+	* @override
+	*/
+	virtual void run();
+
+	/**
+	* Schedule a script for background execution.
+	* @param job the job to schedule. The uri, user and parameters should be set
+	* @param delay the number of milliseconds that the execution should be delayed
+	* @return true if the job was queued, false if the queue is full or could not be persisted
+	*/
+	bool schedule(ScriptJob job,unsigned long delay);
+
+	/**
+	* Get the average time in milliseconds that jobs waited
+	* past their due time before being executed.
+	* @return the average latency in milliseconds
+	*/
+	const int64_t getAverageLatency();
+
+	/**
+	* Get the number of jobs that has been executed successfully.
+	* @return the number of jobs that has been executed successfully
+	*/
+	const uint64_t getCompletedJobs();
+
+	/**
+	* Get the number of jobs that has been dropped, either after exceeding 
+	* the maximum attempts or because they could not be executed at all.
+	* @return the number of jobs that has been dropped
+	*/
+	const uint64_t getFailedJobs();
+
+	/**
+	* Get the number of jobs currently queued, including any waiting for a retry.
+	* @return the number of jobs currently queued
+	*/
+	const size_t getQueueSize();
+
+private:
+	enum ExecutionResult
+	{
+		EXECUTION_SUCCEEDED,
+		EXECUTION_FAILED,
+		EXECUTION_REJECTED
+	};
+
+	/**
+	* Get the current time in milliseconds since the epoch.
+	* @return the current time in milliseconds since the epoch
+	*/
+	static int64_t getCurrentTime();
+
+	/**
+	* Execute a job through the script engine.
+	* @param job the job to execute
+	* @return EXECUTION_SUCCEEDED if the script was executed successfully,
+	* EXECUTION_FAILED if the script failed and may be retried or
+	* EXECUTION_REJECTED if the job can never be executed
+	*/
+	ExecutionResult execute(const ScriptJob &job);
+
+	/**
+	* Load all persisted jobs from the database into the queue.
+	*/
+	void loadQueue();
+
+	/**
+	* Pop the next job that is due for execution.
+	* @param job out parameter for the popped job
+	* @param waitTime out parameter for the number of milliseconds until the next
+	* job is due. Zero if the queue is empty
+	* @return true if a job was popped
+	*/
+	bool popQueue(ScriptJob &job,unsigned long &waitTime);
+
+	/**
+	* Put a job into the queue, sorted by execution time.
+	* @param job the job to put into the queue
+	*/
+	void putQueue(const ScriptJob &job);
+
+	/**
+	* Notify all worker threads that the queue has changed.
+	*/
+	void notifyWorkers();
+
+	/**
+	* Insert a database entry for the given job.
+	* @param job the job to persist. The database id is updated on success
+	* @return true if the database entry was created
+	*/
+	bool insertDbEntry(ScriptJob &job);
+
+	/**
+	* Update the attempts and execution time of the database entry for the given job.
+	* @param job the job to update
+	*/
+	void updateDbEntry(const ScriptJob &job);
+
+	/**
+	* Delete the database entry for the given job.
+	* @param job the job to delete
+	*/
+	void deleteDbEntry(const ScriptJob &job);
+
+	/**
+	* Parse a url encoded parameter string.
+	* @param s the parameter string to parse
+	* @param job the job that will receive the parsed parameters
+	*/
+	static void parseParameters(const std::string &s,ScriptJob &job);
+
+	/**
+	* Format the job parameters as a url encoded string.
+	* @param job the job containing the parameters
+	* @return the url encoded parameter string
+	*/
+	static std::string formatParameters(const ScriptJob &job);
+
+	ACE_Mutex m_mutex;
+
+	Engine m_engine;
+
+	std::list<ScriptJob> m_queue;
+
+	std::list<Thread*> m_workers;
+
+	uint64_t m_completedJobs;
+	uint64_t m_executions;
+	uint64_t m_failedJobs;
+
+	int64_t m_totalLatency;
+
+	int m_maxAttempts;
+	int m_maxQueueSize;
+	int m_maxWorkers;
+	int m_retryDelay;
+
+	bool m_started;
+};
+
+#endif
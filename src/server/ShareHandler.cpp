@@ -31,12 +31,14 @@
 #include "logmanager.h"
 #include "sharemanager.h"
 #include "statisticsmanager.h"
+#include "streammonitor.h"
 #include "usermanager.h"
 
 const std::string ShareHandler::ATTRIBUTE_BANDWIDTH = "vibe.sharehandler.bandwidth";
 const std::string ShareHandler::ATTRIBUTE_LAST_DOWNLOAD = "vibe.sharehandler.lastdownload";
 const std::string ShareHandler::ATTRIBUTE_LAST_PLAYED = "vibe.sharehandler.lastplayed";
 const std::string ShareHandler::DEFAULT_MIME_TYPE = "text/plain;charset=iso-8859-1";
+const std::string ShareHandler::NAME = "ShareHandler";
 
 const int ShareHandler::IO_BUFFER_SIZE = 2048;
 
@@ -103,6 +105,8 @@ bool ShareHandler::handleRequest(HttpWorker *worker,
 	DatabaseConnection *conn = DatabaseManager::getInstance()->getConnection(DatabaseManager::DATABASE_INDEX);
 	if ( conn!=NULL )
 	{
+		TraceScope scope(httpRequest.getTrace(),"query");
+
 		try
 		{
 			std::stringstream query;
@@ -169,6 +173,7 @@ bool ShareHandler::handleRequest(HttpWorker *worker,
 			mimeType = DEFAULT_MIME_TYPE;
 		}
 
+		TraceScope scope(httpRequest.getTrace(),"sendStream");
 		success = sendStream(httpRequest,httpResponse,file,mimeType);
 
 		fclose(file);
@@ -195,9 +200,7 @@ bool ShareHandler::sendStream(HttpServerRequest &httpRequest,
 		// disable client cache
 		if ( !httpRequest.getParameter("allowcaching",NULL) )
 		{
-			tm localTime;
-			Util::TimeUtil::getLocalTime(&localTime);
-			std::string modifiedTime = Util::TimeUtil::format(localTime,"%a, %d %b %Y %H:%M:%S GMT");
+			std::string modifiedTime = Util::TimeUtil::formatHttpDate(Util::TimeUtil::getCalendarTime());
 
 			httpResponse.setHeader("Cache-Control","no-store,no-cache,must-revalidate,max-age=0");
 			httpResponse.setHeader("Pragma","no-cache");
@@ -220,9 +223,18 @@ bool ShareHandler::sendStream(HttpServerRequest &httpRequest,
 		char *buffer = new char[IO_BUFFER_SIZE];
 		memset(buffer,0,IO_BUFFER_SIZE);
 
+		StreamMonitor::getInstance()->addStream();
+
+		// reads are timed so that background work can back off when the disk is busy
+		ACE_Time_Value readStartTime = ACE_High_Res_Timer::gettimeofday();
+
 		size_t bytesRead = 0;
 		while ( (bytesRead = fread(buffer,sizeof(char),IO_BUFFER_SIZE,file))>0 )
 		{
+			ACE_UINT64 readTime = 0;
+			(ACE_High_Res_Timer::gettimeofday()-readStartTime).to_usec(readTime);
+			StreamMonitor::getInstance()->addRead(readTime);
+
 			if ( Thread::current()->isInterrupted() ) {
 				break;
 			}
@@ -252,8 +264,12 @@ bool ShareHandler::sendStream(HttpServerRequest &httpRequest,
 			}
 
 			memset(buffer,0,IO_BUFFER_SIZE);
+
+			readStartTime = ACE_High_Res_Timer::gettimeofday();
 		}
 
+		StreamMonitor::getInstance()->removeStream();
+
 		httpResponse.flush();
 
 		delete[] buffer;
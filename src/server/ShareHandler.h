@@ -40,6 +40,7 @@ public:
 	static const std::string ATTRIBUTE_LAST_DOWNLOAD;
 	static const std::string ATTRIBUTE_LAST_PLAYED;
 	static const std::string DEFAULT_MIME_TYPE;
+	static const std::string NAME;
 
 	static const int IO_BUFFER_SIZE;
 
@@ -59,6 +60,13 @@ public:
 	virtual bool handleRequest(HttpWorker *worker,
 		HttpServerRequest &httpRequest,HttpServerResponse &httpResponse);
 
+	/**
+	* @override
+	*/
+	virtual const std::string& getName() const {
+		return NAME;
+	}
+
 private:
 	/**
 	* Send the stream to the connected client.
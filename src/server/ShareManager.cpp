@@ -20,6 +20,9 @@
 
 #define LOGGER_CLASSNAME "ShareManager"
 
+#include <ace/os.h>
+#include <set>
+
 #include "../tinyxml/tinyxml.h"
 
 #include "databasemanager.h"
@@ -30,9 +33,10 @@ int ShareManager::load()
 {
 	LogManager::getInstance()->debug(LOGGER_CLASSNAME,"Loading");
 
-	ACE_Write_Guard<ACE_Mutex> guard(m_mutex);
+	ACE_Write_Guard<ProfiledMutex> guard(m_mutex);
 
 	m_shares.clear();
+	m_dirty = false;
 
 	TiXmlDocument document;
 	document.LoadFile("conf\\shares.xml");
@@ -138,8 +142,6 @@ int ShareManager::load()
 
 			share.setTransactions(Share::TRANSACTION_NONE);
 
-			prepareDbEntry(share);
-
 			share.setManager(this);
 			m_shares.push_back(share);
 
@@ -147,12 +149,31 @@ int ShareManager::load()
 		}
 	}
 
+	prepareDbEntries();
+
 	return 0;
 }
 
 int ShareManager::save()
 {
-	ACE_Write_Guard<ACE_Mutex> guard(m_mutex);
+	// saves are serialized so that an older snapshot never replaces a newer one
+	ACE_Guard<ACE_Mutex> saveGuard(m_saveMutex);
+
+	std::list<Share> shares;
+
+	// the lock is only held while the snapshot is taken and not while 
+	// the document is built and written, so that lookups aren't blocked
+	m_mutex.acquire();
+
+	if ( !m_dirty ) {
+		m_mutex.release();
+		return 0;
+	}
+
+	shares = m_shares;
+	m_dirty = false;
+
+	m_mutex.release();
 
 	LogManager::getInstance()->debug(LOGGER_CLASSNAME,"Saving");
 
@@ -169,7 +190,7 @@ int ShareManager::save()
 
 		// save all share instances
 		std::list<Share>::iterator iter;
-		for ( iter=m_shares.begin(); iter!=m_shares.end(); iter++ ) 
+		for ( iter=shares.begin(); iter!=shares.end(); iter++ ) 
 		{
 			TiXmlNode *shareNode = sharesNode->InsertEndChild(TiXmlElement("share"));
 			if ( shareNode!=NULL )	
@@ -231,7 +252,15 @@ int ShareManager::save()
 		document.InsertBeforeChild(document.FirstChild(),TiXmlDeclaration("1.0","iso-8859-1","yes"));
 	}
 
-	if ( !document.SaveFile() ) {
+	// the file is replaced by a rename so that it's never left partially written
+	if ( !document.SaveFile("conf\\shares.xml.tmp") || ACE_OS::rename("conf\\shares.xml.tmp","conf\\shares.xml")!=0 ) 
+	{
+		ACE_OS::unlink("conf\\shares.xml.tmp");
+
+		m_mutex.acquire();
+		m_dirty = true;
+		m_mutex.release();
+
 		return 1;
 	}
 
@@ -280,6 +309,65 @@ bool ShareManager::prepareDbEntry(Share &share)
 	return success;
 }
 
+void ShareManager::prepareDbEntries()
+{
+	if ( m_shares.empty() ) {
+		return;
+	}
+
+	DatabaseConnection *conn = DatabaseManager::getInstance()->getConnection(DatabaseManager::DATABASE_SERVER,true);
+	if ( conn==NULL ) {
+		return;
+	}
+
+	try
+	{
+		std::set<uint64_t> shareIds;
+
+		// all existing entries are read at once instead of looking up every share
+		sqlite3x::sqlite3_command cmd(conn->getSqliteConn(),"SELECT shareId FROM [shares]");
+		sqlite3x::sqlite3_reader reader = cmd.executereader();
+		while ( reader.read() ) {
+			shareIds.insert(reader.getint64(0));
+		}
+
+		reader.close();
+
+		// the missing entries are created in a single transaction, and the shares 
+		// are only given their new database ids once it has been committed
+		std::map<Share*,uint64_t> createdEntries;
+
+		sqlite3x::sqlite3_transaction transaction(conn->getSqliteConn());
+
+		for ( std::list<Share>::iterator iter=m_shares.begin(); iter!=m_shares.end(); iter++ )
+		{
+			if ( iter->getDbId()>0 && shareIds.find(iter->getDbId())!=shareIds.end() ) {
+				continue;
+			}
+
+			conn->getSqliteConn().executenonquery("INSERT INTO [shares] (guid) "
+				"VALUES ('" + conn->quote(iter->getGuid()) + "')");
+
+			createdEntries[&(*iter)] = conn->getSqliteConn().insertid();
+		}
+
+		transaction.commit();
+
+		if ( !createdEntries.empty() ) {
+			m_dirty = true;
+		}
+
+		for ( std::map<Share*,uint64_t>::iterator iter=createdEntries.begin(); iter!=createdEntries.end(); iter++ ) {
+			iter->first->setDbId(iter->second);
+		}
+	}
+	catch(exception &ex) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not prepare database entries for shares [%s]",ex.what());
+	}
+
+	DatabaseManager::getInstance()->releaseConnection(conn);
+}
+
 void ShareManager::deleteDbEntry(const Share &share)
 {
 	DatabaseConnection *conn = DatabaseManager::getInstance()->getConnection(DatabaseManager::DATABASE_SERVER,true);
@@ -308,6 +396,7 @@ bool ShareManager::addShare(Share &share)
 
 		m_mutex.acquire();
 		m_shares.push_back(share);
+		m_dirty = true;
 		m_mutex.release();
 
 		LogManager::getInstance()->info(LOGGER_CLASSNAME,"Added share '%s'",share.getName().c_str());
@@ -331,6 +420,7 @@ bool ShareManager::removeShare(const Share &share)
 		if ( iter->getGuid()==share.getGuid() ) {
 			removedShare = new Share(*iter);
 			m_shares.erase(iter);
+			m_dirty = true;
 			break;
 		}
 	}
@@ -416,6 +506,11 @@ bool ShareManager::updateShare(Share &share)
 	share.setTransactions(Share::TRANSACTION_NONE);
 	managedShare->setTransactions(Share::TRANSACTION_NONE);
 
+	// the counters are read from the index and aren't saved
+	if ( transactions & ~(Share::TRANSACTION_SETDIRECTORIES | Share::TRANSACTION_SETFILES | Share::TRANSACTION_SETSIZE) ) {
+		m_dirty = true;
+	}
+
 	Share updatedShare = *managedShare;
 
 	m_mutex.release();
@@ -427,7 +522,7 @@ bool ShareManager::updateShare(Share &share)
 
 bool ShareManager::findShareByDbId(uint64_t dbId,Share *share)
 {
-	ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+	ACE_Read_Guard<ProfiledMutex> guard(m_mutex);
 
 	std::list<Share>::iterator iter;
 	for ( iter=m_shares.begin(); iter!=m_shares.end(); iter++ ) 
@@ -447,7 +542,7 @@ bool ShareManager::findShareByDbId(uint64_t dbId,Share *share)
 
 bool ShareManager::findShareByGuid(const std::string &guid,Share *share)
 {
-	ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+	ACE_Read_Guard<ProfiledMutex> guard(m_mutex);
 
 	std::list<Share>::iterator iter;
 	for ( iter=m_shares.begin(); iter!=m_shares.end(); iter++ ) 
@@ -467,7 +562,7 @@ bool ShareManager::findShareByGuid(const std::string &guid,Share *share)
 
 bool ShareManager::findShareByName(const std::string &name,Share *share)
 {
-	ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+	ACE_Read_Guard<ProfiledMutex> guard(m_mutex);
 
 	std::list<Share>::iterator iter;
 	for ( iter=m_shares.begin(); iter!=m_shares.end(); iter++ ) 
@@ -487,7 +582,7 @@ bool ShareManager::findShareByName(const std::string &name,Share *share)
 
 std::list<Share> ShareManager::getShares()
 {
-	ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+	ACE_Read_Guard<ProfiledMutex> guard(m_mutex);
 
 	std::list<Share> shares;
 
@@ -501,7 +596,7 @@ std::list<Share> ShareManager::getShares()
 
 std::list<Share> ShareManager::getSharesToIndex()
 {
-	ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+	ACE_Read_Guard<ProfiledMutex> guard(m_mutex);
 
 	std::list<Share> shares;
 
@@ -22,6 +22,7 @@
 
 #include "eventbroadcaster.h"
 #include "persistentmanager.h"
+#include "profiledmutex.h"
 #include "share.h"
 #include "singleton.h"
 
@@ -66,6 +67,16 @@ class ShareManager : public Singleton<ShareManager>,
 					 public PersistentManager
 {
 public:
+	/**
+	* Default constructor.
+	* @return instance
+	*/
+	ShareManager() : m_dirty(false),
+		m_mutex("ShareManager") 
+	{
+
+	}
+
 	/**
 	* @override
 	*/
@@ -128,7 +139,7 @@ public:
 	* @return the number of shares in the manager
 	*/
 	const size_t getShareCount() {
-		ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+		ACE_Read_Guard<ProfiledMutex> guard(m_mutex);
 		return m_shares.size();
 	}
 
@@ -156,15 +167,27 @@ private:
 	*/
 	bool prepareDbEntry(Share &share);
 
+	/**
+	* Prepare the database entries for all loaded shares.
+	* The existing entries are read and any missing entries created in a single
+	* transaction, instead of preparing the entry of every share by itself.
+	* The calling thread must hold the lock.
+	*/
+	void prepareDbEntries();
+
 	/**
 	* Delete the database entry for the given share
 	* @param share the share to delete the database entry for
 	*/
 	void deleteDbEntry(const Share &share);
 
-	ACE_Mutex m_mutex;
+	ACE_Mutex m_saveMutex;
+
+	ProfiledMutex m_mutex;
 
 	std::list<Share> m_shares;
+
+	bool m_dirty;
 };
 
 #endif
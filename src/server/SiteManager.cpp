@@ -27,7 +27,7 @@
 
 int SiteManager::load()
 {
-	ACE_Write_Guard<ACE_Mutex> guard(m_mutex);
+	ACE_Write_Guard<ProfiledMutex> guard(m_mutex);
 
 	LogManager::getInstance()->debug(LOGGER_CLASSNAME,"Loading");
 
@@ -195,7 +195,7 @@ int SiteManager::load()
 
 int SiteManager::save()
 {
-	ACE_Write_Guard<ACE_Mutex> guard(m_mutex);
+	ACE_Write_Guard<ProfiledMutex> guard(m_mutex);
 
 	LogManager::getInstance()->debug(LOGGER_CLASSNAME,"Saving");
 
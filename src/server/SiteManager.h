@@ -22,6 +22,7 @@
 
 #include "mutexpool.h"
 #include "persistentmanager.h"
+#include "profiledmutex.h"
 #include "singleton.h"
 #include "site.h"
 /**
@@ -36,8 +37,8 @@ public:
 	* Default constructor.
 	* @return instance
 	*/
-	SiteManager() {
-		m_mutexPool.init(5); // create mutex pool (for locking individual sites)
+	SiteManager() : m_mutex("SiteManager") {
+		m_mutexPool.init(5,"SiteManager.sites"); // create mutex pool (for locking individual sites)
 	}
 
 	/**
@@ -83,7 +84,7 @@ public:
 	}
 
 private:
-	ACE_Mutex m_mutex;
+	ProfiledMutex m_mutex;
 
 	MutexPool m_mutexPool;
 
@@ -25,32 +25,58 @@
 #include "logmanager.h"
 #include "taskrunner.h"
 
-void DownloadStatistics::add(uint64_t files,uint64_t size,time_t timeStamp)
+StatisticsPeriods StatisticsPeriods::fromTime(time_t calendarTime)
 {
-	tm currentTimeLocal;
-	tm timeStampLocal;
+	tm localTime;
+	Util::TimeUtil::getLocalTime(calendarTime,&localTime);
 
-	Util::TimeUtil::getLocalTime(&currentTimeLocal);
-	Util::TimeUtil::getLocalTime(timeStamp,&timeStampLocal);
+	localTime.tm_hour = 0;
+	localTime.tm_min = 0;
+	localTime.tm_sec = 0;
+	localTime.tm_isdst = -1;
 
-	if ( timeStampLocal.tm_year==currentTimeLocal.tm_year
-		&& timeStampLocal.tm_mon==currentTimeLocal.tm_mon
-		&& timeStampLocal.tm_mday==currentTimeLocal.tm_mday )
-	{
+	StatisticsPeriods periods;
+
+	tm dayTime = localTime;
+	periods.m_dayStart = mktime(&dayTime);
+
+	tm nextDayTime = localTime;
+	nextDayTime.tm_mday += 1;
+	periods.m_nextDayStart = mktime(&nextDayTime);
+
+	tm monthTime = localTime;
+	monthTime.tm_mday = 1;
+	periods.m_monthStart = mktime(&monthTime);
+
+	// weeks start on sundays, but never before the start of the year
+	tm weekTime = localTime;
+	if ( localTime.tm_yday<localTime.tm_wday ) {
+		weekTime.tm_mon = 0;
+		weekTime.tm_mday = 1;
+	}
+	else {
+		weekTime.tm_mday -= localTime.tm_wday;
+	}
+	periods.m_weekStart = mktime(&weekTime);
+
+	return periods;
+}
+
+void DownloadStatistics::add(uint64_t files,uint64_t size,time_t timeStamp,const StatisticsPeriods &periods)
+{
+	update(periods);
+
+	if ( timeStamp>=periods.getDayStart() ) {
 		m_dayDownloadedFiles += files;
 		m_dayDownloadedBytes += size;
 	}
 
-	if ( timeStampLocal.tm_year==currentTimeLocal.tm_year
-		&& timeStampLocal.tm_mon==currentTimeLocal.tm_mon )
-	{
+	if ( timeStamp>=periods.getMonthStart() ) {
 		m_monthDownloadedFiles += files;
 		m_monthDownloadedBytes += size;
 	}
 
-	if ( timeStampLocal.tm_year==currentTimeLocal.tm_year
-		&& Util::TimeUtil::format(timeStampLocal,"%U")==Util::TimeUtil::format(currentTimeLocal,"%U") )
-	{
+	if ( timeStamp>=periods.getWeekStart() ) {
 		m_weekDownloadedFiles += files;
 		m_weekDownloadedBytes += size;
 	}
@@ -59,235 +85,312 @@ void DownloadStatistics::add(uint64_t files,uint64_t size,time_t timeStamp)
 	m_totalDownloadedBytes += size;
 }
 
-void DownloadStatistics::update()
+void DownloadStatistics::update(const StatisticsPeriods &periods)
 {
-	time_t currentTime = Util::TimeUtil::getCalendarTime();
+	// check if daily download statistics should be reset
+	if ( m_dayStart!=periods.getDayStart() ) {
+		m_dayDownloadedFiles = 0;
+		m_dayDownloadedBytes = 0;
+		m_dayStart = periods.getDayStart();
+	}
 
-	if ( m_lastUpdateTime>0 )
-	{
-		tm currentTimeLocal;
-		tm lastUpdateTimeLocal;
+	// check if monthly download statistics should be reset
+	if ( m_monthStart!=periods.getMonthStart() ) {
+		m_monthDownloadedFiles = 0;
+		m_monthDownloadedBytes = 0;
+		m_monthStart = periods.getMonthStart();
+	}
 
-		Util::TimeUtil::getLocalTime(currentTime,&currentTimeLocal);
-		Util::TimeUtil::getLocalTime(m_lastUpdateTime,&lastUpdateTimeLocal);
+	// check if weekly download statistics should be reset
+	if ( m_weekStart!=periods.getWeekStart() ) {
+		m_weekDownloadedFiles = 0;
+		m_weekDownloadedBytes = 0;
+		m_weekStart = periods.getWeekStart();
+	}
+}
 
-		// check if daily download statistics should be reset
-		if ( !(lastUpdateTimeLocal.tm_year==currentTimeLocal.tm_year
-			&& lastUpdateTimeLocal.tm_mon==currentTimeLocal.tm_mon
-			&& lastUpdateTimeLocal.tm_mday==currentTimeLocal.tm_mday) )
-		{
-			m_dayDownloadedFiles = 0;
-			m_dayDownloadedBytes = 0;
-		}
+int StatisticsManager::load()
+{
+	ACE_Write_Guard<ProfiledRWMutex> guard(m_mutex);
 
-		// check if monthly download statistics should be reset
-		if ( !(lastUpdateTimeLocal.tm_year==currentTimeLocal.tm_year
-			&& lastUpdateTimeLocal.tm_mon==currentTimeLocal.tm_mon) )
-		{
-			m_monthDownloadedFiles = 0;
-			m_monthDownloadedBytes = 0;
-		}
+	LogManager::getInstance()->debug(LOGGER_CLASSNAME,"Loading");
+
+	m_downloadStatistics.clear();
+
+	migrateDownloads();
 
-		// check if weekly download statistics should be reset
-		if ( !(lastUpdateTimeLocal.tm_year==currentTimeLocal.tm_year
-			&& Util::TimeUtil::format(lastUpdateTimeLocal,"%U")==Util::TimeUtil::format(currentTimeLocal,"%U")) )
+	StatisticsPeriods periods = getPeriods();
+
+	DatabaseConnection *conn = DatabaseManager::getInstance()->getConnection(DatabaseManager::DATABASE_SERVER);
+	if ( conn==NULL ) {
+		return 0;
+	}
+
+	try
+	{
+		// sum up the daily rollups for every period in a single pass
+		std::stringstream query;
+		query << "SELECT userId,"
+				<< "SUM(CASE WHEN day>=" << periods.getDayStart() << " THEN files ELSE 0 END),"
+				<< "SUM(CASE WHEN day>=" << periods.getDayStart() << " THEN size ELSE 0 END),"
+				<< "SUM(CASE WHEN day>=" << periods.getMonthStart() << " THEN files ELSE 0 END),"
+				<< "SUM(CASE WHEN day>=" << periods.getMonthStart() << " THEN size ELSE 0 END),"
+				<< "SUM(CASE WHEN day>=" << periods.getWeekStart() << " THEN files ELSE 0 END),"
+				<< "SUM(CASE WHEN day>=" << periods.getWeekStart() << " THEN size ELSE 0 END),"
+				<< "SUM(files),"
+				<< "SUM(size) "
+			<< "FROM [downloaddays] GROUP BY userId";
+
+		sqlite3x::sqlite3_command cmd(conn->getSqliteConn(),query.str());
+		sqlite3x::sqlite3_reader reader = cmd.executereader();
+
+		while ( reader.read() ) 
 		{
-			m_weekDownloadedFiles = 0;
-			m_weekDownloadedBytes = 0;
+			DownloadStatistics downloadStatistics(reader.getint64(0));
+			downloadStatistics.update(periods);
+			downloadStatistics.setDayDownloads(reader.getint64(1),reader.getint64(2));
+			downloadStatistics.setMonthDownloads(reader.getint64(3),reader.getint64(4));
+			downloadStatistics.setWeekDownloads(reader.getint64(5),reader.getint64(6));
+			downloadStatistics.setTotalDownloads(reader.getint64(7),reader.getint64(8));
+
+			m_downloadStatistics.insert(std::make_pair(downloadStatistics.getUserId(),downloadStatistics));
 		}
 	}
+	catch(exception &ex) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not load download statistics [%s]",ex.what());
+	}
 
-	m_lastUpdateTime = currentTime;
-}
+	DatabaseManager::getInstance()->releaseConnection(conn);
 
-int StatisticsManager::load()
-{
-	ACE_Write_Guard<ACE_Mutex> guard(m_mutex);
-
-	LogManager::getInstance()->debug(LOGGER_CLASSNAME,"Loading");
+	LogManager::getInstance()->debug(LOGGER_CLASSNAME,"Loaded download statistics for %d users",(int)m_downloadStatistics.size());
 
 	return 0;
 }
 
 int StatisticsManager::save()
 {
-	ACE_Write_Guard<ACE_Mutex> guard(m_mutex);
-
 	LogManager::getInstance()->debug(LOGGER_CLASSNAME,"Saving");
 
+	std::map<PendingKey,PendingDownloads> pendingDownloads;
+
+	{
+		ACE_Guard<ACE_Mutex> guard(m_pendingMutex);
+		pendingDownloads.swap(m_pendingDownloads);
+	}
+
+	if ( pendingDownloads.empty() ) {
+		return 0;
+	}
+
 	DatabaseConnection *conn = DatabaseManager::getInstance()->getConnection(DatabaseManager::DATABASE_SERVER,true);
-	if ( conn!=NULL )
+	if ( conn==NULL ) {
+		mergePendingDownloads(pendingDownloads);
+		return 0;
+	}
+
+	try
 	{
-		try
-		{
-			sqlite3x::sqlite3_transaction transaction(conn->getSqliteConn(),true);
+		sqlite3x::sqlite3_transaction transaction(conn->getSqliteConn(),true);
 
-			std::list<DownloadEntry>::iterator iter;
-			for ( iter=m_downloadEntries.begin(); iter!=m_downloadEntries.end(); iter++ )
-			{				
-				try
-				{
-					uint64_t downloadId = 0;
-
-					std::stringstream query;
-					query << "SELECT downloadId FROM [downloads] "
-						<< "WHERE DATE(timeStamp,'unixepoch')=DATE(" << iter->getTimeStamp() << ",'unixepoch') "
-						<< "AND userId=" << iter->getUserId() << " LIMIT 1";
-
-					sqlite3x::sqlite3_command cmd(conn->getSqliteConn(),query.str());
-					sqlite3x::sqlite3_reader reader = cmd.executereader();
-
-					if ( reader.read() ) {
-						downloadId = reader.getint64(0);
-					}
-
-					std::stringstream appendQuery;
-
-					if ( downloadId>0 )
-					{
-						appendQuery << "UPDATE [downloads] "
-							<< "SET files=files+1,"
-							<< "size=size+" << iter->getSize() << ","
-							<< "timeStamp=" << iter->getTimeStamp() << " "
-							<< "WHERE downloadId=" << downloadId;
-					}
-					else 
-					{
-						appendQuery << "INSERT INTO [downloads] ("
-								<< "userId,"
-								<< "files,"
-								<< "size,"
-								<< "timeStamp) "
-							<< "VALUES ("
-								<< iter->getUserId() << ","
-								<< "1" << ","
-								<< iter->getSize() << ","
-								<< iter->getTimeStamp() << ")";
-					}
-
-					conn->getSqliteConn().executenonquery(appendQuery.str());
-				}
-				catch(exception &ex) {
-					LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not save download statistics [%s]",ex.what());
-				}
-			}
+		// the bundled sqlite has no upsert, so make sure the rollup exists and then add to it
+		sqlite3x::sqlite3_command insertCmd(conn->getSqliteConn(),
+			"INSERT OR IGNORE INTO [downloaddays] (userId,day,files,size,timeStamp) VALUES (?,?,0,0,?)");
 
-			transaction.commit();
+		sqlite3x::sqlite3_command updateCmd(conn->getSqliteConn(),
+			"UPDATE [downloaddays] SET files=files+?,size=size+?,timeStamp=MAX(timeStamp,?) WHERE userId=? AND day=?");
 
-			m_downloadEntries.clear();
-		}
-		catch(exception &ex) {
-			LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not save download statistics [%s]",ex.what());
+		std::map<PendingKey,PendingDownloads>::iterator iter;
+		for ( iter=pendingDownloads.begin(); iter!=pendingDownloads.end(); iter++ )
+		{
+			insertCmd.bind(1,(long long)iter->first.first);
+			insertCmd.bind(2,(long long)iter->first.second);
+			insertCmd.bind(3,(long long)iter->second.timeStamp);
+			insertCmd.executenonquery();
+
+			updateCmd.bind(1,(long long)iter->second.files);
+			updateCmd.bind(2,(long long)iter->second.size);
+			updateCmd.bind(3,(long long)iter->second.timeStamp);
+			updateCmd.bind(4,(long long)iter->first.first);
+			updateCmd.bind(5,(long long)iter->first.second);
+			updateCmd.executenonquery();
 		}
 
-		DatabaseManager::getInstance()->releaseConnection(conn);
+		transaction.commit();
+	}
+	catch(exception &ex) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not save download statistics [%s]",ex.what());
+		mergePendingDownloads(pendingDownloads);
 	}
 
+	DatabaseManager::getInstance()->releaseConnection(conn);
+
 	return 0;
 }
 
+void StatisticsManager::migrateDownloads()
+{
+	DatabaseConnection *conn = DatabaseManager::getInstance()->getConnection(DatabaseManager::DATABASE_SERVER,true);
+	if ( conn==NULL ) {
+		return;
+	}
+
+	try
+	{
+		if ( conn->getSqliteConn().executeint("SELECT COUNT(*) FROM sqlite_master WHERE type='table' AND name='downloads'")>0 ) 
+		{
+			LogManager::getInstance()->info(LOGGER_CLASSNAME,"Migrating downloads into daily rollups");
+
+			sqlite3x::sqlite3_transaction transaction(conn->getSqliteConn(),true);
+
+			conn->getSqliteConn().executenonquery("INSERT OR IGNORE INTO [downloaddays] (userId,day,files,size,timeStamp) "
+				"SELECT userId,CAST(strftime('%s',DATE(timeStamp,'unixepoch','localtime'),'utc') AS INTEGER),SUM(files),SUM(size),MAX(timeStamp) "
+				"FROM [downloads] GROUP BY userId,DATE(timeStamp,'unixepoch','localtime')");
+			conn->getSqliteConn().executenonquery("DROP TABLE [downloads]");
+
+			transaction.commit();
+		}
+	}
+	catch(exception &ex) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not migrate downloads [%s]",ex.what());
+	}
+
+	DatabaseManager::getInstance()->releaseConnection(conn);
+}
+
 void StatisticsManager::deleteDbEntry(uint64_t userId)
 {
 	std::stringstream taskQuery;
-	taskQuery << "DELETE FROM [downloads] WHERE userId=" << userId;
+	taskQuery << "DELETE FROM [downloaddays] WHERE userId=" << userId;
 	TaskRunner::getInstance()->schedule(new DatabaseTask(DatabaseManager::DATABASE_SERVER,taskQuery.str(),true));
 }
 
 void StatisticsManager::addDownload(const DownloadEntry &downloadEntry)
 {
-	ACE_Write_Guard<ACE_Mutex> guard(m_mutex);
+	StatisticsPeriods periods = getPeriods();
 
-	time_t currentTime = Util::TimeUtil::getCalendarTime();
+	bool exists = false;
 
-	User user;
-	if ( UserManager::getInstance()->findUserByDbId(downloadEntry.getUserId(),&user) )
 	{
-		DownloadStatistics *downloadStatistics = loadDownloadStatistics(user);
-		downloadStatistics->add(1,downloadEntry.getSize(),downloadEntry.getTimeStamp());
+		ACE_Read_Guard<ProfiledRWMutex> guard(m_mutex);
+		exists = m_downloadStatistics.find(downloadEntry.getUserId())!=m_downloadStatistics.end();
+	}
 
-		m_downloadEntries.push_back(downloadEntry);
+	if ( !exists ) 
+	{
+		// only verify the user the first time it downloads anything
+		User user;
+		if ( !UserManager::getInstance()->findUserByDbId(downloadEntry.getUserId(),&user) ) {
+			return;
+		}
+
+		// another download by the user may have inserted the statistics already
+		ACE_Write_Guard<ProfiledRWMutex> guard(m_mutex);
+		m_downloadStatistics.insert(std::make_pair(user.getDbId(),DownloadStatistics(user.getDbId())));
+	}
+
+	{
+		ACE_Read_Guard<ProfiledRWMutex> guard(m_mutex);
+
+		// the statistics may have been cleared since they were inserted
+		std::map<uint64_t,DownloadStatistics>::iterator iter = m_downloadStatistics.find(downloadEntry.getUserId());
+		if ( iter==m_downloadStatistics.end() ) {
+			return;
+		}
+
+		DownloadStatistics *downloadStatistics = &iter->second;
+
+		m_mutexPool.lock(downloadStatistics);
+		downloadStatistics->add(1,downloadEntry.getSize(),downloadEntry.getTimeStamp(),periods);
+		m_mutexPool.release(downloadStatistics);
+
+		// sum up the download with any other downloads by the user the same day
+		ACE_Guard<ACE_Mutex> pendingGuard(m_pendingMutex);
+
+		PendingDownloads &pendingDownloads = m_pendingDownloads[PendingKey(downloadEntry.getUserId(),
+			periods.getDayStart(downloadEntry.getTimeStamp()))];
+
+		pendingDownloads.files++;
+		pendingDownloads.size += downloadEntry.getSize();
+
+		if ( downloadEntry.getTimeStamp()>pendingDownloads.timeStamp ) {
+			pendingDownloads.timeStamp = downloadEntry.getTimeStamp();
+		}
 	}
 }
 
 void StatisticsManager::clearDownloads(const User &user)
 {
-	ACE_Write_Guard<ACE_Mutex> guard(m_mutex);
+	ACE_Write_Guard<ProfiledRWMutex> guard(m_mutex);
 
-	// remove all download entries for the user
-	std::list<DownloadEntry>::iterator entryIter;
-	for ( entryIter=m_downloadEntries.begin(); entryIter!=m_downloadEntries.end(); ) {
-		if ( entryIter->getUserId()==user.getDbId() ) {
-			entryIter = m_downloadEntries.erase(entryIter);
-		}
-		else {
-			entryIter++;
+	// remove all pending downloads for the user
+	{
+		ACE_Guard<ACE_Mutex> pendingGuard(m_pendingMutex);
+
+		std::map<PendingKey,PendingDownloads>::iterator iter;
+		for ( iter=m_pendingDownloads.begin(); iter!=m_pendingDownloads.end(); ) {
+			if ( iter->first.first==user.getDbId() ) {
+				m_pendingDownloads.erase(iter++);
+			}
+			else {
+				iter++;
+			}
 		}
 	}
 
 	// remove download statistics for the user
-	std::list<DownloadStatistics>::iterator statsIter;
-	for ( statsIter=m_downloadStatistics.begin(); statsIter!=m_downloadStatistics.end(); statsIter++ ) {
-		if ( statsIter->getUserId()==user.getDbId() ) {
-			m_downloadStatistics.erase(statsIter);
-			break;
-		}
-	}
+	m_downloadStatistics.erase(user.getDbId());
 
 	deleteDbEntry(user.getDbId());
 }
 
 DownloadStatistics StatisticsManager::getDownloadStatistics(const User &user)
 {
-	ACE_Write_Guard<ACE_Mutex> guard(m_mutex);
+	StatisticsPeriods periods = getPeriods();
 
-	return *loadDownloadStatistics(user);
-}
+	ACE_Read_Guard<ProfiledRWMutex> guard(m_mutex);
 
-DownloadStatistics* StatisticsManager::loadDownloadStatistics(const User &user)
-{
-	DownloadStatistics *downloadStatistics = NULL;
-
-	// find existing download statistics
-	std::list<DownloadStatistics>::iterator iter;
-	for ( iter=m_downloadStatistics.begin(); iter!=m_downloadStatistics.end(); iter++ ) {
-		if ( iter->getUserId()==user.getDbId() ) {
-			downloadStatistics = &*iter;
-			break;
-		}
+	std::map<uint64_t,DownloadStatistics>::iterator iter = m_downloadStatistics.find(user.getDbId());
+	if ( iter==m_downloadStatistics.end() ) {
+		return DownloadStatistics(user.getDbId());
 	}
 
-	if ( downloadStatistics==NULL )
-	{
-		// create download statistics for the user
-		m_downloadStatistics.push_back(DownloadStatistics(user.getDbId()));
-		downloadStatistics = &m_downloadStatistics.back();
+	DownloadStatistics *downloadStatistics = &iter->second;
 
-		DatabaseConnection *conn = DatabaseManager::getInstance()->getConnection(DatabaseManager::DATABASE_SERVER);
-		if ( conn!=NULL )
-		{
-			try
-			{
-				std::stringstream query;
-				query << "SELECT files,size,timeStamp FROM [downloads] WHERE userId=" << user.getDbId();
+	m_mutexPool.lock(downloadStatistics);
+	downloadStatistics->update(periods);
+	DownloadStatistics copy = *downloadStatistics;
+	m_mutexPool.release(downloadStatistics);
 
-				sqlite3x::sqlite3_command cmd(conn->getSqliteConn(),query.str());
-				sqlite3x::sqlite3_reader reader = cmd.executereader();
+	return copy;
+}
 
-				while ( reader.read() ) {
-					downloadStatistics->add(reader.getint64(0),reader.getint64(1),reader.getint64(2));
-				}
-			}
-			catch(exception &ex) {
-				LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not get download statistics for user '%s' [%s]",user.getName().c_str(),ex.what());
-			}
+StatisticsPeriods StatisticsManager::getPeriods()
+{
+	ACE_Guard<ACE_Mutex> guard(m_periodsMutex);
 
-			DatabaseManager::getInstance()->releaseConnection(conn);
-		}
+	time_t currentTime = Util::TimeUtil::getCalendarTime();
+	if ( currentTime>=m_periods.getNextDayStart() ) {
+		m_periods = StatisticsPeriods::fromTime(currentTime);
 	}
 
-	downloadStatistics->update();
+	return m_periods;
+}
+
+void StatisticsManager::mergePendingDownloads(const std::map<PendingKey,PendingDownloads> &pendingDownloads)
+{
+	ACE_Guard<ACE_Mutex> guard(m_pendingMutex);
 
-	return downloadStatistics;
+	std::map<PendingKey,PendingDownloads>::const_iterator iter;
+	for ( iter=pendingDownloads.begin(); iter!=pendingDownloads.end(); iter++ )
+	{
+		PendingDownloads &target = m_pendingDownloads[iter->first];
+		target.files += iter->second.files;
+		target.size += iter->second.size;
+
+		if ( iter->second.timeStamp>target.timeStamp ) {
+			target.timeStamp = iter->second.timeStamp;
+		}
+	}
 }
 
 void StatisticsManager::on(UserManagerListener::UserRemoved,const User &user)
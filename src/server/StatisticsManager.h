@@ -20,7 +20,9 @@
 
 #include <ace/synch.h>
 
+#include "mutexpool.h"
 #include "persistentmanager.h"
+#include "profiledmutex.h"
 #include "singleton.h"
 #include "usermanager.h"
 
@@ -75,6 +77,88 @@ private:
 	uint64_t m_userId;
 };
 
+/**
+* StatisticsPeriods.
+* Class representing the start times of the periods that download statistics are kept for.
+* The periods are calculated once for a day so that a download can be assigned
+* to a period by comparing time stamps alone.
+*/
+class StatisticsPeriods
+{
+public:
+	/**
+	* Default constructor.
+	* @return instance
+	*/
+	StatisticsPeriods() : m_dayStart(0),
+		m_monthStart(0),
+		m_nextDayStart(0),
+		m_weekStart(0)
+	{
+
+	}
+
+	/**
+	* Calculate the periods that the given time falls within.
+	* Weeks start on sundays and are numbered within the year, the same way as 
+	* the strftime %U format, so the first week of a year starts on january 1st.
+	* @param calendarTime the calendar time to calculate the periods for
+	* @return the periods that the given time falls within
+	*/
+	static StatisticsPeriods fromTime(time_t calendarTime);
+
+	/**
+	* Get the start of the day that the given time falls within.
+	* @param calendarTime the calendar time
+	* @return the start of the day that the given time falls within
+	*/
+	const time_t getDayStart(time_t calendarTime) const {
+		if ( calendarTime>=m_dayStart && calendarTime<m_nextDayStart ) {
+			return m_dayStart;
+		}
+
+		return fromTime(calendarTime).getDayStart();
+	}
+
+	/**
+	* Get the start of the current day.
+	* @return the start of the current day
+	*/
+	const time_t getDayStart() const {
+		return m_dayStart;
+	}
+
+	/**
+	* Get the start of the current month.
+	* @return the start of the current month
+	*/
+	const time_t getMonthStart() const {
+		return m_monthStart;
+	}
+
+	/**
+	* Get the start of the next day, which is when the periods expire.
+	* @return the start of the next day
+	*/
+	const time_t getNextDayStart() const {
+		return m_nextDayStart;
+	}
+
+	/**
+	* Get the start of the current week.
+	* @return the start of the current week
+	*/
+	const time_t getWeekStart() const {
+		return m_weekStart;
+	}
+
+private:
+	time_t m_dayStart;
+	time_t m_monthStart;
+	time_t m_nextDayStart;
+	time_t m_weekStart;
+};
+
 /**
 * DownloadStatistics.
 * Class representing download statistics for a user.
@@ -89,14 +173,16 @@ public:
 	*/
 	DownloadStatistics(uint64_t userId) : m_dayDownloadedBytes(0),
 		m_dayDownloadedFiles(0),
-		m_lastUpdateTime(0),
+		m_dayStart(0),
 		m_monthDownloadedBytes(0),
 		m_monthDownloadedFiles(0),
+		m_monthStart(0),
 		m_totalDownloadedBytes(0),
 		m_totalDownloadedFiles(0),
 		m_userId(0),
 		m_weekDownloadedBytes(0),
-		m_weekDownloadedFiles(0)
+		m_weekDownloadedFiles(0),
+		m_weekStart(0)
 	{
 		m_userId = userId;
 	}
@@ -106,16 +192,17 @@ public:
 	* @param files the number of files for the download
 	* @param size the size of the download in bytes
 	* @param timeStamp the time stamp for the download
+	* @param periods the current statistics periods
 	*/
-	void add(uint64_t files,uint64_t size,time_t timeStamp);
+	void add(uint64_t files,uint64_t size,time_t timeStamp,const StatisticsPeriods &periods);
 
 	/**
 	* Update the download statistics.
-	* This method verifies the last download time and
-	* resets the statistics if the current time does not
-	* match the last download time.
+	* This method resets the statistics of any period that 
+	* has passed since the statistics were last updated.
+	* @param periods the current statistics periods
 	*/
-	void update();
+	void update(const StatisticsPeriods &periods);
 
 	/**
 	* Get the number of downloaded bytes today.
@@ -189,8 +276,50 @@ public:
 		return m_weekDownloadedFiles;
 	}
 
+	/**
+	* Set the downloads for the current day.
+	* @param files the number of downloaded files
+	* @param bytes the number of downloaded bytes
+	*/
+	void setDayDownloads(uint64_t files,uint64_t bytes) {
+		m_dayDownloadedFiles = files;
+		m_dayDownloadedBytes = bytes;
+	}
+
+	/**
+	* Set the downloads for the current month.
+	* @param files the number of downloaded files
+	* @param bytes the number of downloaded bytes
+	*/
+	void setMonthDownloads(uint64_t files,uint64_t bytes) {
+		m_monthDownloadedFiles = files;
+		m_monthDownloadedBytes = bytes;
+	}
+
+	/**
+	* Set the total downloads.
+	* @param files the number of downloaded files
+	* @param bytes the number of downloaded bytes
+	*/
+	void setTotalDownloads(uint64_t files,uint64_t bytes) {
+		m_totalDownloadedFiles = files;
+		m_totalDownloadedBytes = bytes;
+	}
+
+	/**
+	* Set the downloads for the current week.
+	* @param files the number of downloaded files
+	* @param bytes the number of downloaded bytes
+	*/
+	void setWeekDownloads(uint64_t files,uint64_t bytes) {
+		m_weekDownloadedFiles = files;
+		m_weekDownloadedBytes = bytes;
+	}
+
 private:
-	time_t m_lastUpdateTime;
+	time_t m_dayStart;
+	time_t m_monthStart;
+	time_t m_weekStart;
 
 	uint64_t m_dayDownloadedBytes;
 	uint64_t m_dayDownloadedFiles;
@@ -210,6 +339,9 @@ private:
 /**
 * StatisticsManager.
 * Singleton class that manages all statistics.
+* Download statistics for all users are loaded from the daily rollups in the 
+* database at startup and are then kept up to date in memory. Downloads are
+* summed up per user and day until the next save, when they are merged into the rollups.
 */
 class StatisticsManager : public Singleton<StatisticsManager>,
 						  public PersistentManager,
@@ -220,7 +352,8 @@ public:
 	* Default constructor.
 	* @return instance
 	*/
-	StatisticsManager() {
+	StatisticsManager() : m_mutex("StatisticsManager") {
+		m_mutexPool.init(31,"StatisticsManager.statistics"); // create mutex pool (for locking individual download statistics)
 		UserManager::getInstance()->addListener(this);
 	}
 
@@ -301,6 +434,30 @@ public:
 	}
 
 private:
+	/**
+	* PendingDownloads.
+	* Downloads of a user during a day that have not yet been saved.
+	*/
+	struct PendingDownloads
+	{
+		PendingDownloads() : files(0),
+			size(0),
+			timeStamp(0)
+		{
+
+		}
+
+		uint64_t files;
+		uint64_t size;
+
+		time_t timeStamp;
+	};
+
+	/**
+	* Key for pending downloads, made up of the user database id and the start of the day.
+	*/
+	typedef std::pair<uint64_t,time_t> PendingKey;
+
 	/**
 	* Delete the database entry for the given user.
 	* @param userId the database id of the user to remove statistics entries for
@@ -308,19 +465,37 @@ private:
 	void deleteDbEntry(uint64_t userId);
 
 	/**
-	* Load the download statistics for the given user.
-	* If no download statistics already exists, a new one 
-	* will be created and any statistics will be loaded from the database.
-	* @param user the user to find the download statistics for
-	* @return the download statistics for the given user
+	* Migrate the downloads kept by earlier versions into daily rollups.
+	* The downloads table is dropped once migrated, so this is only done once.
 	*/
-	DownloadStatistics* loadDownloadStatistics(const User &user);
+	void migrateDownloads();
+
+	/**
+	* Get the current statistics periods.
+	* The periods are recalculated when a new day has started.
+	* @return the current statistics periods
+	*/
+	StatisticsPeriods getPeriods();
+
+	/**
+	* Merge pending downloads back into the downloads waiting to be saved.
+	* Used when the pending downloads could not be saved.
+	* @param pendingDownloads the pending downloads to merge
+	*/
+	void mergePendingDownloads(const std::map<PendingKey,PendingDownloads> &pendingDownloads);
+
+	ACE_Mutex m_pendingMutex;
+	ACE_Mutex m_periodsMutex;
+
+	ProfiledRWMutex m_mutex;
+
+	MutexPool m_mutexPool;
 
-	ACE_Mutex m_mutex;
+	StatisticsPeriods m_periods;
 
-	std::list<DownloadEntry> m_downloadEntries;
+	std::map<PendingKey,PendingDownloads> m_pendingDownloads;
 
-	std::list<DownloadStatistics> m_downloadStatistics;
+	std::map<uint64_t,DownloadStatistics> m_downloadStatistics;
 };
 
 #endif
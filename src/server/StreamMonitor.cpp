@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "streammonitor.h"
+
+#define LOGGER_CLASSNAME "StreamMonitor"
+
+#include <ace/high_res_timer.h>
+
+const int StreamMonitor::WINDOW_TIME = 1000;
+
+void StreamMonitor::addStream()
+{
+	ACE_Guard<ACE_Mutex> guard(m_mutex);
+	m_activeStreams++;
+}
+
+void StreamMonitor::removeStream()
+{
+	ACE_Guard<ACE_Mutex> guard(m_mutex);
+
+	if ( m_activeStreams>0 ) {
+		m_activeStreams--;
+	}
+
+	// a stream that ended slow should not keep anything throttled
+	if ( m_activeStreams==0 ) {
+		m_readLatency = 0;
+		m_slowestRead = 0;
+	}
+}
+
+void StreamMonitor::addRead(uint64_t readTime)
+{
+	ACE_Guard<ACE_Mutex> guard(m_mutex);
+
+	closeWindow(ACE_High_Res_Timer::gettimeofday().msec());
+
+	if ( readTime>m_slowestRead ) {
+		m_slowestRead = readTime;
+	}
+}
+
+const int StreamMonitor::getActiveStreams()
+{
+	ACE_Guard<ACE_Mutex> guard(m_mutex);
+	return m_activeStreams;
+}
+
+const uint64_t StreamMonitor::getReadLatency()
+{
+	ACE_Guard<ACE_Mutex> guard(m_mutex);
+
+	if ( m_activeStreams==0 ) {
+		return 0;
+	}
+
+	closeWindow(ACE_High_Res_Timer::gettimeofday().msec());
+
+	return m_readLatency;
+}
+
+void StreamMonitor::closeWindow(uint64_t currentTime)
+{
+	if ( currentTime-m_windowTime<(uint64_t)WINDOW_TIME ) {
+		return;
+	}
+
+	// a window without any reads may be a read that is still blocked, but also a
+	// stream that paused, so the latency is halved for every window without reads
+	if ( m_slowestRead>0 ) {
+		m_readLatency = m_slowestRead;
+	}
+	else 
+	{
+		uint64_t windows = (currentTime-m_windowTime)/WINDOW_TIME;
+		m_readLatency = windows<64 ? m_readLatency>>windows : 0;
+	}
+
+	m_slowestRead = 0;
+	m_windowTime = currentTime;
+}
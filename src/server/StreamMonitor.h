@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef guard_streammonitor_h
+#define guard_streammonitor_h
+
+#include <ace/synch.h>
+
+#include "singleton.h"
+
+/**
+* StreamMonitor.
+* Singleton class that keeps track of the streams being sent to clients
+* and how long their reads from disk take. Background work such as indexing
+* uses it to back off while listeners are waiting for data.
+*/
+class StreamMonitor : public Singleton<StreamMonitor>
+{
+public:
+	/**
+	* Default constructor.
+	* @return instance
+	*/
+	StreamMonitor() : m_activeStreams(0),
+		m_readLatency(0),
+		m_slowestRead(0),
+		m_windowTime(0)
+	{
+
+	}
+
+	static const int WINDOW_TIME;
+
+	/**
+	* Add a stream that has been started.
+	*/
+	void addStream();
+
+	/**
+	* Remove a stream that has ended.
+	*/
+	void removeStream();
+
+	/**
+	* Add a read made by a stream.
+	* @param readTime the time it took to read from disk, in microseconds
+	*/
+	void addRead(uint64_t readTime);
+
+	/**
+	* Get the number of streams currently being sent.
+	* @return the number of streams currently being sent
+	*/
+	const int getActiveStreams();
+
+	/**
+	* Get the slowest read made by any stream during the last measuring window.
+	* A single slow read is what a listener hears as buffering, so the
+	* slowest read is tracked rather than the average.
+	* @return the slowest read in microseconds, or zero if no streams are active
+	*/
+	const uint64_t getReadLatency();
+
+private:
+	/**
+	* Close the measuring window if it has expired.
+	* The calling thread must hold the lock.
+	* @param currentTime the current time in milliseconds
+	*/
+	void closeWindow(uint64_t currentTime);
+
+	ACE_Mutex m_mutex;
+
+	uint64_t m_readLatency;
+	uint64_t m_slowestRead;
+	uint64_t m_windowTime;
+
+	int m_activeStreams;
+};
+
+#endif
@@ -18,8 +18,10 @@
 #include "common.h"
 #include "taglibreader.h"
 
+#include <boost/filesystem/path.hpp>
 #include <taglib/attachedpictureframe.h>
 #include <taglib/fileref.h>
+#include <taglib/flacfile.h>
 #include <taglib/id3v2tag.h>
 #include <taglib/mpegfile.h>
 #include <taglib/tag.h>
@@ -29,66 +31,111 @@ const int TagLibReader::MAX_IMAGE_SIZE = 1024*1024;
 void TagLibReader::extract(const std::wstring path,
 	std::map<std::string,std::wstring> *metadata,std::list<MetadataImage::Ptr> *images)
 {
-	TagLib::FileRef fileRef(path.c_str());
-	if ( !fileRef.isNull() ) 
+	// the audio properties are only read if they're needed, and then estimated
+	// from the headers in fast mode instead of scanning the frames
+	bool readProperties = metadata!=NULL;
+	TagLib::AudioProperties::ReadStyle readStyle = m_fast ? 
+		TagLib::AudioProperties::Fast : TagLib::AudioProperties::Average;
+
+	// the format is recognized by extension, so that images are only read from formats with id3v2 tags
+	std::wstring extension = boost::to_lower_copy(boost::filesystem::wpath(path).extension());
+
+	if ( extension==L".mp3" )
 	{
-		if ( metadata!=NULL )
+		TagLib::MPEG::File file(path.c_str(),readProperties,readStyle);
+		if ( file.isValid() ) 
 		{
-			TagLib::Tag *tag = fileRef.tag();
-			if ( tag!=NULL && !tag->isEmpty() )
-			{	
-				if ( !tag->album().isNull() ) {
-					(*metadata)["mdAlbum"] = boost::trim_copy(tag->album().toWString());
-				}
+			if ( metadata!=NULL ) {
+				readTag(file.tag(),file.audioProperties(),metadata);
+			}
 
-				if ( !tag->artist().isNull() ) {
-					(*metadata)["mdArtist"] = boost::trim_copy(tag->artist().toWString());
-				}
+			if ( images!=NULL ) {
+				readImages(file.ID3v2Tag(),images);
+			}
+		}
+	}
+	else if ( extension==L".flac" )
+	{
+		TagLib::FLAC::File file(path.c_str(),readProperties,readStyle);
+		if ( file.isValid() ) 
+		{
+			if ( metadata!=NULL ) {
+				readTag(file.tag(),file.audioProperties(),metadata);
+			}
 
-				if ( !tag->genre().isNull() ) {
-					(*metadata)["mdGenre"] = boost::trim_copy(tag->genre().toWString());
-				}
+			if ( images!=NULL ) {
+				readImages(file.ID3v2Tag(),images);
+			}
+		}
+	}
+	else if ( metadata!=NULL )
+	{
+		TagLib::FileRef fileRef(path.c_str(),readProperties,readStyle);
+		if ( !fileRef.isNull() ) {
+			readTag(fileRef.tag(),fileRef.audioProperties(),metadata);
+		}
+	}
+}
 
-				if ( !tag->title().isNull() ) {
-					(*metadata)["mdTitle"] = boost::trim_copy(tag->title().toWString());
-				}
+void TagLibReader::readTag(TagLib::Tag *tag,TagLib::AudioProperties *audioProperties,
+	std::map<std::string,std::wstring> *metadata)
+{
+	if ( tag!=NULL && !tag->isEmpty() )
+	{	
+		if ( !tag->album().isNull() ) {
+			(*metadata)["mdAlbum"] = boost::trim_copy(tag->album().toWString());
+		}
 
-				// TODO: comment field is ignored since it caused unexpected crashes in rare cases (taglib bug?)
+		if ( !tag->artist().isNull() ) {
+			(*metadata)["mdArtist"] = boost::trim_copy(tag->artist().toWString());
+		}
 
-				(*metadata)["mdTrack"] = Util::ConvertUtil::toWideString(tag->track());
-				(*metadata)["mdYear"] = Util::ConvertUtil::toWideString(tag->year());
-			}
+		if ( !tag->genre().isNull() ) {
+			(*metadata)["mdGenre"] = boost::trim_copy(tag->genre().toWString());
+		}
 
-			TagLib::AudioProperties *audioProperties = fileRef.audioProperties();
-			if ( audioProperties!=NULL )
-			{
-				(*metadata)["mdBitRate"] = Util::ConvertUtil::toWideString(audioProperties->bitrate());
-				(*metadata)["mdChannels"] = Util::ConvertUtil::toWideString(audioProperties->channels());
-				(*metadata)["mdLength"] = Util::ConvertUtil::toWideString(audioProperties->length());
-				(*metadata)["mdSampleRate"] = Util::ConvertUtil::toWideString(audioProperties->sampleRate());
-			}
+		if ( !tag->title().isNull() ) {
+			(*metadata)["mdTitle"] = boost::trim_copy(tag->title().toWString());
 		}
 
-		if ( images!=NULL )
+		// TODO: comment field is ignored since it caused unexpected crashes in rare cases (taglib bug?)
+
+		(*metadata)["mdTrack"] = Util::ConvertUtil::toWideString(tag->track());
+		(*metadata)["mdYear"] = Util::ConvertUtil::toWideString(tag->year());
+	}
+
+	if ( audioProperties!=NULL )
+	{
+		(*metadata)["mdBitRate"] = Util::ConvertUtil::toWideString(audioProperties->bitrate());
+		(*metadata)["mdChannels"] = Util::ConvertUtil::toWideString(audioProperties->channels());
+		(*metadata)["mdLength"] = Util::ConvertUtil::toWideString(audioProperties->length());
+		(*metadata)["mdSampleRate"] = Util::ConvertUtil::toWideString(audioProperties->sampleRate());
+	}
+}
+
+void TagLibReader::readImages(TagLib::ID3v2::Tag *tag,std::list<MetadataImage::Ptr> *images)
+{
+	if ( tag==NULL ) {
+		return;
+	}
+
+	TagLib::ID3v2::FrameList frameList = tag->frameListMap()["APIC"];
+	for ( TagLib::ID3v2::FrameList::Iterator iter=frameList.begin();
+		iter!=frameList.end(); iter++ )
+	{
+		TagLib::ID3v2::AttachedPictureFrame *ap = (TagLib::ID3v2::AttachedPictureFrame*)*iter;
+		const TagLib::ByteVector &iv = ap->picture();
+		if ( iv.size()>0 && iv.size()<MAX_IMAGE_SIZE ) 
 		{
-			TagLib::MPEG::File *mpegFile = (TagLib::MPEG::File*)fileRef.file();
-			if ( mpegFile->ID3v2Tag()!=NULL )
-			{
-				TagLib::ID3v2::Tag &id3Tag = *mpegFile->ID3v2Tag();
-				TagLib::ID3v2::FrameList frameList = id3Tag.frameListMap()["APIC"];
-				for ( TagLib::ID3v2::FrameList::Iterator iter=frameList.begin();
-					iter!=frameList.end(); iter++ )
-				{
-					TagLib::ID3v2::AttachedPictureFrame *ap = (TagLib::ID3v2::AttachedPictureFrame*)*iter;
-					const TagLib::ByteVector &iv = ap->picture();
-					if ( iv.size()>0 && iv.size()<MAX_IMAGE_SIZE ) 
-					{
-						MetadataImage::Ptr imagePtr = MetadataImage::Ptr(new MetadataImage(ap->mimeType().toCString(),
-							iv.data(),iv.size()));
-
-						images->push_back(imagePtr);
-					}
-				}
+			MetadataImage::Ptr imagePtr = MetadataImage::Ptr(new MetadataImage(ap->mimeType().toCString(),
+				iv.data(),iv.size()));
+
+			// front covers are put first, since they're the ones used as cover
+			if ( ap->type()==TagLib::ID3v2::AttachedPictureFrame::FrontCover ) {
+				images->push_front(imagePtr);
+			}
+			else {
+				images->push_back(imagePtr);
 			}
 		}
 	}
@@ -20,6 +20,17 @@
 
 #include "metadatareader.h"
 
+namespace TagLib 
+{
+	class AudioProperties;
+	class Tag;
+
+	namespace ID3v2 
+	{
+		class Tag;
+	}
+}
+
 /**
 * TagLibReader.
 * Metadata reader that uses the TagLib library for reading id3 metadata.
@@ -28,21 +39,23 @@ class TagLibReader : public MetadataReader
 {
 public:
 	/**
-	* Default constructor.
+	* Constructor used for creating a new instance.
+	* @param fast true if only the headers and tags should be read, so that
+	* the audio properties are estimated instead of computed from the frames
 	* @return instance
 	*/
-	TagLibReader()
+	TagLibReader(bool fast = false) : m_fast(fast)
 	{
-		m_fieldNames.push_back("mdAlbum");
-		m_fieldNames.push_back("mdArtist");
-		m_fieldNames.push_back("mdBitRate");
-		m_fieldNames.push_back("mdChannels");
-		m_fieldNames.push_back("mdGenre");
-		m_fieldNames.push_back("mdLength");
-		m_fieldNames.push_back("mdSampleRate");
-		m_fieldNames.push_back("mdTitle");
-		m_fieldNames.push_back("mdTrack");
-		m_fieldNames.push_back("mdYear");
+		addField("mdAlbum",FIELD_TEXT);
+		addField("mdArtist",FIELD_TEXT);
+		addField("mdBitRate",FIELD_INTEGER);
+		addField("mdChannels",FIELD_INTEGER);
+		addField("mdGenre",FIELD_TEXT);
+		addField("mdLength",FIELD_INTEGER);
+		addField("mdSampleRate",FIELD_INTEGER);
+		addField("mdTitle",FIELD_TEXT);
+		addField("mdTrack",FIELD_INTEGER);
+		addField("mdYear",FIELD_INTEGER);
 	}
 
 	static const int MAX_IMAGE_SIZE;
@@ -52,6 +65,25 @@ public:
 	*/
 	virtual void extract(const std::wstring path,
 		std::map<std::string,std::wstring> *metadata,std::list<MetadataImage::Ptr> *images);
+
+private:
+	/**
+	* Read the fields of a tag and the audio properties into metadata.
+	* @param tag the tag to read, or NULL
+	* @param audioProperties the audio properties to read, or NULL
+	* @param metadata out parameter for any found metadata
+	*/
+	static void readTag(TagLib::Tag *tag,TagLib::AudioProperties *audioProperties,
+		std::map<std::string,std::wstring> *metadata);
+
+	/**
+	* Read the attached pictures of an id3v2 tag.
+	* @param tag the tag to read the pictures of, or NULL
+	* @param images out parameter for any found images
+	*/
+	static void readImages(TagLib::ID3v2::Tag *tag,std::list<MetadataImage::Ptr> *images);
+
+	bool m_fast;
 };
 
 #endif
@@ -22,13 +22,36 @@
 
 #include <ace/high_res_timer.h>
 
+#include <algorithm>
+
+#include "configmanager.h"
+#include "logmanager.h"
+
+const long TaskRunner::SLOW_TASK_THRESHOLD = 5000;
+
 bool TaskRunner::start()
 {
 	if ( m_started ) {
 		return false;
 	}
 
-	if ( !m_thread.start() ) {
+	m_maxWorkers = ConfigManager::getInstance()->getInt(ConfigManager::TASKRUNNER_MAXWORKERS);
+	if ( m_maxWorkers<1 ) {
+		m_maxWorkers = 1;
+	}
+
+	for ( int i=0; i<m_maxWorkers; i++ )
+	{
+		Thread *worker = new Thread(this);
+		if ( !worker->start() ) {
+			delete worker;
+			break;
+		}
+
+		m_workers.push_back(worker);
+	}
+
+	if ( m_workers.empty() ) {
 		return false;
 	}
 
@@ -43,72 +66,66 @@ bool TaskRunner::stop(bool graceful)
 		return false;
 	}
 
-	m_thread.cancel();
-	m_thread.join();
-
-	ACE_Time_Value currentTime = ACE_High_Res_Timer::gettimeofday();
+	std::list<Thread*>::iterator iter;
+	for ( iter=m_workers.begin(); iter!=m_workers.end(); iter++ ) {
+		(*iter)->cancel();
+	}
 
-	while ( !m_queue.empty() ) 
-	{
-		Task *task = popQueue();
-		if ( graceful && currentTime>= task->getNextExecutionTime() ) {
-			task->run();
-		}
-		delete task;
+	for ( iter=m_workers.begin(); iter!=m_workers.end(); iter++ ) {
+		(*iter)->join();
+		delete *iter;
 	}
 
+	m_workers.clear();
+
+	clearQueue(graceful);
+
 	m_started = false;
 
 	return true;
 }
 
+bool TaskRunner::cancel()
+{
+	return stop(false);
+}
+
 void TaskRunner::run()
 {
+	Thread *thread = Thread::current();
+
 	while ( true )
 	{
-		if ( m_thread.isCancelled() ) {
+		if ( thread->isCancelled() ) {
 			break;
 		}
 
-		Task *task = popQueue();
+		unsigned long waitTime = 0;
+
+		Task *task = popQueue(waitTime);
 		if ( task!=NULL )
 		{
-			ACE_Time_Value currentTime = ACE_High_Res_Timer::gettimeofday();
-			ACE_Time_Value nextExecutionTime = task->getNextExecutionTime();
-
-			if ( currentTime>=nextExecutionTime ) 
-			{
-				task->run();
-				if ( task->getPeriod()>0 ) {
-					reschedule(task);
-				}
-				else {
-					delete task;
-				}
+			execute(task);
+
+			if ( task->getPeriod()>0 ) {
+				reschedule(task);
 			}
-			else 
-			{
-				ACE_Time_Value waitTime = nextExecutionTime-currentTime;
-				m_thread.wait(waitTime.msec());
-				putQueue(task);
+			else {
+				delete task;
 			}
 		}
 		else {
-			m_thread.wait();
+			thread->wait(waitTime);
 		}
 	}
 }
 
 void TaskRunner::schedule(Task *task)
 {
-	ACE_Write_Guard<ACE_Mutex> guard(m_mutex);
-
 	task->setNextExecutionTime(ACE_High_Res_Timer::gettimeofday()+
 		ACE_Time_Value(task->getDelay(),0));
 
 	putQueue(task);
-
-	m_thread.notify();
 }
 
 void TaskRunner::schedule(Task *task,unsigned long delay,unsigned long period)
@@ -119,34 +136,85 @@ void TaskRunner::schedule(Task *task,unsigned long delay,unsigned long period)
 	schedule(task);
 }
 
-Task* TaskRunner::popQueue()
+const size_t TaskRunner::getQueueSize()
 {
-	ACE_Write_Guard<ACE_Mutex> guard(m_mutex);
+	ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
 
-	Task *task = NULL;
+	return m_readyQueue.size()+m_timerQueue.size();
+}
 
-	if ( !m_queue.empty() ) {
-		task = m_queue.front();
-		m_queue.pop_front();
+std::map<std::string,TaskStatistics> TaskRunner::getStatistics()
+{
+	ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+
+	return m_statistics;
+}
+
+bool TaskRunner::compareExecutionTime(const Task *task1,const Task *task2)
+{
+	return task1->getNextExecutionTime()>task2->getNextExecutionTime();
+}
+
+bool TaskRunner::comparePriority(const Task *task1,const Task *task2)
+{
+	if ( task1->getPriority()!=task2->getPriority() ) {
+		return task1->getPriority()<task2->getPriority();
 	}
 
-	return task;
+	return task1->getNextExecutionTime()>task2->getNextExecutionTime();
 }
 
-void TaskRunner::putQueue(Task *task)
+Task* TaskRunner::popQueue(unsigned long &waitTime)
 {
 	ACE_Write_Guard<ACE_Mutex> guard(m_mutex);
 
-	std::list<Task*>::iterator iter;
-	for ( iter=m_queue.begin(); iter!=m_queue.end(); iter++ )
+	waitTime = 0;
+
+	ACE_Time_Value currentTime = ACE_High_Res_Timer::gettimeofday();
+
+	// move all tasks that are due from the timer heap to the ready heap
+	while ( !m_timerQueue.empty() && m_timerQueue.front()->getNextExecutionTime()<=currentTime )
 	{
-		if ( (*iter)->getNextExecutionTime()>task->getNextExecutionTime() ) {
-			m_queue.insert(iter,task);
-			return;
-		}
+		std::pop_heap(m_timerQueue.begin(),m_timerQueue.end(),compareExecutionTime);
+		m_readyQueue.push_back(m_timerQueue.back());
+		std::push_heap(m_readyQueue.begin(),m_readyQueue.end(),comparePriority);
+		m_timerQueue.pop_back();
+	}
+
+	if ( !m_readyQueue.empty() )
+	{
+		std::pop_heap(m_readyQueue.begin(),m_readyQueue.end(),comparePriority);
+		Task *task = m_readyQueue.back();
+		m_readyQueue.pop_back();
+
+		return task;
+	}
+
+	if ( !m_timerQueue.empty() )
+	{
+		ACE_Time_Value timeLeft = m_timerQueue.front()->getNextExecutionTime()-currentTime;
+		waitTime = timeLeft.msec()>0 ? timeLeft.msec() : 1;
 	}
 
-	m_queue.push_back(task);
+	return NULL;
+}
+
+void TaskRunner::putQueue(Task *task)
+{
+	m_mutex.acquire();
+	m_timerQueue.push_back(task);
+	std::push_heap(m_timerQueue.begin(),m_timerQueue.end(),compareExecutionTime);
+	m_mutex.release();
+
+	notifyWorkers();
+}
+
+void TaskRunner::notifyWorkers()
+{
+	std::list<Thread*>::iterator iter;
+	for ( iter=m_workers.begin(); iter!=m_workers.end(); iter++ ) {
+		(*iter)->notify();
+	}
 }
 
 void TaskRunner::reschedule(Task *task)
@@ -156,3 +224,49 @@ void TaskRunner::reschedule(Task *task)
 
 	putQueue(task);
 }
+
+void TaskRunner::execute(Task *task)
+{
+	ACE_Time_Value startTime = ACE_High_Res_Timer::gettimeofday();
+
+	task->run();
+
+	ACE_Time_Value endTime = ACE_High_Res_Timer::gettimeofday();
+
+	long runTime = (endTime-startTime).msec();
+	long delay = startTime>task->getNextExecutionTime() ? (startTime-task->getNextExecutionTime()).msec() : 0;
+
+	m_mutex.acquire();
+	m_statistics[task->getName()].add(runTime,delay);
+	m_mutex.release();
+
+	if ( runTime>SLOW_TASK_THRESHOLD ) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Task \"%s\" took %d ms to execute",
+			task->getName().c_str(),(int)runTime);
+	}
+}
+
+void TaskRunner::clearQueue(bool graceful)
+{
+	ACE_Time_Value currentTime = ACE_High_Res_Timer::gettimeofday();
+
+	m_mutex.acquire();
+	std::vector<Task*> tasks = m_readyQueue;
+	tasks.insert(tasks.end(),m_timerQueue.begin(),m_timerQueue.end());
+	m_readyQueue.clear();
+	m_timerQueue.clear();
+	m_mutex.release();
+
+	// run due tasks in priority order
+	std::sort(tasks.begin(),tasks.end(),comparePriority);
+
+	std::vector<Task*>::reverse_iterator iter;
+	for ( iter=tasks.rbegin(); iter!=tasks.rend(); iter++ )
+	{
+		if ( graceful && currentTime>=(*iter)->getNextExecutionTime() ) {
+			(*iter)->run();
+		}
+
+		delete *iter;
+	}
+}
@@ -33,14 +33,23 @@
 class Task : public Runnable
 {
 public:
+	enum Priority
+	{
+		PRIORITY_LOW = 0,
+		PRIORITY_NORMAL = 1,
+		PRIORITY_HIGH = 2
+	};
+
 	/**
-	* Default constructor.
+	* Constructor used for creating a new instance.
+	* @param name the name of the task, used for collecting run time statistics
 	* @return instance
 	*/
-	Task() : m_delay(0),
-		m_period(0) 
+	Task(std::string name="Task") : m_delay(0),
+		m_period(0),
+		m_priority(PRIORITY_NORMAL)
 	{
-
+		m_name = name;
 	}
 
 	/**
@@ -51,6 +60,14 @@ public:
 		return m_delay;
 	}
 
+	/**
+	* Get the name of the task.
+	* @return the name of the task
+	*/
+	const std::string& getName() const {
+		return m_name;
+	}
+
 	/**
 	* Get the next time the task will be executed.
 	* @return the next time the task will be executed
@@ -67,6 +84,15 @@ public:
 		return m_period;
 	}
 
+	/**
+	* Get the task priority. When several tasks are due at the
+	* same time the one with the highest priority is executed first.
+	* @return the task priority
+	*/
+	const Priority getPriority() const {
+		return m_priority;
+	}
+
 	/**
 	* Set the number of seconds that the task should be delayed.
 	* @param delay the number of seconds that the task should be delayed
@@ -91,16 +117,116 @@ public:
 		m_period = period;
 	}
 
+	/**
+	* Set the task priority.
+	* @param priority the task priority
+	*/
+	void setPriority(const Priority priority) {
+		m_priority = priority;
+	}
+
 private:
 	ACE_Time_Value m_nextExecutionTime;
 
+	std::string m_name;
+
 	unsigned long m_delay;
 	unsigned long m_period;
+
+	Priority m_priority;
+};
+
+/**
+* TaskStatistics.
+* Run time statistics collected for all tasks sharing the same name.
+*/
+class TaskStatistics
+{
+public:
+	/**
+	* Default constructor.
+	* @return instance
+	*/
+	TaskStatistics() : m_executions(0),
+		m_lastRunTime(0),
+		m_maxRunTime(0),
+		m_totalDelay(0),
+		m_totalRunTime(0)
+	{
+
+	}
+
+	/**
+	* Add an execution to the statistics.
+	* @param runTime the number of milliseconds the task was running
+	* @param delay the number of milliseconds the task waited past its due time
+	*/
+	void add(long runTime,long delay)
+	{
+		m_executions++;
+		m_lastRunTime = runTime;
+		m_totalRunTime += runTime;
+		m_totalDelay += delay;
+
+		if ( runTime>m_maxRunTime ) {
+			m_maxRunTime = runTime;
+		}
+	}
+
+	/**
+	* Get the average number of milliseconds tasks waited past their due time.
+	* @return the average delay in milliseconds
+	*/
+	const long getAverageDelay() const {
+		return m_executions>0 ? (long)(m_totalDelay/m_executions) : 0;
+	}
+
+	/**
+	* Get the average run time in milliseconds.
+	* @return the average run time in milliseconds
+	*/
+	const long getAverageRunTime() const {
+		return m_executions>0 ? (long)(m_totalRunTime/m_executions) : 0;
+	}
+
+	/**
+	* Get the number of executions.
+	* @return the number of executions
+	*/
+	const uint64_t getExecutions() const {
+		return m_executions;
+	}
+
+	/**
+	* Get the run time in milliseconds of the last execution.
+	* @return the run time in milliseconds of the last execution
+	*/
+	const long getLastRunTime() const {
+		return m_lastRunTime;
+	}
+
+	/**
+	* Get the longest run time in milliseconds.
+	* @return the longest run time in milliseconds
+	*/
+	const long getMaxRunTime() const {
+		return m_maxRunTime;
+	}
+
+private:
+	uint64_t m_executions;
+	uint64_t m_totalDelay;
+	uint64_t m_totalRunTime;
+
+	long m_lastRunTime;
+	long m_maxRunTime;
 };
 
 /**
 * TaskRunner.
-* An instance of this class can execute schedules tasks in a single thread.
+* An instance of this class executes scheduled tasks on a pool of worker threads.
+* Scheduled tasks are kept in a heap sorted by next execution time and due tasks
+* are moved to a second heap sorted by priority, from which the workers pick them up.
 * This class is also available as a singleton.
 */
 class TaskRunner : public Singleton<TaskRunner>,
@@ -110,8 +236,7 @@ public:
 	/**
 	* Default constructor.
 	*/
-	TaskRunner() : 	
-		m_thread(this),
+	TaskRunner() : m_maxWorkers(1),
 		m_started(false)
 	{
 	
@@ -124,6 +249,8 @@ public:
 		stop();
 	}
 
+	static const long SLOW_TASK_THRESHOLD;
+
 	/**
 	* Start the task runner.
 	* @return true if task runner was successfully started
@@ -166,31 +293,78 @@ public:
 	*/
 	void schedule(Task *task,unsigned long delay,unsigned long period);
 
+	/**
+	* Get the number of tasks currently queued.
+	* @return the number of tasks currently queued
+	*/
+	const size_t getQueueSize();
+
+	/**
+	* Get the run time statistics for all executed tasks, by task name.
+	* @return a copy of the collected statistics
+	*/
+	std::map<std::string,TaskStatistics> getStatistics();
+
 private:
 	/**
-	* Pop the next task in queue.
-	* @return the next task in queue, NULL if no task was found
+	* Compare tasks by next execution time. Used for
+	* ordering the timer heap with the earliest task on top.
 	*/
-	Task* popQueue();
+	static bool compareExecutionTime(const Task *task1,const Task *task2);
 
 	/**
-	* Put a task into the queue, sorted by
-	* next execution time.
+	* Compare tasks by priority and next execution time. Used for
+	* ordering the ready heap with the most important task on top.
+	*/
+	static bool comparePriority(const Task *task1,const Task *task2);
+
+	/**
+	* Pop the next task that is due for execution.
+	* @param waitTime out parameter for the number of milliseconds until the next
+	* task is due. Zero if no task is queued
+	* @return the next task due for execution, NULL if no task is due
+	*/
+	Task* popQueue(unsigned long &waitTime);
+
+	/**
+	* Put a task into the timer heap.
 	* @param task the task to put into the queue
 	*/
 	void putQueue(Task *task);
 
+	/**
+	* Notify all worker threads that the queue has changed.
+	*/
+	void notifyWorkers();
+
 	/**
 	* Reschedule a task for repetition.
 	* @param task the task to reschedule
 	*/
 	void reschedule(Task *task);
 
+	/**
+	* Execute a task and collect its run time statistics.
+	* @param task the task to execute
+	*/
+	void execute(Task *task);
+
+	/**
+	* Clear all queued tasks.
+	* @param graceful true if tasks due for execution should be executed before being destroyed
+	*/
+	void clearQueue(bool graceful);
+
 	ACE_Mutex m_mutex;
 
-	Thread m_thread;
+	std::list<Thread*> m_workers;
+
+	std::vector<Task*> m_readyQueue;
+	std::vector<Task*> m_timerQueue;
+
+	std::map<std::string,TaskStatistics> m_statistics;
 
-	std::list<Task*> m_queue;
+	int m_maxWorkers;
 
 	bool m_started;
 };
@@ -20,6 +20,20 @@
 
 #include <ace/os.h>
 
+#ifndef WIN32
+#include <sys/resource.h>
+#endif
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifndef THREAD_MODE_BACKGROUND_BEGIN
+#define THREAD_MODE_BACKGROUND_BEGIN 0x00010000
+#define THREAD_MODE_BACKGROUND_END 0x00020000
+#endif
+
 ACE_TSS<ThreadStorage> Thread::m_tss;
 
 bool Thread::start()
@@ -208,6 +222,34 @@ void Thread::yield()
 	wait(1);
 }
 
+bool Thread::setBackground(bool background)
+{
+	#ifdef WIN32
+		// background mode lowers the I/O priority too but is only available from Vista
+		if ( SetThreadPriority(GetCurrentThread(),background ? 
+			THREAD_MODE_BACKGROUND_BEGIN : THREAD_MODE_BACKGROUND_END) ) 
+		{
+			return true;
+		}
+
+		return SetThreadPriority(GetCurrentThread(),background ? 
+			THREAD_PRIORITY_LOWEST : THREAD_PRIORITY_NORMAL)!=0;
+	#elif defined(__linux__)
+		// the idle I/O class only gets disk time when no one else wants it
+		const int ioprioWhoProcess = 1;
+		const int ioprioClassShift = 13;
+		const int ioprio = background ? (3<<ioprioClassShift) : 0;
+
+		pid_t tid = (pid_t)syscall(SYS_gettid);
+		syscall(SYS_ioprio_set,ioprioWhoProcess,tid,ioprio);
+
+		return setpriority(PRIO_PROCESS,tid,background ? 10 : 0)==0;
+	#else
+		// the nice value of a single thread can't be changed portably
+		return false;
+	#endif
+}
+
 bool Thread::isAlive()
 {
 	ACE_Guard<ACE_Mutex> guard(m_mutex);
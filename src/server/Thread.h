@@ -160,6 +160,15 @@ public:
 	*/
 	void yield();
 
+	/**
+	* Set whether the calling thread should run in background mode.
+	* A thread in background mode is scheduled with a lower CPU priority
+	* and, where the platform supports it, a lower I/O priority.
+	* @param background true to enter background mode, false to leave it
+	* @return false if the priority could not be changed
+	*/
+	static bool setBackground(bool background);
+
 	/**
 	* Get the thread id.
 	* @return the id of the thread.
@@ -20,6 +20,9 @@
 
 #define LOGGER_CLASSNAME "UserManager"
 
+#include <ace/os.h>
+#include <set>
+
 #include "../tinyxml/tinyxml.h"
 
 #include "databasemanager.h"
@@ -29,10 +32,11 @@ int UserManager::load()
 {
 	LogManager::getInstance()->debug(LOGGER_CLASSNAME,"Loading");
 
-	ACE_Write_Guard<ACE_Mutex> guard(m_mutex);
+	ACE_Write_Guard<ProfiledMutex> guard(m_mutex);
 
 	m_users.clear();
 	m_groups.clear();
+	m_dirty = false;
 
 	TiXmlDocument document;
 	document.LoadFile("conf\\users.xml");
@@ -173,8 +177,6 @@ int UserManager::load()
 
 			user.setTransactions(User::TRANSACTION_NONE);
 
-			prepareDbEntry(user);
-
 			user.setManager(this);
 			m_users.push_back(user);
 
@@ -316,8 +318,6 @@ int UserManager::load()
 
 			group.setTransactions(Group::TRANSACTION_NONE);
 
-			prepareDbEntry(group);
-		
 			group.setManager(this);
 			m_groups.push_back(group);
 			
@@ -325,12 +325,33 @@ int UserManager::load()
 		}
 	}
 
+	prepareDbEntries();
+
 	return 0;
 }
 
 int UserManager::save()
 {
-	ACE_Write_Guard<ACE_Mutex> guard(m_mutex);
+	// saves are serialized so that an older snapshot never replaces a newer one
+	ACE_Guard<ACE_Mutex> saveGuard(m_saveMutex);
+
+	std::list<User> users;
+	std::list<Group> groups;
+
+	// the lock is only held while the snapshot is taken and not while 
+	// the document is built and written, so that lookups aren't blocked
+	m_mutex.acquire();
+
+	if ( !m_dirty ) {
+		m_mutex.release();
+		return 0;
+	}
+
+	users = m_users;
+	groups = m_groups;
+	m_dirty = false;
+
+	m_mutex.release();
 
 	LogManager::getInstance()->debug(LOGGER_CLASSNAME,"Saving");
 
@@ -347,7 +368,7 @@ int UserManager::save()
 
 		// save all user instances
 		std::list<User>::iterator iter;
-		for ( iter=m_users.begin(); iter!=m_users.end(); iter++ ) 
+		for ( iter=users.begin(); iter!=users.end(); iter++ ) 
 		{
 			TiXmlNode *userNode = usersNode->InsertEndChild(TiXmlElement("user"));
 			if ( userNode!=NULL )
@@ -440,7 +461,7 @@ int UserManager::save()
 
 		// save all group instances
 		std::list<Group>::iterator iter;
-		for ( iter=m_groups.begin(); iter!=m_groups.end(); iter++ ) 
+		for ( iter=groups.begin(); iter!=groups.end(); iter++ ) 
 		{
 			TiXmlNode *groupNode = groupsNode->InsertEndChild(TiXmlElement("group"));
 			if ( groupNode!=NULL )
@@ -525,7 +546,15 @@ int UserManager::save()
 		document.InsertBeforeChild(document.FirstChild(),TiXmlDeclaration("1.0","iso-8859-1","yes"));
 	}
 
-	if ( !document.SaveFile() ) {
+	// the file is replaced by a rename so that it's never left partially written
+	if ( !document.SaveFile("conf\\users.xml.tmp") || ACE_OS::rename("conf\\users.xml.tmp","conf\\users.xml")!=0 ) 
+	{
+		ACE_OS::unlink("conf\\users.xml.tmp");
+
+		m_mutex.acquire();
+		m_dirty = true;
+		m_mutex.release();
+
 		return 1;
 	}
 
@@ -616,6 +645,91 @@ bool UserManager::prepareDbEntry(Group &group)
 	return success;
 }
 
+void UserManager::prepareDbEntries()
+{
+	if ( m_users.empty() && m_groups.empty() ) {
+		return;
+	}
+
+	DatabaseConnection *conn = DatabaseManager::getInstance()->getConnection(DatabaseManager::DATABASE_SERVER,true);
+	if ( conn==NULL ) {
+		return;
+	}
+
+	try
+	{
+		std::set<uint64_t> userIds;
+		std::set<uint64_t> groupIds;
+
+		// all existing entries are read at once instead of looking up every user and group
+		sqlite3x::sqlite3_command userCmd(conn->getSqliteConn(),"SELECT userId FROM [users]");
+		sqlite3x::sqlite3_reader userReader = userCmd.executereader();
+		while ( userReader.read() ) {
+			userIds.insert(userReader.getint64(0));
+		}
+
+		userReader.close();
+
+		sqlite3x::sqlite3_command groupCmd(conn->getSqliteConn(),"SELECT groupId FROM [groups]");
+		sqlite3x::sqlite3_reader groupReader = groupCmd.executereader();
+		while ( groupReader.read() ) {
+			groupIds.insert(groupReader.getint64(0));
+		}
+
+		groupReader.close();
+
+		// the missing entries are created in a single transaction, and the users and 
+		// groups are only given their new database ids once it has been committed
+		std::map<User*,uint64_t> createdUserEntries;
+		std::map<Group*,uint64_t> createdGroupEntries;
+
+		sqlite3x::sqlite3_transaction transaction(conn->getSqliteConn());
+
+		for ( std::list<User>::iterator iter=m_users.begin(); iter!=m_users.end(); iter++ )
+		{
+			if ( iter->getDbId()>0 && userIds.find(iter->getDbId())!=userIds.end() ) {
+				continue;
+			}
+
+			conn->getSqliteConn().executenonquery("INSERT INTO [users] (guid) "
+				"VALUES ('" + conn->quote(iter->getGuid()) + "')");
+
+			createdUserEntries[&(*iter)] = conn->getSqliteConn().insertid();
+		}
+
+		for ( std::list<Group>::iterator iter=m_groups.begin(); iter!=m_groups.end(); iter++ )
+		{
+			if ( iter->getDbId()>0 && groupIds.find(iter->getDbId())!=groupIds.end() ) {
+				continue;
+			}
+
+			conn->getSqliteConn().executenonquery("INSERT INTO [groups] (guid) "
+				"VALUES ('" + conn->quote(iter->getGuid()) + "')");
+
+			createdGroupEntries[&(*iter)] = conn->getSqliteConn().insertid();
+		}
+
+		transaction.commit();
+
+		if ( !createdUserEntries.empty() || !createdGroupEntries.empty() ) {
+			m_dirty = true;
+		}
+
+		for ( std::map<User*,uint64_t>::iterator iter=createdUserEntries.begin(); iter!=createdUserEntries.end(); iter++ ) {
+			iter->first->setDbId(iter->second);
+		}
+
+		for ( std::map<Group*,uint64_t>::iterator iter=createdGroupEntries.begin(); iter!=createdGroupEntries.end(); iter++ ) {
+			iter->first->setDbId(iter->second);
+		}
+	}
+	catch(exception &ex) {
+		LogManager::getInstance()->warning(LOGGER_CLASSNAME,"Could not prepare database entries for users and groups [%s]",ex.what());
+	}
+
+	DatabaseManager::getInstance()->releaseConnection(conn);
+}
+
 void UserManager::deleteDbEntry(const Group &group)
 {
 	DatabaseConnection *conn = DatabaseManager::getInstance()->getConnection(DatabaseManager::DATABASE_SERVER,true);
@@ -663,6 +777,7 @@ bool UserManager::addGroup(Group &group)
 		m_mutex.acquire();
 		updateMemberships(group,group.getUsers());
 		m_groups.push_back(group);
+		m_dirty = true;
 		m_mutex.release();
 
 		LogManager::getInstance()->info(LOGGER_CLASSNAME,"Added group '%s'",group.getName().c_str());
@@ -687,6 +802,7 @@ bool UserManager::removeGroup(const Group &group)
 		if ( iter->getGuid()==group.getGuid() ) {
 			removedGroup = new Group(*iter);
 			m_groups.erase(iter);
+			m_dirty = true;
 			break;
 		}
 	}
@@ -801,6 +917,7 @@ bool UserManager::updateGroup(Group &group)
 
 	group.setTransactions(Group::TRANSACTION_NONE);
 	managedGroup->setTransactions(Group::TRANSACTION_NONE);
+	m_dirty = true;
 
 	Group updatedGroup = *managedGroup;
 
@@ -822,6 +939,7 @@ bool UserManager::addUser(User &user)
 		m_mutex.acquire();
 		updateMemberships(user,user.getGroups());
 		m_users.push_back(user);
+		m_dirty = true;
 		m_mutex.release();
 
 		LogManager::getInstance()->info(LOGGER_CLASSNAME,"Added user '%s'",user.getName().c_str());
@@ -846,6 +964,7 @@ bool UserManager::removeUser(const User &user)
 		if ( iter->getGuid()==user.getGuid() ) {
 			removedUser = new User(*iter);
 			m_users.erase(iter);
+			m_dirty = true;
 			break;
 		}
 	}
@@ -976,6 +1095,7 @@ bool UserManager::updateUser(User &user)
 
 	user.setTransactions(User::TRANSACTION_NONE);
 	managedUser->setTransactions(User::TRANSACTION_NONE);
+	m_dirty = true;
 
 	User updatedUser = *managedUser;
 
@@ -988,7 +1108,7 @@ bool UserManager::updateUser(User &user)
 
 bool UserManager::findGroupByDbId(uint64_t dbId,Group *group)
 {
-	ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+	ACE_Read_Guard<ProfiledMutex> guard(m_mutex);
 
 	std::list<Group>::iterator iter;
 	for ( iter=m_groups.begin(); iter!=m_groups.end(); iter++ )
@@ -1008,7 +1128,7 @@ bool UserManager::findGroupByDbId(uint64_t dbId,Group *group)
 
 bool UserManager::findGroupByGuid(const std::string &guid,Group *group)
 {
-	ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+	ACE_Read_Guard<ProfiledMutex> guard(m_mutex);
 
 	std::list<Group>::iterator iter;
 	for ( iter=m_groups.begin(); iter!=m_groups.end(); iter++ )
@@ -1028,7 +1148,7 @@ bool UserManager::findGroupByGuid(const std::string &guid,Group *group)
 
 bool UserManager::findGroupByName(const std::string &name,Group *group)
 {
-	ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+	ACE_Read_Guard<ProfiledMutex> guard(m_mutex);
 
 	std::list<Group>::iterator iter;
 	for ( iter=m_groups.begin(); iter!=m_groups.end(); iter++ )
@@ -1048,7 +1168,7 @@ bool UserManager::findGroupByName(const std::string &name,Group *group)
 
 bool UserManager::findUserByDbId(uint64_t dbId,User *user)
 {
-	ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+	ACE_Read_Guard<ProfiledMutex> guard(m_mutex);
 
 	std::list<User>::iterator iter;
 	for ( iter=m_users.begin(); iter!=m_users.end(); iter++ )
@@ -1068,7 +1188,7 @@ bool UserManager::findUserByDbId(uint64_t dbId,User *user)
 
 bool UserManager::findUserByGuid(const std::string &guid,User *user)
 {
-	ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+	ACE_Read_Guard<ProfiledMutex> guard(m_mutex);
 
 	std::list<User>::iterator iter;
 	for ( iter=m_users.begin(); iter!=m_users.end(); iter++ )
@@ -1088,7 +1208,7 @@ bool UserManager::findUserByGuid(const std::string &guid,User *user)
 
 bool UserManager::findUserByName(const std::string &name,User *user)
 {
-	ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+	ACE_Read_Guard<ProfiledMutex> guard(m_mutex);
 
 	std::list<User>::iterator iter;
 	for ( iter=m_users.begin(); iter!=m_users.end(); iter++ )
@@ -1108,7 +1228,7 @@ bool UserManager::findUserByName(const std::string &name,User *user)
 
 std::list<Group> UserManager::getGroups()
 {
-	ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+	ACE_Read_Guard<ProfiledMutex> guard(m_mutex);
 
 	std::list<Group> groups;
 
@@ -1122,7 +1242,7 @@ std::list<Group> UserManager::getGroups()
 
 std::list<User> UserManager::getUsers()
 {
-	ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+	ACE_Read_Guard<ProfiledMutex> guard(m_mutex);
 
 	std::list<User> users;
 
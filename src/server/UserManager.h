@@ -23,6 +23,7 @@
 #include "eventbroadcaster.h"
 #include "group.h"
 #include "persistentmanager.h"
+#include "profiledmutex.h"
 #include "singleton.h"
 #include "user.h"
 
@@ -89,6 +90,16 @@ class UserManager : public Singleton<UserManager>,
 					public PersistentManager
 {
 public:
+	/**
+	* Default constructor.
+	* @return instance
+	*/
+	UserManager() : m_dirty(false),
+		m_mutex("UserManager") 
+	{
+
+	}
+
 	/**
 	* @override
 	*/
@@ -196,7 +207,7 @@ public:
 	* @return the number of groups in the manager
 	*/
 	const size_t getGroupCount() {
-		ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+		ACE_Read_Guard<ProfiledMutex> guard(m_mutex);
 		return m_groups.size();
 	}
 
@@ -212,7 +223,7 @@ public:
 	* @return the number of users in the manager
 	*/
 	const size_t getUserCount() {
-		ACE_Read_Guard<ACE_Mutex> guard(m_mutex);
+		ACE_Read_Guard<ProfiledMutex> guard(m_mutex);
 		return m_users.size();
 	}
 
@@ -239,6 +250,14 @@ private:
 	*/
 	bool prepareDbEntry(User &user);
 
+	/**
+	* Prepare the database entries for all loaded users and groups.
+	* The existing entries are read and any missing entries created in a single
+	* transaction, instead of preparing the entry of every user and group by itself.
+	* The calling thread must hold the lock.
+	*/
+	void prepareDbEntries();
+
 	/**
 	* Delete the database entry for the given group
 	* @param group the group to delete the database entry for
@@ -281,10 +300,14 @@ private:
 	*/
 	void removeMemberships(const User &user);
 
-	ACE_Mutex m_mutex;
+	ACE_Mutex m_saveMutex;
+
+	ProfiledMutex m_mutex;
 
 	std::list<Group> m_groups;
 	std::list<User> m_users;
+
+	bool m_dirty;
 };
 
 #endif
@@ -489,6 +489,24 @@ std::string Util::TimeUtil::format(const tm &localTime,const char *fmt)
 	return formattedTime;
 }
 
+std::string Util::TimeUtil::formatHttpDate(const time_t &calendarTime)
+{
+	static const char *DAYS[] = { "Sun","Mon","Tue","Wed","Thu","Fri","Sat" };
+	static const char *MONTHS[] = { "Jan","Feb","Mar","Apr","May","Jun","Jul","Aug","Sep","Oct","Nov","Dec" };
+
+	tm universalTime;
+	if ( !getUniversalTime(calendarTime,&universalTime) ) {
+		return "";
+	}
+
+	char formattedTime[64] = {0};
+	ACE_OS::snprintf(formattedTime,sizeof(formattedTime),"%s, %02d %s %04d %02d:%02d:%02d GMT",
+		DAYS[universalTime.tm_wday],universalTime.tm_mday,MONTHS[universalTime.tm_mon],
+		universalTime.tm_year+1900,universalTime.tm_hour,universalTime.tm_min,universalTime.tm_sec);
+
+	return formattedTime;
+}
+
 time_t Util::TimeUtil::getCalendarTime()
 {
 	time_t calendarTime;
@@ -509,6 +527,11 @@ bool Util::TimeUtil::getLocalTime(const time_t& calendarTime,tm *localTime)
 	return ACE_OS::localtime_r(&calendarTime,localTime)!=NULL;
 }
 
+bool Util::TimeUtil::getUniversalTime(const time_t& calendarTime,tm *universalTime)
+{
+	return ACE_OS::gmtime_r(&calendarTime,universalTime)!=NULL;
+}
+
 std::string Util::UriUtil::getLastSegment(const std::string &uri)
 {
 	std::string lastSegment;
@@ -311,6 +311,14 @@ namespace Util
 		*/
 		static std::string format(const tm &localTime,const char *fmt);
 
+		/**
+		* Format a calendar time as a HTTP date, as defined by RFC 1123.
+		* The names of days and months are always english, whatever the locale.
+		* @param calendarTime the calendar time to format
+		* @return the formatted date in GMT, or an empty string if the time could not be converted
+		*/
+		static std::string formatHttpDate(const time_t &calendarTime);
+
 		/**
 		* Get the current calendar time.
 		* @return the current calendar time
@@ -331,6 +339,14 @@ namespace Util
 		* @return true if time was retrieved successfully
 		*/
 		static bool getLocalTime(const time_t& calendarTime,tm *localTime);
+
+		/**
+		* Get the universal time (UTC) based on the given calendar time.
+		* @param calendarTime the calendar time
+		* @param universalTime the out parameter for the universal time
+		* @return true if time was retrieved successfully
+		*/
+		static bool getUniversalTime(const time_t& calendarTime,tm *universalTime);
 	};
 
 	/**
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2005-2010 Erik Nilsson, software on versionstudio point com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef guard_verifyindextask_h
+#define guard_verifyindextask_h
+
+#include "taskrunner.h"
+
+/**
+* VerifyIndexTask.
+* Task class used for verifying the index aggregates in the background.
+*/
+class VerifyIndexTask : public Task
+{
+public:
+	/**
+	* Default constructor.
+	*/
+	VerifyIndexTask() : Task("VerifyIndex") {
+
+	}
+
+	/**
+	* @override
+	*/
+	virtual void run();
+};
+
+#endif
@@ -80,9 +80,35 @@ void IndexingDialog::dialogInit(HWND hWnd,LPARAM lParam)
 void IndexingDialog::updateDialog()
 {
 	std::stringstream message;
-	IndexerJob currentJob = Indexer::getInstance()->getCurrentJob();
+	std::stringstream paths;
 
-	switch ( currentJob.getState() )
+	IndexerJob::State state = IndexerJob::State::IDLE;
+
+	uint64_t analyzedDirectories = 0;
+	uint64_t analyzedFiles = 0;
+	uint64_t indexedDirectories = 0;
+	uint64_t indexedFiles = 0;
+	uint64_t duration = 0;
+
+	// shares on different devices are indexed concurrently, so all active jobs are summed up
+	std::list<IndexerJob> activeJobs = Indexer::getInstance()->getActiveJobs();
+	for ( std::list<IndexerJob>::iterator iter=activeJobs.begin(); iter!=activeJobs.end(); iter++ )
+	{
+		state = iter->getState();
+
+		analyzedDirectories += iter->getAnalyzedDirectories();
+		analyzedFiles += iter->getAnalyzedFiles();
+		indexedDirectories += iter->getIndexedDirectories();
+		indexedFiles += iter->getIndexedFiles();
+
+		if ( (uint64_t)iter->getDuration()>duration ) {
+			duration = iter->getDuration();
+		}
+
+		paths << "\r\n" << iter->getCurrentPath();
+	}
+
+	switch ( state )
 	{
 		case IndexerJob::State::IDLE: 
 		{
@@ -93,31 +119,29 @@ void IndexingDialog::updateDialog()
 		case IndexerJob::State::VALIDATING: 
 		{
 			SetWindowText(m_hStaticValueAction,WinUtil::ResourceUtil::loadString(IDS_VALIDATING).c_str());
-			message << currentJob.getCurrentPath();
+			message << paths.str().substr(2);
 		}
 		break;
 
 		case IndexerJob::State::ANALYZING: 
 		{
 			SetWindowText(m_hStaticValueAction,WinUtil::ResourceUtil::loadString(IDS_ANALYZING).c_str());
-			message << "Found " << currentJob.getAnalyzedFiles()
-					<< " files in " << currentJob.getAnalyzedDirectories() << " directories\r\n" 
-					<< currentJob.getCurrentPath();
+			message << "Found " << analyzedFiles
+					<< " files in " << analyzedDirectories << " directories" 
+					<< paths.str();
 		}
 		break;
 
 		case IndexerJob::State::INDEXING: 
 		{
 			SetWindowText(m_hStaticValueAction,WinUtil::ResourceUtil::loadString(IDS_INDEXING).c_str());
-			message << "Indexed " << currentJob.getIndexedFiles() << " of " << currentJob.getAnalyzedFiles() << " files in "
-					<< currentJob.getIndexedDirectories() << " of " << currentJob.getAnalyzedDirectories() << " directories\r\n" 
-					<< currentJob.getCurrentPath();
+			message << "Indexed " << indexedFiles << " of " << analyzedFiles << " files in "
+					<< indexedDirectories << " of " << analyzedDirectories << " directories" 
+					<< paths.str();
 		}
 		break;
 	}
 
-	uint64_t duration = currentJob.getDuration();
-
 	int hours = 0;
 	int minutes = 0;
 	int seconds = 0;
@@ -140,10 +164,10 @@ void IndexingDialog::updateDialog()
 
 	int progressBarValue = 0;
 
-	if ( currentJob.getIndexedDirectories()>0 || currentJob.getIndexedFiles()>0 ) 
+	if ( indexedDirectories>0 || indexedFiles>0 ) 
 	{
-		uint64_t val1 = currentJob.getIndexedDirectories()+currentJob.getIndexedFiles();
-		uint64_t val2 = currentJob.getAnalyzedDirectories()+currentJob.getAnalyzedFiles();
+		uint64_t val1 = indexedDirectories+indexedFiles;
+		uint64_t val2 = analyzedDirectories+analyzedFiles;
 		progressBarValue = (val1*100)/val2;
 	}
 
@@ -153,8 +177,12 @@ void IndexingDialog::updateDialog()
 
 void IndexingDialog::on(IndexerListener::JobCompleted)
 {
-	KillTimer(this->getHwnd(),IDT_INDEXINGPROGRESS);
-	EnableWindow(m_hButtonAbort,false);
+	// other shares may still be indexed
+	if ( Indexer::getInstance()->getActiveJobs().empty() ) {
+		KillTimer(this->getHwnd(),IDT_INDEXINGPROGRESS);
+		EnableWindow(m_hButtonAbort,false);
+	}
+
 	PostMessage(this->getHwnd(),UWM_INDEX_UPDATED,NULL,NULL);
 }
 
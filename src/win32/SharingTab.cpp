@@ -51,8 +51,11 @@ INT CALLBACK SharingTab::dialogProc(HWND hWnd,UINT msg,WPARAM wParam,LPARAM lPar
 				}
 
 				// check if share is currently being indexed
-				if ( Indexer::getInstance()->getCurrentJob().getShareId()==share.getDbId() ) {
-					lastIndexed = "Indexing...";
+				std::list<IndexerJob> activeJobs = Indexer::getInstance()->getActiveJobs();
+				for ( iter=activeJobs.begin(); iter!=activeJobs.end(); iter++ ) {
+					if ( iter->getShareId()==share.getDbId() ) {
+						lastIndexed = "Indexing...";
+					}
 				}
 
 				// check when share was last indexed
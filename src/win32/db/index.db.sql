@@ -16,12 +16,31 @@ CREATE TABLE IF NOT EXISTS items (
   directories INTEGER,
   files INTEGER,
   size INTEGER,
-  lastWriteTime DATE
+  lastWriteTime DATE,
+  coverHash TEXT,
+  generation INTEGER,
+  fingerprint TEXT
+);
+
+CREATE TABLE IF NOT EXISTS shares (
+  shareId INTEGER PRIMARY KEY,
+  directories INTEGER,
+  files INTEGER,
+  size INTEGER
+);
+
+CREATE TABLE IF NOT EXISTS checkpoints (
+  shareId INTEGER PRIMARY KEY,
+  generation INTEGER,
+  fullIndexing INT,
+  path TEXT
 );
 
 CREATE INDEX IF NOT EXISTS idxItemsHash ON items (hash);
 
-CREATE INDEX IF NOT EXISTS idxItemsParentItemId ON items (parentItemId);
+DROP INDEX IF EXISTS idxItemsParentItemId;
+
+CREATE INDEX IF NOT EXISTS idxItemsBrowse ON items (shareId,parentItemId,directory,name,hash,directories,files,lastWriteTime);
 
 CREATE INDEX IF NOT EXISTS idxItemsPath ON items (path);
 
@@ -27,12 +27,24 @@ CREATE TABLE sessions (
   guid TEXT
 );
 
-CREATE TABLE IF NOT EXISTS downloads (
-  downloadId INTEGER PRIMARY KEY AUTOINCREMENT UNIQUE,
+CREATE TABLE IF NOT EXISTS downloaddays (
   userId INTEGER,
+  day INTEGER,
   files INTEGER,
   size INTEGER,
-  timeStamp DATE
+  timeStamp INTEGER
+);
+
+CREATE UNIQUE INDEX IF NOT EXISTS idxDownloadDaysUserIdDay ON downloaddays (userId,day);
+
+CREATE TABLE IF NOT EXISTS jobs (
+  jobId INTEGER PRIMARY KEY AUTOINCREMENT UNIQUE,
+  uri TEXT,
+  userGuid TEXT,
+  parameters TEXT,
+  attempts INTEGER,
+  queueTime INTEGER,
+  executionTime INTEGER
 );
 
 -- PREPARE PLAYLISTS PLUGIN